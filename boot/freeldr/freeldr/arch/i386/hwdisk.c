@@ -153,6 +153,10 @@ DiskOpen(CHAR* Path, OPENMODE OpenMode, ULONG* FileId)
     Context->SectorNumber = 0;
     FsSetDeviceSpecific(*FileId, Context);
 
+    /* The media of a floppy may have been changed since it was cached */
+    if (Context->IsFloppy)
+        CacheCheckMediaChange(Context->DriveNumber);
+
     return ESUCCESS;
 }
 
@@ -175,6 +179,16 @@ DiskRead(ULONG FileId, VOID* Buffer, ULONG N, ULONG* Count)
     // In release builds assertions are disabled, however we also have sanity checks in DiskOpen()
     ASSERT(MaxSectors > 0);
 
+    /* Go through the block cache for the small reads of whole sectors */
+    if ((N % Context->SectorSize) == 0 &&
+        CacheIsReadCacheable(Context->DriveNumber, TotalSectors) &&
+        CacheReadDiskSectors(Context->DriveNumber, SectorOffset, TotalSectors, Buffer))
+    {
+        *Count = N;
+        Context->SectorNumber += TotalSectors;
+        return ESUCCESS;
+    }
+
     ret = TRUE;
 
     while (TotalSectors)
@@ -862,11 +862,12 @@ PcDiskGetCacheableBlockCount(UCHAR DriveNumber)
         return 1; // Unknown count.
 
     /*
-     * If LBA is supported then the block size will be 64 sectors (32k).
+     * If LBA is supported then the block size will be 8 sectors (4k),
+     * the cache reads ahead several of them in one transfer.
      * If not then the block size is the size of one track.
      */
     if (DiskDrive->Int13ExtensionsSupported)
-        return 64;
+        return 8;
     else
         return DiskDrive->Geometry.SectorsPerTrack;
 }
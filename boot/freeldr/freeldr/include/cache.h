@@ -23,20 +23,27 @@
 #define TAG_CACHE_DATA 'DcaC'
 #define TAG_CACHE_BLOCK 'BcaC'
 
+#define CACHE_HASH_TABLE_SIZE       256     // Number of buckets of the block hash table, a power of 2
+#define CACHE_READ_AHEAD_BLOCKS     8       // Blocks read past the end of a request that missed the cache
+#define CACHE_MAX_CACHED_READ       16      // Larger reads (in blocks) bypass the cache
+#define CACHE_MAX_DRIVES            4       // Drives cached at the same time
+#define CACHE_SIZE_LIMIT            (4 * 1024 * 1024)   // Cache budget shared by all drives, in bytes
+
 ///////////////////////////////////////////////////////////////////////////////////////
 //
 // This structure describes a cached block element. The disk is divided up into
 // cache blocks. For disks which LBA is not supported each block is the size of
 // one track. This will force the cache manager to make track sized reads, and
 // therefore maximizes throughput. For disks which support LBA the block size
-// is 64k because they have no cylinder, head, or sector boundaries.
+// is 4k, and consecutive blocks are read ahead together in a single transfer.
 //
 ///////////////////////////////////////////////////////////////////////////////////////
 typedef struct
 {
     LIST_ENTRY    ListEntry;                    // Doubly linked list synchronization member
+    LIST_ENTRY    HashListEntry;                // Entry in the hash bucket of the block number
 
-    ULONG            BlockNumber;                // Track index for CHS, 64k block index for LBA
+    ULONG            BlockNumber;                // Track index for CHS, 4k block index for LBA
     BOOLEAN        LockedInCache;                // Indicates that this block is locked in cache memory
     ULONG            AccessCount;                // Access count for this block
 
@@ -53,11 +60,15 @@ typedef struct
 ///////////////////////////////////////////////////////////////////////////////////////
 typedef struct
 {
+    BOOLEAN            Initialized;            // This entry caches a drive
+    BOOLEAN            DataInvalid;            // The cached blocks must be discarded before the next use
     UCHAR            DriveNumber;
     ULONG            BytesPerSector;
+    ULONG            LastUsed;            // Value of CacheUseCount when this drive was last read
 
     ULONG            BlockSize;            // Block size (in sectors)
-    LIST_ENTRY        CacheBlockHead;            // Contains CACHE_BLOCK structures
+    LIST_ENTRY        CacheBlockHead;            // Contains CACHE_BLOCK structures, most recently used first
+    LIST_ENTRY        CacheBlockHashTable[CACHE_HASH_TABLE_SIZE];    // Contains CACHE_BLOCK structures, by block number
 
 } CACHE_DRIVE, *PCACHE_DRIVE;
 
@@ -67,28 +78,36 @@ typedef struct
 // Internal data
 //
 ///////////////////////////////////////////////////////////////////////////////////////
-extern    CACHE_DRIVE        CacheManagerDrive;
-extern    BOOLEAN            CacheManagerInitialized;
+extern    CACHE_DRIVE        CacheManagerDrives[CACHE_MAX_DRIVES];
+extern    ULONG                CacheUseCount;
 extern    ULONG                CacheBlockCount;
 extern    SIZE_T                CacheSizeLimit;
 extern    SIZE_T                CacheSizeCurrent;
+extern    ULONG                CacheHitCount;
+extern    ULONG                CacheMissCount;
+extern    ULONG                CacheTransferCount;
+extern    ULONG                CacheReadAheadCount;
 
 ///////////////////////////////////////////////////////////////////////////////////////
 //
 // Internal functions
 //
 ///////////////////////////////////////////////////////////////////////////////////////
-PCACHE_BLOCK    CacheInternalGetBlockPointer(PCACHE_DRIVE CacheDrive, ULONG BlockNumber);                // Returns a pointer to a CACHE_BLOCK structure given a block number
-PCACHE_BLOCK    CacheInternalFindBlock(PCACHE_DRIVE CacheDrive, ULONG BlockNumber);                    // Searches the block list for a particular block
-PCACHE_BLOCK    CacheInternalAddBlockToCache(PCACHE_DRIVE CacheDrive, ULONG BlockNumber);                // Adds a block to the cache's block list
+PCACHE_DRIVE    CacheInternalFindDrive(UCHAR DriveNumber);                                            // Returns the cache of a drive, if it has one
+VOID            CacheInternalFreeDrive(PCACHE_DRIVE CacheDrive);                                    // Frees all the cached blocks of a drive
+PCACHE_BLOCK    CacheInternalGetBlockPointer(PCACHE_DRIVE CacheDrive, ULONG BlockNumber, ULONG ReadAheadCount);    // Returns a pointer to a CACHE_BLOCK structure given a block number
+PCACHE_BLOCK    CacheInternalFindBlock(PCACHE_DRIVE CacheDrive, ULONG BlockNumber);                    // Searches the block hash table for a particular block
+PCACHE_BLOCK    CacheInternalAddBlocksToCache(PCACHE_DRIVE CacheDrive, ULONG BlockNumber, ULONG BlockCount);    // Reads consecutive blocks in one transfer and adds them to the cache's block list
 BOOLEAN            CacheInternalFreeBlock(PCACHE_DRIVE CacheDrive);                                    // Removes a block from the cache's block list & frees the memory
-VOID            CacheInternalCheckCacheSizeLimits(PCACHE_DRIVE CacheDrive);                            // Checks the cache size limits to see if we can add a new block, if not calls CacheInternalFreeBlock()
+VOID            CacheInternalCheckCacheSizeLimits(PCACHE_DRIVE CacheDrive, ULONG BlockCount);            // Checks the cache size limits to see if we can add new blocks, if not frees blocks of this drive, then of the others
 VOID            CacheInternalDumpBlockList(PCACHE_DRIVE CacheDrive);                                // Dumps the list of cached blocks to the debug output port
 VOID            CacheInternalOptimizeBlockList(PCACHE_DRIVE CacheDrive, PCACHE_BLOCK CacheBlock);    // Moves the specified block to the head of the list
 
 
 BOOLEAN    CacheInitializeDrive(UCHAR DriveNumber);
 VOID    CacheInvalidateCacheData(VOID);
+VOID    CacheCheckMediaChange(UCHAR DriveNumber);
 BOOLEAN    CacheReadDiskSectors(UCHAR DiskNumber, ULONGLONG StartSector, ULONG SectorCount, PVOID Buffer);
+BOOLEAN    CacheIsReadCacheable(UCHAR DiskNumber, ULONG SectorCount);
 BOOLEAN    CacheForceDiskSectorsIntoCache(UCHAR DiskNumber, ULONGLONG StartSector, ULONG SectorCount);
 BOOLEAN    CacheReleaseMemory(ULONG MinimumAmountToRelease);
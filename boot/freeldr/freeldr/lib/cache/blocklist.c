@@ -25,11 +25,13 @@ DBG_DEFAULT_CHANNEL(CACHE);
 // Returns a pointer to a CACHE_BLOCK structure
 // Adds the block to the cache manager block list
 // in cache memory if it isn't already there
-PCACHE_BLOCK CacheInternalGetBlockPointer(PCACHE_DRIVE CacheDrive, ULONG BlockNumber)
+PCACHE_BLOCK CacheInternalGetBlockPointer(PCACHE_DRIVE CacheDrive, ULONG BlockNumber, ULONG ReadAheadCount)
 {
     PCACHE_BLOCK    CacheBlock = NULL;
+    ULONG            BlockCount;
+    ULONG            MaxBlockCount;
 
-    TRACE("CacheInternalGetBlockPointer() BlockNumber = %d\n", BlockNumber);
+    TRACE("CacheInternalGetBlockPointer() BlockNumber = %d ReadAheadCount = %d\n", BlockNumber, ReadAheadCount);
 
     CacheBlock = CacheInternalFindBlock(CacheDrive, BlockNumber);
 
@@ -37,105 +39,138 @@ PCACHE_BLOCK CacheInternalGetBlockPointer(PCACHE_DRIVE CacheDrive, ULONG BlockNu
     {
         TRACE("Cache hit! BlockNumber: %d CacheBlock->BlockNumber: %d\n", BlockNumber, CacheBlock->BlockNumber);
 
+        CacheHitCount++;
+
+        // Optimize the block list so it has a LRU structure
+        CacheInternalOptimizeBlockList(CacheDrive, CacheBlock);
+
         return CacheBlock;
     }
 
     TRACE("Cache miss! BlockNumber: %d\n", BlockNumber);
 
-    CacheBlock = CacheInternalAddBlockToCache(CacheDrive, BlockNumber);
+    CacheMissCount++;
+
+    // Read the following blocks in the same transfer, as long as
+    // they aren't cached yet and fit in the disk read buffer
+    MaxBlockCount = (ULONG)(DiskReadBufferSize / (CacheDrive->BlockSize * CacheDrive->BytesPerSector));
+    MaxBlockCount = min(MaxBlockCount, ReadAheadCount);
 
-    // Optimize the block list so it has a LRU structure
-    CacheInternalOptimizeBlockList(CacheDrive, CacheBlock);
+    for (BlockCount = 1; BlockCount < MaxBlockCount; BlockCount++)
+    {
+        if (CacheInternalFindBlock(CacheDrive, BlockNumber + BlockCount) != NULL)
+        {
+            break;
+        }
+    }
+
+    CacheBlock = CacheInternalAddBlocksToCache(CacheDrive, BlockNumber, BlockCount);
+
+    // The read ahead may go past the end of the disk, retry without it
+    if (CacheBlock == NULL && BlockCount > 1)
+    {
+        CacheBlock = CacheInternalAddBlocksToCache(CacheDrive, BlockNumber, 1);
+    }
 
     return CacheBlock;
 }
 
 PCACHE_BLOCK CacheInternalFindBlock(PCACHE_DRIVE CacheDrive, ULONG BlockNumber)
 {
-    PCACHE_BLOCK    CacheBlock = NULL;
+    PLIST_ENTRY        HashHead;
+    PLIST_ENTRY        Entry;
+    PCACHE_BLOCK    CacheBlock;
 
     TRACE("CacheInternalFindBlock() BlockNumber = %d\n", BlockNumber);
 
     //
-    // Make sure the block list has entries before I start searching it.
+    // Search the hash bucket of this block number
     //
-    if (!IsListEmpty(&CacheDrive->CacheBlockHead))
+    HashHead = &CacheDrive->CacheBlockHashTable[BlockNumber & (CACHE_HASH_TABLE_SIZE - 1)];
+
+    for (Entry = HashHead->Flink; Entry != HashHead; Entry = Entry->Flink)
     {
+        CacheBlock = CONTAINING_RECORD(Entry, CACHE_BLOCK, HashListEntry);
+
         //
-        // Search the list and find the BIOS drive number
+        // We found the block, so return it
         //
-        CacheBlock = CONTAINING_RECORD(CacheDrive->CacheBlockHead.Flink, CACHE_BLOCK, ListEntry);
-
-        while (&CacheBlock->ListEntry != &CacheDrive->CacheBlockHead)
+        if (CacheBlock->BlockNumber == BlockNumber)
         {
             //
-            // We found the block, so return it
+            // Increment the blocks access count
             //
-            if (CacheBlock->BlockNumber == BlockNumber)
-            {
-                //
-                // Increment the blocks access count
-                //
-                CacheBlock->AccessCount++;
+            CacheBlock->AccessCount++;
 
-                return CacheBlock;
-            }
-
-            CacheBlock = CONTAINING_RECORD(CacheBlock->ListEntry.Flink, CACHE_BLOCK, ListEntry);
+            return CacheBlock;
         }
     }
 
     return NULL;
 }
 
-PCACHE_BLOCK CacheInternalAddBlockToCache(PCACHE_DRIVE CacheDrive, ULONG BlockNumber)
+PCACHE_BLOCK CacheInternalAddBlocksToCache(PCACHE_DRIVE CacheDrive, ULONG BlockNumber, ULONG BlockCount)
 {
     PCACHE_BLOCK    CacheBlock = NULL;
+    ULONG            BlockBytes = CacheDrive->BlockSize * CacheDrive->BytesPerSector;
+    ULONG            Idx;
 
-    TRACE("CacheInternalAddBlockToCache() BlockNumber = %d\n", BlockNumber);
+    TRACE("CacheInternalAddBlocksToCache() BlockNumber = %d BlockCount = %d\n", BlockNumber, BlockCount);
 
-    // Check the size of the cache so we don't exceed our limits
-    CacheInternalCheckCacheSizeLimits(CacheDrive);
+    ASSERT(BlockCount > 0 && BlockCount * BlockBytes <= DiskReadBufferSize);
 
-    // We will need to add the block to the
-    // drive's list of cached blocks. So allocate
-    // the block memory.
-    CacheBlock = FrLdrTempAlloc(sizeof(CACHE_BLOCK), TAG_CACHE_BLOCK);
-    if (CacheBlock == NULL)
+    // Now try to read in the blocks
+    if (!MachDiskReadLogicalSectors(CacheDrive->DriveNumber, ((ULONGLONG)BlockNumber * CacheDrive->BlockSize), BlockCount * CacheDrive->BlockSize, DiskReadBuffer))
     {
         return NULL;
     }
 
-    // Now initialize the structure and
-    // allocate room for the block data
-    RtlZeroMemory(CacheBlock, sizeof(CACHE_BLOCK));
-    CacheBlock->BlockNumber = BlockNumber;
-    CacheBlock->BlockData = FrLdrTempAlloc(CacheDrive->BlockSize * CacheDrive->BytesPerSector,
-                                           TAG_CACHE_DATA);
-    if (CacheBlock->BlockData ==NULL)
-    {
-        FrLdrTempFree(CacheBlock, TAG_CACHE_BLOCK);
-        return NULL;
-    }
+    CacheTransferCount++;
+    CacheReadAheadCount += BlockCount - 1;
+
+    // Check the size of the cache so we don't exceed our limits
+    CacheInternalCheckCacheSizeLimits(CacheDrive, BlockCount);
 
-    // Now try to read in the block
-    if (!MachDiskReadLogicalSectors(CacheDrive->DriveNumber, (BlockNumber * CacheDrive->BlockSize), CacheDrive->BlockSize, DiskReadBuffer))
+    // Add the blocks from the last one, so that the one which
+    // was asked for ends up at the head of the LRU list
+    for (Idx = BlockCount; Idx-- > 0; )
     {
-        FrLdrTempFree(CacheBlock->BlockData, TAG_CACHE_DATA);
-        FrLdrTempFree(CacheBlock, TAG_CACHE_BLOCK);
-        return NULL;
-    }
-    RtlCopyMemory(CacheBlock->BlockData, DiskReadBuffer, CacheDrive->BlockSize * CacheDrive->BytesPerSector);
+        // We will need to add the block to the
+        // drive's list of cached blocks. So allocate
+        // the block memory.
+        CacheBlock = FrLdrTempAlloc(sizeof(CACHE_BLOCK), TAG_CACHE_BLOCK);
+        if (CacheBlock == NULL)
+        {
+            continue;
+        }
 
-    // Add it to our list of blocks managed by the cache
-    InsertTailList(&CacheDrive->CacheBlockHead, &CacheBlock->ListEntry);
+        // Now initialize the structure and
+        // allocate room for the block data
+        RtlZeroMemory(CacheBlock, sizeof(CACHE_BLOCK));
+        CacheBlock->BlockNumber = BlockNumber + Idx;
+        CacheBlock->BlockData = FrLdrTempAlloc(BlockBytes, TAG_CACHE_DATA);
+        if (CacheBlock->BlockData == NULL)
+        {
+            FrLdrTempFree(CacheBlock, TAG_CACHE_BLOCK);
+            CacheBlock = NULL;
+            continue;
+        }
 
-    // Update the cache data
-    CacheBlockCount++;
-    CacheSizeCurrent = CacheBlockCount * (CacheDrive->BlockSize * CacheDrive->BytesPerSector);
+        RtlCopyMemory(CacheBlock->BlockData, (PUCHAR)DiskReadBuffer + Idx * BlockBytes, BlockBytes);
+
+        // Add it to our list of blocks managed by the cache
+        InsertHeadList(&CacheDrive->CacheBlockHead, &CacheBlock->ListEntry);
+        InsertHeadList(&CacheDrive->CacheBlockHashTable[CacheBlock->BlockNumber & (CACHE_HASH_TABLE_SIZE - 1)],
+                       &CacheBlock->HashListEntry);
+
+        // Update the cache data
+        CacheBlockCount++;
+        CacheSizeCurrent += BlockBytes;
+    }
 
     CacheInternalDumpBlockList(CacheDrive);
 
+    // This is the block which was asked for, if it could be allocated
     return CacheBlock;
 }
 
@@ -156,12 +191,13 @@ BOOLEAN CacheInternalFreeBlock(PCACHE_DRIVE CacheDrive)
 
     // No blocks left in cache that can be freed
     // so just return
-    if (IsListEmpty(&CacheDrive->CacheBlockHead))
+    if (&CacheBlockToFree->ListEntry == &CacheDrive->CacheBlockHead)
     {
         return FALSE;
     }
 
     RemoveEntryList(&CacheBlockToFree->ListEntry);
+    RemoveEntryList(&CacheBlockToFree->HashListEntry);
 
     // Free the block memory and the block structure
     FrLdrTempFree(CacheBlockToFree->BlockData, TAG_CACHE_DATA);
@@ -169,25 +205,39 @@ BOOLEAN CacheInternalFreeBlock(PCACHE_DRIVE CacheDrive)
 
     // Update the cache data
     CacheBlockCount--;
-    CacheSizeCurrent = CacheBlockCount * (CacheDrive->BlockSize * CacheDrive->BytesPerSector);
+    CacheSizeCurrent -= CacheDrive->BlockSize * CacheDrive->BytesPerSector;
 
     return TRUE;
 }
 
-VOID CacheInternalCheckCacheSizeLimits(PCACHE_DRIVE CacheDrive)
+VOID CacheInternalCheckCacheSizeLimits(PCACHE_DRIVE CacheDrive, ULONG BlockCount)
 {
     SIZE_T        NewCacheSize;
+    ULONG        Idx = 0;
 
     TRACE("CacheInternalCheckCacheSizeLimits()\n");
 
-    // Calculate the size of the cache if we added a block
-    NewCacheSize = (CacheBlockCount + 1) * (CacheDrive->BlockSize * CacheDrive->BytesPerSector);
+    // Calculate the size of the cache once we added the blocks
+    NewCacheSize = BlockCount * (CacheDrive->BlockSize * CacheDrive->BytesPerSector);
 
-    // Check the new size against the cache size limit
-    if (NewCacheSize > CacheSizeLimit)
+    // Free blocks of this drive first, then of the other ones
+    while (CacheSizeCurrent + NewCacheSize > CacheSizeLimit)
     {
-        CacheInternalFreeBlock(CacheDrive);
-        CacheInternalDumpBlockList(CacheDrive);
+        if (CacheInternalFreeBlock(CacheDrive))
+        {
+            CacheInternalDumpBlockList(CacheDrive);
+            continue;
+        }
+
+        // Nothing left to free in this drive, go on with the next one
+        do
+        {
+            if (Idx == CACHE_MAX_DRIVES)
+            {
+                return;
+            }
+            CacheDrive = &CacheManagerDrives[Idx++];
+        } while (!CacheDrive->Initialized);
     }
 }
 
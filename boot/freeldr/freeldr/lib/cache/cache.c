@@ -27,79 +27,145 @@ DBG_DEFAULT_CHANNEL(CACHE);
 // Internal data
 //
 ///////////////////////////////////////////////////////////////////////////////////////
-CACHE_DRIVE        CacheManagerDrive;
-BOOLEAN            CacheManagerInitialized = FALSE;
-BOOLEAN            CacheManagerDataInvalid = FALSE;
+CACHE_DRIVE        CacheManagerDrives[CACHE_MAX_DRIVES];
+ULONG            CacheUseCount = 0;
 ULONG            CacheBlockCount = 0;
 SIZE_T            CacheSizeLimit = 0;
 SIZE_T            CacheSizeCurrent = 0;
+ULONG            CacheHitCount = 0;
+ULONG            CacheMissCount = 0;
+ULONG            CacheTransferCount = 0;
+ULONG            CacheReadAheadCount = 0;
 
-BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
+PCACHE_DRIVE CacheInternalFindDrive(UCHAR DriveNumber)
+{
+    ULONG        Idx;
+
+    for (Idx = 0; Idx < CACHE_MAX_DRIVES; Idx++)
+    {
+        if (CacheManagerDrives[Idx].Initialized &&
+            CacheManagerDrives[Idx].DriveNumber == DriveNumber)
+        {
+            return &CacheManagerDrives[Idx];
+        }
+    }
+
+    return NULL;
+}
+
+VOID CacheInternalFreeDrive(PCACHE_DRIVE CacheDrive)
 {
     PCACHE_BLOCK    NextCacheBlock;
+    ULONG        BlockBytes = CacheDrive->BlockSize * CacheDrive->BytesPerSector;
+
+    TRACE("Freeing the cache of BIOS drive 0x%x.\n", CacheDrive->DriveNumber);
+    TRACE("CacheBlockCount: %d\n", CacheBlockCount);
+    TRACE("CacheSizeCurrent: %d\n", CacheSizeCurrent);
+    TRACE("CacheHitCount: %d CacheMissCount: %d\n", CacheHitCount, CacheMissCount);
+
+    //
+    // Loop through and free the cache blocks
+    //
+    while (!IsListEmpty(&CacheDrive->CacheBlockHead))
+    {
+        NextCacheBlock = CONTAINING_RECORD(RemoveHeadList(&CacheDrive->CacheBlockHead),
+                                           CACHE_BLOCK,
+                                           ListEntry);
+        RemoveEntryList(&NextCacheBlock->HashListEntry);
+
+        FrLdrTempFree(NextCacheBlock->BlockData, TAG_CACHE_DATA);
+        FrLdrTempFree(NextCacheBlock, TAG_CACHE_BLOCK);
+
+        CacheBlockCount--;
+        CacheSizeCurrent -= BlockBytes;
+    }
+}
+
+BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
+{
+    PCACHE_DRIVE    CacheDrive;
     GEOMETRY    DriveGeometry;
+    ULONG        Idx;
 
     // If we already have a cache for this drive then
-    // by all means lets keep it, unless it is a removable
-    // drive, in which case we'll invalidate the cache
-    if ((CacheManagerInitialized) &&
-        (DriveNumber == CacheManagerDrive.DriveNumber) &&
-        (DriveNumber >= 0x80) &&
-        (!CacheManagerDataInvalid))
+    // by all means lets keep it, unless it was invalidated
+    CacheDrive = CacheInternalFindDrive(DriveNumber);
+    if (CacheDrive != NULL && !CacheDrive->DataInvalid)
     {
         return TRUE;
     }
 
-    CacheManagerDataInvalid = FALSE;
-
     //
-    // If we have already been initialized then free
-    // the old data
+    // Otherwise take a free entry, or the one of the
+    // drive which was read the longest time ago
     //
-    if (CacheManagerInitialized)
+    if (CacheDrive == NULL)
     {
-        CacheManagerInitialized = FALSE;
-
-        TRACE("CacheBlockCount: %d\n", CacheBlockCount);
-        TRACE("CacheSizeLimit: %d\n", CacheSizeLimit);
-        TRACE("CacheSizeCurrent: %d\n", CacheSizeCurrent);
-        //
-        // Loop through and free the cache blocks
-        //
-        while (!IsListEmpty(&CacheManagerDrive.CacheBlockHead))
+        CacheDrive = &CacheManagerDrives[0];
+        for (Idx = 0; Idx < CACHE_MAX_DRIVES; Idx++)
         {
-            NextCacheBlock = CONTAINING_RECORD(RemoveHeadList(&CacheManagerDrive.CacheBlockHead),
-                                               CACHE_BLOCK,
-                                               ListEntry);
-
-            FrLdrTempFree(NextCacheBlock->BlockData, TAG_CACHE_DATA);
-            FrLdrTempFree(NextCacheBlock, TAG_CACHE_BLOCK);
+            if (!CacheManagerDrives[Idx].Initialized)
+            {
+                CacheDrive = &CacheManagerDrives[Idx];
+                break;
+            }
+
+            if (CacheManagerDrives[Idx].LastUsed < CacheDrive->LastUsed)
+            {
+                CacheDrive = &CacheManagerDrives[Idx];
+            }
         }
     }
 
+    //
+    // If it was already in use then free the old data
+    //
+    if (CacheDrive->Initialized)
+    {
+        CacheInternalFreeDrive(CacheDrive);
+    }
+
     // Initialize the structure
-    RtlZeroMemory(&CacheManagerDrive, sizeof(CACHE_DRIVE));
-    InitializeListHead(&CacheManagerDrive.CacheBlockHead);
-    CacheManagerDrive.DriveNumber = DriveNumber;
+    RtlZeroMemory(CacheDrive, sizeof(CACHE_DRIVE));
+    InitializeListHead(&CacheDrive->CacheBlockHead);
+    for (Idx = 0; Idx < CACHE_HASH_TABLE_SIZE; Idx++)
+    {
+        InitializeListHead(&CacheDrive->CacheBlockHashTable[Idx]);
+    }
+    CacheDrive->DriveNumber = DriveNumber;
     if (!MachDiskGetDriveGeometry(DriveNumber, &DriveGeometry))
     {
         return FALSE;
     }
-    CacheManagerDrive.BytesPerSector = DriveGeometry.BytesPerSector;
+    CacheDrive->BytesPerSector = DriveGeometry.BytesPerSector;
 
     // Get the number of sectors in each cache block
-    CacheManagerDrive.BlockSize = MachDiskGetCacheableBlockCount(DriveNumber);
+    CacheDrive->BlockSize = MachDiskGetCacheableBlockCount(DriveNumber);
 
-    CacheBlockCount = 0;
-    CacheSizeCurrent = 0;
+    // Blocks are read through the disk read buffer, they must fit in it
+    if (CacheDrive->BlockSize * CacheDrive->BytesPerSector > DiskReadBufferSize)
+    {
+        CacheDrive->BlockSize = (ULONG)(DiskReadBufferSize / CacheDrive->BytesPerSector);
+    }
+    if (CacheDrive->BlockSize == 0)
+    {
+        return FALSE;
+    }
+
+    //
+    // The cache lives in the temporary heap, along with everything
+    // else the loader needs while it runs, so it only gets a small
+    // share of it, whatever the amount of memory
+    //
     CacheSizeLimit = TotalPagesInLookupTable / 8 * MM_PAGE_SIZE;
-    CacheSizeLimit = min(CacheSizeLimit, TEMP_HEAP_SIZE - (128 * 1024));
+    CacheSizeLimit = min(CacheSizeLimit, CACHE_SIZE_LIMIT);
 
-    CacheManagerInitialized = TRUE;
+    CacheDrive->LastUsed = CacheUseCount;
+    CacheDrive->Initialized = TRUE;
 
     TRACE("Initializing BIOS drive 0x%x.\n", DriveNumber);
-    TRACE("BytesPerSector: %d.\n", CacheManagerDrive.BytesPerSector);
-    TRACE("BlockSize: %d.\n", CacheManagerDrive.BlockSize);
+    TRACE("BytesPerSector: %d.\n", CacheDrive->BytesPerSector);
+    TRACE("BlockSize: %d.\n", CacheDrive->BlockSize);
     TRACE("CacheSizeLimit: %d.\n", CacheSizeLimit);
 
     return TRUE;
@@ -107,114 +173,97 @@ BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
 
 VOID CacheInvalidateCacheData(VOID)
 {
-    CacheManagerDataInvalid = TRUE;
+    ULONG        Idx;
+
+    for (Idx = 0; Idx < CACHE_MAX_DRIVES; Idx++)
+    {
+        CacheManagerDrives[Idx].DataInvalid = TRUE;
+    }
 }
 
-BOOLEAN CacheReadDiskSectors(UCHAR DiskNumber, ULONGLONG StartSector, ULONG SectorCount, PVOID Buffer)
+VOID CacheCheckMediaChange(UCHAR DriveNumber)
 {
+    PCACHE_DRIVE    CacheDrive;
     PCACHE_BLOCK    CacheBlock;
-    ULONG                StartBlock;
-    ULONG                SectorOffsetInStartBlock;
-    ULONG                CopyLengthInStartBlock;
-    ULONG                EndBlock;
-    ULONG                SectorOffsetInEndBlock;
-    ULONG                BlockCount;
-    ULONG                Idx;
 
-    TRACE("CacheReadDiskSectors() DiskNumber: 0x%x StartSector: %I64u SectorCount: %u Buffer: 0x%x\n", DiskNumber, StartSector, SectorCount, Buffer);
-
-    // If we aren't initialized yet then they can't do this
-    if (CacheManagerInitialized == FALSE)
+    CacheDrive = CacheInternalFindDrive(DriveNumber);
+    if (CacheDrive == NULL || CacheDrive->DataInvalid)
     {
-        return FALSE;
+        return;
     }
 
     //
-    // Calculate which blocks we must cache
+    // Removable media are told apart by their boot sector, which holds
+    // the volume serial number. If we don't have it anymore, we can't
+    // tell, so throw the cache away.
     //
-    StartBlock = (ULONG)(StartSector / CacheManagerDrive.BlockSize);
-    SectorOffsetInStartBlock = (ULONG)(StartSector % CacheManagerDrive.BlockSize);
-    CopyLengthInStartBlock = (ULONG)((SectorCount > (CacheManagerDrive.BlockSize - SectorOffsetInStartBlock)) ? (CacheManagerDrive.BlockSize - SectorOffsetInStartBlock) : SectorCount);
-    EndBlock = (ULONG)((StartSector + (SectorCount - 1)) / CacheManagerDrive.BlockSize);
-    SectorOffsetInEndBlock = (ULONG)(1 + (StartSector + (SectorCount - 1)) % CacheManagerDrive.BlockSize);
-    BlockCount = (EndBlock - StartBlock) + 1;
-    TRACE("StartBlock: %d SectorOffsetInStartBlock: %d CopyLengthInStartBlock: %d EndBlock: %d SectorOffsetInEndBlock: %d BlockCount: %d\n", StartBlock, SectorOffsetInStartBlock, CopyLengthInStartBlock, EndBlock, SectorOffsetInEndBlock, BlockCount);
+    CacheBlock = CacheInternalFindBlock(CacheDrive, 0);
+    if (CacheBlock == NULL ||
+        !MachDiskReadLogicalSectors(DriveNumber, 0, 1, DiskReadBuffer) ||
+        !RtlEqualMemory(CacheBlock->BlockData, DiskReadBuffer, CacheDrive->BytesPerSector))
+    {
+        TRACE("Media of BIOS drive 0x%x may have changed.\n", DriveNumber);
+        CacheDrive->DataInvalid = TRUE;
+    }
+}
 
+BOOLEAN CacheIsReadCacheable(UCHAR DiskNumber, ULONG SectorCount)
+{
     //
-    // Read the first block into the buffer
+    // Small reads are mostly file system metadata, which is read
+    // again and again. Large ones are file data, read only once:
+    // they would only push the metadata out of the cache.
     //
-    if (BlockCount > 0)
+    if (!CacheInitializeDrive(DiskNumber))
     {
-        //
-        // Get cache block pointer (this forces the disk sectors into the cache memory)
-        //
-        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, StartBlock);
-        if (CacheBlock == NULL)
-        {
-            return FALSE;
-        }
+        return FALSE;
+    }
 
-        //
-        // Copy the portion requested into the buffer
-        //
-        RtlCopyMemory(Buffer,
-            (PVOID)((ULONG_PTR)CacheBlock->BlockData + (SectorOffsetInStartBlock * CacheManagerDrive.BytesPerSector)),
-            (CopyLengthInStartBlock * CacheManagerDrive.BytesPerSector));
-        TRACE("1 - RtlCopyMemory(0x%x, 0x%x, %d)\n", Buffer, ((ULONG_PTR)CacheBlock->BlockData + (SectorOffsetInStartBlock * CacheManagerDrive.BytesPerSector)), (CopyLengthInStartBlock * CacheManagerDrive.BytesPerSector));
+    return (SectorCount <= CacheInternalFindDrive(DiskNumber)->BlockSize * CACHE_MAX_CACHED_READ);
+}
 
-        //
-        // Update the buffer address
-        //
-        Buffer = (PVOID)((ULONG_PTR)Buffer + (CopyLengthInStartBlock * CacheManagerDrive.BytesPerSector));
+BOOLEAN CacheReadDiskSectors(UCHAR DiskNumber, ULONGLONG StartSector, ULONG SectorCount, PVOID Buffer)
+{
+    PCACHE_DRIVE    CacheDrive;
+    PCACHE_BLOCK    CacheBlock;
+    ULONG                StartBlock;
+    ULONG                EndBlock;
+    ULONG                SectorOffsetInBlock;
+    ULONG                CopyLengthInBlock;
+    ULONG                Idx;
 
-        //
-        // Update the block count
-        //
-        BlockCount--;
-    }
+    TRACE("CacheReadDiskSectors() DiskNumber: 0x%x StartSector: %I64u SectorCount: %u Buffer: 0x%x\n", DiskNumber, StartSector, SectorCount, Buffer);
 
-    //
-    // Loop through the middle blocks and read them into the buffer
-    //
-    for (Idx=StartBlock+1; BlockCount>1; Idx++)
+    // If we aren't initialized yet then they can't do this
+    CacheDrive = CacheInternalFindDrive(DiskNumber);
+    if (CacheDrive == NULL || CacheDrive->DataInvalid)
     {
-        //
-        // Get cache block pointer (this forces the disk sectors into the cache memory)
-        //
-        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, Idx);
-        if (CacheBlock == NULL)
-        {
-            return FALSE;
-        }
-
-        //
-        // Copy the portion requested into the buffer
-        //
-        RtlCopyMemory(Buffer,
-            CacheBlock->BlockData,
-            CacheManagerDrive.BlockSize * CacheManagerDrive.BytesPerSector);
-        TRACE("2 - RtlCopyMemory(0x%x, 0x%x, %d)\n", Buffer, CacheBlock->BlockData, CacheManagerDrive.BlockSize * CacheManagerDrive.BytesPerSector);
+        return FALSE;
+    }
 
-        //
-        // Update the buffer address
-        //
-        Buffer = (PVOID)((ULONG_PTR)Buffer + (CacheManagerDrive.BlockSize * CacheManagerDrive.BytesPerSector));
+    CacheDrive->LastUsed = ++CacheUseCount;
 
-        //
-        // Update the block count
-        //
-        BlockCount--;
+    if (SectorCount == 0)
+    {
+        return TRUE;
     }
 
     //
-    // Read the last block into the buffer
+    // Calculate which blocks we must cache
     //
-    if (BlockCount > 0)
+    StartBlock = (ULONG)(StartSector / CacheDrive->BlockSize);
+    SectorOffsetInBlock = (ULONG)(StartSector % CacheDrive->BlockSize);
+    EndBlock = (ULONG)((StartSector + (SectorCount - 1)) / CacheDrive->BlockSize);
+    TRACE("StartBlock: %d SectorOffsetInBlock: %d EndBlock: %d\n", StartBlock, SectorOffsetInBlock, EndBlock);
+
+    for (Idx = StartBlock; Idx <= EndBlock; Idx++)
     {
         //
-        // Get cache block pointer (this forces the disk sectors into the cache memory)
+        // Get cache block pointer (this forces the disk sectors into the cache memory).
+        // If it isn't cached yet, the rest of the request and the blocks that follow
+        // are read along with it.
         //
-        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, EndBlock);
+        CacheBlock = CacheInternalGetBlockPointer(CacheDrive, Idx, (EndBlock - Idx) + 1 + CACHE_READ_AHEAD_BLOCKS);
         if (CacheBlock == NULL)
         {
             return FALSE;
@@ -223,20 +272,17 @@ BOOLEAN CacheReadDiskSectors(UCHAR DiskNumber, ULONGLONG StartSector, ULONG Sect
         //
         // Copy the portion requested into the buffer
         //
+        CopyLengthInBlock = min(CacheDrive->BlockSize - SectorOffsetInBlock, SectorCount);
         RtlCopyMemory(Buffer,
-            CacheBlock->BlockData,
-            SectorOffsetInEndBlock * CacheManagerDrive.BytesPerSector);
-        TRACE("3 - RtlCopyMemory(0x%x, 0x%x, %d)\n", Buffer, CacheBlock->BlockData, SectorOffsetInEndBlock * CacheManagerDrive.BytesPerSector);
-
-        //
-        // Update the buffer address
-        //
-        Buffer = (PVOID)((ULONG_PTR)Buffer + (SectorOffsetInEndBlock * CacheManagerDrive.BytesPerSector));
+            (PVOID)((ULONG_PTR)CacheBlock->BlockData + (SectorOffsetInBlock * CacheDrive->BytesPerSector)),
+            (CopyLengthInBlock * CacheDrive->BytesPerSector));
 
         //
-        // Update the block count
+        // Update the buffer address and the sector count
         //
-        BlockCount--;
+        Buffer = (PVOID)((ULONG_PTR)Buffer + (CopyLengthInBlock * CacheDrive->BytesPerSector));
+        SectorCount -= CopyLengthInBlock;
+        SectorOffsetInBlock = 0;
     }
 
     return TRUE;
@@ -245,6 +291,7 @@ BOOLEAN CacheReadDiskSectors(UCHAR DiskNumber, ULONGLONG StartSector, ULONG Sect
 #if 0
 BOOLEAN CacheForceDiskSectorsIntoCache(UCHAR DiskNumber, ULONGLONG StartSector, ULONG SectorCount)
 {
+    PCACHE_DRIVE    CacheDrive;
     PCACHE_BLOCK    CacheBlock;
     ULONG                StartBlock;
     ULONG                EndBlock;
@@ -254,7 +301,8 @@ BOOLEAN CacheForceDiskSectorsIntoCache(UCHAR DiskNumber, ULONGLONG StartSector,
     TRACE("CacheForceDiskSectorsIntoCache() DiskNumber: 0x%x StartSector: %d SectorCount: %d\n", DiskNumber, StartSector, SectorCount);
 
     // If we aren't initialized yet then they can't do this
-    if (CacheManagerInitialized == FALSE)
+    CacheDrive = CacheInternalFindDrive(DiskNumber);
+    if (CacheDrive == NULL)
     {
         return FALSE;
     }
@@ -262,8 +310,8 @@ BOOLEAN CacheForceDiskSectorsIntoCache(UCHAR DiskNumber, ULONGLONG StartSector,
     //
     // Calculate which blocks we must cache
     //
-    StartBlock = StartSector / CacheManagerDrive.BlockSize;
-    EndBlock = (StartSector + SectorCount) / CacheManagerDrive.BlockSize;
+    StartBlock = StartSector / CacheDrive->BlockSize;
+    EndBlock = (StartSector + SectorCount) / CacheDrive->BlockSize;
     BlockCount = (EndBlock - StartBlock) + 1;
 
     //
@@ -274,7 +322,7 @@ BOOLEAN CacheForceDiskSectorsIntoCache(UCHAR DiskNumber, ULONGLONG StartSector,
         //
         // Get cache block pointer (this forces the disk sectors into the cache memory)
         //
-        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, Idx);
+        CacheBlock = CacheInternalGetBlockPointer(CacheDrive, Idx, 1);
         if (CacheBlock == NULL)
         {
             return FALSE;
@@ -292,28 +340,35 @@ BOOLEAN CacheForceDiskSectorsIntoCache(UCHAR DiskNumber, ULONGLONG StartSector,
 
 BOOLEAN CacheReleaseMemory(ULONG MinimumAmountToRelease)
 {
-    ULONG                AmountReleased;
+    PCACHE_DRIVE        CacheDrive;
+    ULONG                AmountReleased = 0;
+    ULONG                Idx;
 
     TRACE("CacheReleaseMemory() MinimumAmountToRelease = %d\n", MinimumAmountToRelease);
 
-    // If we aren't initialized yet then they can't do this
-    if (CacheManagerInitialized == FALSE)
+    // Loop through the drives and try to free the requested amount of memory
+    for (Idx = 0; Idx < CACHE_MAX_DRIVES && AmountReleased < MinimumAmountToRelease; Idx++)
     {
-        return FALSE;
-    }
+        CacheDrive = &CacheManagerDrives[Idx];
 
-    // Loop through and try to free the requested amount of memory
-    for (AmountReleased=0; AmountReleased<MinimumAmountToRelease; )
-    {
-        // Try to free a block
-        // If this fails then break out of the loop
-        if (!CacheInternalFreeBlock(&CacheManagerDrive))
+        // If we aren't initialized yet then there is nothing to free
+        if (!CacheDrive->Initialized)
         {
-            break;
+            continue;
         }
 
-        // It succeeded so increment the amount of memory we have freed
-        AmountReleased += CacheManagerDrive.BlockSize * CacheManagerDrive.BytesPerSector;
+        while (AmountReleased < MinimumAmountToRelease)
+        {
+            // Try to free a block
+            // If this fails then go on with the next drive
+            if (!CacheInternalFreeBlock(CacheDrive))
+            {
+                break;
+            }
+
+            // It succeeded so increment the amount of memory we have freed
+            AmountReleased += CacheDrive->BlockSize * CacheDrive->BytesPerSector;
+        }
     }
 
     // Return status
@@ -36,6 +36,7 @@ BOOLEAN    ExtReadSuperBlock(PEXT_VOLUME_INFO Volume);
 BOOLEAN    ExtReadGroupDescriptors(PEXT_VOLUME_INFO Volume);
 BOOLEAN    ExtReadDirectory(PEXT_VOLUME_INFO Volume, ULONG Inode, PVOID* DirectoryBuffer, PEXT_INODE InodePointer);
 BOOLEAN    ExtReadBlock(PEXT_VOLUME_INFO Volume, ULONG BlockNumber, PVOID Buffer);
+BOOLEAN    ExtReadAdjacentBlocks(PEXT_VOLUME_INFO Volume, ULONG BlockNumber, ULONG BlockCount, PVOID Buffer);
 BOOLEAN    ExtReadPartialBlock(PEXT_VOLUME_INFO Volume, ULONG BlockNumber, ULONG StartingOffset, ULONG Length, PVOID Buffer);
 BOOLEAN    ExtReadInode(PEXT_VOLUME_INFO Volume, ULONG Inode, PEXT_INODE InodeBuffer);
 BOOLEAN    ExtReadGroupDescriptor(PEXT_VOLUME_INFO Volume, ULONG Group, PEXT_GROUP_DESC GroupBuffer);
@@ -392,6 +393,7 @@ BOOLEAN ExtReadFileBig(PEXT_FILE_INFO ExtFileInfo, ULONGLONG BytesToRead, ULONGL
     ULONG                OffsetInBlock;
     ULONG                LengthInBlock;
     ULONG                NumberOfBlocks;
+    ULONG                AdjacentBlocks;
 
     TRACE("ExtReadFileBig() BytesToRead = %d Buffer = 0x%x\n", (ULONG)BytesToRead, Buffer);
 
@@ -523,21 +525,35 @@ BOOLEAN ExtReadFileBig(PEXT_FILE_INFO ExtFileInfo, ULONGLONG BytesToRead, ULONGL
             BlockNumberIndex = (ULONG)(ExtFileInfo->FilePointer / Volume->BlockSizeInBytes);
             BlockNumber = ExtFileInfo->FileBlockList[BlockNumberIndex];
 
+            //
+            // Get the number of blocks which are adjacent on the disk,
+            // so that they are read all at once
+            //
+            AdjacentBlocks = 1;
+            if (BlockNumber != 0)
+            {
+                while (AdjacentBlocks < NumberOfBlocks &&
+                       ExtFileInfo->FileBlockList[BlockNumberIndex + AdjacentBlocks] == BlockNumber + AdjacentBlocks)
+                {
+                    AdjacentBlocks++;
+                }
+            }
+
             //
             // Now do the read and update BytesRead, BytesToRead, FilePointer, & Buffer
             //
-            if (!ExtReadBlock(Volume, BlockNumber, Buffer))
+            if (!ExtReadAdjacentBlocks(Volume, BlockNumber, AdjacentBlocks, Buffer))
             {
                 return FALSE;
             }
             if (BytesRead != NULL)
             {
-                *BytesRead += Volume->BlockSizeInBytes;
+                *BytesRead += AdjacentBlocks * Volume->BlockSizeInBytes;
             }
-            BytesToRead -= Volume->BlockSizeInBytes;
-            ExtFileInfo->FilePointer += Volume->BlockSizeInBytes;
-            Buffer = (PVOID)((ULONG_PTR)Buffer + Volume->BlockSizeInBytes);
-            NumberOfBlocks--;
+            BytesToRead -= AdjacentBlocks * Volume->BlockSizeInBytes;
+            ExtFileInfo->FilePointer += AdjacentBlocks * Volume->BlockSizeInBytes;
+            Buffer = (PVOID)((ULONG_PTR)Buffer + AdjacentBlocks * Volume->BlockSizeInBytes);
+            NumberOfBlocks -= AdjacentBlocks;
         }
     }
 
@@ -897,6 +913,33 @@ BOOLEAN ExtReadBlock(PEXT_VOLUME_INFO Volume, ULONG BlockNumber, PVOID Buffer)
     return ExtReadVolumeSectors(Volume, (ULONGLONG)BlockNumber * Volume->BlockSizeInSectors, Volume->BlockSizeInSectors, Buffer);
 }
 
+/*
+ * ExtReadAdjacentBlocks()
+ * Reads consecutive blocks of the volume in a single transfer
+ */
+BOOLEAN ExtReadAdjacentBlocks(PEXT_VOLUME_INFO Volume, ULONG BlockNumber, ULONG BlockCount, PVOID Buffer)
+{
+    CHAR    ErrorString[80];
+
+    TRACE("ExtReadAdjacentBlocks() BlockNumber = %d BlockCount = %d Buffer = 0x%x\n", BlockNumber, BlockCount, Buffer);
+
+    // Sparse blocks are never adjacent to anything
+    if (BlockCount == 1)
+    {
+        return ExtReadBlock(Volume, BlockNumber, Buffer);
+    }
+
+    // Make sure they are valid blocks
+    if (BlockNumber + BlockCount - 1 > Volume->SuperBlock->BlocksCountLo)
+    {
+        sprintf(ErrorString, "Error reading block %d - block out of range.", (int) (BlockNumber + BlockCount - 1));
+        FileSystemError(ErrorString);
+        return FALSE;
+    }
+
+    return ExtReadVolumeSectors(Volume, (ULONGLONG)BlockNumber * Volume->BlockSizeInSectors, BlockCount * Volume->BlockSizeInSectors, Buffer);
+}
+
 /*
  * ExtReadPartialBlock()
  * Reads part of a block into memory
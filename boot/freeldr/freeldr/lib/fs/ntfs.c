@@ -231,6 +231,9 @@ static ULONG NtfsReadAttribute(PNTFS_VOLUME_INFO Volume, PNTFS_ATTR_CONTEXT Cont
     ULONGLONG CurrentOffset;
     ULONG ReadLength;
     ULONG AlreadyRead;
+    PUCHAR NextDataRun;
+    LONGLONG NextDataRunOffset;
+    ULONGLONG NextDataRunLength;
 
     if (!Context->Record.IsNonResident)
     {
@@ -326,6 +329,26 @@ static ULONG NtfsReadAttribute(PNTFS_VOLUME_INFO Volume, PNTFS_ATTR_CONTEXT Cont
 
         while (Length > 0)
         {
+            /*
+             * Merge the following runs which continue this one on the disk,
+             * so that they are read all at once.
+             */
+            while (DataRunStartLCN != -1 &&
+                   DataRunLength * Volume->ClusterSize < Length &&
+                   *DataRun != 0)
+            {
+                NextDataRun = NtfsDecodeRun(DataRun, &NextDataRunOffset, &NextDataRunLength);
+                if (NextDataRunOffset == -1 ||
+                    LastLCN + NextDataRunOffset != DataRunStartLCN + DataRunLength)
+                {
+                    break;
+                }
+
+                DataRun = NextDataRun;
+                LastLCN += NextDataRunOffset;
+                DataRunLength += NextDataRunLength;
+            }
+
             ReadLength = (ULONG)min(DataRunLength * Volume->ClusterSize, Length);
             if (DataRunStartLCN == -1)
                 RtlZeroMemory(Buffer, ReadLength);
@@ -45,6 +45,7 @@ SetupLdrLoadNlsData(
     UNICODE_STRING OemFileName = {0};
     UNICODE_STRING LangFileName = {0}; // CaseTable
     UNICODE_STRING OemHalFileName = {0};
+    ULONGLONG PhaseStart;
 
     /* Get ANSI codepage file */
     if (!InfFindFirstLine(InfHandle, "NLS", "AnsiCodepage", &InfContext) ||
@@ -87,12 +88,14 @@ SetupLdrLoadNlsData(
           &AnsiFileName, &OemFileName, &LangFileName, &OemHalFileName);
 
     /* Load NLS data */
+    PhaseStart = WinLdrBeginBootPhase();
     Success = WinLdrLoadNLSData(LoaderBlock,
                                 SearchPath,
                                 &AnsiFileName,
                                 &OemFileName,
                                 &LangFileName,
                                 &OemHalFileName);
+    WinLdrEndBootPhase(WinLdrPhaseNlsData, PhaseStart);
     TRACE("NLS data loading %s\n", Success ? "successful" : "failed");
     (VOID)Success;
 
@@ -36,6 +36,10 @@ BOOLEAN PaeModeOn = FALSE;
 #endif
 BOOLEAN NoExecuteEnabled = FALSE;
 
+#if DBG && !defined(_M_ARM)
+static ULONGLONG WinLdrBootPhaseTime[WinLdrPhaseMax];
+#endif
+
 // debug stuff
 VOID DumpMemoryAllocMap(VOID);
 
@@ -1184,6 +1188,7 @@ LoadAndBootWindowsCommon(
     PLDR_DATA_TABLE_ENTRY KernelDTE;
     KERNEL_ENTRY_POINT KiSystemStartup;
     PCSTR SystemRoot;
+    ULONGLONG PhaseStart;
 
     TRACE("LoadAndBootWindowsCommon()\n");
 
@@ -1206,11 +1211,13 @@ LoadAndBootWindowsCommon(
     PeLdrImportDllLoadCallback = NtLdrImportDllLoadCallback;
 
     /* Load the operating system core: the Kernel, the HAL and the Kernel Debugger Transport DLL */
+    PhaseStart = WinLdrBeginBootPhase();
     Success = LoadWindowsCore(OperatingSystemVersion,
                               LoaderBlock,
                               BootOptions,
                               BootPath,
                               &KernelDTE);
+    WinLdrEndBootPhase(WinLdrPhaseCore, PhaseStart);
     if (!Success)
     {
         /* Reset the PE loader import-DLL callback */
@@ -1231,7 +1238,9 @@ LoadAndBootWindowsCommon(
 
     /* Load boot drivers */
     UiSetProgressBarText("Loading boot drivers...");
+    PhaseStart = WinLdrBeginBootPhase();
     Success = WinLdrLoadBootDrivers(LoaderBlock, BootPath);
+    WinLdrEndBootPhase(WinLdrPhaseBootDrivers, PhaseStart);
     TRACE("Boot drivers loading %s\n", Success ? "successful" : "failed");
 
     UiSetProgressBarSubset(0, 100);
@@ -1308,6 +1317,7 @@ LoadAndBootWindowsCommon(
 #ifndef _M_AMD64
     WinLdrpDumpArcDisks(LoaderBlockVA);
 #endif
+    WinLdrpDumpBootPhases();
 
     /* Pass control */
     (*KiSystemStartup)(LoaderBlockVA);
@@ -1371,3 +1381,38 @@ WinLdrpDumpArcDisks(PLOADER_PARAMETER_BLOCK LoaderBlock)
         NextBd = ArcDisk->ListEntry.Flink;
     }
 }
+
+ULONGLONG
+WinLdrBeginBootPhase(VOID)
+{
+#if DBG && !defined(_M_ARM)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+VOID
+WinLdrEndBootPhase(
+    _In_ WINLDR_BOOT_PHASE Phase,
+    _In_ ULONGLONG StartTime)
+{
+#if DBG && !defined(_M_ARM)
+    WinLdrBootPhaseTime[Phase] += __rdtsc() - StartTime;
+#endif
+}
+
+VOID
+WinLdrpDumpBootPhases(VOID)
+{
+#if DBG && !defined(_M_ARM)
+    TRACE("Boot time breakdown (in cycles): SYSTEM hive %I64u, NLS data %I64u, "
+          "NTOS core %I64u, boot drivers %I64u\n",
+          WinLdrBootPhaseTime[WinLdrPhaseSystemHive],
+          WinLdrBootPhaseTime[WinLdrPhaseNlsData],
+          WinLdrBootPhaseTime[WinLdrPhaseCore],
+          WinLdrBootPhaseTime[WinLdrPhaseBootDrivers]);
+#endif
+    TRACE("Disk cache: %lu hits, %lu misses, %lu transfers, %lu blocks read ahead\n",
+          CacheHitCount, CacheMissCount, CacheTransferCount, CacheReadAheadCount);
+}
@@ -137,6 +137,27 @@ WinLdrpDumpBootDriver(PLOADER_PARAMETER_BLOCK LoaderBlock);
 VOID
 WinLdrpDumpArcDisks(PLOADER_PARAMETER_BLOCK LoaderBlock);
 
+/* Parts of the boot whose duration is logged, they are mostly disk reads */
+typedef enum _WINLDR_BOOT_PHASE
+{
+    WinLdrPhaseSystemHive,
+    WinLdrPhaseNlsData,
+    WinLdrPhaseCore,
+    WinLdrPhaseBootDrivers,
+    WinLdrPhaseMax
+} WINLDR_BOOT_PHASE;
+
+ULONGLONG
+WinLdrBeginBootPhase(VOID);
+
+VOID
+WinLdrEndBootPhase(
+    _In_ WINLDR_BOOT_PHASE Phase,
+    _In_ ULONGLONG StartTime);
+
+VOID
+WinLdrpDumpBootPhases(VOID);
+
 ARC_STATUS
 LoadAndBootWindowsCommon(
     IN USHORT OperatingSystemVersion,
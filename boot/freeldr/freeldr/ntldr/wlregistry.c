@@ -132,6 +132,7 @@ WinLdrInitSystemHive(
     PCSTR HiveName;
     BOOLEAN Success;
     BAD_HIVE_REASON Reason;
+    ULONGLONG PhaseStart;
 
     /* Load the corresponding text-mode setup system hive or the standard hive */
     if (Setup)
@@ -147,7 +148,9 @@ WinLdrInitSystemHive(
     }
 
     TRACE("WinLdrInitSystemHive: loading hive %s%s\n", SearchPath, HiveName);
+    PhaseStart = WinLdrBeginBootPhase();
     Success = WinLdrLoadSystemHive(LoaderBlock, SearchPath, HiveName, &Reason);
+    WinLdrEndBootPhase(WinLdrPhaseSystemHive, PhaseStart);
     if (!Success)
     {
         /* Check whether the SYSTEM hive does not exist or is too corrupt to be read */
@@ -237,6 +240,7 @@ BOOLEAN WinLdrScanSystemHive(IN OUT PLOADER_PARAMETER_BLOCK LoaderBlock,
     DECLARE_UNICODE_STRING_SIZE(LangFileName, MAX_PATH); // CaseTable
     DECLARE_UNICODE_STRING_SIZE(OemHalFileName, MAX_PATH);
     CHAR SearchPath[1024];
+    ULONGLONG PhaseStart;
 
     /* Scan registry and prepare boot drivers list */
     Success = WinLdrScanRegistry(&LoaderBlock->BootDriverListHead);
@@ -264,12 +268,14 @@ BOOLEAN WinLdrScanSystemHive(IN OUT PLOADER_PARAMETER_BLOCK LoaderBlock,
     /* Load NLS data */
     RtlStringCbCopyA(SearchPath, sizeof(SearchPath), SystemRoot);
     RtlStringCbCatA(SearchPath, sizeof(SearchPath), "system32\\");
+    PhaseStart = WinLdrBeginBootPhase();
     Success = WinLdrLoadNLSData(LoaderBlock,
                                 SearchPath,
                                 &AnsiFileName,
                                 &OemFileName,
                                 &LangFileName,
                                 &OemHalFileName);
+    WinLdrEndBootPhase(WinLdrPhaseNlsData, PhaseStart);
     TRACE("NLS data loading %s\n", Success ? "successful" : "failed");
 
     return TRUE;
@@ -137,6 +137,15 @@ RtlLeaveHeapLock(IN OUT PHEAP_LOCK Lock)
     return RtlLeaveCriticalSection(&Lock->CriticalSection);
 }
 
+ULONG
+NTAPI
+RtlpGetHeapAffinity(VOID)
+{
+    /* Asking for the current processor would cost a system call, spread by thread
+       instead. Thread IDs are multiples of 4. */
+    return HandleToUlong(NtCurrentTeb()->ClientId.UniqueThread) >> 2;
+}
+
 PVOID
 NTAPI
 RtlpAllocateMemory(UINT Bytes,
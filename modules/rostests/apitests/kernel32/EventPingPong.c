@@ -0,0 +1,277 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Test and benchmark for event and semaphore signaling and waiting across processors
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include "precomp.h"
+
+#define MAX_PAIRS           32
+#define BENCH_ROUND_TRIPS   20000
+
+typedef struct _PING_PONG
+{
+    HANDLE Ping;
+    HANDLE Pong;
+    HANDLE Threads[2];
+    BOOL SignalAndWait;
+    ULONG Failures;
+} PING_PONG, *PPING_PONG;
+
+static HANDLE StartEvent;
+
+static
+VOID
+Bounce(
+    HANDLE Signal,
+    HANDLE Wait,
+    BOOL SignalAndWait,
+    PULONG Failures)
+{
+    DWORD Result;
+
+    if (SignalAndWait)
+    {
+        Result = SignalObjectAndWait(Signal, Wait, INFINITE, FALSE);
+    }
+    else
+    {
+        SetEvent(Signal);
+        Result = WaitForSingleObject(Wait, INFINITE);
+    }
+
+    if (Result != WAIT_OBJECT_0)
+        (*Failures)++;
+}
+
+static
+DWORD
+WINAPI
+PingThread(
+    PVOID Parameter)
+{
+    PPING_PONG Pair = Parameter;
+    ULONG i;
+
+    WaitForSingleObject(StartEvent, INFINITE);
+    for (i = 0; i < BENCH_ROUND_TRIPS; i++)
+    {
+        Bounce(Pair->Ping, Pair->Pong, Pair->SignalAndWait, &Pair->Failures);
+    }
+
+    return 0;
+}
+
+static
+DWORD
+WINAPI
+PongThread(
+    PVOID Parameter)
+{
+    PPING_PONG Pair = Parameter;
+    ULONG i;
+
+    WaitForSingleObject(StartEvent, INFINITE);
+    if (WaitForSingleObject(Pair->Ping, INFINITE) != WAIT_OBJECT_0)
+        Pair->Failures++;
+    for (i = 0; i < BENCH_ROUND_TRIPS - 1; i++)
+    {
+        Bounce(Pair->Pong, Pair->Ping, Pair->SignalAndWait, &Pair->Failures);
+    }
+    SetEvent(Pair->Pong);
+
+    return 0;
+}
+
+static
+VOID
+BenchPairs(
+    ULONG PairCount,
+    ULONG ProcessorCount,
+    BOOL SignalAndWait)
+{
+    PING_PONG Pairs[MAX_PAIRS];
+    LARGE_INTEGER Start, End, Frequency;
+    ULONGLONG Elapsed;
+    ULONG i, Failures = 0;
+
+    ZeroMemory(Pairs, sizeof(Pairs));
+    ResetEvent(StartEvent);
+
+    for (i = 0; i < PairCount; i++)
+    {
+        Pairs[i].SignalAndWait = SignalAndWait;
+        Pairs[i].Ping = CreateEventW(NULL, FALSE, FALSE, NULL);
+        Pairs[i].Pong = CreateEventW(NULL, FALSE, FALSE, NULL);
+        Pairs[i].Threads[0] = CreateThread(NULL, 0, PingThread, &Pairs[i], CREATE_SUSPENDED, NULL);
+        Pairs[i].Threads[1] = CreateThread(NULL, 0, PongThread, &Pairs[i], CREATE_SUSPENDED, NULL);
+        if (!Pairs[i].Ping || !Pairs[i].Pong || !Pairs[i].Threads[0] || !Pairs[i].Threads[1])
+        {
+            ok(0, "Failed to set up pair %lu: %lu\n", i, GetLastError());
+            PairCount = i + 1;
+            goto Cleanup;
+        }
+
+        /* Keep both ends of a pair on different processors, so every round trip crosses them */
+        if (ProcessorCount > 1 && ProcessorCount <= sizeof(DWORD_PTR) * 8)
+        {
+            SetThreadAffinityMask(Pairs[i].Threads[0], (DWORD_PTR)1 << ((2 * i) % ProcessorCount));
+            SetThreadAffinityMask(Pairs[i].Threads[1], (DWORD_PTR)1 << ((2 * i + 1) % ProcessorCount));
+        }
+
+        ResumeThread(Pairs[i].Threads[0]);
+        ResumeThread(Pairs[i].Threads[1]);
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    SetEvent(StartEvent);
+    for (i = 0; i < PairCount; i++)
+    {
+        ok(WaitForMultipleObjects(2, Pairs[i].Threads, TRUE, 60000) == WAIT_OBJECT_0,
+           "Pair %lu didn't finish\n", i);
+    }
+    QueryPerformanceCounter(&End);
+
+    Elapsed = (End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart;
+    trace("%lu pairs, %s: %I64u ms, %I64u round trips/s\n",
+          PairCount, SignalAndWait ? "SignalObjectAndWait" : "SetEvent + WaitForSingleObject",
+          Elapsed, Elapsed ? (ULONGLONG)PairCount * BENCH_ROUND_TRIPS * 1000 / Elapsed : 0);
+
+Cleanup:
+    SetEvent(StartEvent);
+    for (i = 0; i < PairCount; i++)
+    {
+        Failures += Pairs[i].Failures;
+        if (Pairs[i].Threads[0]) CloseHandle(Pairs[i].Threads[0]);
+        if (Pairs[i].Threads[1]) CloseHandle(Pairs[i].Threads[1]);
+        if (Pairs[i].Ping) CloseHandle(Pairs[i].Ping);
+        if (Pairs[i].Pong) CloseHandle(Pairs[i].Pong);
+    }
+    ok_eq_ulong(Failures, 0UL);
+}
+
+static
+VOID
+TestPolling(VOID)
+{
+    HANDLE Event, Mutex;
+
+    Event = CreateEventW(NULL, FALSE, FALSE, NULL);
+    ok(Event != NULL, "CreateEventW failed with %lu\n", GetLastError());
+    if (Event)
+    {
+        /* Polling an unsignaled event must not consume anything */
+        ok_eq_ulong(WaitForSingleObject(Event, 0), (DWORD)WAIT_TIMEOUT);
+        ok_eq_ulong(WaitForSingleObject(Event, 0), (DWORD)WAIT_TIMEOUT);
+
+        /* Setting a signaled auto-reset event again must not signal it twice */
+        ok(SetEvent(Event), "SetEvent failed with %lu\n", GetLastError());
+        ok(SetEvent(Event), "SetEvent failed with %lu\n", GetLastError());
+        ok_eq_ulong(WaitForSingleObject(Event, 0), (DWORD)WAIT_OBJECT_0);
+        ok_eq_ulong(WaitForSingleObject(Event, 0), (DWORD)WAIT_TIMEOUT);
+        CloseHandle(Event);
+    }
+
+    /* A mutex we own must still be acquired by a poll */
+    Mutex = CreateMutexW(NULL, TRUE, NULL);
+    ok(Mutex != NULL, "CreateMutexW failed with %lu\n", GetLastError());
+    if (Mutex)
+    {
+        ok_eq_ulong(WaitForSingleObject(Mutex, 0), (DWORD)WAIT_OBJECT_0);
+        ok(ReleaseMutex(Mutex), "ReleaseMutex failed with %lu\n", GetLastError());
+        ok(ReleaseMutex(Mutex), "ReleaseMutex failed with %lu\n", GetLastError());
+        ok(!ReleaseMutex(Mutex), "ReleaseMutex succeeded on a released mutex\n");
+        CloseHandle(Mutex);
+    }
+}
+
+static
+DWORD
+WINAPI
+SemaphoreThread(
+    PVOID Parameter)
+{
+    HANDLE Semaphore = Parameter;
+    ULONG i, Failures = 0;
+
+    WaitForSingleObject(StartEvent, INFINITE);
+    for (i = 0; i < BENCH_ROUND_TRIPS; i++)
+    {
+        if (!ReleaseSemaphore(Semaphore, 1, NULL))
+            Failures++;
+        if (WaitForSingleObject(Semaphore, INFINITE) != WAIT_OBJECT_0)
+            Failures++;
+    }
+
+    return Failures;
+}
+
+static
+VOID
+TestSemaphoreContention(
+    ULONG ProcessorCount)
+{
+    HANDLE Semaphore, Threads[MAX_PAIRS];
+    ULONG i, ThreadCount;
+    DWORD ExitCode;
+
+    ThreadCount = min(max(ProcessorCount, 2), MAX_PAIRS);
+    Semaphore = CreateSemaphoreW(NULL, 0, ThreadCount, NULL);
+    ok(Semaphore != NULL, "CreateSemaphoreW failed with %lu\n", GetLastError());
+    if (!Semaphore)
+        return;
+
+    ResetEvent(StartEvent);
+    for (i = 0; i < ThreadCount; i++)
+    {
+        Threads[i] = CreateThread(NULL, 0, SemaphoreThread, Semaphore, 0, NULL);
+        ok(Threads[i] != NULL, "CreateThread failed with %lu\n", GetLastError());
+        if (!Threads[i])
+        {
+            ThreadCount = i;
+            break;
+        }
+    }
+
+    /* Every release is taken by exactly one wait, whoever races for it */
+    SetEvent(StartEvent);
+    for (i = 0; i < ThreadCount; i++)
+    {
+        ok_eq_ulong(WaitForSingleObject(Threads[i], 60000), (DWORD)WAIT_OBJECT_0);
+        ok(GetExitCodeThread(Threads[i], &ExitCode), "GetExitCodeThread failed with %lu\n", GetLastError());
+        ok_eq_ulong(ExitCode, 0UL);
+        CloseHandle(Threads[i]);
+    }
+    ok_eq_ulong(WaitForSingleObject(Semaphore, 0), (DWORD)WAIT_TIMEOUT);
+
+    CloseHandle(Semaphore);
+}
+
+START_TEST(EventPingPong)
+{
+    SYSTEM_INFO SystemInfo;
+    ULONG PairCount;
+
+    GetSystemInfo(&SystemInfo);
+
+    StartEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    ok(StartEvent != NULL, "CreateEventW failed with %lu\n", GetLastError());
+    if (!StartEvent)
+        return;
+
+    TestPolling();
+    TestSemaphoreContention(SystemInfo.dwNumberOfProcessors);
+
+    /* Double the pairs until every processor is busy */
+    for (PairCount = 1; PairCount <= MAX_PAIRS; PairCount *= 2)
+    {
+        BenchPairs(PairCount, SystemInfo.dwNumberOfProcessors, FALSE);
+        BenchPairs(PairCount, SystemInfo.dwNumberOfProcessors, TRUE);
+        if (2 * PairCount >= SystemInfo.dwNumberOfProcessors)
+            break;
+    }
+
+    CloseHandle(StartEvent);
+}
@@ -0,0 +1,131 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Test for completion port notification modes and batched dequeue
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include "precomp.h"
+#include <ndk/iofuncs.h>
+
+#define PIPE_NAME   L"\\\\.\\pipe\\rostest_iocompletionport"
+#define PIPE_KEY    0x1234
+#define POST_COUNT  3
+
+static
+VOID
+TestSkipModes(
+    HANDLE Port)
+{
+    HANDLE Server, Client;
+    OVERLAPPED Overlapped, *CompletedOverlapped;
+    ULONG_PTR Key;
+    DWORD Transferred;
+    CHAR Buffer[16];
+    BOOL Ret;
+
+    Server = CreateNamedPipeW(PIPE_NAME,
+                              PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
+                              PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
+                              1, 0, 0, 0, NULL);
+    ok(Server != INVALID_HANDLE_VALUE, "CreateNamedPipeW failed with %lu\n", GetLastError());
+    if (Server == INVALID_HANDLE_VALUE)
+        return;
+
+    Client = CreateFileW(PIPE_NAME, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+    ok(Client != INVALID_HANDLE_VALUE, "CreateFileW failed with %lu\n", GetLastError());
+    if (Client == INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(Server);
+        return;
+    }
+
+    ok(CreateIoCompletionPort(Server, Port, PIPE_KEY, 0) == Port,
+       "CreateIoCompletionPort failed with %lu\n", GetLastError());
+    ok(SetFileCompletionNotificationModes(Server, FILE_SKIP_COMPLETION_PORT_ON_SUCCESS |
+                                                  FILE_SKIP_SET_EVENT_ON_HANDLE),
+       "SetFileCompletionNotificationModes failed with %lu\n", GetLastError());
+
+    /* The data is already there, so the read succeeds inline and the caller already has its result */
+    ok(WriteFile(Client, "ping", 4, &Transferred, NULL), "WriteFile failed with %lu\n", GetLastError());
+    ZeroMemory(&Overlapped, sizeof(Overlapped));
+    Ret = ReadFile(Server, Buffer, 4, NULL, &Overlapped);
+    ok(Ret, "ReadFile didn't complete synchronously: %lu\n", GetLastError());
+    if (Ret)
+    {
+        ok(!GetQueuedCompletionStatus(Port, &Transferred, &Key, &CompletedOverlapped, 0),
+           "A packet was queued for a synchronous success\n");
+        ok_eq_ulong(GetLastError(), (DWORD)WAIT_TIMEOUT);
+    }
+
+    /* Nothing to read, so this one pends and still gets its packet */
+    ZeroMemory(&Overlapped, sizeof(Overlapped));
+    Ret = ReadFile(Server, Buffer, 4, NULL, &Overlapped);
+    ok(!Ret && GetLastError() == ERROR_IO_PENDING, "ReadFile returned %d with %lu\n", Ret, GetLastError());
+    if (!Ret && GetLastError() == ERROR_IO_PENDING)
+    {
+        ok(WriteFile(Client, "pong", 4, &Transferred, NULL), "WriteFile failed with %lu\n", GetLastError());
+
+        CompletedOverlapped = NULL;
+        ok(GetQueuedCompletionStatus(Port, &Transferred, &Key, &CompletedOverlapped, 5000),
+           "GetQueuedCompletionStatus failed with %lu\n", GetLastError());
+        ok(CompletedOverlapped == &Overlapped, "Got overlapped %p, expected %p\n", CompletedOverlapped, &Overlapped);
+        ok_eq_ulong((ULONG)Key, (ULONG)PIPE_KEY);
+        ok_eq_ulong(Transferred, 4UL);
+
+        /* And the handle was left alone */
+        ok_eq_ulong(WaitForSingleObject(Server, 0), (DWORD)WAIT_TIMEOUT);
+    }
+
+    CloseHandle(Client);
+    CloseHandle(Server);
+}
+
+static
+VOID
+TestBatchedRemove(
+    HANDLE Port)
+{
+    FILE_IO_COMPLETION_INFORMATION Information[POST_COUNT + 2];
+    LARGE_INTEGER Timeout;
+    ULONG Removed, i;
+    NTSTATUS Status;
+
+    for (i = 0; i < POST_COUNT; i++)
+    {
+        ok(PostQueuedCompletionStatus(Port, i, i + 1, NULL),
+           "PostQueuedCompletionStatus failed with %lu\n", GetLastError());
+    }
+
+    /* One call takes them all, in order */
+    Timeout.QuadPart = 0;
+    Removed = 0xdeadbeef;
+    Status = NtRemoveIoCompletionEx(Port, Information, _countof(Information), &Removed, &Timeout, FALSE);
+    ok_hex(Status, STATUS_SUCCESS);
+    ok_eq_ulong(Removed, (ULONG)POST_COUNT);
+    for (i = 0; i < min(Removed, POST_COUNT); i++)
+    {
+        ok_eq_ulong((ULONG)(ULONG_PTR)Information[i].KeyContext, i + 1);
+        ok_eq_ulong((ULONG)Information[i].IoStatusBlock.Information, i);
+    }
+
+    /* Nothing left */
+    Removed = 0xdeadbeef;
+    Status = NtRemoveIoCompletionEx(Port, Information, _countof(Information), &Removed, &Timeout, FALSE);
+    ok_hex(Status, STATUS_TIMEOUT);
+}
+
+START_TEST(IoCompletionPort)
+{
+    HANDLE Port;
+
+    Port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 0);
+    ok(Port != NULL, "CreateIoCompletionPort failed with %lu\n", GetLastError());
+    if (!Port)
+        return;
+
+    TestSkipModes(Port);
+    TestBatchedRemove(Port);
+
+    CloseHandle(Port);
+}
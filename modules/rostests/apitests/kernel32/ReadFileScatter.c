@@ -0,0 +1,250 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Test and benchmark for ReadFileScatter and WriteFileGather
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include "precomp.h"
+
+#define TEST_PAGES          64
+#define BENCH_ITERATIONS    200
+
+static SYSTEM_INFO SystemInfo;
+
+static
+BOOL
+WaitForIo(
+    HANDLE FileHandle,
+    LPOVERLAPPED Overlapped,
+    BOOL Result,
+    PDWORD Transferred)
+{
+    if (!Result && GetLastError() != ERROR_IO_PENDING)
+        return FALSE;
+
+    return GetOverlappedResult(FileHandle, Overlapped, Transferred, TRUE);
+}
+
+/* Scatter the pages backwards over every other page of the pool, like a buffer pool would */
+static
+VOID
+BuildSegments(
+    PUCHAR Pool,
+    FILE_SEGMENT_ELEMENT *Segments)
+{
+    ULONG i;
+
+    for (i = 0; i < TEST_PAGES; i++)
+    {
+        Segments[i].Alignment = (ULONG_PTR)(Pool + (2 * (TEST_PAGES - 1 - i) * SystemInfo.dwPageSize));
+    }
+    Segments[TEST_PAGES].Alignment = 0;
+}
+
+static
+ULONGLONG
+BenchScatter(
+    HANDLE FileHandle,
+    HANDLE Event,
+    FILE_SEGMENT_ELEMENT *Segments)
+{
+    LARGE_INTEGER Start, End, Frequency;
+    OVERLAPPED Overlapped;
+    DWORD Transferred;
+    ULONG i;
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        ZeroMemory(&Overlapped, sizeof(Overlapped));
+        Overlapped.hEvent = Event;
+        if (!WaitForIo(FileHandle, &Overlapped,
+                       ReadFileScatter(FileHandle, Segments, TEST_PAGES * SystemInfo.dwPageSize, NULL, &Overlapped),
+                       &Transferred))
+        {
+            ok(0, "ReadFileScatter failed with %lu\n", GetLastError());
+            break;
+        }
+    }
+    QueryPerformanceCounter(&End);
+
+    return (End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart;
+}
+
+static
+ULONGLONG
+BenchReadLoop(
+    HANDLE FileHandle,
+    HANDLE Event,
+    FILE_SEGMENT_ELEMENT *Segments)
+{
+    LARGE_INTEGER Start, End, Frequency;
+    OVERLAPPED Overlapped;
+    DWORD Transferred;
+    ULONG i, Page;
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        for (Page = 0; Page < TEST_PAGES; Page++)
+        {
+            ZeroMemory(&Overlapped, sizeof(Overlapped));
+            Overlapped.Offset = Page * SystemInfo.dwPageSize;
+            Overlapped.hEvent = Event;
+            if (!WaitForIo(FileHandle, &Overlapped,
+                           ReadFile(FileHandle, (PVOID)(ULONG_PTR)Segments[Page].Alignment,
+                                    SystemInfo.dwPageSize, NULL, &Overlapped),
+                           &Transferred))
+            {
+                ok(0, "ReadFile failed with %lu\n", GetLastError());
+                goto Quit;
+            }
+        }
+    }
+
+Quit:
+    QueryPerformanceCounter(&End);
+
+    return (End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart;
+}
+
+static
+BOOL
+CheckPages(
+    FILE_SEGMENT_ELEMENT *Segments,
+    UCHAR Seed)
+{
+    PUCHAR Page;
+    ULONG i, j;
+
+    for (i = 0; i < TEST_PAGES; i++)
+    {
+        Page = (PUCHAR)(ULONG_PTR)Segments[i].Alignment;
+        for (j = 0; j < SystemInfo.dwPageSize; j++)
+        {
+            if (Page[j] != (UCHAR)(Seed + i + j))
+                return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+START_TEST(ReadFileScatter)
+{
+    WCHAR TempPath[MAX_PATH], FileName[MAX_PATH];
+    FILE_SEGMENT_ELEMENT Segments[TEST_PAGES + 1];
+    ULONGLONG ScatterTime, ReadLoopTime;
+    OVERLAPPED Overlapped;
+    HANDLE FileHandle, Event;
+    DWORD Transferred;
+    PUCHAR Pool, Page;
+    ULONG i, j;
+    BOOL Ret;
+
+    GetSystemInfo(&SystemInfo);
+
+    GetTempPathW(_countof(TempPath), TempPath);
+    if (!GetTempFileNameW(TempPath, L"sg", 0, FileName))
+    {
+        skip("GetTempFileNameW failed with %lu\n", GetLastError());
+        return;
+    }
+
+    Pool = VirtualAlloc(NULL, 2 * TEST_PAGES * SystemInfo.dwPageSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    ok(Pool != NULL, "VirtualAlloc failed with %lu\n", GetLastError());
+    Event = CreateEventW(NULL, TRUE, FALSE, NULL);
+    ok(Event != NULL, "CreateEventW failed with %lu\n", GetLastError());
+    if (!Pool || !Event)
+        goto Cleanup;
+
+    BuildSegments(Pool, Segments);
+
+    /* Scatter/gather only works on unbuffered handles */
+    FileHandle = CreateFileW(FileName, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING,
+                             FILE_FLAG_OVERLAPPED, NULL);
+    ok(FileHandle != INVALID_HANDLE_VALUE, "CreateFileW failed with %lu\n", GetLastError());
+    if (FileHandle != INVALID_HANDLE_VALUE)
+    {
+        ZeroMemory(&Overlapped, sizeof(Overlapped));
+        Overlapped.hEvent = Event;
+        SetLastError(0xdeadbeef);
+        Ret = ReadFileScatter(FileHandle, Segments, SystemInfo.dwPageSize, NULL, &Overlapped);
+        ok(!Ret, "ReadFileScatter succeeded on a cached handle\n");
+        ok_eq_ulong(GetLastError(), (DWORD)ERROR_INVALID_PARAMETER);
+        CloseHandle(FileHandle);
+    }
+
+    FileHandle = CreateFileW(FileName, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING,
+                             FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING, NULL);
+    ok(FileHandle != INVALID_HANDLE_VALUE, "CreateFileW failed with %lu\n", GetLastError());
+    if (FileHandle == INVALID_HANDLE_VALUE)
+        goto Cleanup;
+
+    /* Gather a pattern which tells the file page and the byte apart */
+    for (i = 0; i < TEST_PAGES; i++)
+    {
+        Page = (PUCHAR)(ULONG_PTR)Segments[i].Alignment;
+        for (j = 0; j < SystemInfo.dwPageSize; j++)
+            Page[j] = (UCHAR)(0x5A + i + j);
+    }
+
+    ZeroMemory(&Overlapped, sizeof(Overlapped));
+    Overlapped.hEvent = Event;
+    Ret = WaitForIo(FileHandle, &Overlapped,
+                    WriteFileGather(FileHandle, Segments, TEST_PAGES * SystemInfo.dwPageSize, NULL, &Overlapped),
+                    &Transferred);
+    ok(Ret, "WriteFileGather failed with %lu\n", GetLastError());
+    ok_eq_ulong(Transferred, TEST_PAGES * SystemInfo.dwPageSize);
+
+    /* Each file page must have landed where its segment said */
+    for (i = 0; i < TEST_PAGES; i++)
+    {
+        ZeroMemory(&Overlapped, sizeof(Overlapped));
+        Overlapped.Offset = i * SystemInfo.dwPageSize;
+        Overlapped.hEvent = Event;
+        Page = Pool + (2 * TEST_PAGES - 1) * SystemInfo.dwPageSize;
+        Ret = WaitForIo(FileHandle, &Overlapped,
+                        ReadFile(FileHandle, Page, SystemInfo.dwPageSize, NULL, &Overlapped),
+                        &Transferred);
+        ok(Ret, "ReadFile failed with %lu\n", GetLastError());
+        ok(Page[0] == (UCHAR)(0x5A + i) && Page[SystemInfo.dwPageSize - 1] == (UCHAR)(0x5A + i - 1),
+           "Page %lu is wrong: %02x %02x\n", i, Page[0], Page[SystemInfo.dwPageSize - 1]);
+    }
+
+    /* And scatter back into the same places */
+    ZeroMemory(Pool, 2 * TEST_PAGES * SystemInfo.dwPageSize);
+    ZeroMemory(&Overlapped, sizeof(Overlapped));
+    Overlapped.hEvent = Event;
+    Ret = WaitForIo(FileHandle, &Overlapped,
+                    ReadFileScatter(FileHandle, Segments, TEST_PAGES * SystemInfo.dwPageSize, NULL, &Overlapped),
+                    &Transferred);
+    ok(Ret, "ReadFileScatter failed with %lu\n", GetLastError());
+    ok_eq_ulong(Transferred, TEST_PAGES * SystemInfo.dwPageSize);
+    ok(CheckPages(Segments, 0x5A), "Scattered pages don't match\n");
+
+    /* The unused pages in between must not have been touched */
+    for (i = 0; i < TEST_PAGES; i++)
+    {
+        Page = Pool + (2 * i + 1) * SystemInfo.dwPageSize;
+        ok(Page[0] == 0 && Page[SystemInfo.dwPageSize - 1] == 0, "Gap page %lu was written\n", i);
+    }
+
+    /* One request for all the pages against one request per page */
+    ScatterTime = BenchScatter(FileHandle, Event, Segments);
+    ReadLoopTime = BenchReadLoop(FileHandle, Event, Segments);
+    ok(CheckPages(Segments, 0x5A), "Pages read by the benchmark don't match\n");
+
+    trace("%u x %u pages: ReadFileScatter %I64u ms, ReadFile loop %I64u ms\n",
+          BENCH_ITERATIONS, TEST_PAGES, ScatterTime, ReadLoopTime);
+
+    CloseHandle(FileHandle);
+
+Cleanup:
+    if (Event) CloseHandle(Event);
+    if (Pool) VirtualFree(Pool, 0, MEM_RELEASE);
+    DeleteFileW(FileName);
+}
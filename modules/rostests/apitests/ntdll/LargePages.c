@@ -0,0 +1,229 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Test and TLB benchmark for MEM_LARGE_PAGES allocations
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include "precomp.h"
+
+#define BENCH_LARGE_PAGES   8
+#define BENCH_ACCESSES      (4 * 1024 * 1024)
+
+static
+VOID
+BuildPageChain(
+    PUCHAR Buffer,
+    SIZE_T Size)
+{
+    ULONG PageCount = (ULONG)(Size / PAGE_SIZE);
+    PULONG Order;
+    ULONG Seed = 0x5EED;
+    ULONG i, j, Temp;
+
+    Order = RtlAllocateHeap(RtlGetProcessHeap(), 0, PageCount * sizeof(ULONG));
+    ok(Order != NULL, "Out of memory\n");
+    if (!Order) return;
+
+    /* Sattolo's algorithm gives a single cycle through every page */
+    for (i = 0; i < PageCount; i++)
+        Order[i] = i;
+    for (i = PageCount - 1; i > 0; i--)
+    {
+        j = RtlRandom(&Seed) % i;
+        Temp = Order[i];
+        Order[i] = Order[j];
+        Order[j] = Temp;
+    }
+
+    /* Each page points to the next one, at a varying offset so we don't only hit one cache set */
+    for (i = 0; i < PageCount; i++)
+    {
+        PVOID *Link = (PVOID *)(Buffer + Order[i] * PAGE_SIZE + (Order[i] % 64) * 64);
+        ULONG Next = Order[(i + 1) % PageCount];
+        *Link = Buffer + Next * PAGE_SIZE + (Next % 64) * 64;
+    }
+
+    RtlFreeHeap(RtlGetProcessHeap(), 0, Order);
+}
+
+static
+ULONGLONG
+RunBenchmark(
+    PUCHAR Buffer,
+    SIZE_T Size)
+{
+    LARGE_INTEGER Start, End, Frequency;
+    PVOID *Link;
+    ULONG i;
+
+    BuildPageChain(Buffer, Size);
+
+    /* Every access is on another page: with 4K pages, nearly every one misses the TLB */
+    Link = (PVOID *)Buffer;
+    NtQueryPerformanceCounter(&Start, &Frequency);
+    for (i = 0; i < BENCH_ACCESSES; i++)
+        Link = *Link;
+    NtQueryPerformanceCounter(&End, NULL);
+
+    ok(Link != NULL, "Broken chain\n");
+    return (End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart;
+}
+
+static
+VOID
+TestAllocation(
+    SIZE_T LargePageSize)
+{
+    MEMORY_BASIC_INFORMATION MemoryInformation;
+    PVOID BaseAddress;
+    SIZE_T Size;
+    NTSTATUS Status;
+    PUCHAR Buffer;
+    SIZE_T i;
+    BOOLEAN Zeroed;
+
+    /* Large pages must be reserved and committed at once */
+    BaseAddress = NULL;
+    Size = LargePageSize;
+    Status = NtAllocateVirtualMemory(NtCurrentProcess(), &BaseAddress, 0, &Size,
+                                     MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    ok_ntstatus(Status, STATUS_INVALID_PARAMETER_5);
+
+    /* The size must be a multiple of the large page size */
+    BaseAddress = NULL;
+    Size = LargePageSize + PAGE_SIZE;
+    Status = NtAllocateVirtualMemory(NtCurrentProcess(), &BaseAddress, 0, &Size,
+                                     MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    ok_ntstatus(Status, STATUS_INVALID_PARAMETER);
+
+    /* Guard pages make no sense without PTEs */
+    BaseAddress = NULL;
+    Size = LargePageSize;
+    Status = NtAllocateVirtualMemory(NtCurrentProcess(), &BaseAddress, 0, &Size,
+                                     MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE | PAGE_GUARD);
+    ok_ntstatus(Status, STATUS_INVALID_PAGE_PROTECTION);
+
+    BaseAddress = NULL;
+    Size = 2 * LargePageSize;
+    Status = NtAllocateVirtualMemory(NtCurrentProcess(), &BaseAddress, 0, &Size,
+                                     MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    if (Status == STATUS_INSUFFICIENT_RESOURCES)
+    {
+        skip("Not enough contiguous physical memory\n");
+        return;
+    }
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status)) return;
+
+    ok_eq_size(Size, 2 * LargePageSize);
+    ok(((ULONG_PTR)BaseAddress & (LargePageSize - 1)) == 0, "Unaligned base %p\n", BaseAddress);
+
+    /* The whole range is committed */
+    Status = NtQueryVirtualMemory(NtCurrentProcess(), BaseAddress, MemoryBasicInformation,
+                                  &MemoryInformation, sizeof(MemoryInformation), NULL);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok(MemoryInformation.AllocationBase == BaseAddress, "AllocationBase %p\n", MemoryInformation.AllocationBase);
+    ok_eq_size(MemoryInformation.RegionSize, 2 * LargePageSize);
+    ok_eq_ulong(MemoryInformation.State, MEM_COMMIT);
+    ok_eq_ulong(MemoryInformation.Protect, PAGE_READWRITE);
+    ok_eq_ulong(MemoryInformation.Type, MEM_PRIVATE);
+
+    /* And it is zeroed */
+    Buffer = BaseAddress;
+    Zeroed = TRUE;
+    for (i = 0; i < Size; i += sizeof(ULONG_PTR))
+    {
+        if (*(PULONG_PTR)(Buffer + i) != 0) Zeroed = FALSE;
+    }
+    ok(Zeroed, "Large pages are not zeroed\n");
+    RtlFillMemory(Buffer, Size, 0xA5);
+
+    /* It can be written to by the kernel */
+    Status = NtQueryVirtualMemory(NtCurrentProcess(), BaseAddress, MemoryBasicInformation,
+                                  Buffer + LargePageSize - sizeof(MemoryInformation) / 2,
+                                  sizeof(MemoryInformation), NULL);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+
+    /* Nothing can be committed on top of them */
+    Size = PAGE_SIZE;
+    Status = NtAllocateVirtualMemory(NtCurrentProcess(), &BaseAddress, 0, &Size,
+                                     MEM_COMMIT, PAGE_READWRITE);
+    ok_ntstatus(Status, STATUS_CONFLICTING_ADDRESSES);
+
+    /* They can only be released as a whole */
+    Size = LargePageSize;
+    Status = NtFreeVirtualMemory(NtCurrentProcess(), &BaseAddress, &Size, MEM_RELEASE);
+    ok_ntstatus(Status, STATUS_INVALID_PARAMETER);
+
+    Size = 0;
+    Status = NtFreeVirtualMemory(NtCurrentProcess(), &BaseAddress, &Size, MEM_RELEASE);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok_eq_size(Size, 2 * LargePageSize);
+}
+
+START_TEST(LargePages)
+{
+    SIZE_T LargePageSize = SharedUserData->LargePageMinimum;
+    PVOID LargeBuffer = NULL, SmallBuffer = NULL;
+    ULONGLONG LargeTime, SmallTime;
+    BOOLEAN WasEnabled;
+    NTSTATUS Status;
+    SIZE_T Size;
+
+    if (LargePageSize == 0)
+    {
+        skip("Large pages are not supported\n");
+        return;
+    }
+
+    /* Without the privilege, nothing else can be checked */
+    Status = RtlAdjustPrivilege(SE_LOCK_MEMORY_PRIVILEGE, TRUE, FALSE, &WasEnabled);
+    if (!NT_SUCCESS(Status))
+    {
+        Size = LargePageSize;
+        Status = NtAllocateVirtualMemory(NtCurrentProcess(), &LargeBuffer, 0, &Size,
+                                         MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        ok_ntstatus(Status, STATUS_PRIVILEGE_NOT_HELD);
+        skip("SeLockMemoryPrivilege is not held\n");
+        return;
+    }
+
+    TestAllocation(LargePageSize);
+
+    /* Same chase through the same amount of memory, with 4K and large pages */
+    Size = BENCH_LARGE_PAGES * LargePageSize;
+    Status = NtAllocateVirtualMemory(NtCurrentProcess(), &SmallBuffer, 0, &Size,
+                                     MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+
+    Status = NtAllocateVirtualMemory(NtCurrentProcess(), &LargeBuffer, 0, &Size,
+                                     MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    if (NT_SUCCESS(Status) && SmallBuffer)
+    {
+        SmallTime = RunBenchmark(SmallBuffer, Size);
+        LargeTime = RunBenchmark(LargeBuffer, Size);
+        trace("%u random page accesses over %Iu MB: 4K pages %I64u ms, %Iu KB pages %I64u ms\n",
+              BENCH_ACCESSES, Size / (1024 * 1024), SmallTime, LargePageSize / 1024, LargeTime);
+    }
+    else
+    {
+        skip("Cannot allocate %Iu bytes of large pages (Status 0x%08lx)\n", Size, Status);
+    }
+
+    if (LargeBuffer)
+    {
+        Size = 0;
+        Status = NtFreeVirtualMemory(NtCurrentProcess(), &LargeBuffer, &Size, MEM_RELEASE);
+        ok_ntstatus(Status, STATUS_SUCCESS);
+    }
+    if (SmallBuffer)
+    {
+        Size = 0;
+        Status = NtFreeVirtualMemory(NtCurrentProcess(), &SmallBuffer, &Size, MEM_RELEASE);
+        ok_ntstatus(Status, STATUS_SUCCESS);
+    }
+
+    if (!WasEnabled)
+        RtlAdjustPrivilege(SE_LOCK_MEMORY_PRIVILEGE, FALSE, FALSE, &WasEnabled);
+}
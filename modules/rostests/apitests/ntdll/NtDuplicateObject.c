@@ -3,12 +3,133 @@
  * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
  * PURPOSE:     Test for NtDuplicateObject
  * COPYRIGHT:   Copyright 2019 Thomas Faber (thomas.faber@reactos.org)
+ *              Copyright 2026 ReactOS Team
  */
 
 #include "precomp.h"
 
 #define OBJ_PROTECT_CLOSE 0x01
 
+#define BENCH_MAX_THREADS   16
+#define BENCH_ITERATIONS    20000
+#define BENCH_BATCH         32
+
+typedef struct _BENCH_CONTEXT
+{
+    HANDLE StartEvent;
+    HANDLE Object;
+    volatile LONG Failures;
+} BENCH_CONTEXT, *PBENCH_CONTEXT;
+
+static
+DWORD
+WINAPI
+DuplicateCloseThread(
+    _In_ PVOID Parameter)
+{
+    PBENCH_CONTEXT Context = Parameter;
+    HANDLE Handles[BENCH_BATCH];
+    NTSTATUS Status;
+    ULONG i, j;
+
+    WaitForSingleObject(Context->StartEvent, INFINITE);
+
+    /* Keep a few handles open at once so the free lists see some depth */
+    for (i = 0; i < BENCH_ITERATIONS / BENCH_BATCH; i++)
+    {
+        for (j = 0; j < BENCH_BATCH; j++)
+        {
+            Status = NtDuplicateObject(NtCurrentProcess(),
+                                       Context->Object,
+                                       NtCurrentProcess(),
+                                       &Handles[j],
+                                       0,
+                                       0,
+                                       DUPLICATE_SAME_ACCESS);
+            if (!NT_SUCCESS(Status))
+            {
+                InterlockedIncrement(&Context->Failures);
+                Handles[j] = NULL;
+            }
+        }
+
+        for (j = 0; j < BENCH_BATCH; j++)
+        {
+            if (Handles[j] && !NT_SUCCESS(NtClose(Handles[j])))
+                InterlockedIncrement(&Context->Failures);
+        }
+    }
+
+    return 0;
+}
+
+static
+VOID
+BenchmarkDuplicateClose(VOID)
+{
+    HANDLE Threads[BENCH_MAX_THREADS];
+    LARGE_INTEGER Start, End, Frequency;
+    BENCH_CONTEXT Context;
+    SYSTEM_INFO SystemInfo;
+    ULONG HandleCountBefore, HandleCountAfter;
+    ULONG ThreadCount, MaxThreads, i, j;
+    NTSTATUS Status;
+
+    GetSystemInfo(&SystemInfo);
+    MaxThreads = min(max(SystemInfo.dwNumberOfProcessors * 2, 4), BENCH_MAX_THREADS);
+
+    Context.Object = CreateEventW(NULL, TRUE, FALSE, NULL);
+    ok(Context.Object != NULL, "CreateEventW failed: %lu\n", GetLastError());
+    if (!Context.Object) return;
+
+    Status = NtQueryInformationProcess(NtCurrentProcess(), ProcessHandleCount,
+                                       &HandleCountBefore, sizeof(HandleCountBefore), NULL);
+    ok_hex(Status, STATUS_SUCCESS);
+
+    for (ThreadCount = 1; ThreadCount <= MaxThreads; ThreadCount *= 2)
+    {
+        Context.StartEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+        ok(Context.StartEvent != NULL, "CreateEventW failed: %lu\n", GetLastError());
+        if (!Context.StartEvent) break;
+        Context.Failures = 0;
+
+        for (i = 0; i < ThreadCount; i++)
+        {
+            Threads[i] = CreateThread(NULL, 0, DuplicateCloseThread, &Context, 0, NULL);
+            ok(Threads[i] != NULL, "CreateThread failed: %lu\n", GetLastError());
+            if (!Threads[i]) break;
+        }
+
+        /* All threads start at once, each one churns through its share of handles */
+        NtQueryPerformanceCounter(&Start, &Frequency);
+        SetEvent(Context.StartEvent);
+        if (i) WaitForMultipleObjects(i, Threads, TRUE, INFINITE);
+        NtQueryPerformanceCounter(&End, NULL);
+
+        ok_long(Context.Failures, 0);
+        if (i == ThreadCount)
+        {
+            trace("%lu thread(s): %lu duplicate/close pairs in %I64u ms\n",
+                  ThreadCount,
+                  ThreadCount * (BENCH_ITERATIONS / BENCH_BATCH) * BENCH_BATCH,
+                  (End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart);
+        }
+
+        CloseHandle(Context.StartEvent);
+        for (j = 0; j < i; j++)
+            CloseHandle(Threads[j]);
+        if (i != ThreadCount) break;
+    }
+
+    /* Every handle went back to the table */
+    Status = NtQueryInformationProcess(NtCurrentProcess(), ProcessHandleCount,
+                                       &HandleCountAfter, sizeof(HandleCountAfter), NULL);
+    ok_hex(Status, STATUS_SUCCESS);
+    ok_long(HandleCountAfter, HandleCountBefore);
+
+    CloseHandle(Context.Object);
+}
+
 START_TEST(NtDuplicateObject)
 {
     NTSTATUS Status;
@@ -27,4 +148,6 @@ START_TEST(NtDuplicateObject)
         "Handle = %p\n", Handle);
     Status = NtClose(Handle);
     ok_hex(Status, STATUS_HANDLE_NOT_CLOSABLE);
+
+    BenchmarkDuplicateClose();
 }
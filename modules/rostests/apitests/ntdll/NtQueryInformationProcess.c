@@ -704,6 +704,129 @@ Test_ProcQueryAlignmentProbe(void)
     }
 }
 
+static
+void
+Test_ProcessVmCountersFaults(void)
+{
+    VM_COUNTERS Before, After;
+    PVOID BaseAddress = NULL;
+    SIZE_T Size = 16 * PAGE_SIZE;
+    NTSTATUS Status;
+    ULONG i;
+
+    Status = NtAllocateVirtualMemory(NtCurrentProcess(), &BaseAddress, 0, &Size,
+                                     MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    ok_hex(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status)) return;
+
+    Status = NtQueryInformationProcess(NtCurrentProcess(), ProcessVmCounters,
+                                       &Before, sizeof(Before), NULL);
+    ok_hex(Status, STATUS_SUCCESS);
+
+    /* Every first touch of a demand zero page is a fault */
+    for (i = 0; i < Size / PAGE_SIZE; i++)
+        ((volatile UCHAR *)BaseAddress)[i * PAGE_SIZE] = 1;
+
+    Status = NtQueryInformationProcess(NtCurrentProcess(), ProcessVmCounters,
+                                       &After, sizeof(After), NULL);
+    ok_hex(Status, STATUS_SUCCESS);
+    ok(After.PageFaultCount - Before.PageFaultCount >= Size / PAGE_SIZE,
+       "Expected at least %lu faults, got %lu\n",
+       (ULONG)(Size / PAGE_SIZE), After.PageFaultCount - Before.PageFaultCount);
+
+    Size = 0;
+    Status = NtFreeVirtualMemory(NtCurrentProcess(), &BaseAddress, &Size, MEM_RELEASE);
+    ok_hex(Status, STATUS_SUCCESS);
+}
+
+static
+ULONG
+GetPageFaultCount(void)
+{
+    VM_COUNTERS Counters;
+    NTSTATUS Status;
+
+    Status = NtQueryInformationProcess(NtCurrentProcess(), ProcessVmCounters,
+                                       &Counters, sizeof(Counters), NULL);
+    ok_hex(Status, STATUS_SUCCESS);
+    return Counters.PageFaultCount;
+}
+
+static
+void
+Test_ProcessVmCountersTrim(void)
+{
+#define TRIM_PAGES 32
+    QUOTA_LIMITS OldLimits, Limits;
+    LARGE_INTEGER MaximumSize;
+    HANDLE Section;
+    PVOID BaseAddress = NULL;
+    SIZE_T ViewSize = 0;
+    volatile UCHAR *Pages;
+    ULONG Faults, i;
+    NTSTATUS Status;
+
+    /* Section pages are the ones which get trimmed through their mappings */
+    MaximumSize.QuadPart = TRIM_PAGES * PAGE_SIZE;
+    Status = NtCreateSection(&Section, SECTION_ALL_ACCESS, NULL, &MaximumSize,
+                             PAGE_READWRITE, SEC_COMMIT, NULL);
+    ok_hex(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status)) return;
+
+    Status = NtMapViewOfSection(Section, NtCurrentProcess(), &BaseAddress, 0, 0, NULL,
+                                &ViewSize, ViewUnmap, 0, PAGE_READWRITE);
+    ok_hex(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+    {
+        NtClose(Section);
+        return;
+    }
+
+    Pages = BaseAddress;
+    for (i = 0; i < TRIM_PAGES; i++)
+        Pages[i * PAGE_SIZE] = 1;
+
+    Status = NtQueryInformationProcess(NtCurrentProcess(), ProcessQuotaLimits,
+                                       &OldLimits, sizeof(OldLimits), NULL);
+    ok_hex(Status, STATUS_SUCCESS);
+
+    /*
+     * Lowering the maximum trims the pages which went unused for two samples, and every call takes one.
+     * The first page is used before each of them, the others only before the first one.
+     */
+    Limits = OldLimits;
+    Limits.MaximumWorkingSetSize = Limits.MinimumWorkingSetSize;
+    for (i = 0; i < 3; i++)
+    {
+        Pages[0] = 2;
+        Status = NtSetInformationProcess(NtCurrentProcess(), ProcessQuotaLimits,
+                                         &Limits, sizeof(Limits));
+        ok(NT_SUCCESS(Status), "NtSetInformationProcess failed with 0x%lx\n", Status);
+    }
+
+    /* The hot page survived */
+    Faults = GetPageFaultCount();
+    ok_eq_ulong((ULONG)Pages[0], 2UL);
+    ok_eq_ulong(GetPageFaultCount() - Faults, 0UL);
+
+    /* The cold ones didn't */
+    Faults = GetPageFaultCount();
+    for (i = 1; i < TRIM_PAGES; i++)
+        ok(Pages[i * PAGE_SIZE] == 1, "Page %lu lost its content\n", i);
+    Faults = GetPageFaultCount() - Faults;
+    ok(Faults > 0, "No cold page was trimmed\n");
+    trace("%lu of %d cold pages were trimmed\n", Faults, TRIM_PAGES - 1);
+
+    Status = NtSetInformationProcess(NtCurrentProcess(), ProcessQuotaLimits,
+                                     &OldLimits, sizeof(OldLimits));
+    ok(NT_SUCCESS(Status), "NtSetInformationProcess failed with 0x%lx\n", Status);
+
+    Status = NtUnmapViewOfSection(NtCurrentProcess(), BaseAddress);
+    ok_hex(Status, STATUS_SUCCESS);
+    NtClose(Section);
+#undef TRIM_PAGES
+}
+
 START_TEST(NtQueryInformationProcess)
 {
     NTSTATUS Status;
@@ -721,4 +844,6 @@ START_TEST(NtQueryInformationProcess)
     Test_ProcessPriorityClassAlignment();
     Test_ProcessWx86Information();
     Test_ProcQueryAlignmentProbe();
+    Test_ProcessVmCountersFaults();
+    Test_ProcessVmCountersTrim();
 }
@@ -7,6 +7,93 @@
 
 #include "precomp.h"
 
+static
+VOID
+TestLookasideInformation(VOID)
+{
+    SYSTEM_LOOKASIDE_INFORMATION Info[512];
+    ULONG ReturnLength, Count, i, PoolLists = 0;
+    NTSTATUS Status;
+
+    Status = NtQuerySystemInformation(SystemLookasideInformation, Info, 0, &ReturnLength);
+    ok_hex(Status, STATUS_INFO_LENGTH_MISMATCH);
+
+    ReturnLength = 0;
+    Status = NtQuerySystemInformation(SystemLookasideInformation, Info, sizeof(Info), &ReturnLength);
+    ok_hex(Status, STATUS_SUCCESS);
+    ok(ReturnLength % sizeof(Info[0]) == 0, "Unexpected length %lu\n", ReturnLength);
+
+    Count = ReturnLength / sizeof(Info[0]);
+    ok(Count != 0, "No lookaside lists\n");
+    for (i = 0; i < Count; i++)
+    {
+        ok(Info[i].CurrentDepth <= Info[i].MaximumDepth,
+           "List %lu depth %u above maximum %u\n", i, Info[i].CurrentDepth, Info[i].MaximumDepth);
+
+        /* The small pool lists come first, with one set per processor on MP */
+        if (Info[i].Tag == 'looP')
+        {
+            PoolLists++;
+            ok(Info[i].Size != 0, "List %lu has no size\n", i);
+        }
+    }
+    ok(PoolLists != 0, "No small pool lookaside lists\n");
+    ok(Info[0].Tag == 'looP', "Unexpected first tag 0x%lx\n", Info[0].Tag);
+}
+
+static
+VOID
+TestPoolTagInformation(VOID)
+{
+    SYSTEM_POOLTAG_INFORMATION Small;
+    PSYSTEM_POOLTAG_INFORMATION Info;
+    ULONG ReturnLength, Length, i;
+    BOOLEAN FoundPool = FALSE;
+    NTSTATUS Status;
+
+    /* A single entry is never enough and tells us the size */
+    ReturnLength = 0;
+    Status = NtQuerySystemInformation(SystemPoolTagInformation, &Small, sizeof(Small), &ReturnLength);
+    ok_hex(Status, STATUS_INFO_LENGTH_MISMATCH);
+    ok(ReturnLength > FIELD_OFFSET(SYSTEM_POOLTAG_INFORMATION, TagInfo), "Unexpected length %lu\n", ReturnLength);
+
+    /* Leave room for tags created in between */
+    Length = ReturnLength + 64 * sizeof(SYSTEM_POOLTAG);
+    Info = RtlAllocateHeap(RtlGetProcessHeap(), 0, Length);
+    if (!Info)
+    {
+        skip("Out of memory\n");
+        return;
+    }
+
+    Status = NtQuerySystemInformation(SystemPoolTagInformation, Info, Length, &ReturnLength);
+    ok_hex(Status, STATUS_SUCCESS);
+    if (NT_SUCCESS(Status))
+    {
+        ok(Info->Count != 0, "No pool tags\n");
+
+        /* Per-processor counters must add up to consistent totals */
+        for (i = 0; i < Info->Count; i++)
+        {
+            ok(Info->TagInfo[i].PagedAllocs >= Info->TagInfo[i].PagedFrees,
+               "Tag 0x%08lx: %lu paged allocations, %lu frees\n", Info->TagInfo[i].TagUlong,
+               Info->TagInfo[i].PagedAllocs, Info->TagInfo[i].PagedFrees);
+            ok(Info->TagInfo[i].NonPagedAllocs >= Info->TagInfo[i].NonPagedFrees,
+               "Tag 0x%08lx: %lu non-paged allocations, %lu frees\n", Info->TagInfo[i].TagUlong,
+               Info->TagInfo[i].NonPagedAllocs, Info->TagInfo[i].NonPagedFrees);
+
+            if (Info->TagInfo[i].TagUlong == 'looP')
+            {
+                FoundPool = TRUE;
+                ok(Info->TagInfo[i].NonPagedUsed != 0, "Pool tables are not accounted\n");
+            }
+        }
+        ok(FoundPool, "No pool tag for the pool itself\n");
+    }
+
+    RtlFreeHeap(RtlGetProcessHeap(), 0, Info);
+}
+
 START_TEST(NtQuerySystemInformation)
 {
     NTSTATUS Status;
@@ -16,4 +103,7 @@ START_TEST(NtQuerySystemInformation)
 
     Status = NtQuerySystemInformation(0x80000000, NULL, 0, NULL);
     ok_hex(Status, STATUS_INVALID_INFO_CLASS);
+
+    TestLookasideInformation();
+    TestPoolTagInformation();
 }
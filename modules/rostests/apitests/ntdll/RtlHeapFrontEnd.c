@@ -0,0 +1,216 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Test and benchmark for the low fragmentation heap front end
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include "precomp.h"
+
+#define BENCH_THREADS       4
+#define BENCH_ITERATIONS    200000
+#define BENCH_WORKING_SET   256
+
+typedef struct _BENCH_CONTEXT
+{
+    HANDLE HeapHandle;
+    ULONG Seed;
+    ULONG Failures;
+} BENCH_CONTEXT, *PBENCH_CONTEXT;
+
+static
+DWORD
+WINAPI
+BenchThread(LPVOID Parameter)
+{
+    PBENCH_CONTEXT Context = Parameter;
+    PVOID Blocks[BENCH_WORKING_SET] = { NULL };
+    ULONG i, Slot;
+    SIZE_T Size;
+
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        Slot = RtlRandom(&Context->Seed) % BENCH_WORKING_SET;
+        if (Blocks[Slot])
+        {
+            if (!RtlFreeHeap(Context->HeapHandle, 0, Blocks[Slot]))
+                Context->Failures++;
+        }
+
+        /* Mostly small blocks, like a typical service */
+        Size = 8 + (RtlRandom(&Context->Seed) % 248);
+        if ((i % 16) == 0)
+            Size += RtlRandom(&Context->Seed) % 1024;
+
+        Blocks[Slot] = RtlAllocateHeap(Context->HeapHandle, 0, Size);
+        if (!Blocks[Slot])
+            Context->Failures++;
+        else
+            *(volatile UCHAR *)Blocks[Slot] = (UCHAR)i;
+    }
+
+    for (Slot = 0; Slot < BENCH_WORKING_SET; Slot++)
+    {
+        if (Blocks[Slot])
+            RtlFreeHeap(Context->HeapHandle, 0, Blocks[Slot]);
+    }
+
+    return 0;
+}
+
+static
+ULONGLONG
+RunBenchmark(HANDLE HeapHandle)
+{
+    BENCH_CONTEXT Contexts[BENCH_THREADS];
+    HANDLE Threads[BENCH_THREADS];
+    LARGE_INTEGER Start, End, Frequency;
+    ULONG i;
+
+    NtQueryPerformanceCounter(&Start, &Frequency);
+
+    for (i = 0; i < BENCH_THREADS; i++)
+    {
+        Contexts[i].HeapHandle = HeapHandle;
+        Contexts[i].Seed = 0x1234 + i;
+        Contexts[i].Failures = 0;
+        Threads[i] = CreateThread(NULL, 0, BenchThread, &Contexts[i], 0, NULL);
+        ok(Threads[i] != NULL, "CreateThread failed with %lu\n", GetLastError());
+    }
+
+    for (i = 0; i < BENCH_THREADS; i++)
+    {
+        if (!Threads[i]) continue;
+        WaitForSingleObject(Threads[i], INFINITE);
+        CloseHandle(Threads[i]);
+        ok(Contexts[i].Failures == 0, "Thread %lu had %lu failures\n", i, Contexts[i].Failures);
+    }
+
+    NtQueryPerformanceCounter(&End, NULL);
+    return (End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart;
+}
+
+static
+VOID
+TestBlocks(HANDLE HeapHandle)
+{
+    PVOID Blocks[1100];
+    SIZE_T Size;
+    ULONG i, j;
+    BOOLEAN Zeroed;
+
+    /* Every size through the front end and back, sizes must be exact */
+    for (i = 0; i < RTL_NUMBER_OF(Blocks); i++)
+    {
+        Blocks[i] = RtlAllocateHeap(HeapHandle, 0, i);
+        ok(Blocks[i] != NULL, "Allocation of %lu bytes failed\n", i);
+        if (!Blocks[i]) continue;
+        RtlFillMemory(Blocks[i], i, 0xCC);
+        Size = RtlSizeHeap(HeapHandle, 0, Blocks[i]);
+        ok(Size == i, "RtlSizeHeap returned %Iu for %lu bytes\n", Size, i);
+    }
+
+    for (i = 0; i < RTL_NUMBER_OF(Blocks); i++)
+    {
+        ok(RtlFreeHeap(HeapHandle, 0, Blocks[i]), "Free of %lu bytes failed\n", i);
+    }
+
+    /* Recycled blocks must still honor HEAP_ZERO_MEMORY */
+    for (i = 0; i < RTL_NUMBER_OF(Blocks); i++)
+    {
+        Blocks[i] = RtlAllocateHeap(HeapHandle, HEAP_ZERO_MEMORY, i);
+        ok(Blocks[i] != NULL, "Allocation of %lu bytes failed\n", i);
+        if (!Blocks[i]) continue;
+
+        Zeroed = TRUE;
+        for (j = 0; j < i; j++)
+        {
+            if (((PUCHAR)Blocks[i])[j] != 0) Zeroed = FALSE;
+        }
+        ok(Zeroed, "Block of %lu bytes is not zeroed\n", i);
+    }
+
+    for (i = 0; i < RTL_NUMBER_OF(Blocks); i++)
+    {
+        RtlFreeHeap(HeapHandle, 0, Blocks[i]);
+    }
+
+    ok(RtlValidateHeap(HeapHandle, 0, NULL), "Heap is corrupted\n");
+}
+
+START_TEST(RtlHeapFrontEnd)
+{
+    RTL_HEAP_FRONT_END_INFORMATION Information;
+    HANDLE HeapHandle, NoSerializeHeap;
+    ULONG HeapType;
+    ULONGLONG BackEndTime, FrontEndTime;
+    NTSTATUS Status;
+
+    HeapHandle = RtlCreateHeap(HEAP_GROWABLE, NULL, 0, 0, NULL, NULL);
+    ok(HeapHandle != NULL, "RtlCreateHeap failed\n");
+    if (!HeapHandle) return;
+
+    Status = RtlQueryHeapInformation(HeapHandle, HeapCompatibilityInformation,
+                                     &HeapType, sizeof(HeapType), NULL);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok_eq_ulong(HeapType, 0UL);
+
+    /* Baseline with the back end only */
+    TestBlocks(HeapHandle);
+    BackEndTime = RunBenchmark(HeapHandle);
+
+    /* Only the LFH value is accepted */
+    HeapType = 1;
+    Status = RtlSetHeapInformation(HeapHandle, HeapCompatibilityInformation,
+                                   &HeapType, sizeof(HeapType));
+    ok_ntstatus(Status, STATUS_UNSUCCESSFUL);
+
+    HeapType = 2;
+    Status = RtlSetHeapInformation(HeapHandle, HeapCompatibilityInformation,
+                                   &HeapType, sizeof(HeapType));
+    ok_ntstatus(Status, STATUS_SUCCESS);
+
+    HeapType = 0;
+    Status = RtlQueryHeapInformation(HeapHandle, HeapCompatibilityInformation,
+                                     &HeapType, sizeof(HeapType), NULL);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok_eq_ulong(HeapType, 2UL);
+
+    TestBlocks(HeapHandle);
+    FrontEndTime = RunBenchmark(HeapHandle);
+    ok(RtlValidateHeap(HeapHandle, 0, NULL), "Heap is corrupted\n");
+
+    trace("%u threads x %u alloc/free: back end %I64u ms, front end %I64u ms\n",
+          BENCH_THREADS, BENCH_ITERATIONS, BackEndTime, FrontEndTime);
+
+    /* Statistics are a ReactOS extension */
+    Status = RtlQueryHeapInformation(HeapHandle, HeapFrontEndInformation,
+                                     &Information, sizeof(Information), NULL);
+    if (Status == STATUS_SUCCESS)
+    {
+        ok_eq_ulong(Information.FrontEndHeapType, 2UL);
+        ok(Information.Hits != 0, "No front end hits\n");
+        ok(Information.Frees != 0, "No front end frees\n");
+        trace("Front end: %lu hits, %lu misses, %lu frees, %lu overflows, %Iu cached\n",
+              Information.Hits, Information.Misses, Information.Frees,
+              Information.Overflows, Information.CachedBlocks);
+    }
+    else
+    {
+        skip("HeapFrontEndInformation is not supported\n");
+    }
+
+    RtlDestroyHeap(HeapHandle);
+
+    /* The front end runs without the heap lock */
+    NoSerializeHeap = RtlCreateHeap(HEAP_GROWABLE | HEAP_NO_SERIALIZE, NULL, 0, 0, NULL, NULL);
+    ok(NoSerializeHeap != NULL, "RtlCreateHeap failed\n");
+    if (NoSerializeHeap)
+    {
+        HeapType = 2;
+        Status = RtlSetHeapInformation(NoSerializeHeap, HeapCompatibilityInformation,
+                                       &HeapType, sizeof(HeapType));
+        ok(!NT_SUCCESS(Status), "Enabling the LFH on a HEAP_NO_SERIALIZE heap succeeded\n");
+        RtlDestroyHeap(NoSerializeHeap);
+    }
+}
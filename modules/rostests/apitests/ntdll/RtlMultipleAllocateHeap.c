@@ -267,6 +267,96 @@ MultiHeapFreeTest()
     TEST_FREE(3, -1, 0, HeapHandle, 0, 3, Array);
 }
 
+static void
+MultiHeapBatchTest()
+{
+    static PVOID Array[1000];
+    HANDLE HeapHandle;
+    PVOID Pages, *Edge;
+    ULONG i, j, ret, OldProtect;
+    NTSTATUS Threw;
+    BOOL Zeroed;
+
+    HeapHandle = HeapCreate(0, 0, 0);
+    ok(HeapHandle != NULL, "HeapCreate failed\n");
+    if (!HeapHandle)
+        return;
+
+    // Many blocks at once must all be distinct, zeroed and of the right size
+    ret = g_alloc(HeapHandle, HEAP_ZERO_MEMORY, 24, _countof(Array), Array);
+    INT_EXPECTED(ret, (ULONG)_countof(Array));
+    for (i = 0; i < ret; i++)
+    {
+        ok(HeapSize(HeapHandle, 0, Array[i]) == 24, "Array[%lu] has wrong size\n", i);
+
+        Zeroed = TRUE;
+        for (j = 0; j < 24; j++)
+        {
+            if (((PUCHAR)Array[i])[j] != 0) Zeroed = FALSE;
+        }
+        ok(Zeroed, "Array[%lu] is not zeroed\n", i);
+        FillMemory(Array[i], 24, 0xA5);
+    }
+    ok(HeapValidate(HeapHandle, 0, NULL), "Heap is corrupted\n");
+
+    // Free every other block, then the rest in reverse order
+    for (i = 0; i < _countof(Array); i += 2)
+    {
+        Array[i / 2] = Array[i];
+        Array[_countof(Array) / 2 + i / 2] = Array[i + 1];
+    }
+    ret = g_free(HeapHandle, 0, _countof(Array) / 2, Array);
+    INT_EXPECTED(ret, (ULONG)_countof(Array) / 2);
+    ok(HeapValidate(HeapHandle, 0, NULL), "Heap is corrupted\n");
+
+    for (i = 0; i < _countof(Array) / 4; i++)
+    {
+        PVOID Temp = Array[_countof(Array) / 2 + i];
+        Array[_countof(Array) / 2 + i] = Array[_countof(Array) - 1 - i];
+        Array[_countof(Array) - 1 - i] = Temp;
+    }
+    ret = g_free(HeapHandle, 0, _countof(Array) / 2, &Array[_countof(Array) / 2]);
+    INT_EXPECTED(ret, (ULONG)_countof(Array) / 2);
+    ok(HeapValidate(HeapHandle, 0, NULL), "Heap is corrupted\n");
+
+    // A block passed twice is only freed once
+    ret = g_alloc(HeapHandle, 0, 24, 2, Array);
+    INT_EXPECTED(ret, 2);
+    Array[2] = Array[0];
+    SetLastError(-1);
+    ret = g_free(HeapHandle, 0, 3, Array);
+    INT_EXPECTED(ret, 2);
+    ok(GetLastError() == ERROR_INVALID_PARAMETER, "Unexpected error %lu\n", GetLastError());
+    ok(HeapValidate(HeapHandle, 0, NULL), "Heap is corrupted\n");
+
+    // An array running into an inaccessible page faults, and leaves the heap consistent
+    Pages = VirtualAlloc(NULL, 2 * PAGE_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    ok(Pages != NULL, "VirtualAlloc failed\n");
+    if (Pages && VirtualProtect((PUCHAR)Pages + PAGE_SIZE, PAGE_SIZE, PAGE_NOACCESS, &OldProtect))
+    {
+        Edge = (PVOID *)((PUCHAR)Pages + PAGE_SIZE) - 2;
+        ret = g_alloc(HeapHandle, 0, 24, 2, Edge);
+        INT_EXPECTED(ret, 2);
+
+        Threw = 0;
+        _SEH2_TRY
+        {
+            g_free(HeapHandle, 0, 3, Edge);
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            Threw = _SEH2_GetExceptionCode();
+        }
+        _SEH2_END;
+        ok(Threw == STATUS_ACCESS_VIOLATION, "Unexpected exception 0x%lx\n", Threw);
+        ok(HeapValidate(HeapHandle, 0, NULL), "Heap is corrupted\n");
+    }
+    if (Pages)
+        VirtualFree(Pages, 0, MEM_RELEASE);
+
+    HeapDestroy(HeapHandle);
+}
+
 START_TEST(RtlMultipleAllocateHeap)
 {
     HINSTANCE ntdll = LoadLibraryA("ntdll");
@@ -282,6 +372,7 @@ START_TEST(RtlMultipleAllocateHeap)
     {
         MultiHeapAllocTest();
         MultiHeapFreeTest();
+        MultiHeapBatchTest();
     }
 
     FreeLibrary(ntdll);
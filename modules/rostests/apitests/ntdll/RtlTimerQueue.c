@@ -0,0 +1,168 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Test and benchmark for the Rtl timer queue
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include "precomp.h"
+
+#define ORDER_TIMERS    16
+#define BENCH_TIMERS    100000
+
+static LONG FiredCount;
+static LONG FiredOrder[ORDER_TIMERS];
+static HANDLE AllFiredEvent;
+
+static
+VOID
+NTAPI
+OrderCallback(
+    PVOID Parameter,
+    BOOLEAN TimerOrWaitFired)
+{
+    LONG Index = InterlockedIncrement(&FiredCount) - 1;
+
+    if (Index < ORDER_TIMERS)
+        FiredOrder[Index] = (LONG)(ULONG_PTR)Parameter;
+    if (Index == ORDER_TIMERS - 1)
+        SetEvent(AllFiredEvent);
+}
+
+static
+VOID
+NTAPI
+NeverCallback(
+    PVOID Parameter,
+    BOOLEAN TimerOrWaitFired)
+{
+    ok(0, "Timer %p fired\n", Parameter);
+}
+
+static
+ULONGLONG
+ElapsedMs(
+    PLARGE_INTEGER Start)
+{
+    LARGE_INTEGER End, Frequency;
+
+    QueryPerformanceCounter(&End);
+    QueryPerformanceFrequency(&Frequency);
+    return (End.QuadPart - Start->QuadPart) * 1000 / Frequency.QuadPart;
+}
+
+static
+VOID
+TestOrder(VOID)
+{
+    HANDLE TimerQueue, Timers[ORDER_TIMERS];
+    NTSTATUS Status;
+    ULONG i;
+
+    Status = RtlCreateTimerQueue(&TimerQueue);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+        return;
+
+    /* Insert them out of order, and move every other one to a later slot */
+    FiredCount = 0;
+    for (i = 0; i < ORDER_TIMERS; i++)
+    {
+        Status = RtlCreateTimer(TimerQueue, &Timers[i], OrderCallback, (PVOID)(ULONG_PTR)i,
+                                100 + 20 * (ORDER_TIMERS - 1 - i), 0, WT_EXECUTEINTIMERTHREAD);
+        ok_ntstatus(Status, STATUS_SUCCESS);
+    }
+    for (i = 0; i < ORDER_TIMERS; i += 2)
+    {
+        Status = RtlUpdateTimer(TimerQueue, Timers[i], 100 + 20 * (ORDER_TIMERS + i), 0);
+        ok_ntstatus(Status, STATUS_SUCCESS);
+    }
+
+    ok(WaitForSingleObject(AllFiredEvent, 5000) == WAIT_OBJECT_0, "Timers didn't fire\n");
+    ok_long(FiredCount, ORDER_TIMERS);
+
+    /* The odd ones first, latest created first, then the moved even ones */
+    for (i = 0; i < ORDER_TIMERS / 2; i++)
+    {
+        ok(FiredOrder[i] == (LONG)(ORDER_TIMERS - 1 - 2 * i),
+           "Slot %lu fired timer %ld\n", i, FiredOrder[i]);
+        ok(FiredOrder[ORDER_TIMERS / 2 + i] == (LONG)(2 * i),
+           "Slot %lu fired timer %ld\n", ORDER_TIMERS / 2 + i, FiredOrder[ORDER_TIMERS / 2 + i]);
+    }
+
+    Status = RtlDeleteTimerQueueEx(TimerQueue, INVALID_HANDLE_VALUE);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+}
+
+static
+VOID
+BenchCreateResetCancel(VOID)
+{
+    HANDLE TimerQueue, *Timers;
+    ULONGLONG CreateTime, UpdateTime, DeleteTime;
+    LARGE_INTEGER Start;
+    NTSTATUS Status;
+    ULONG i, Created;
+
+    Timers = HeapAlloc(GetProcessHeap(), 0, BENCH_TIMERS * sizeof(HANDLE));
+    ok(Timers != NULL, "HeapAlloc failed\n");
+    if (!Timers)
+        return;
+
+    Status = RtlCreateTimerQueue(&TimerQueue);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+    {
+        HeapFree(GetProcessHeap(), 0, Timers);
+        return;
+    }
+
+    /* Connection style timeouts: far away, spread out, and not inserted in order */
+    QueryPerformanceCounter(&Start);
+    for (Created = 0; Created < BENCH_TIMERS; Created++)
+    {
+        Status = RtlCreateTimer(TimerQueue, &Timers[Created], NeverCallback, (PVOID)(ULONG_PTR)Created,
+                                3600000 + (Created * 7919) % BENCH_TIMERS, 0, 0);
+        if (!NT_SUCCESS(Status))
+        {
+            ok_ntstatus(Status, STATUS_SUCCESS);
+            break;
+        }
+    }
+    CreateTime = ElapsedMs(&Start);
+
+    /* Only touch the timers which were actually created */
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < Created; i++)
+    {
+        RtlUpdateTimer(TimerQueue, Timers[i], 3600000 + (i * 104729) % BENCH_TIMERS, 0);
+    }
+    UpdateTime = ElapsedMs(&Start);
+
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < Created; i++)
+    {
+        RtlDeleteTimer(TimerQueue, Timers[i], NULL);
+    }
+    DeleteTime = ElapsedMs(&Start);
+
+    trace("%lu timers: create %I64u ms, reset %I64u ms, cancel %I64u ms\n",
+          Created, CreateTime, UpdateTime, DeleteTime);
+
+    Status = RtlDeleteTimerQueueEx(TimerQueue, INVALID_HANDLE_VALUE);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    HeapFree(GetProcessHeap(), 0, Timers);
+}
+
+START_TEST(RtlTimerQueue)
+{
+    AllFiredEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    ok(AllFiredEvent != NULL, "CreateEventW failed with %lu\n", GetLastError());
+    if (!AllFiredEvent)
+        return;
+
+    TestOrder();
+    BenchCreateResetCancel();
+
+    CloseHandle(AllFiredEvent);
+}
@@ -0,0 +1,376 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Round-trip and throughput test for the Rtl compression engine
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include <rtltests.h>
+
+#define CORPUS_TEXT_SIZE    (256 * 1024)
+#define CORPUS_RANDOM_SIZE  (64 * 1024)
+#define CORPUS_ZERO_SIZE    (64 * 1024)
+#define BENCH_ITERATIONS    4
+
+typedef struct _CORPUS_ENTRY
+{
+    PCSTR Name;
+    PUCHAR Buffer;
+    ULONG Size;
+} CORPUS_ENTRY, *PCORPUS_ENTRY;
+
+static PVOID
+Alloc(SIZE_T Size)
+{
+    return RtlAllocateHeap(RtlGetProcessHeap(), HEAP_ZERO_MEMORY, Size);
+}
+
+static VOID
+Free(PVOID Buffer)
+{
+    RtlFreeHeap(RtlGetProcessHeap(), 0, Buffer);
+}
+
+/* Throughput in MB/s (bytes per microsecond) */
+static ULONG
+Throughput(ULONGLONG Bytes, LARGE_INTEGER Start, LARGE_INTEGER End, LARGE_INTEGER Frequency)
+{
+    ULONGLONG Microseconds;
+
+    Microseconds = (End.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart;
+    return (ULONG)(Bytes / max(Microseconds, 1));
+}
+
+static
+VOID
+FillText(
+    _Out_writes_bytes_(Size) PUCHAR Buffer,
+    _In_ ULONG Size)
+{
+    static PCSTR Words[] = { "Compress ", "Buffer ", "Chunk ", "Workspace ",
+                             "ReactOS ", "NTFS ", "cluster ", "\r\n" };
+    ULONG Seed = 0x1234, Offset = 0, Length;
+    PCSTR Word;
+
+    while (Offset < Size)
+    {
+        Word = Words[RtlRandom(&Seed) % RTL_NUMBER_OF(Words)];
+        Length = min((ULONG)strlen(Word), Size - Offset);
+        RtlCopyMemory(Buffer + Offset, Word, Length);
+        Offset += Length;
+    }
+}
+
+static
+VOID
+TestRoundTrip(
+    _In_ USHORT FormatAndEngine,
+    _In_ PCORPUS_ENTRY Entry)
+{
+    ULONG BufferWorkSpaceSize, FragmentWorkSpaceSize;
+    ULONG CompressedSize, FinalSize, FragmentOffset, Iteration;
+    LARGE_INTEGER Frequency, Start, Middle, End;
+    PVOID FragmentWorkSpace;
+    PUCHAR Compressed, Decompressed;
+    PVOID WorkSpace;
+    NTSTATUS Status;
+
+    Status = RtlGetCompressionWorkSpaceSize(FormatAndEngine,
+                                            &BufferWorkSpaceSize,
+                                            &FragmentWorkSpaceSize);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+        return;
+
+    WorkSpace = Alloc(BufferWorkSpaceSize);
+    Compressed = Alloc(Entry->Size + Entry->Size / 8 + 0x1000);
+    Decompressed = Alloc(Entry->Size + 1);
+    if (!WorkSpace || !Compressed || !Decompressed)
+    {
+        skip("Out of memory\n");
+        goto Cleanup;
+    }
+
+    NtQueryPerformanceCounter(&Start, &Frequency);
+    for (Iteration = 0; Iteration < BENCH_ITERATIONS; Iteration++)
+    {
+        Status = RtlCompressBuffer(FormatAndEngine,
+                                   Entry->Buffer,
+                                   Entry->Size,
+                                   Compressed,
+                                   Entry->Size + Entry->Size / 8 + 0x1000,
+                                   0x1000,
+                                   &CompressedSize,
+                                   WorkSpace);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+    }
+    NtQueryPerformanceCounter(&Middle, NULL);
+    for (Iteration = 0; Iteration < BENCH_ITERATIONS; Iteration++)
+    {
+        Decompressed[Entry->Size] = 0x55;
+        Status = RtlDecompressBuffer(FormatAndEngine,
+                                     Decompressed,
+                                     Entry->Size,
+                                     Compressed,
+                                     CompressedSize,
+                                     &FinalSize);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+    }
+    NtQueryPerformanceCounter(&End, NULL);
+
+    ok(FinalSize == Entry->Size, "%s: FinalSize = %lu, expected %lu\n",
+       Entry->Name, FinalSize, Entry->Size);
+    ok(RtlEqualMemory(Decompressed, Entry->Buffer, Entry->Size),
+       "%s: round trip mismatch for format 0x%04x\n", Entry->Name, FormatAndEngine);
+    ok(Decompressed[Entry->Size] == 0x55, "%s: buffer overrun\n", Entry->Name);
+
+    /* Decompress a fragment from the middle of the data */
+    FragmentOffset = Entry->Size / 3;
+    FragmentWorkSpace = Alloc(FragmentWorkSpaceSize);
+    if (FragmentWorkSpace)
+    {
+        Status = RtlDecompressFragment(FormatAndEngine,
+                                       Decompressed,
+                                       0x1000,
+                                       Compressed,
+                                       CompressedSize,
+                                       FragmentOffset,
+                                       &FinalSize,
+                                       FragmentWorkSpace);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+        ok(FinalSize == min(0x1000, Entry->Size - FragmentOffset),
+           "%s: fragment FinalSize = %lu\n", Entry->Name, FinalSize);
+        ok(RtlEqualMemory(Decompressed, Entry->Buffer + FragmentOffset, FinalSize),
+           "%s: fragment mismatch for format 0x%04x\n", Entry->Name, FormatAndEngine);
+        Free(FragmentWorkSpace);
+    }
+
+    trace("0x%04x %-8s %8lu -> %8lu bytes (%3lu%%), compress %4lu MB/s, decompress %4lu MB/s\n",
+          FormatAndEngine, Entry->Name, Entry->Size, CompressedSize,
+          (ULONG)((ULONGLONG)CompressedSize * 100 / Entry->Size),
+          Throughput((ULONGLONG)Entry->Size * BENCH_ITERATIONS, Start, Middle, Frequency),
+          Throughput((ULONGLONG)Entry->Size * BENCH_ITERATIONS, Middle, End, Frequency));
+
+Cleanup:
+    Free(Decompressed);
+    Free(Compressed);
+    Free(WorkSpace);
+}
+
+static
+VOID
+TestChunks(
+    _In_ PCORPUS_ENTRY Entry)
+{
+    ULONG BufferWorkSpaceSize, FragmentWorkSpaceSize;
+    ULONG NumberOfChunks, InfoLength, TotalSize, HeadSize, Chunk;
+    PCOMPRESSED_DATA_INFO Info = NULL;
+    PUCHAR Compressed = NULL, Decompressed = NULL;
+    PVOID WorkSpace = NULL;
+    NTSTATUS Status;
+
+    Status = RtlGetCompressionWorkSpaceSize(COMPRESSION_FORMAT_LZNT1,
+                                            &BufferWorkSpaceSize,
+                                            &FragmentWorkSpaceSize);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+
+    NumberOfChunks = (Entry->Size + 0xFFF) >> 12;
+    InfoLength = FIELD_OFFSET(COMPRESSED_DATA_INFO, CompressedChunkSizes[NumberOfChunks]);
+    Info = Alloc(InfoLength);
+    WorkSpace = Alloc(BufferWorkSpaceSize);
+    Compressed = Alloc(Entry->Size);
+    Decompressed = Alloc(Entry->Size);
+    if (!Info || !WorkSpace || !Compressed || !Decompressed)
+    {
+        skip("Out of memory\n");
+        goto Cleanup;
+    }
+
+    Info->CompressionFormatAndEngine = COMPRESSION_FORMAT_LZNT1;
+    Info->CompressionUnitShift = 16;
+    Info->ChunkShift = 12;
+    Info->ClusterShift = 9;
+
+    Status = RtlCompressChunks(Entry->Buffer, Entry->Size, Compressed, Entry->Size,
+                               Info, InfoLength - sizeof(ULONG), WorkSpace);
+    ok_eq_hex(Status, STATUS_BUFFER_TOO_SMALL);
+
+    Status = RtlCompressChunks(Entry->Buffer, Entry->Size, Compressed, Entry->Size,
+                               Info, InfoLength, WorkSpace);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok_eq_ulong((ULONG)Info->NumberOfChunks, NumberOfChunks);
+
+    TotalSize = 0;
+    for (Chunk = 0; Chunk < Info->NumberOfChunks; Chunk++)
+    {
+        ok(Info->CompressedChunkSizes[Chunk] <= 0x1000,
+           "%s: chunk %lu has size %lu\n", Entry->Name, Chunk, Info->CompressedChunkSizes[Chunk]);
+        TotalSize += Info->CompressedChunkSizes[Chunk];
+    }
+
+    /* Split the compressed data at the chunk boundary half way through */
+    HeadSize = 0;
+    for (Chunk = 0; Chunk < Info->NumberOfChunks / 2; Chunk++)
+        HeadSize += Info->CompressedChunkSizes[Chunk];
+
+    Status = RtlDecompressChunks(Decompressed, Entry->Size,
+                                 Compressed, HeadSize,
+                                 Compressed + HeadSize, TotalSize - HeadSize,
+                                 Info);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok(RtlEqualMemory(Decompressed, Entry->Buffer, Entry->Size),
+       "%s: chunk round trip mismatch\n", Entry->Name);
+
+Cleanup:
+    Free(Decompressed);
+    Free(Compressed);
+    Free(WorkSpace);
+    Free(Info);
+}
+
+static
+VOID
+TestChunksPartial(
+    _In_ PCORPUS_ENTRY Entry)
+{
+    ULONG BufferWorkSpaceSize, FragmentWorkSpaceSize;
+    ULONG NumberOfChunks, InfoLength, CompressedSize, TotalSize, Size, Chunk, i;
+    PCOMPRESSED_DATA_INFO Info = NULL;
+    PUCHAR Compressed = NULL, Decompressed = NULL;
+    PVOID WorkSpace = NULL;
+    NTSTATUS Status;
+
+    Status = RtlGetCompressionWorkSpaceSize(COMPRESSION_FORMAT_LZNT1,
+                                            &BufferWorkSpaceSize,
+                                            &FragmentWorkSpaceSize);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+
+    /* Uncompressed chunks take a whole chunk, even the short last one */
+    NumberOfChunks = (Entry->Size + 0xFFF) >> 12;
+    CompressedSize = NumberOfChunks << 12;
+    InfoLength = FIELD_OFFSET(COMPRESSED_DATA_INFO, CompressedChunkSizes[NumberOfChunks]);
+    Info = Alloc(InfoLength);
+    WorkSpace = Alloc(BufferWorkSpaceSize);
+    Compressed = Alloc(CompressedSize);
+    Decompressed = Alloc(CompressedSize + 0x1000);
+    if (!Info || !WorkSpace || !Compressed || !Decompressed)
+    {
+        skip("Out of memory\n");
+        goto Cleanup;
+    }
+
+    Info->CompressionFormatAndEngine = COMPRESSION_FORMAT_LZNT1;
+    Info->CompressionUnitShift = 16;
+    Info->ChunkShift = 12;
+    Info->ClusterShift = 9;
+
+    Status = RtlCompressChunks(Entry->Buffer, Entry->Size, Compressed, CompressedSize,
+                               Info, InfoLength, WorkSpace);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+        goto Cleanup;
+
+    TotalSize = 0;
+    for (Chunk = 0; Chunk < Info->NumberOfChunks; Chunk++)
+        TotalSize += Info->CompressedChunkSizes[Chunk];
+
+    /* An output buffer larger than the original gets zeros past its end */
+    RtlFillMemory(Decompressed, CompressedSize + 0x1000, 0xCC);
+    Status = RtlDecompressChunks(Decompressed, CompressedSize + 0x1000,
+                                 Compressed, TotalSize, NULL, 0, Info);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    ok(RtlEqualMemory(Decompressed, Entry->Buffer, Entry->Size),
+       "%s: oversized chunk round trip mismatch\n", Entry->Name);
+    for (i = Entry->Size; i < CompressedSize; i++)
+        if (Decompressed[i]) break;
+    ok(i == CompressedSize, "%s: byte %lu past the end is 0x%02x\n", Entry->Name, i, Decompressed[i]);
+
+    /* Prefixes ending inside the second chunk, including at the size of its compressed data */
+    for (i = 0; i < 3; i++)
+    {
+        Size = 0x1000 + (i == 0 ? 1 : i == 1 ? Info->CompressedChunkSizes[1] : 0xFFF);
+        if (Size > Entry->Size)
+            continue;
+
+        RtlFillMemory(Decompressed, Size + 1, 0xCC);
+        Status = RtlDecompressChunks(Decompressed, Size, Compressed, TotalSize, NULL, 0, Info);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+        ok(RtlEqualMemory(Decompressed, Entry->Buffer, Size),
+           "%s: prefix of %lu bytes mismatch\n", Entry->Name, Size);
+        ok(Decompressed[Size] == 0xCC, "%s: prefix of %lu bytes overflowed\n", Entry->Name, Size);
+    }
+
+Cleanup:
+    Free(Decompressed);
+    Free(Compressed);
+    Free(WorkSpace);
+    Free(Info);
+}
+
+START_TEST(RtlCompression)
+{
+    static const USHORT Formats[] =
+    {
+        COMPRESSION_FORMAT_LZNT1 | COMPRESSION_ENGINE_STANDARD,
+        COMPRESSION_FORMAT_LZNT1 | COMPRESSION_ENGINE_MAXIMUM,
+        COMPRESSION_FORMAT_XPRESS | COMPRESSION_ENGINE_STANDARD,
+        COMPRESSION_FORMAT_XPRESS | COMPRESSION_ENGINE_MAXIMUM,
+        COMPRESSION_FORMAT_XPRESS_HUFF | COMPRESSION_ENGINE_STANDARD,
+        COMPRESSION_FORMAT_XPRESS_HUFF | COMPRESSION_ENGINE_MAXIMUM,
+    };
+    CORPUS_ENTRY Corpus[5];
+    PIMAGE_NT_HEADERS NtHeaders;
+    PUCHAR Text, Random, Zeros;
+    ULONG Seed = 42, i, j;
+
+    Text = Alloc(CORPUS_TEXT_SIZE);
+    Random = Alloc(CORPUS_RANDOM_SIZE);
+    Zeros = Alloc(CORPUS_ZERO_SIZE);
+    if (!Text || !Random || !Zeros)
+    {
+        skip("Out of memory\n");
+        goto Cleanup;
+    }
+
+    FillText(Text, CORPUS_TEXT_SIZE);
+    for (i = 0; i < CORPUS_RANDOM_SIZE; i++)
+        Random[i] = (UCHAR)RtlRandom(&Seed);
+
+    /* Our own mapped image is a reasonable stand-in for executable data */
+    NtHeaders = RtlImageNtHeader(NtCurrentPeb()->ImageBaseAddress);
+
+    Corpus[0].Name = "text";
+    Corpus[0].Buffer = Text;
+    Corpus[0].Size = CORPUS_TEXT_SIZE;
+    Corpus[1].Name = "random";
+    Corpus[1].Buffer = Random;
+    Corpus[1].Size = CORPUS_RANDOM_SIZE;
+    Corpus[2].Name = "zeros";
+    Corpus[2].Buffer = Zeros;
+    Corpus[2].Size = CORPUS_ZERO_SIZE;
+    Corpus[3].Name = "image";
+    Corpus[3].Buffer = NtCurrentPeb()->ImageBaseAddress;
+    Corpus[3].Size = NtHeaders->OptionalHeader.SizeOfImage;
+    Corpus[4].Name = "odd";
+    Corpus[4].Buffer = Text + 17;
+    Corpus[4].Size = 0x1000 * 3 + 5;
+
+    for (i = 0; i < RTL_NUMBER_OF(Formats); i++)
+    {
+        for (j = 0; j < RTL_NUMBER_OF(Corpus); j++)
+            TestRoundTrip(Formats[i], &Corpus[j]);
+    }
+
+    for (j = 0; j < RTL_NUMBER_OF(Corpus); j++)
+        TestChunks(&Corpus[j]);
+
+    /* Chunks of text compress, random ones don't, and both end with a short chunk */
+    TestChunksPartial(&Corpus[4]);
+    Corpus[1].Size = 0x1000 * 2 + 0x123;
+    TestChunksPartial(&Corpus[1]);
+
+Cleanup:
+    Free(Zeros);
+    Free(Random);
+    Free(Text);
+}
@@ -4,11 +4,13 @@
 #include <apitest.h>
 
 extern void func_RtlCaptureContext(void);
+extern void func_RtlCompression(void);
 extern void func_RtlIntSafe(void);
 extern void func_RtlUnwind(void);
 
 const struct test winetest_testlist[] =
 {
+    { "RtlCompression",           func_RtlCompression },
     { "RtlIntSafe",               func_RtlIntSafe },
 
 #ifdef _M_IX86
@@ -0,0 +1,49 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Test for NtGdiGetStats
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include "../win32nt.h"
+
+START_TEST(NtGdiGetStats)
+{
+    FONT_CACHE_STATISTICS Before, After;
+    HBITMAP hbm;
+    NTSTATUS Status;
+    HDC hdc;
+
+    Status = NtGdiGetStats(GetCurrentProcess(), GS_GLYPH_CACHE, 0, &Before, sizeof(Before));
+    if (!NT_SUCCESS(Status))
+    {
+        skip("The glyph cache counters are not available: 0x%lx\n", Status);
+        return;
+    }
+
+    ok(Before.CurrentBytes <= Before.MaximumBytes, "%Iu bytes cached out of %Iu\n",
+       Before.CurrentBytes, Before.MaximumBytes);
+
+    /* Too small and invalid buffers */
+    ok_hex(NtGdiGetStats(GetCurrentProcess(), GS_GLYPH_CACHE, 0, &After, sizeof(After) - 1),
+           STATUS_BUFFER_TOO_SMALL);
+    ok_hex(NtGdiGetStats(GetCurrentProcess(), GS_GLYPH_CACHE, 0, (PVOID)1, sizeof(After)),
+           STATUS_ACCESS_VIOLATION);
+
+    /* Draw the same text twice, the second time must come from the cache */
+    hdc = CreateCompatibleDC(NULL);
+    hbm = CreateCompatibleBitmap(hdc, 100, 20);
+    SelectObject(hdc, hbm);
+    SelectObject(hdc, GetStockObject(DEFAULT_GUI_FONT));
+    ok(TextOutW(hdc, 0, 0, L"Glyph cache", 11), "TextOutW failed\n");
+    ok(TextOutW(hdc, 0, 0, L"Glyph cache", 11), "TextOutW failed\n");
+
+    ok_hex(NtGdiGetStats(GetCurrentProcess(), GS_GLYPH_CACHE, 0, &After, sizeof(After)),
+           STATUS_SUCCESS);
+    ok(After.Hits >= Before.Hits + 11, "Hits went from %I64u to %I64u\n", Before.Hits, After.Hits);
+    ok(After.Misses >= Before.Misses, "Misses went from %I64u to %I64u\n", Before.Misses, After.Misses);
+    ok(After.NumEntries > 0, "The cache is empty\n");
+
+    DeleteDC(hdc);
+    DeleteObject(hbm);
+}
@@ -26,6 +26,7 @@ extern void func_NtGdiGetBitmapBits(void);
 extern void func_NtGdiGetDIBitsInternal(void);
 extern void func_NtGdiGetFontResourceInfoInternalW(void);
 extern void func_NtGdiGetRandomRgn(void);
+extern void func_NtGdiGetStats(void);
 extern void func_NtGdiGetStockObject(void);
 extern void func_NtGdiIntersectClipRect(void);
 extern void func_NtGdiLineTo(void);
@@ -97,6 +98,7 @@ const struct test winetest_testlist[] =
     { "NtGdiGetDIBitsInternal", func_NtGdiGetDIBitsInternal },
     //{ "NtGdiGetFontResourceInfoInternalW", func_NtGdiGetFontResourceInfoInternalW },
     { "NtGdiGetRandomRgn", func_NtGdiGetRandomRgn },
+    { "NtGdiGetStats", func_NtGdiGetStats },
     { "NtGdiGetStockObject", func_NtGdiGetStockObject },
     { "NtGdiIntersectClipRect", func_NtGdiIntersectClipRect },
     { "NtGdiLineTo", func_NtGdiLineTo },
@@ -0,0 +1,381 @@
+/*
+ * PROJECT:     ReactOS kernel-mode tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Test driver measuring VACB lookup time against file size
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include <kmt_test.h>
+
+#define NDEBUG
+#include <debug.h>
+
+#define IOCTL_START_TEST  1
+#define IOCTL_FINISH_TEST 2
+
+#define LOOKUP_ITERATIONS 20000
+
+typedef struct _TEST_FCB
+{
+    FSRTL_ADVANCED_FCB_HEADER Header;
+    SECTION_OBJECT_POINTERS SectionObjectPointers;
+    FAST_MUTEX HeaderMutex;
+} TEST_FCB, *PTEST_FCB;
+
+/* Number of views mapped for each test, the file is exactly that large */
+static const ULONG ViewCounts[] = { 8, 64, 256 };
+
+static ULONG TestTestId = -1;
+static PFILE_OBJECT TestFileObject;
+static PDEVICE_OBJECT TestDeviceObject;
+static KMT_IRP_HANDLER TestIrpHandler;
+static KMT_MESSAGE_HANDLER TestMessageHandler;
+static ULONGLONG LookupTime[RTL_NUMBER_OF(ViewCounts)];
+
+NTSTATUS
+TestEntry(
+    _In_ PDRIVER_OBJECT DriverObject,
+    _In_ PCUNICODE_STRING RegistryPath,
+    _Out_ PCWSTR *DeviceName,
+    _Inout_ INT *Flags)
+{
+    PAGED_CODE();
+
+    UNREFERENCED_PARAMETER(RegistryPath);
+
+    *DeviceName = L"CcVacbLookup";
+    *Flags = TESTENTRY_NO_EXCLUSIVE_DEVICE |
+             TESTENTRY_BUFFERED_IO_DEVICE |
+             TESTENTRY_NO_READONLY_DEVICE;
+
+    KmtRegisterIrpHandler(IRP_MJ_READ, NULL, TestIrpHandler);
+    KmtRegisterMessageHandler(0, NULL, TestMessageHandler);
+
+    return STATUS_SUCCESS;
+}
+
+VOID
+TestUnload(
+    _In_ PDRIVER_OBJECT DriverObject)
+{
+    PAGED_CODE();
+}
+
+BOOLEAN
+NTAPI
+AcquireForLazyWrite(
+    _In_ PVOID Context,
+    _In_ BOOLEAN Wait)
+{
+    return TRUE;
+}
+
+VOID
+NTAPI
+ReleaseFromLazyWrite(
+    _In_ PVOID Context)
+{
+    return;
+}
+
+BOOLEAN
+NTAPI
+AcquireForReadAhead(
+    _In_ PVOID Context,
+    _In_ BOOLEAN Wait)
+{
+    return TRUE;
+}
+
+VOID
+NTAPI
+ReleaseFromReadAhead(
+    _In_ PVOID Context)
+{
+    return;
+}
+
+static CACHE_MANAGER_CALLBACKS Callbacks = {
+    AcquireForLazyWrite,
+    ReleaseFromLazyWrite,
+    AcquireForReadAhead,
+    ReleaseFromReadAhead,
+};
+
+static
+PVOID
+MapAndLockUserBuffer(
+    _In_ _Out_ PIRP Irp,
+    _In_ ULONG BufferLength)
+{
+    PMDL Mdl;
+
+    if (Irp->MdlAddress == NULL)
+    {
+        Mdl = IoAllocateMdl(Irp->UserBuffer, BufferLength, FALSE, FALSE, Irp);
+        if (Mdl == NULL)
+        {
+            return NULL;
+        }
+
+        _SEH2_TRY
+        {
+            MmProbeAndLockPages(Mdl, Irp->RequestorMode, IoWriteAccess);
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            IoFreeMdl(Mdl);
+            Irp->MdlAddress = NULL;
+            _SEH2_YIELD(return NULL);
+        }
+        _SEH2_END;
+    }
+
+    return MmGetSystemAddressForMdlSafe(Irp->MdlAddress, NormalPagePriority);
+}
+
+static
+BOOLEAN
+MapView(
+    _In_ ULONG View,
+    _In_ BOOLEAN Check)
+{
+    LARGE_INTEGER Offset;
+    PULONG Buffer;
+    BOOLEAN Ret;
+    PVOID Bcb;
+
+    Ret = FALSE;
+    Offset.QuadPart = (LONGLONG)View * VACB_MAPPING_GRANULARITY;
+    KmtStartSeh();
+    Ret = CcMapData(TestFileObject, &Offset, sizeof(ULONG), MAP_WAIT, &Bcb, (PVOID *)&Buffer);
+    KmtEndSeh(STATUS_SUCCESS);
+
+    if (Ret)
+    {
+        /* Every view starts with its own number */
+        if (Check) ok_eq_ulong(*Buffer, View);
+        CcUnpinData(Bcb);
+    }
+
+    return Ret;
+}
+
+static
+VOID
+PerformTest(
+    ULONG TestId,
+    PDEVICE_OBJECT DeviceObject)
+{
+    LARGE_INTEGER Start, End, Frequency;
+    CC_FILE_SIZES FileSizes;
+    PTEST_FCB Fcb;
+    ULONG i, View, ViewCount, Failures;
+
+    ok_eq_pointer(TestFileObject, NULL);
+    ok_eq_pointer(TestDeviceObject, NULL);
+    ok_eq_ulong(TestTestId, -1);
+
+    if (skip(TestId < RTL_NUMBER_OF(ViewCounts), "Invalid test %lu\n", TestId))
+        return;
+
+    ViewCount = ViewCounts[TestId];
+    FileSizes.AllocationSize.QuadPart = (LONGLONG)ViewCount * VACB_MAPPING_GRANULARITY;
+    FileSizes.FileSize = FileSizes.AllocationSize;
+    FileSizes.ValidDataLength = FileSizes.AllocationSize;
+
+    TestDeviceObject = DeviceObject;
+    TestTestId = TestId;
+    TestFileObject = IoCreateStreamFileObject(NULL, DeviceObject);
+    if (skip(TestFileObject != NULL, "Failed to allocate FO\n"))
+        return;
+
+    Fcb = ExAllocatePool(NonPagedPool, sizeof(TEST_FCB));
+    if (skip(Fcb != NULL, "ExAllocatePool failed\n"))
+        return;
+
+    RtlZeroMemory(Fcb, sizeof(TEST_FCB));
+    ExInitializeFastMutex(&Fcb->HeaderMutex);
+    FsRtlSetupAdvancedHeader(&Fcb->Header, &Fcb->HeaderMutex);
+
+    TestFileObject->FsContext = Fcb;
+    TestFileObject->SectionObjectPointer = &Fcb->SectionObjectPointers;
+
+    KmtStartSeh();
+    CcInitializeCacheMap(TestFileObject, &FileSizes, FALSE, &Callbacks, NULL);
+    KmtEndSeh(STATUS_SUCCESS);
+
+    if (skip(CcIsFileCached(TestFileObject) == TRUE, "CcInitializeCacheMap failed\n"))
+        return;
+
+    /* Create every view, backwards so the list is never appended to in order */
+    Failures = 0;
+    for (i = ViewCount; i > 0; i--)
+    {
+        if (!MapView(i - 1, TRUE)) Failures++;
+    }
+    ok_eq_ulong(Failures, 0UL);
+
+    /* Now only look them up, in a scattered order */
+    Failures = 0;
+    Start = KeQueryPerformanceCounter(&Frequency);
+    for (i = 0; i < LOOKUP_ITERATIONS; i++)
+    {
+        View = (i * 7919) % ViewCount;
+        if (!MapView(View, FALSE)) Failures++;
+    }
+    End = KeQueryPerformanceCounter(NULL);
+    ok_eq_ulong(Failures, 0UL);
+
+    LookupTime[TestId] = (End.QuadPart - Start.QuadPart) * 1000000000ULL /
+                         Frequency.QuadPart / LOOKUP_ITERATIONS;
+    trace("%lu views (%lu MB): %I64u ns per lookup\n",
+          ViewCount, ViewCount * (VACB_MAPPING_GRANULARITY / 1024) / 1024, LookupTime[TestId]);
+
+    /* Lookups should not get slower as the file grows. Timings are too noisy
+       on loaded machines to fail on, so only report how they compare */
+    if (TestId == RTL_NUMBER_OF(ViewCounts) - 1 && LookupTime[0] != 0)
+    {
+        trace("Lookup time went from %I64u ns to %I64u ns\n", LookupTime[0], LookupTime[TestId]);
+    }
+}
+
+
+static
+VOID
+CleanupTest(
+    ULONG TestId,
+    PDEVICE_OBJECT DeviceObject)
+{
+    LARGE_INTEGER Zero = RTL_CONSTANT_LARGE_INTEGER(0LL);
+    CACHE_UNINITIALIZE_EVENT CacheUninitEvent;
+
+    ok_eq_pointer(TestDeviceObject, DeviceObject);
+    ok_eq_ulong(TestTestId, TestId);
+
+    if (!skip(TestFileObject != NULL, "No test FO\n"))
+    {
+        if (CcIsFileCached(TestFileObject))
+        {
+            KeInitializeEvent(&CacheUninitEvent.Event, NotificationEvent, FALSE);
+            CcUninitializeCacheMap(TestFileObject, &Zero, &CacheUninitEvent);
+            KeWaitForSingleObject(&CacheUninitEvent.Event, Executive, KernelMode, FALSE, NULL);
+        }
+
+        if (TestFileObject->FsContext != NULL)
+        {
+            ExFreePool(TestFileObject->FsContext);
+            TestFileObject->FsContext = NULL;
+            TestFileObject->SectionObjectPointer = NULL;
+        }
+
+        ObDereferenceObject(TestFileObject);
+    }
+
+    TestFileObject = NULL;
+    TestDeviceObject = NULL;
+    TestTestId = -1;
+}
+
+
+static
+NTSTATUS
+TestMessageHandler(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ ULONG ControlCode,
+    _In_opt_ PVOID Buffer,
+    _In_ SIZE_T InLength,
+    _Inout_ PSIZE_T OutLength)
+{
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    FsRtlEnterFileSystem();
+
+    switch (ControlCode)
+    {
+        case IOCTL_START_TEST:
+            ok_eq_ulong((ULONG)InLength, sizeof(ULONG));
+            PerformTest(*(PULONG)Buffer, DeviceObject);
+            break;
+
+        case IOCTL_FINISH_TEST:
+            ok_eq_ulong((ULONG)InLength, sizeof(ULONG));
+            CleanupTest(*(PULONG)Buffer, DeviceObject);
+            break;
+
+        default:
+            Status = STATUS_NOT_IMPLEMENTED;
+            break;
+    }
+
+    FsRtlExitFileSystem();
+
+    return Status;
+}
+
+static
+NTSTATUS
+TestIrpHandler(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIRP Irp,
+    _In_ PIO_STACK_LOCATION IoStack)
+{
+    NTSTATUS Status;
+
+    PAGED_CODE();
+
+    DPRINT("IRP %x/%x\n", IoStack->MajorFunction, IoStack->MinorFunction);
+    ASSERT(IoStack->MajorFunction == IRP_MJ_READ);
+
+    FsRtlEnterFileSystem();
+
+    Status = STATUS_NOT_SUPPORTED;
+    Irp->IoStatus.Information = 0;
+
+    if (IoStack->MajorFunction == IRP_MJ_READ)
+    {
+        ULONG Length;
+        PVOID Buffer;
+        LARGE_INTEGER Offset;
+        ULONG Done;
+
+        Offset = IoStack->Parameters.Read.ByteOffset;
+        Length = IoStack->Parameters.Read.Length;
+
+        ok_eq_pointer(DeviceObject, TestDeviceObject);
+        ok_eq_pointer(IoStack->FileObject, TestFileObject);
+        ok(FlagOn(Irp->Flags, IRP_NOCACHE), "Not coming from Cc\n");
+
+        Buffer = MapAndLockUserBuffer(Irp, Length);
+        ok(Buffer != NULL, "Null pointer!\n");
+
+        Status = STATUS_SUCCESS;
+        if (Buffer != NULL)
+        {
+            RtlFillMemory(Buffer, Length, 0xBA);
+
+            /* Stamp the view number at the start of each view */
+            for (Done = 0; Done < Length; Done += PAGE_SIZE)
+            {
+                if ((Offset.QuadPart + Done) % VACB_MAPPING_GRANULARITY == 0)
+                {
+                    *(PULONG)((ULONG_PTR)Buffer + Done) =
+                        (ULONG)((Offset.QuadPart + Done) / VACB_MAPPING_GRANULARITY);
+                }
+            }
+
+            Irp->IoStatus.Information = Length;
+        }
+        else
+        {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+        }
+    }
+
+    Irp->IoStatus.Status = Status;
+    IoCompleteRequest(Irp, IO_NO_INCREMENT);
+
+    FsRtlExitFileSystem();
+
+    return Status;
+}
@@ -0,0 +1,128 @@
+/*
+ * PROJECT:     ReactOS kernel-mode tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Kernel-Mode Test Suite lookaside list information test
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include <kmt_test.h>
+
+#define NDEBUG
+#include <debug.h>
+
+#define TAG_LOOKASIDE_TEST  'tLmK'
+#define TEST_ENTRY_SIZE     72
+#define TEST_ENTRIES        32
+#define TEST_ROUNDS         4
+#define MAX_INFO_ENTRIES    4096
+
+static
+BOOLEAN
+FindLookasideInfo(
+    _In_ PSYSTEM_LOOKASIDE_INFORMATION Buffer,
+    _Out_ PSYSTEM_LOOKASIDE_INFORMATION Found)
+{
+    ULONG ReturnLength = 0, Count, i;
+    NTSTATUS Status;
+
+    Status = ZwQuerySystemInformation(SystemLookasideInformation,
+                                      Buffer,
+                                      MAX_INFO_ENTRIES * sizeof(*Buffer),
+                                      &ReturnLength);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+        return FALSE;
+
+    ok(ReturnLength % sizeof(*Buffer) == 0, "Unexpected length %lu\n", ReturnLength);
+    Count = ReturnLength / sizeof(*Buffer);
+    for (i = 0; i < Count; i++)
+    {
+        if (Buffer[i].Tag == TAG_LOOKASIDE_TEST)
+        {
+            *Found = Buffer[i];
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+START_TEST(ExLookaside)
+{
+    NPAGED_LOOKASIDE_LIST Lookaside;
+    SYSTEM_LOOKASIDE_INFORMATION Info;
+    PSYSTEM_LOOKASIDE_INFORMATION Buffer;
+    PVOID Entries[TEST_ENTRIES];
+    LARGE_INTEGER Interval;
+    ULONG Round, i;
+
+    Buffer = ExAllocatePoolWithTag(PagedPool, MAX_INFO_ENTRIES * sizeof(*Buffer), TAG_LOOKASIDE_TEST);
+    if (skip(Buffer != NULL, "Out of memory\n"))
+        return;
+
+    ExInitializeNPagedLookasideList(&Lookaside, NULL, NULL, 0, TEST_ENTRY_SIZE, TAG_LOOKASIDE_TEST, 0);
+
+    /* A new list is reported right away, with nothing counted yet */
+    if (FindLookasideInfo(Buffer, &Info))
+    {
+        ok_eq_ulong(Info.Size, (ULONG)TEST_ENTRY_SIZE);
+        ok_eq_ulong(Info.Type, (ULONG)NonPagedPool);
+        ok_eq_ulong(Info.TotalAllocates, 0UL);
+        ok_eq_ulong(Info.TotalFrees, 0UL);
+    }
+    else
+    {
+        ok(0, "Own lookaside list is not reported\n");
+    }
+
+    /* More entries than the list holds, so some allocations and frees miss */
+    for (Round = 0; Round < TEST_ROUNDS; Round++)
+    {
+        for (i = 0; i < TEST_ENTRIES; i++)
+        {
+            Entries[i] = ExAllocateFromNPagedLookasideList(&Lookaside);
+            ok(Entries[i] != NULL, "Allocation %lu failed\n", i);
+        }
+        for (i = 0; i < TEST_ENTRIES; i++)
+        {
+            if (Entries[i])
+                ExFreeToNPagedLookasideList(&Lookaside, Entries[i]);
+        }
+    }
+
+    if (FindLookasideInfo(Buffer, &Info))
+    {
+        ok_eq_ulong(Info.TotalAllocates, (ULONG)(TEST_ROUNDS * TEST_ENTRIES));
+        ok_eq_ulong(Info.TotalFrees, (ULONG)(TEST_ROUNDS * TEST_ENTRIES));
+        /* The first round starts empty, the later ones reuse what was kept */
+        ok(Info.AllocateMisses >= TEST_ENTRIES && Info.AllocateMisses < Info.TotalAllocates,
+           "%lu of %lu allocations missed\n", Info.AllocateMisses, Info.TotalAllocates);
+        ok(Info.FreeMisses < Info.TotalFrees,
+           "%lu of %lu frees missed\n", Info.FreeMisses, Info.TotalFrees);
+        ok(Info.CurrentDepth != 0 && Info.CurrentDepth <= Info.MaximumDepth,
+           "Depth %u, maximum %u\n", Info.CurrentDepth, Info.MaximumDepth);
+        ok_eq_uint(Info.MaximumDepth, 256);
+    }
+    else
+    {
+        ok(0, "Own lookaside list is not reported\n");
+    }
+
+    /* The depth is retuned about once a second, which isn't reliable enough to check */
+    Interval.QuadPart = -15 * 1000 * 1000;
+    KeDelayExecutionThread(KernelMode, FALSE, &Interval);
+    if (FindLookasideInfo(Buffer, &Info))
+    {
+        ok(Info.CurrentDepth <= Info.MaximumDepth,
+           "Depth %u, maximum %u\n", Info.CurrentDepth, Info.MaximumDepth);
+        trace("Depth after %lu misses in %lu allocations: %u\n",
+              Info.AllocateMisses, Info.TotalAllocates, Info.CurrentDepth);
+    }
+
+    ExDeleteNPagedLookasideList(&Lookaside);
+
+    /* And it's gone once deleted */
+    ok(!FindLookasideInfo(Buffer, &Info), "Deleted lookaside list is still reported\n");
+
+    ExFreePoolWithTag(Buffer, TAG_LOOKASIDE_TEST);
+}
@@ -0,0 +1,134 @@
+/*
+ * PROJECT:     ReactOS kernel-mode tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Kernel-Mode Test Suite coalescable timer test
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include <kmt_test.h>
+
+#define MS_TO_100NS(Ms) ((LONGLONG)(Ms) * 10000)
+
+static
+BOOLEAN
+(NTAPI
+*pKeSetCoalescableTimer)(
+    _Inout_ PKTIMER Timer,
+    _In_ LARGE_INTEGER DueTime,
+    _In_ ULONG Period,
+    _In_ ULONG TolerableDelay,
+    _In_opt_ PKDPC Dpc);
+
+static
+VOID
+TestRounding(
+    _In_ ULONG Delay,
+    _In_ ULONG TolerableDelay)
+{
+    KTIMER Timer;
+    LARGE_INTEGER DueTime;
+    ULONGLONG Before, After;
+    NTSTATUS Status;
+
+    KeInitializeTimerEx(&Timer, NotificationTimer);
+
+    DueTime.QuadPart = -MS_TO_100NS(Delay);
+    Before = KeQueryInterruptTime();
+    ok_eq_bool(pKeSetCoalescableTimer(&Timer, DueTime, 0, TolerableDelay, NULL), FALSE);
+    After = KeQueryInterruptTime();
+
+    /* The timer may only be pushed out, and by no more than the caller tolerates */
+    ok(Timer.DueTime.QuadPart >= (LONGLONG)Before + MS_TO_100NS(Delay),
+       "Due time %I64d is before %I64d\n", Timer.DueTime.QuadPart, Before + MS_TO_100NS(Delay));
+    ok(Timer.DueTime.QuadPart <= (LONGLONG)After + MS_TO_100NS(Delay + TolerableDelay),
+       "Due time %I64d is after %I64d\n", Timer.DueTime.QuadPart, After + MS_TO_100NS(Delay + TolerableDelay));
+
+    /* It really expires, and not early */
+    Status = KeWaitForSingleObject(&Timer, Executive, KernelMode, FALSE, NULL);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    After = KeQueryInterruptTime();
+    ok(After >= Before + MS_TO_100NS(Delay),
+       "Timer expired after %I64u, expected at least %I64d\n", After - Before, MS_TO_100NS(Delay));
+    trace("Delay %lu ms, tolerance %lu ms: expired after %I64u\n", Delay, TolerableDelay, After - Before);
+
+    ok_eq_bool(KeCancelTimer(&Timer), FALSE);
+}
+
+static
+VOID
+TestPeriodicPhase(VOID)
+{
+    KTIMER Timer;
+    LARGE_INTEGER DueTime;
+    LONGLONG FirstDueTime, Period;
+    NTSTATUS Status;
+    ULONG i;
+
+    KeInitializeTimerEx(&Timer, SynchronizationTimer);
+
+    DueTime.QuadPart = -MS_TO_100NS(20);
+    ok_eq_bool(pKeSetCoalescableTimer(&Timer, DueTime, 50, 30, NULL), FALSE);
+    FirstDueTime = Timer.DueTime.QuadPart;
+
+    for (i = 0; i < 3; i++)
+    {
+        Status = KeWaitForSingleObject(&Timer, Executive, KernelMode, FALSE, NULL);
+        ok_eq_hex(Status, STATUS_SUCCESS);
+    }
+
+    ok_eq_bool(KeCancelTimer(&Timer), TRUE);
+
+    /* Every period stays a whole number of periods away from the first expiration */
+    Period = MS_TO_100NS(50);
+    ok(Timer.DueTime.QuadPart >= FirstDueTime + 3 * Period,
+       "Due time %I64d is before %I64d\n", Timer.DueTime.QuadPart, FirstDueTime + 3 * Period);
+    ok_eq_longlong((Timer.DueTime.QuadPart - FirstDueTime) % Period, 0LL);
+}
+
+static
+VOID
+TestCancelOtherProcessor(VOID)
+{
+    KTIMER Timer;
+    LARGE_INTEGER DueTime, Timeout;
+    NTSTATUS Status;
+
+    if (skip(KeNumberProcessors >= 2, "Only one processor\n"))
+        return;
+
+    KeInitializeTimerEx(&Timer, NotificationTimer);
+
+    /* Set it on the first processor... */
+    KeSetSystemAffinityThread(1);
+    DueTime.QuadPart = -MS_TO_100NS(100);
+    ok_eq_bool(pKeSetCoalescableTimer(&Timer, DueTime, 0, 50, NULL), FALSE);
+
+    /* ...and cancel it from the second one */
+    KeSetSystemAffinityThread(2);
+    ok_eq_bool(KeCancelTimer(&Timer), TRUE);
+    ok_eq_bool(KeCancelTimer(&Timer), FALSE);
+    KeRevertToUserAffinityThread();
+
+    /* It must not expire anymore */
+    Timeout.QuadPart = -MS_TO_100NS(300);
+    Status = KeWaitForSingleObject(&Timer, Executive, KernelMode, FALSE, &Timeout);
+    ok_eq_hex(Status, STATUS_TIMEOUT);
+    ok_eq_bool(KeReadStateTimer(&Timer), FALSE);
+}
+
+START_TEST(KeCoalescableTimer)
+{
+    UNICODE_STRING RoutineName = RTL_CONSTANT_STRING(L"KeSetCoalescableTimer");
+
+    pKeSetCoalescableTimer = MmGetSystemRoutineAddress(&RoutineName);
+    if (skip(pKeSetCoalescableTimer != NULL, "KeSetCoalescableTimer unavailable\n"))
+        return;
+
+    /* No tolerance, a tolerance below a clock tick, and one of several ticks */
+    TestRounding(100, 0);
+    TestRounding(100, 1);
+    TestRounding(100, 100);
+
+    TestPeriodicPhase();
+    TestCancelOtherProcessor();
+}
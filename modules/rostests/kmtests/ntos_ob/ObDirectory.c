@@ -0,0 +1,193 @@
+/*
+ * PROJECT:     ReactOS kernel-mode tests
+ * LICENSE:     LGPL-2.1-or-later (https://spdx.org/licenses/LGPL-2.1-or-later)
+ * PURPOSE:     Kernel-Mode Test for large object directories
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include <kmt_test.h>
+
+#define NDEBUG
+#include <debug.h>
+
+#define OBJECT_COUNT        100000
+#define QUERY_BUFFER_SIZE   (256 * 1024)
+
+static
+VOID
+MakeName(
+    _Out_writes_(16) PWCHAR Buffer,
+    _Out_ PUNICODE_STRING Name,
+    _In_ ULONG Index)
+{
+    NTSTATUS Status;
+
+    Status = RtlStringCchPrintfW(Buffer, 16, L"Evt%lu", Index);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    RtlInitUnicodeString(Name, Buffer);
+}
+
+static
+ULONGLONG
+ElapsedMs(
+    _In_ LARGE_INTEGER Start,
+    _In_ LARGE_INTEGER Frequency)
+{
+    LARGE_INTEGER End = KeQueryPerformanceCounter(NULL);
+
+    return (End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart;
+}
+
+static
+ULONG
+CountDirectoryEntries(
+    _In_ HANDLE DirectoryHandle)
+{
+    POBJECT_DIRECTORY_INFORMATION Buffer;
+    ULONG Context = 0, Count = 0;
+    BOOLEAN Restart = TRUE;
+    NTSTATUS Status;
+
+    Buffer = ExAllocatePoolWithTag(PagedPool, QUERY_BUFFER_SIZE, 'DOmK');
+    if (!skip(Buffer != NULL, "Out of memory\n"))
+    {
+        do
+        {
+            Status = ZwQueryDirectoryObject(DirectoryHandle,
+                                            Buffer,
+                                            QUERY_BUFFER_SIZE,
+                                            FALSE,
+                                            Restart,
+                                            &Context,
+                                            NULL);
+            Restart = FALSE;
+            if (NT_SUCCESS(Status)) Count = Context;
+        } while (Status == STATUS_MORE_ENTRIES);
+
+        ExFreePoolWithTag(Buffer, 'DOmK');
+    }
+
+    return Count;
+}
+
+START_TEST(ObDirectory)
+{
+    UNICODE_STRING DirectoryName = RTL_CONSTANT_STRING(L"\\KmtestObDirectory");
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    LARGE_INTEGER Start, Frequency;
+    HANDLE DirectoryHandle;
+    UNICODE_STRING Name;
+    WCHAR NameBuffer[16];
+    PHANDLE Handles;
+    HANDLE Handle;
+    NTSTATUS Status;
+    ULONG Created, Opened, i;
+    ULONGLONG CreateTime, OpenTime;
+
+    /* A temporary directory, it goes away with its last handle */
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &DirectoryName,
+                               OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                               NULL,
+                               NULL);
+    Status = ZwCreateDirectoryObject(&DirectoryHandle, DIRECTORY_ALL_ACCESS, &ObjectAttributes);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (skip(NT_SUCCESS(Status), "No directory\n"))
+        return;
+
+    Handles = ExAllocatePoolZero(PagedPool, OBJECT_COUNT * sizeof(HANDLE), 'DOmK');
+    if (skip(Handles != NULL, "Out of memory\n"))
+    {
+        ZwClose(DirectoryHandle);
+        return;
+    }
+
+    /* Fill the directory, it has to grow its hash table a few times on the way */
+    KeQueryPerformanceCounter(&Frequency);
+    Start = KeQueryPerformanceCounter(NULL);
+    for (Created = 0; Created < OBJECT_COUNT; Created++)
+    {
+        MakeName(NameBuffer, &Name, Created);
+        InitializeObjectAttributes(&ObjectAttributes,
+                                   &Name,
+                                   OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                                   DirectoryHandle,
+                                   NULL);
+        Status = ZwCreateEvent(&Handles[Created], EVENT_ALL_ACCESS, &ObjectAttributes, NotificationEvent, FALSE);
+        if (Status != STATUS_SUCCESS)
+        {
+            ok_eq_hex(Status, STATUS_SUCCESS);
+            break;
+        }
+    }
+    CreateTime = ElapsedMs(Start, Frequency);
+
+    /* Look every one of them up again */
+    Start = KeQueryPerformanceCounter(NULL);
+    for (Opened = 0, i = 0; i < Created; i++)
+    {
+        MakeName(NameBuffer, &Name, i);
+        InitializeObjectAttributes(&ObjectAttributes,
+                                   &Name,
+                                   OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                                   DirectoryHandle,
+                                   NULL);
+        Status = ZwOpenEvent(&Handle, EVENT_ALL_ACCESS, &ObjectAttributes);
+        if (NT_SUCCESS(Status))
+        {
+            Opened++;
+            ZwClose(Handle);
+        }
+    }
+    OpenTime = ElapsedMs(Start, Frequency);
+
+    ok_eq_ulong(Created, OBJECT_COUNT);
+    ok_eq_ulong(Opened, Created);
+    trace("%lu named events: created in %I64u ms, opened in %I64u ms\n", Created, CreateTime, OpenTime);
+
+    /* Names still collide after the table grew, and case does not matter */
+    RtlInitUnicodeString(&Name, L"EVT0");
+    InitializeObjectAttributes(&ObjectAttributes, &Name, OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE, DirectoryHandle, NULL);
+    Status = ZwCreateEvent(&Handle, EVENT_ALL_ACCESS, &ObjectAttributes, NotificationEvent, FALSE);
+    ok_eq_hex(Status, STATUS_OBJECT_NAME_EXISTS);
+    if (NT_SUCCESS(Status)) ZwClose(Handle);
+
+    /* Enumeration sees every entry exactly once */
+    ok_eq_ulong(CountDirectoryEntries(DirectoryHandle), Created);
+
+    /* Closing the even ones removes them from the directory */
+    for (i = 0; i < Created; i += 2)
+    {
+        ZwClose(Handles[i]);
+        Handles[i] = NULL;
+    }
+    for (Opened = 0, i = 0; i < Created; i++)
+    {
+        MakeName(NameBuffer, &Name, i);
+        InitializeObjectAttributes(&ObjectAttributes,
+                                   &Name,
+                                   OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                                   DirectoryHandle,
+                                   NULL);
+        Status = ZwOpenEvent(&Handle, EVENT_ALL_ACCESS, &ObjectAttributes);
+        if (NT_SUCCESS(Status))
+        {
+            ok(i % 2, "Event %lu was not deleted\n", i);
+            Opened++;
+            ZwClose(Handle);
+        }
+        else
+        {
+            ok(!(i % 2), "Event %lu cannot be opened: 0x%lx\n", i, Status);
+        }
+    }
+    ok_eq_ulong(Opened, Created / 2);
+    ok_eq_ulong(CountDirectoryEntries(DirectoryHandle), Created / 2);
+
+    for (i = 0; i < Created; i++)
+    {
+        if (Handles[i]) ZwClose(Handles[i]);
+    }
+    ExFreePoolWithTag(Handles, 'DOmK');
+    ZwClose(DirectoryHandle);
+}
@@ -14,32 +14,12 @@
 #define NDEBUG
 #include <debug.h>
 
-BOOLEAN CcPfEnablePrefetcher;
-PFSN_PREFETCHER_GLOBALS CcPfGlobals;
 MM_SYSTEMSIZE CcCapturedSystemSize;
 
 static ULONG BugCheckFileId = 0x4 << 16;
 
 /* FUNCTIONS *****************************************************************/
 
-CODE_SEG("INIT")
-VOID
-NTAPI
-CcPfInitializePrefetcher(VOID)
-{
-    /* Notify debugger */
-    DbgPrintEx(DPFLTR_PREFETCHER_ID,
-               DPFLTR_TRACE_LEVEL,
-               "CCPF: InitializePrefetecher()\n");
-
-    /* Setup the Prefetcher Data */
-    InitializeListHead(&CcPfGlobals.ActiveTraces);
-    InitializeListHead(&CcPfGlobals.CompletedTraces);
-    ExInitializeFastMutex(&CcPfGlobals.CompletedTracesLock);
-
-    /* FIXME: Setup the rest of the prefetecher */
-}
-
 CODE_SEG("INIT")
 BOOLEAN
 CcInitializeCacheManager(VOID)
@@ -150,7 +130,7 @@ CcRemapBcb (
 }
 
 /*
- * @unimplemented
+ * @implemented
  */
 VOID
 NTAPI
@@ -161,9 +141,12 @@ CcScheduleReadAhead (
 	)
 {
     KIRQL OldIrql;
-    LARGE_INTEGER NewOffset;
+    LONGLONG ReadEnd, Start, End, Stride;
+    ULONG Granularity;
+    CC_ACCESS_PATTERN AccessPattern;
     PROS_SHARED_CACHE_MAP SharedCacheMap;
     PPRIVATE_CACHE_MAP PrivateCacheMap;
+    PROS_PRIVATE_CACHE_MAP RosPrivateCacheMap;
 
     SharedCacheMap = FileObject->SectionObjectPointer->SharedCacheMap;
     PrivateCacheMap = FileObject->PrivateCacheMap;
@@ -175,47 +158,128 @@ CcScheduleReadAhead (
         return;
     }
 
-    /* Round read length with read ahead mask */
-    Length = ROUND_UP(Length, PrivateCacheMap->ReadAheadMask + 1);
-    /* Compute the offset we'll reach */
-    NewOffset.QuadPart = FileOffset->QuadPart + Length;
+    RosPrivateCacheMap = CONTAINING_RECORD(PrivateCacheMap, ROS_PRIVATE_CACHE_MAP, PrivateCacheMap);
+    Granularity = PrivateCacheMap->ReadAheadMask + 1;
+    ReadEnd = FileOffset->QuadPart + Length;
 
     /* Lock read ahead spin lock */
     KeAcquireSpinLock(&PrivateCacheMap->ReadAheadSpinLock, &OldIrql);
-    /* Easy case: the file is sequentially read */
-    if (BooleanFlagOn(FileObject->Flags, FO_SEQUENTIAL_ONLY))
+
+    /* Both Cc and the FSD may report the same read, it doesn't tell anything new */
+    if (FileOffset->QuadPart != PrivateCacheMap->FileOffset2.QuadPart ||
+        ReadEnd != PrivateCacheMap->BeyondLastByte2.QuadPart)
     {
-        /* If we went backward, this is no go! */
-        if (NewOffset.QuadPart < PrivateCacheMap->ReadAheadOffset[1].QuadPart)
+        /* Find out what kind of stream this read belongs to, given the two previous ones.
+         * A read starting where the previous one ended (give or take the granularity)
+         * is sequential. Reads moving by the same amount twice in a row are strided
+         */
+        Stride = FileOffset->QuadPart - PrivateCacheMap->FileOffset2.QuadPart;
+        if (BooleanFlagOn(FileObject->Flags, FO_SEQUENTIAL_ONLY) ||
+            (Stride >= 0 && ReadEnd > PrivateCacheMap->BeyondLastByte2.QuadPart &&
+             FileOffset->QuadPart <= PrivateCacheMap->BeyondLastByte2.QuadPart + Granularity))
         {
-            KeReleaseSpinLock(&PrivateCacheMap->ReadAheadSpinLock, OldIrql);
-            return;
+            AccessPattern = CcAccessSequential;
+        }
+        else if (Stride != 0 &&
+                 Stride == PrivateCacheMap->FileOffset2.QuadPart - PrivateCacheMap->FileOffset1.QuadPart)
+        {
+            AccessPattern = CcAccessStrided;
+        }
+        else
+        {
+            AccessPattern = CcAccessRandom;
         }
 
-        /* FIXME: hackish, but will do the job for now */
-        PrivateCacheMap->ReadAheadOffset[1].QuadPart = NewOffset.QuadPart;
-        PrivateCacheMap->ReadAheadLength[1] = Length;
-    }
-    /* Other cases: try to find some logic in that mess... */
-    else
-    {
-        /* Let's check if we always read the same way (like going down in the file)
-         * and pretend it's enough for now
-         */
-        if (PrivateCacheMap->FileOffset2.QuadPart >= PrivateCacheMap->FileOffset1.QuadPart &&
-            FileOffset->QuadPart >= PrivateCacheMap->FileOffset2.QuadPart)
+        /* Same stream as before, it's confirmed. Otherwise, start over */
+        if (AccessPattern == RosPrivateCacheMap->AccessPattern &&
+            (AccessPattern != CcAccessStrided || Stride == RosPrivateCacheMap->Stride))
         {
-            /* FIXME: hackish, but will do the job for now */
-            PrivateCacheMap->ReadAheadOffset[1].QuadPart = NewOffset.QuadPart;
-            PrivateCacheMap->ReadAheadLength[1] = Length;
+            RosPrivateCacheMap->ConfirmedReads++;
         }
         else
         {
-            /* FIXME: handle the other cases */
-            KeReleaseSpinLock(&PrivateCacheMap->ReadAheadSpinLock, OldIrql);
-            UNIMPLEMENTED_ONCE;
-            return;
+            RosPrivateCacheMap->AccessPattern = AccessPattern;
+            RosPrivateCacheMap->ConfirmedReads = 0;
+            RosPrivateCacheMap->ReadAheadWindow = 0;
+            RosPrivateCacheMap->ReadAheadEnd = 0;
+            RosPrivateCacheMap->Stride = Stride;
         }
+
+        /* And update read history */
+        PrivateCacheMap->FileOffset1.QuadPart = PrivateCacheMap->FileOffset2.QuadPart;
+        PrivateCacheMap->BeyondLastByte1.QuadPart = PrivateCacheMap->BeyondLastByte2.QuadPart;
+        PrivateCacheMap->FileOffset2.QuadPart = FileOffset->QuadPart;
+        PrivateCacheMap->BeyondLastByte2.QuadPart = ReadEnd;
+    }
+
+    Start = End = 0;
+    switch (RosPrivateCacheMap->AccessPattern)
+    {
+        case CcAccessSequential:
+            /* Don't bother while the reader is still far from the end of what we read for it */
+            if (RosPrivateCacheMap->ReadAheadWindow != 0 &&
+                RosPrivateCacheMap->ReadAheadEnd - ReadEnd >= RosPrivateCacheMap->ReadAheadWindow / 2)
+            {
+                break;
+            }
+
+            /* Start small, unless we were told it's sequential, and double the window
+             * each time the reader catches up with it
+             */
+            if (RosPrivateCacheMap->ReadAheadWindow == 0)
+            {
+                if (BooleanFlagOn(FileObject->Flags, FO_SEQUENTIAL_ONLY))
+                    RosPrivateCacheMap->ReadAheadWindow = CC_MAXIMUM_READ_AHEAD_WINDOW;
+                else
+                    RosPrivateCacheMap->ReadAheadWindow = max(CC_MINIMUM_READ_AHEAD_WINDOW, 2 * Length);
+            }
+            else if (RosPrivateCacheMap->ReadAheadWindow < CC_MAXIMUM_READ_AHEAD_WINDOW)
+            {
+                RosPrivateCacheMap->ReadAheadWindow *= 2;
+            }
+            RosPrivateCacheMap->ReadAheadWindow = min(RosPrivateCacheMap->ReadAheadWindow,
+                                                      CC_MAXIMUM_READ_AHEAD_WINDOW);
+
+            Start = max(ReadEnd, RosPrivateCacheMap->ReadAheadEnd);
+            End = ReadEnd + RosPrivateCacheMap->ReadAheadWindow;
+            break;
+
+        case CcAccessStrided:
+            /* Bring in the next record */
+            Start = FileOffset->QuadPart + RosPrivateCacheMap->Stride;
+            End = Start + Length;
+            if (Start < 0)
+            {
+                Start = End = 0;
+            }
+            break;
+
+        case CcAccessRandom:
+            /* Nothing to guess, keep the window collapsed */
+            break;
+    }
+
+    /* Respect the granularity the FSD asked for */
+    Start = ROUND_DOWN(Start, Granularity);
+    End = ROUND_UP(End, Granularity);
+    if (End <= Start || Start >= SharedCacheMap->FileSize.QuadPart)
+    {
+        KeReleaseSpinLock(&PrivateCacheMap->ReadAheadSpinLock, OldIrql);
+        return;
+    }
+    RosPrivateCacheMap->ReadAheadEnd = End;
+
+    /* If the worker didn't pick up the previous request yet, and this one follows it, just extend it */
+    if (PrivateCacheMap->ReadAheadLength[1] != 0 &&
+        PrivateCacheMap->ReadAheadOffset[1].QuadPart + PrivateCacheMap->ReadAheadLength[1] == Start &&
+        End - PrivateCacheMap->ReadAheadOffset[1].QuadPart <= 2 * CC_MAXIMUM_READ_AHEAD_WINDOW)
+    {
+        PrivateCacheMap->ReadAheadLength[1] = (ULONG)(End - PrivateCacheMap->ReadAheadOffset[1].QuadPart);
+    }
+    else
+    {
+        PrivateCacheMap->ReadAheadOffset[1].QuadPart = Start;
+        PrivateCacheMap->ReadAheadLength[1] = (ULONG)(End - Start);
     }
 
     /* If read ahead isn't active yet */
@@ -246,12 +310,16 @@ CcScheduleReadAhead (
             return;
         }
 
-        /* Fail path: lock again, and revert read ahead active */
+        /* Fail path: lock again, revert read ahead active and forget
+         * about the request, so that the next read tries again
+         */
         KeAcquireSpinLock(&PrivateCacheMap->ReadAheadSpinLock, &OldIrql);
         InterlockedAnd((volatile long *)&PrivateCacheMap->UlongFlags, ~PRIVATE_CACHE_MAP_READ_AHEAD_ACTIVE);
+        PrivateCacheMap->ReadAheadLength[1] = 0;
+        RosPrivateCacheMap->ReadAheadEnd = 0;
     }
 
-    /* Done (fail) */
+    /* Done, the worker will pick up the request if it's already running */
     KeReleaseSpinLock(&PrivateCacheMap->ReadAheadSpinLock, OldIrql);
 }
 
@@ -39,9 +39,11 @@ ULONG CcFastReadResourceMiss;
 /* Counters:
  * - Amount of pages flushed to the disk
  * - Number of flush operations
+ * - Number of writes CcCanIWrite throttled
  */
 ULONG CcDataPages = 0;
 ULONG CcDataFlushes = 0;
+ULONG CcThrottleEvents = 0;
 
 /* FUNCTIONS *****************************************************************/
 
@@ -126,6 +128,48 @@ CcPostDeferredWrites(VOID)
     }
 }
 
+static
+BOOLEAN
+CcpDequeueReadAhead(
+    IN PFILE_OBJECT FileObject,
+    OUT PLONGLONG FileOffset,
+    OUT PULONG Length)
+{
+    KIRQL OldIrql;
+    BOOLEAN Pending = FALSE;
+    PPRIVATE_CACHE_MAP PrivateCacheMap;
+
+    /* Critical:
+     * PrivateCacheMap might disappear in-between if the handle
+     * to the file is closed (private is attached to the handle not to
+     * the file), so we need to lock the master lock while we deal with
+     * it. It won't disappear without attempting to lock such lock.
+     */
+    OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
+    PrivateCacheMap = FileObject->PrivateCacheMap;
+    /* If the handle was closed since the read ahead was scheduled, just quit */
+    if (PrivateCacheMap != NULL)
+    {
+        KeAcquireSpinLockAtDpcLevel(&PrivateCacheMap->ReadAheadSpinLock);
+        *FileOffset = PrivateCacheMap->ReadAheadOffset[1].QuadPart;
+        *Length = PrivateCacheMap->ReadAheadLength[1];
+        PrivateCacheMap->ReadAheadLength[1] = 0;
+
+        /* Nothing more was scheduled meanwhile: mark read ahead as inactive,
+         * under the same lock, so that the next CcScheduleReadAhead queues us again
+         */
+        Pending = (*Length != 0);
+        if (!Pending)
+        {
+            InterlockedAnd((volatile long *)&PrivateCacheMap->UlongFlags, ~PRIVATE_CACHE_MAP_READ_AHEAD_ACTIVE);
+        }
+        KeReleaseSpinLockFromDpcLevel(&PrivateCacheMap->ReadAheadSpinLock);
+    }
+    KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
+
+    return Pending;
+}
+
 VOID
 CcPerformReadAhead(
     IN PFILE_OBJECT FileObject)
@@ -143,30 +187,14 @@ CcPerformReadAhead(
 
     SharedCacheMap = FileObject->SectionObjectPointer->SharedCacheMap;
 
-    /* Critical:
-     * PrivateCacheMap might disappear in-between if the handle
-     * to the file is closed (private is attached to the handle not to
-     * the file), so we need to lock the master lock while we deal with
-     * it. It won't disappear without attempting to lock such lock.
+    /* Get what was scheduled. If the handle is gone, or it was already
+     * read by a previous pass, just quit
      */
-    OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
-    PrivateCacheMap = FileObject->PrivateCacheMap;
-    /* If the handle was closed since the read ahead was scheduled, just quit */
-    if (PrivateCacheMap == NULL)
+    if (!CcpDequeueReadAhead(FileObject, &CurrentOffset, &Length))
     {
-        KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
         ObDereferenceObject(FileObject);
         return;
     }
-    /* Otherwise, extract read offset and length and release private map */
-    else
-    {
-        KeAcquireSpinLockAtDpcLevel(&PrivateCacheMap->ReadAheadSpinLock);
-        CurrentOffset = PrivateCacheMap->ReadAheadOffset[1].QuadPart;
-        Length = PrivateCacheMap->ReadAheadLength[1];
-        KeReleaseSpinLockFromDpcLevel(&PrivateCacheMap->ReadAheadSpinLock);
-    }
-    KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
 
     /* Time to go! */
     DPRINT("Doing ReadAhead for %p\n", FileObject);
@@ -180,106 +208,117 @@ CcPerformReadAhead(
     /* Remember it's locked */
     Locked = TRUE;
 
-    /* Don't read past the end of the file */
-    if (CurrentOffset >= SharedCacheMap->FileSize.QuadPart)
-    {
-        goto Clear;
-    }
-    if (CurrentOffset + Length > SharedCacheMap->FileSize.QuadPart)
-    {
-        Length = SharedCacheMap->FileSize.QuadPart - CurrentOffset;
-    }
-
-    /* Next of the algorithm will lock like CcCopyData with the slight
-     * difference that we don't copy data back to an user-backed buffer
-     * We just bring data into Cc
+    /* The reader may have scheduled more while we were busy: keep going
+     * as long as there is something left, it saves a trip through the queue
      */
-    PartialLength = CurrentOffset % VACB_MAPPING_GRANULARITY;
-    if (PartialLength != 0)
+    do
     {
-        PartialLength = min(Length, VACB_MAPPING_GRANULARITY - PartialLength);
-        Status = CcRosRequestVacb(SharedCacheMap,
-                                  ROUND_DOWN(CurrentOffset, VACB_MAPPING_GRANULARITY),
-                                  &Vacb);
-        if (!NT_SUCCESS(Status))
+        /* Don't read past the end of the file */
+        if (CurrentOffset >= SharedCacheMap->FileSize.QuadPart)
         {
-            DPRINT1("Failed to request VACB: %lx!\n", Status);
-            goto Clear;
-        }
-
-        _SEH2_TRY
-        {
-            Success = CcRosEnsureVacbResident(Vacb, TRUE, FALSE,
-                    CurrentOffset % VACB_MAPPING_GRANULARITY, PartialLength);
+            continue;
         }
-        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        if (CurrentOffset + Length > SharedCacheMap->FileSize.QuadPart)
         {
-            Success = FALSE;
+            Length = SharedCacheMap->FileSize.QuadPart - CurrentOffset;
         }
-        _SEH2_END
 
-        if (!Success)
+        /* Next of the algorithm will lock like CcCopyData with the slight
+         * difference that we don't copy data back to an user-backed buffer
+         * We just bring data into Cc
+         */
+        PartialLength = CurrentOffset % VACB_MAPPING_GRANULARITY;
+        if (PartialLength != 0)
         {
-            CcRosReleaseVacb(SharedCacheMap, Vacb, FALSE, FALSE);
-            DPRINT1("Failed to read data: %lx!\n", Status);
-            goto Clear;
-        }
+            PartialLength = min(Length, VACB_MAPPING_GRANULARITY - PartialLength);
+            Status = CcRosRequestVacb(SharedCacheMap,
+                                      ROUND_DOWN(CurrentOffset, VACB_MAPPING_GRANULARITY),
+                                      &Vacb);
+            if (!NT_SUCCESS(Status))
+            {
+                DPRINT1("Failed to request VACB: %lx!\n", Status);
+                goto Clear;
+            }
 
-        CcRosReleaseVacb(SharedCacheMap, Vacb, FALSE, FALSE);
+            _SEH2_TRY
+            {
+                Success = CcRosEnsureVacbResident(Vacb, TRUE, FALSE,
+                        CurrentOffset % VACB_MAPPING_GRANULARITY, PartialLength);
+            }
+            _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+            {
+                Success = FALSE;
+            }
+            _SEH2_END
 
-        Length -= PartialLength;
-        CurrentOffset += PartialLength;
-    }
+            if (!Success)
+            {
+                CcRosReleaseVacb(SharedCacheMap, Vacb, FALSE, FALSE);
+                DPRINT1("Failed to read data: %lx!\n", Status);
+                goto Clear;
+            }
 
-    while (Length > 0)
-    {
-        ASSERT(CurrentOffset % VACB_MAPPING_GRANULARITY == 0);
-        PartialLength = min(VACB_MAPPING_GRANULARITY, Length);
-        Status = CcRosRequestVacb(SharedCacheMap,
-                                  CurrentOffset,
-                                  &Vacb);
-        if (!NT_SUCCESS(Status))
-        {
-            DPRINT1("Failed to request VACB: %lx!\n", Status);
-            goto Clear;
-        }
+            CcRosReleaseVacb(SharedCacheMap, Vacb, FALSE, FALSE);
 
-        _SEH2_TRY
-        {
-            Success = CcRosEnsureVacbResident(Vacb, TRUE, FALSE, 0, PartialLength);
-        }
-        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
-        {
-            Success = FALSE;
+            Length -= PartialLength;
+            CurrentOffset += PartialLength;
         }
-        _SEH2_END
 
-        if (!Success)
+        while (Length > 0)
         {
+            ASSERT(CurrentOffset % VACB_MAPPING_GRANULARITY == 0);
+            PartialLength = min(VACB_MAPPING_GRANULARITY, Length);
+            Status = CcRosRequestVacb(SharedCacheMap,
+                                      CurrentOffset,
+                                      &Vacb);
+            if (!NT_SUCCESS(Status))
+            {
+                DPRINT1("Failed to request VACB: %lx!\n", Status);
+                goto Clear;
+            }
+
+            _SEH2_TRY
+            {
+                Success = CcRosEnsureVacbResident(Vacb, TRUE, FALSE, 0, PartialLength);
+            }
+            _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+            {
+                Success = FALSE;
+            }
+            _SEH2_END
+
+            if (!Success)
+            {
+                CcRosReleaseVacb(SharedCacheMap, Vacb, FALSE, FALSE);
+                DPRINT1("Failed to read data: %lx!\n", Status);
+                goto Clear;
+            }
+
             CcRosReleaseVacb(SharedCacheMap, Vacb, FALSE, FALSE);
-            DPRINT1("Failed to read data: %lx!\n", Status);
-            goto Clear;
-        }
 
-        CcRosReleaseVacb(SharedCacheMap, Vacb, FALSE, FALSE);
+            Length -= PartialLength;
+            CurrentOffset += PartialLength;
+        }
+    } while (CcpDequeueReadAhead(FileObject, &CurrentOffset, &Length));
 
-        Length -= PartialLength;
-        CurrentOffset += PartialLength;
-    }
+    /* Everything was read, and read ahead was already marked as inactive */
+    goto Release;
 
 Clear:
-    /* See previous comment about private cache map */
+    /* See comment about private cache map in CcpDequeueReadAhead */
     OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
     PrivateCacheMap = FileObject->PrivateCacheMap;
     if (PrivateCacheMap != NULL)
     {
-        /* Mark read ahead as unactive */
+        /* Drop whatever was scheduled meanwhile, and mark read ahead as unactive */
         KeAcquireSpinLockAtDpcLevel(&PrivateCacheMap->ReadAheadSpinLock);
+        PrivateCacheMap->ReadAheadLength[1] = 0;
         InterlockedAnd((volatile long *)&PrivateCacheMap->UlongFlags, ~PRIVATE_CACHE_MAP_READ_AHEAD_ACTIVE);
         KeReleaseSpinLockFromDpcLevel(&PrivateCacheMap->ReadAheadSpinLock);
     }
     KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
 
+Release:
     /* If file was locked, release it */
     if (Locked)
     {
@@ -306,7 +345,7 @@ CcCanIWrite (
     KIRQL OldIrql;
     KEVENT WaitEvent;
     ULONG Length, Pages;
-    BOOLEAN PerFileDefer;
+    BOOLEAN PerFileDefer, PerVolumeDefer;
     DEFERRED_WRITE Context;
     PFSRTL_COMMON_FCB_HEADER Fcb;
     CC_CAN_WRITE_RETRY TryContext;
@@ -374,10 +413,28 @@ CcCanIWrite (
         }
     }
 
+    /* Check the dirty budget of the volume. No need to lock: a file being
+     * written through the cache has a shared cache map, and that one keeps
+     * the volume cache map alive
+     */
+    PerVolumeDefer = FALSE;
+    if (FileObject->SectionObjectPointer != NULL &&
+        FileObject->SectionObjectPointer->SharedCacheMap != NULL)
+    {
+        PROS_VOLUME_CACHE_MAP VolumeCacheMap;
+
+        SharedCacheMap = FileObject->SectionObjectPointer->SharedCacheMap;
+        VolumeCacheMap = SharedCacheMap->VolumeCacheMap;
+        if (VolumeCacheMap->DirtyPages + Pages >= VolumeCacheMap->DirtyPageThreshold)
+        {
+            PerVolumeDefer = TRUE;
+        }
+    }
+
     /* So, now allow write if:
      * - Not the first try or we have no throttling yet
      * AND:
-     * - We don't exceed threshold!
+     * - We don't exceed threshold, neither global nor for the volume!
      * - We don't exceed what Mm can allow us to use
      *   + If we're above top, that's fine
      *   + If we're above bottom with limited modified pages, that's fine
@@ -387,11 +444,23 @@ CcCanIWrite (
         CcTotalDirtyPages + Pages < CcDirtyPageThreshold &&
         (MmAvailablePages > MmThrottleTop ||
          (MmModifiedPageListHead.Total < 1000 && MmAvailablePages > MmThrottleBottom)) &&
-        !PerFileDefer)
+        !PerFileDefer && !PerVolumeDefer)
     {
         return TRUE;
     }
 
+    /* Account the throttling, only once per write */
+    if (TryContext == FirstTry)
+    {
+        InterlockedIncrement((PLONG)&CcThrottleEvents);
+        if (FileObject->SectionObjectPointer != NULL &&
+            FileObject->SectionObjectPointer->SharedCacheMap != NULL)
+        {
+            SharedCacheMap = FileObject->SectionObjectPointer->SharedCacheMap;
+            InterlockedIncrement((PLONG)&SharedCacheMap->VolumeCacheMap->ThrottleCount);
+        }
+    }
+
     /* If we can wait, we'll start the wait loop for waiting till we can
      * write for real
      */
@@ -442,6 +511,8 @@ CcCanIWrite (
     DPRINT1("Because:\n");
     if (CcTotalDirtyPages + Pages >= CcDirtyPageThreshold)
         DPRINT1("    There are too many cache dirty pages: %x + %x >= %x\n", CcTotalDirtyPages, Pages, CcDirtyPageThreshold);
+    if (PerVolumeDefer)
+        DPRINT1("    There are too many cache dirty pages on the volume\n");
     if (MmAvailablePages <= MmThrottleTop)
         DPRINT1("    Available pages are below throttle top: %lx <= %lx\n", MmAvailablePages, MmThrottleTop);
     if (MmModifiedPageListHead.Total >= 1000)
@@ -559,28 +630,15 @@ CcCopyRead (
     IoStatus->Status = STATUS_SUCCESS;
     IoStatus->Information = ReadLength;
 
-#if 0
-    /* If that was a successful sync read operation, let's handle read ahead */
-    if (Length == 0 && Wait)
+    /* If that was a successful read operation, let's handle read ahead.
+     * CcScheduleReadAhead keeps the read history and decides whether
+     * anything is worth reading in advance
+     */
+    if (Length == 0 && FileObject->PrivateCacheMap != NULL &&
+        !BooleanFlagOn(FileObject->Flags, FO_RANDOM_ACCESS))
     {
-        PPRIVATE_CACHE_MAP PrivateCacheMap = FileObject->PrivateCacheMap;
-
-        /* If file isn't random access and next read may get us cross VACB boundary,
-         * schedule next read
-         */
-        if (!BooleanFlagOn(FileObject->Flags, FO_RANDOM_ACCESS) &&
-            (CurrentOffset - 1) / VACB_MAPPING_GRANULARITY != (CurrentOffset + ReadLength - 1) / VACB_MAPPING_GRANULARITY)
-        {
-            CcScheduleReadAhead(FileObject, FileOffset, ReadLength);
-        }
-
-        /* And update read history in private cache map */
-        PrivateCacheMap->FileOffset1.QuadPart = PrivateCacheMap->FileOffset2.QuadPart;
-        PrivateCacheMap->BeyondLastByte1.QuadPart = PrivateCacheMap->BeyondLastByte2.QuadPart;
-        PrivateCacheMap->FileOffset2.QuadPart = FileOffset->QuadPart;
-        PrivateCacheMap->BeyondLastByte2.QuadPart = FileOffset->QuadPart + ReadLength;
+        CcScheduleReadAhead(FileObject, FileOffset, ReadLength);
     }
-#endif
 
     return TRUE;
 }
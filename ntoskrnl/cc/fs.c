@@ -109,7 +109,8 @@ CcIsThereDirtyData (
     IN PVPB Vpb)
 {
     PROS_VACB Vacb;
-    PLIST_ENTRY Entry;
+    PLIST_ENTRY Entry, VolumeEntry;
+    PROS_VOLUME_CACHE_MAP VolumeCacheMap;
     KIRQL oldIrql;
     /* Assume no dirty data */
     BOOLEAN Dirty = FALSE;
@@ -118,29 +119,38 @@ CcIsThereDirtyData (
 
     oldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
 
-    /* Browse dirty VACBs */
-    for (Entry = DirtyVacbListHead.Flink; Entry != &DirtyVacbListHead; Entry = Entry->Flink)
+    /* Browse dirty VACBs of all volumes */
+    for (VolumeEntry = CcVolumeCacheMapList.Flink;
+         VolumeEntry != &CcVolumeCacheMapList && !Dirty;
+         VolumeEntry = VolumeEntry->Flink)
     {
-        Vacb = CONTAINING_RECORD(Entry, ROS_VACB, DirtyVacbListEntry);
-        /* Look for these associated with our volume */
-        if (Vacb->SharedCacheMap->FileObject->Vpb != Vpb)
-        {
-            continue;
-        }
-
-        /* From now on, we are associated with our VPB */
-
-        /* Temporary files are not counted as dirty */
-        if (BooleanFlagOn(Vacb->SharedCacheMap->FileObject->Flags, FO_TEMPORARY_FILE))
-        {
-            continue;
-        }
+        VolumeCacheMap = CONTAINING_RECORD(VolumeEntry, ROS_VOLUME_CACHE_MAP, VolumeCacheMapLinks);
 
-        /* A single dirty VACB is enough to have dirty data */
-        if (Vacb->Dirty)
+        for (Entry = VolumeCacheMap->DirtyVacbListHead.Flink;
+             Entry != &VolumeCacheMap->DirtyVacbListHead;
+             Entry = Entry->Flink)
         {
-            Dirty = TRUE;
-            break;
+            Vacb = CONTAINING_RECORD(Entry, ROS_VACB, DirtyVacbListEntry);
+            /* Look for these associated with our volume */
+            if (Vacb->SharedCacheMap->FileObject->Vpb != Vpb)
+            {
+                continue;
+            }
+
+            /* From now on, we are associated with our VPB */
+
+            /* Temporary files are not counted as dirty */
+            if (BooleanFlagOn(Vacb->SharedCacheMap->FileObject->Flags, FO_TEMPORARY_FILE))
+            {
+                continue;
+            }
+
+            /* A single dirty VACB is enough to have dirty data */
+            if (Vacb->Dirty)
+            {
+                Dirty = TRUE;
+                break;
+            }
         }
     }
 
@@ -261,7 +271,7 @@ CcPurgeCacheSection (
         {
             CcRosUnmarkDirtyVacb(Vacb, FALSE);
         }
-        RemoveEntryList(&Vacb->CacheMapVacbListEntry);
+        CcRosRemoveVacbFromMap(Vacb);
         InsertHeadList(&FreeList, &Vacb->CacheMapVacbListEntry);
     }
     KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
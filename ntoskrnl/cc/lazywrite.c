@@ -16,9 +16,13 @@
 /* Counters:
  * - Amount of pages flushed by lazy writer
  * - Number of times lazy writer ran
+ * - Pages flushed by lazy writer during the last second
  */
 ULONG CcLazyWritePages = 0;
 ULONG CcLazyWriteIos = 0;
+ULONG CcLazyWritePagesPerSecond = 0;
+static ULONG CcLastLazyWritePages = 0;
+static ULONGLONG CcLastLazyWriteScanTime = 0;
 
 /* Internal vars (MS):
  * - Lazy writer status structure
@@ -114,23 +118,39 @@ CcScanDpc(
 }
 
 VOID
-CcWriteBehind(VOID)
+CcWriteBehind(
+    IN PROS_VOLUME_CACHE_MAP VolumeCacheMap)
 {
     ULONG Target, Count;
+    KIRQL OldIrql;
+
+    /* Our target is one-eighth of the dirty pages of the volume,
+     * plus whatever exceeds its share of the dirty pages
+     */
+    Target = VolumeCacheMap->DirtyPages / 8;
+    if (VolumeCacheMap->DirtyPages > VolumeCacheMap->DirtyPageThreshold)
+    {
+        Target += VolumeCacheMap->DirtyPages - VolumeCacheMap->DirtyPageThreshold;
+    }
 
-    Target = CcTotalDirtyPages / 8;
     if (Target != 0)
     {
         /* Flush! */
-        DPRINT("Lazy writer starting (%d)\n", Target);
-        CcRosFlushDirtyPages(Target, &Count, FALSE, TRUE);
+        DPRINT("Lazy writer starting for %p (%d)\n", VolumeCacheMap->DeviceObject, Target);
+        CcRosFlushVolumeDirtyPages(VolumeCacheMap, Target, &Count, FALSE, TRUE);
 
         /* And update stats */
-        CcLazyWritePages += Count;
-        ++CcLazyWriteIos;
-        DPRINT("Lazy writer done (%d)\n", Count);
+        InterlockedExchangeAdd((PLONG)&CcLazyWritePages, Count);
+        InterlockedIncrement((PLONG)&CcLazyWriteIos);
+        DPRINT("Lazy writer done for %p (%d)\n", VolumeCacheMap->DeviceObject, Count);
     }
 
+    /* This volume can be queued again */
+    OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
+    VolumeCacheMap->Flags &= ~VOLUME_CACHE_MAP_WRITE_BEHIND_QUEUED;
+    CcRosDereferenceVolumeCacheMap(VolumeCacheMap);
+    KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
+
     /* Make sure we're not throttling writes after this */
     while (MmAvailablePages < MmThrottleTop)
     {
@@ -145,14 +165,17 @@ CcWriteBehind(VOID)
 VOID
 CcLazyWriteScan(VOID)
 {
-    ULONG Target;
     KIRQL OldIrql;
     PLIST_ENTRY ListEntry;
-    LIST_ENTRY ToPost;
+    LIST_ENTRY ToPost, ToWrite;
     PWORK_QUEUE_ENTRY WorkItem;
+    PROS_VOLUME_CACHE_MAP VolumeCacheMap;
+    ULONGLONG CurrentTime, Elapsed;
+    ULONG Pages;
 
     /* Do we have entries to queue after we're done? */
     InitializeListHead(&ToPost);
+    InitializeListHead(&ToWrite);
     OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
     if (LazyWriter.OtherWork)
     {
@@ -164,21 +187,67 @@ CcLazyWriteScan(VOID)
         }
         LazyWriter.OtherWork = FALSE;
     }
-    KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
 
-    /* Our target is one-eighth of the dirty pages */
-    Target = CcTotalDirtyPages / 8;
-    if (Target != 0)
+    /* Update the flush rates, both global and per volume */
+    CurrentTime = KeQueryInterruptTime();
+    Elapsed = CurrentTime - CcLastLazyWriteScanTime;
+    if (Elapsed >= 10 * 1000 * 1000)
+    {
+        Pages = CcLazyWritePages - CcLastLazyWritePages;
+        CcLazyWritePagesPerSecond = (ULONG)(Pages * 10ULL * 1000 * 1000 / Elapsed);
+        CcLastLazyWritePages += Pages;
+    }
+
+    /* Schedule a write-behind operation for each volume that has stuff to flush.
+     * They're handled by different workers, so that a slow volume doesn't hold
+     * the others back. A volume only gets a single one at a time
+     */
+    for (ListEntry = CcVolumeCacheMapList.Flink;
+         ListEntry != &CcVolumeCacheMapList;
+         ListEntry = ListEntry->Flink)
     {
-        /* There is stuff to flush, schedule a write-behind operation */
+        VolumeCacheMap = CONTAINING_RECORD(ListEntry, ROS_VOLUME_CACHE_MAP, VolumeCacheMapLinks);
+
+        if (Elapsed >= 10 * 1000 * 1000)
+        {
+            Pages = VolumeCacheMap->PagesFlushed - VolumeCacheMap->LastPagesFlushed;
+            VolumeCacheMap->PagesFlushedPerSecond = (ULONG)(Pages * 10ULL * 1000 * 1000 / Elapsed);
+            VolumeCacheMap->LastPagesFlushed += Pages;
+        }
+
+        if (VolumeCacheMap->DirtyPages / 8 == 0 ||
+            BooleanFlagOn(VolumeCacheMap->Flags, VOLUME_CACHE_MAP_WRITE_BEHIND_QUEUED))
+        {
+            continue;
+        }
 
         /* Allocate a work item */
         WorkItem = ExAllocateFromNPagedLookasideList(&CcTwilightLookasideList);
-        if (WorkItem != NULL)
+        if (WorkItem == NULL)
         {
-            WorkItem->Function = WriteBehind;
-            CcPostWorkQueue(WorkItem, &CcRegularWorkQueue);
+            break;
         }
+
+        /* The work item keeps the volume around */
+        VolumeCacheMap->Flags |= VOLUME_CACHE_MAP_WRITE_BEHIND_QUEUED;
+        VolumeCacheMap->UseCount++;
+        WorkItem->Function = WriteBehind;
+        WorkItem->Parameters.WriteBehind.VolumeCacheMap = VolumeCacheMap;
+        InsertTailList(&ToWrite, &WorkItem->WorkQueueLinks);
+    }
+
+    if (Elapsed >= 10 * 1000 * 1000)
+    {
+        CcLastLazyWriteScanTime = CurrentTime;
+    }
+    KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
+
+    /* Post write-behind operations */
+    while (!IsListEmpty(&ToWrite))
+    {
+        ListEntry = RemoveHeadList(&ToWrite);
+        WorkItem = CONTAINING_RECORD(ListEntry, WORK_QUEUE_ENTRY, WorkQueueLinks);
+        CcPostWorkQueue(WorkItem, &CcRegularWorkQueue);
     }
 
     /* Post items that were due for end of run */
@@ -318,7 +387,7 @@ CcWorkerThread(
 
             case WriteBehind:
                 PsGetCurrentThread()->MemoryMaker = 1;
-                CcWriteBehind();
+                CcWriteBehind(WorkItem->Parameters.WriteBehind.VolumeCacheMap);
                 PsGetCurrentThread()->MemoryMaker = 0;
                 WritePerformed = TRUE;
                 break;
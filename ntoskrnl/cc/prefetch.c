@@ -0,0 +1,958 @@
+/*
+ * PROJECT:     ReactOS Kernel
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Boot and application launch prefetcher
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+/*
+ * The first seconds of the boot and of every process launch are traced: each
+ * fault on a file backed view is logged with its file and page. When the trace
+ * ends, the faults are sorted, merged into runs and written to
+ * \SystemRoot\Prefetch. On the next boot or launch of the same image, the
+ * runs are read in file and page order before the scenario starts to fault,
+ * which turns a random stream of small in-page reads into a few large ones.
+ */
+
+/* INCLUDES *****************************************************************/
+
+#include <ntoskrnl.h>
+#include <reactos/pftrace.h>
+#define NDEBUG
+#include <debug.h>
+
+C_ASSERT(PF_TRACE_PAGE_SHIFT == PAGE_SHIFT);
+
+/* GLOBALS ******************************************************************/
+
+ULONG CcPfEnablePrefetcher = PF_ENABLE_APPLICATION_LAUNCH | PF_ENABLE_BOOT;
+PFSN_PREFETCHER_GLOBALS CcPfGlobals;
+
+/* How long the scenarios are traced, in seconds */
+ULONG CcPfBootTraceTime = 60;
+ULONG CcPfLaunchTraceTime = 10;
+
+#define PFSN_TRACE_MAGIC            'rTfP'
+
+/* Limits of the traces */
+#define PF_BOOT_MAXIMUM_FAULTS      0x10000
+#define PF_BOOT_MAXIMUM_FILES       1024
+#define PF_LAUNCH_MAXIMUM_FAULTS    0x4000
+#define PF_LAUNCH_MAXIMUM_FILES     256
+
+/* Pages logged per trace buffer */
+#define PF_ENTRIES_PER_BUFFER \
+    ((PAGE_SIZE - FIELD_OFFSET(PFSN_LOG_ENTRIES, Entries)) / sizeof(PF_LOG_ENTRY))
+
+/* A page must fit in PF_LOG_ENTRY::FileOffset */
+#define PF_MAXIMUM_PAGE             ((1UL << 30) - 1)
+
+/* Runs separated by less than this are read at once, a few pages are cheaper than a seek */
+#define PF_MAXIMUM_RUN_GAP          8
+
+/* PRIVATE FUNCTIONS ********************************************************/
+
+static
+VOID
+CcPfpBuildTraceFileName(
+    _In_ PPF_SCENARIO_ID ScenarioId,
+    _Out_writes_(Size) PWCHAR Buffer,
+    _In_ SIZE_T Size)
+{
+    RtlStringCbPrintfW(Buffer,
+                       Size,
+                       L"\\SystemRoot\\Prefetch\\%s-%08lX.pf",
+                       ScenarioId->ScenName,
+                       ScenarioId->HashId);
+}
+
+static
+VOID
+CcPfpFreeTrace(
+    _In_ PPFSN_TRACE_HEADER Trace)
+{
+    PPFSN_LOG_ENTRIES Buffer;
+    ULONG i;
+
+    while (!IsListEmpty(&Trace->TraceBuffersList))
+    {
+        Buffer = CONTAINING_RECORD(RemoveHeadList(&Trace->TraceBuffersList),
+                                   PFSN_LOG_ENTRIES,
+                                   TraceBuffersLink);
+        ExFreePoolWithTag(Buffer, TAG_PREFETCH);
+    }
+
+    for (i = 0; i < Trace->NumFiles; i++)
+    {
+        ObDereferenceObject(Trace->Files[i].FileObject);
+    }
+
+    for (i = 0; i < Trace->NumPrefetchedSections; i++)
+    {
+        ObDereferenceObject(Trace->PrefetchedSections[i]);
+    }
+
+    if (Trace->PrefetchedSections)
+        ExFreePoolWithTag(Trace->PrefetchedSections, TAG_PREFETCH);
+    if (Trace->Files)
+        ExFreePoolWithTag(Trace->Files, TAG_PREFETCH);
+    if (Trace->Process)
+        ObDereferenceObject(Trace->Process);
+
+    ExFreePoolWithTag(Trace, TAG_PREFETCH);
+}
+
+static
+NTSTATUS
+CcPfpWriteTrace(
+    _In_ PPFSN_TRACE_HEADER Trace,
+    _In_ PVOID Buffer,
+    _In_ ULONG Size)
+{
+    UNICODE_STRING Directory = RTL_CONSTANT_STRING(L"\\SystemRoot\\Prefetch");
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    IO_STATUS_BLOCK IoStatusBlock;
+    UNICODE_STRING FileName;
+    WCHAR NameBuffer[64];
+    HANDLE Handle;
+    NTSTATUS Status;
+
+    /* Make sure the directory is there */
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &Directory,
+                               OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                               NULL,
+                               NULL);
+    Status = ZwCreateFile(&Handle,
+                          FILE_LIST_DIRECTORY | SYNCHRONIZE,
+                          &ObjectAttributes,
+                          &IoStatusBlock,
+                          NULL,
+                          FILE_ATTRIBUTE_DIRECTORY,
+                          FILE_SHARE_READ | FILE_SHARE_WRITE,
+                          FILE_OPEN_IF,
+                          FILE_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT,
+                          NULL,
+                          0);
+    if (!NT_SUCCESS(Status))
+        return Status;
+    ZwClose(Handle);
+
+    CcPfpBuildTraceFileName(&Trace->ScenarioId, NameBuffer, sizeof(NameBuffer));
+    RtlInitUnicodeString(&FileName, NameBuffer);
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &FileName,
+                               OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                               NULL,
+                               NULL);
+    Status = ZwCreateFile(&Handle,
+                          FILE_WRITE_DATA | SYNCHRONIZE,
+                          &ObjectAttributes,
+                          &IoStatusBlock,
+                          NULL,
+                          FILE_ATTRIBUTE_NORMAL,
+                          0,
+                          FILE_OVERWRITE_IF,
+                          FILE_NON_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT,
+                          NULL,
+                          0);
+    if (!NT_SUCCESS(Status))
+        return Status;
+
+    Status = ZwWriteFile(Handle, NULL, NULL, NULL, &IoStatusBlock, Buffer, Size, NULL, NULL);
+    ZwClose(Handle);
+
+    return Status;
+}
+
+static
+int
+__cdecl
+CcPfpCompareKeys(
+    const void *Key1,
+    const void *Key2)
+{
+    ULONGLONG First = *(const ULONGLONG *)Key1;
+    ULONGLONG Second = *(const ULONGLONG *)Key2;
+
+    return (First < Second) ? -1 : (First > Second);
+}
+
+/* Sorts the faults by file and page, merges them in runs and saves the result */
+static
+NTSTATUS
+CcPfpSaveTrace(
+    _In_ PPFSN_TRACE_HEADER Trace)
+{
+    PPF_TRACE_FILE_HEADER Header;
+    PPF_TRACE_FILE TraceFiles;
+    PPF_TRACE_RUN Runs;
+    PPFSN_LOG_ENTRIES Buffer;
+    PLIST_ENTRY ListEntry;
+    POBJECT_NAME_INFORMATION NameInfo = NULL;
+    PUNICODE_STRING Names = NULL;
+    PULONGLONG Keys = NULL;
+    ULONG NumKeys, NumRuns, NamesLength, Size, File, i, j;
+    ULONG RunStart, RunEnd;
+    PWCHAR NameBuffer;
+    NTSTATUS Status;
+
+    if (Trace->NumFaults == 0 || Trace->NumFiles == 0)
+        return STATUS_SUCCESS;
+
+    /* Gather the faults as (file, page) keys */
+    Keys = ExAllocatePoolWithTag(PagedPool, Trace->NumFaults * sizeof(ULONGLONG), TAG_PREFETCH);
+    if (!Keys)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    NumKeys = 0;
+    for (ListEntry = Trace->TraceBuffersList.Flink;
+         ListEntry != &Trace->TraceBuffersList;
+         ListEntry = ListEntry->Flink)
+    {
+        Buffer = CONTAINING_RECORD(ListEntry, PFSN_LOG_ENTRIES, TraceBuffersLink);
+        for (i = 0; i < (ULONG)Buffer->NumEntries && NumKeys < (ULONG)Trace->NumFaults; i++)
+        {
+            Keys[NumKeys++] = ((ULONGLONG)Buffer->Entries[i].FileKey << 32) |
+                              Buffer->Entries[i].FileOffset;
+        }
+    }
+
+    qsort(Keys, NumKeys, sizeof(ULONGLONG), CcPfpCompareKeys);
+
+    /* Count the runs */
+    NumRuns = 0;
+    for (i = 0; i < NumKeys; i++)
+    {
+        /* Skip the pages faulted twice and the ones extending the current run */
+        if (i > 0 && (Keys[i] == Keys[i - 1] || Keys[i] == Keys[i - 1] + 1))
+            continue;
+        NumRuns++;
+    }
+
+    /* Get the file names */
+    Status = STATUS_INSUFFICIENT_RESOURCES;
+    NameInfo = ExAllocatePoolWithTag(PagedPool, PAGE_SIZE, TAG_PREFETCH);
+    Names = ExAllocatePoolWithTag(PagedPool, Trace->NumFiles * sizeof(UNICODE_STRING), TAG_PREFETCH);
+    if (!NameInfo || !Names)
+        goto Quit;
+    RtlZeroMemory(Names, Trace->NumFiles * sizeof(UNICODE_STRING));
+
+    NamesLength = 0;
+    for (File = 0; File < Trace->NumFiles; File++)
+    {
+        Status = ObQueryNameString(Trace->Files[File].FileObject, NameInfo, PAGE_SIZE, &Size);
+        if (!NT_SUCCESS(Status) || NameInfo->Name.Length == 0)
+        {
+            /* This file won't be prefetched */
+            DPRINT("No name for file %p: %lx\n", Trace->Files[File].FileObject, Status);
+            continue;
+        }
+
+        Names[File].Buffer = ExAllocatePoolWithTag(PagedPool, NameInfo->Name.Length, TAG_PREFETCH);
+        if (!Names[File].Buffer)
+            continue;
+
+        RtlCopyMemory(Names[File].Buffer, NameInfo->Name.Buffer, NameInfo->Name.Length);
+        Names[File].Length = Names[File].MaximumLength = NameInfo->Name.Length;
+        NamesLength += Names[File].Length + sizeof(UNICODE_NULL);
+    }
+
+    Size = sizeof(PF_TRACE_FILE_HEADER) +
+           Trace->NumFiles * sizeof(PF_TRACE_FILE) +
+           NumRuns * sizeof(PF_TRACE_RUN) +
+           NamesLength;
+    if (Size > PF_TRACE_MAXIMUM_SIZE)
+    {
+        Status = STATUS_BUFFER_OVERFLOW;
+        goto Quit;
+    }
+
+    Header = ExAllocatePoolWithTag(PagedPool, Size, TAG_PREFETCH);
+    if (!Header)
+    {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto Quit;
+    }
+
+    RtlZeroMemory(Header, Size);
+    Header->Magic = PF_TRACE_MAGIC;
+    Header->Version = PF_TRACE_VERSION;
+    Header->ScenarioType = (USHORT)Trace->ScenarioType;
+    Header->Size = Size;
+    Header->HashId = Trace->ScenarioId.HashId;
+    RtlCopyMemory(Header->ScenarioName, Trace->ScenarioId.ScenName, sizeof(Header->ScenarioName));
+    Header->LaunchCount = Trace->LaunchCount;
+    Header->FaultCount = Trace->NumFaults;
+    Header->FileCount = Trace->NumFiles;
+    Header->FileOffset = sizeof(PF_TRACE_FILE_HEADER);
+    Header->RunCount = NumRuns;
+    Header->RunOffset = Header->FileOffset + Trace->NumFiles * sizeof(PF_TRACE_FILE);
+    Header->NameOffset = Header->RunOffset + NumRuns * sizeof(PF_TRACE_RUN);
+    Header->NameLength = NamesLength;
+
+    TraceFiles = (PPF_TRACE_FILE)((ULONG_PTR)Header + Header->FileOffset);
+    Runs = (PPF_TRACE_RUN)((ULONG_PTR)Header + Header->RunOffset);
+    NameBuffer = (PWCHAR)((ULONG_PTR)Header + Header->NameOffset);
+
+    /* Files, in the order they were first used */
+    NamesLength = 0;
+    for (File = 0; File < Trace->NumFiles; File++)
+    {
+        TraceFiles[File].Flags = (USHORT)Trace->Files[File].Flags;
+        if (!Names[File].Buffer)
+            continue;
+
+        TraceFiles[File].NameOffset = NamesLength;
+        TraceFiles[File].NameLength = Names[File].Length;
+        RtlCopyMemory((PUCHAR)NameBuffer + NamesLength, Names[File].Buffer, Names[File].Length);
+        NamesLength += Names[File].Length + sizeof(UNICODE_NULL);
+    }
+
+    /* And the runs, by file and by page */
+    j = 0;
+    for (i = 0; i < NumKeys; i = RunEnd)
+    {
+        File = (ULONG)(Keys[i] >> 32);
+        RunStart = i;
+        for (RunEnd = i + 1; RunEnd < NumKeys; RunEnd++)
+        {
+            if (Keys[RunEnd] != Keys[RunEnd - 1] && Keys[RunEnd] != Keys[RunEnd - 1] + 1)
+                break;
+        }
+
+        if (TraceFiles[File].RunCount == 0)
+            TraceFiles[File].FirstRun = j;
+        TraceFiles[File].RunCount++;
+
+        Runs[j].Page = (ULONG)Keys[RunStart];
+        Runs[j].PageCount = (ULONG)Keys[RunEnd - 1] - (ULONG)Keys[RunStart] + 1;
+        j++;
+    }
+    ASSERT(j == NumRuns);
+
+    Status = CcPfpWriteTrace(Trace, Header, Size);
+    DbgPrintEx(DPFLTR_PREFETCHER_ID,
+               DPFLTR_TRACE_LEVEL,
+               "CCPF: %S-%08lX: %lu faults, %lu files, %lu runs, status %lx\n",
+               Trace->ScenarioId.ScenName,
+               Trace->ScenarioId.HashId,
+               Trace->NumFaults,
+               Trace->NumFiles,
+               NumRuns,
+               Status);
+
+    ExFreePoolWithTag(Header, TAG_PREFETCH);
+
+Quit:
+    if (Names)
+    {
+        for (File = 0; File < Trace->NumFiles; File++)
+        {
+            if (Names[File].Buffer)
+                ExFreePoolWithTag(Names[File].Buffer, TAG_PREFETCH);
+        }
+        ExFreePoolWithTag(Names, TAG_PREFETCH);
+    }
+    if (NameInfo)
+        ExFreePoolWithTag(NameInfo, TAG_PREFETCH);
+    ExFreePoolWithTag(Keys, TAG_PREFETCH);
+
+    return Status;
+}
+
+static
+VOID
+NTAPI
+CcPfpEndTraceWorker(
+    _In_ PVOID Context)
+{
+    PPFSN_TRACE_HEADER Trace = Context;
+    KIRQL OldIrql;
+    ULONG i;
+
+    /* Stop logging */
+    KeAcquireSpinLock(&CcPfGlobals.ActiveTracesLock, &OldIrql);
+    RemoveEntryList(&Trace->ActiveTracesLink);
+    if (Trace->Process)
+        ExInitializeFastReference(&Trace->Process->PrefetchTrace, NULL);
+    else
+        CcPfGlobals.SystemWideTrace = NULL;
+    KeReleaseSpinLock(&CcPfGlobals.ActiveTracesLock, OldIrql);
+
+    /* The scenario is over, the prefetched pages can go with their sections */
+    for (i = 0; i < Trace->NumPrefetchedSections; i++)
+    {
+        ObDereferenceObject(Trace->PrefetchedSections[i]);
+    }
+    Trace->NumPrefetchedSections = 0;
+
+    CcPfpSaveTrace(Trace);
+    CcPfpFreeTrace(Trace);
+}
+
+static
+VOID
+NTAPI
+CcPfpTraceTimerDpc(
+    _In_ PKDPC Dpc,
+    _In_opt_ PVOID DeferredContext,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2)
+{
+    PPFSN_TRACE_HEADER Trace = DeferredContext;
+
+    if (InterlockedExchange(&Trace->EndTraceCalled, 1) == 0)
+        ExQueueWorkItem(&Trace->EndTraceWorkItem, DelayedWorkQueue);
+}
+
+static
+PPFSN_TRACE_HEADER
+CcPfpAllocateTrace(
+    _In_ PPF_SCENARIO_ID ScenarioId,
+    _In_ ULONG ScenarioType,
+    _In_opt_ PEPROCESS Process,
+    _In_ ULONG MaxFaults,
+    _In_ ULONG MaxFiles)
+{
+    PPFSN_TRACE_HEADER Trace;
+    PPFSN_LOG_ENTRIES Buffer;
+
+    /* Logging happens at DISPATCH_LEVEL */
+    Trace = ExAllocatePoolWithTag(NonPagedPool, sizeof(*Trace), TAG_PREFETCH);
+    if (!Trace)
+        return NULL;
+
+    RtlZeroMemory(Trace, sizeof(*Trace));
+    Trace->Magic = PFSN_TRACE_MAGIC;
+    Trace->ScenarioId = *ScenarioId;
+    Trace->ScenarioType = ScenarioType;
+    Trace->MaxFaults = MaxFaults;
+    Trace->MaxFiles = MaxFiles;
+    Trace->LaunchCount = 1;
+    InitializeListHead(&Trace->TraceBuffersList);
+    KeInitializeTimer(&Trace->TraceTimer);
+    KeInitializeDpc(&Trace->TraceTimerDpc, CcPfpTraceTimerDpc, Trace);
+    ExInitializeWorkItem(&Trace->EndTraceWorkItem, CcPfpEndTraceWorker, Trace);
+    KeQuerySystemTime(&Trace->LaunchTime);
+
+    Trace->Files = ExAllocatePoolWithTag(NonPagedPool, MaxFiles * sizeof(PFSN_FILE_ENTRY), TAG_PREFETCH);
+    Buffer = ExAllocatePoolWithTag(NonPagedPool, PAGE_SIZE, TAG_PREFETCH);
+    if (!Trace->Files || !Buffer)
+    {
+        if (Buffer)
+            ExFreePoolWithTag(Buffer, TAG_PREFETCH);
+        CcPfpFreeTrace(Trace);
+        return NULL;
+    }
+
+    Buffer->NumEntries = 0;
+    Buffer->MaxEntries = PF_ENTRIES_PER_BUFFER;
+    InsertTailList(&Trace->TraceBuffersList, &Buffer->TraceBuffersLink);
+    Trace->CurrentTraceBuffer = Buffer;
+    Trace->NumTraceBuffers = 1;
+
+    if (Process)
+    {
+        ObReferenceObject(Process);
+        Trace->Process = Process;
+    }
+
+    return Trace;
+}
+
+/* Starts logging faults into the trace, and ends it after the given time */
+static
+VOID
+CcPfpActivateTrace(
+    _In_ PPFSN_TRACE_HEADER Trace,
+    _In_ ULONG Seconds)
+{
+    LARGE_INTEGER DueTime;
+    KIRQL OldIrql;
+
+    KeAcquireSpinLock(&CcPfGlobals.ActiveTracesLock, &OldIrql);
+    InsertTailList(&CcPfGlobals.ActiveTraces, &Trace->ActiveTracesLink);
+    if (Trace->Process)
+        ExInitializeFastReference(&Trace->Process->PrefetchTrace, Trace);
+    else
+        CcPfGlobals.SystemWideTrace = Trace;
+    KeReleaseSpinLock(&CcPfGlobals.ActiveTracesLock, OldIrql);
+
+    DueTime.QuadPart = -(LONGLONG)Seconds * 10 * 1000 * 1000;
+    KeSetTimer(&Trace->TraceTimer, DueTime, &Trace->TraceTimerDpc);
+}
+
+static
+PPF_TRACE_FILE_HEADER
+CcPfpReadTrace(
+    _In_ PPF_SCENARIO_ID ScenarioId)
+{
+    FILE_STANDARD_INFORMATION FileInfo;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    IO_STATUS_BLOCK IoStatusBlock;
+    PPF_TRACE_FILE_HEADER Header = NULL;
+    UNICODE_STRING FileName;
+    WCHAR NameBuffer[64];
+    HANDLE Handle;
+    NTSTATUS Status;
+
+    CcPfpBuildTraceFileName(ScenarioId, NameBuffer, sizeof(NameBuffer));
+    RtlInitUnicodeString(&FileName, NameBuffer);
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &FileName,
+                               OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                               NULL,
+                               NULL);
+    Status = ZwOpenFile(&Handle,
+                        FILE_READ_DATA | SYNCHRONIZE,
+                        &ObjectAttributes,
+                        &IoStatusBlock,
+                        FILE_SHARE_READ,
+                        FILE_NON_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT);
+    if (!NT_SUCCESS(Status))
+        return NULL;
+
+    Status = ZwQueryInformationFile(Handle,
+                                    &IoStatusBlock,
+                                    &FileInfo,
+                                    sizeof(FileInfo),
+                                    FileStandardInformation);
+    if (!NT_SUCCESS(Status) ||
+        FileInfo.EndOfFile.QuadPart < sizeof(PF_TRACE_FILE_HEADER) ||
+        FileInfo.EndOfFile.QuadPart > PF_TRACE_MAXIMUM_SIZE)
+    {
+        goto Quit;
+    }
+
+    Header = ExAllocatePoolWithTag(PagedPool, FileInfo.EndOfFile.LowPart, TAG_PREFETCH);
+    if (!Header)
+        goto Quit;
+
+    Status = ZwReadFile(Handle,
+                        NULL,
+                        NULL,
+                        NULL,
+                        &IoStatusBlock,
+                        Header,
+                        FileInfo.EndOfFile.LowPart,
+                        NULL,
+                        NULL);
+    if (!NT_SUCCESS(Status) ||
+        IoStatusBlock.Information != FileInfo.EndOfFile.LowPart ||
+        Header->Size != FileInfo.EndOfFile.LowPart)
+    {
+        ExFreePoolWithTag(Header, TAG_PREFETCH);
+        Header = NULL;
+    }
+
+Quit:
+    ZwClose(Handle);
+    return Header;
+}
+
+/* Checks everything in a trace read from disk is within bounds */
+static
+BOOLEAN
+CcPfpValidateTrace(
+    _In_ PPF_TRACE_FILE_HEADER Header,
+    _In_ PPF_SCENARIO_ID ScenarioId)
+{
+    PPF_TRACE_FILE Files;
+    ULONG i;
+
+    if (Header->Magic != PF_TRACE_MAGIC ||
+        Header->Version != PF_TRACE_VERSION ||
+        Header->HashId != ScenarioId->HashId)
+    {
+        return FALSE;
+    }
+
+    if ((Header->FileOffset % sizeof(ULONG)) ||
+        (Header->RunOffset % sizeof(ULONG)) ||
+        (Header->NameOffset % sizeof(WCHAR)) ||
+        (ULONGLONG)Header->FileOffset + (ULONGLONG)Header->FileCount * sizeof(PF_TRACE_FILE) > Header->Size ||
+        (ULONGLONG)Header->RunOffset + (ULONGLONG)Header->RunCount * sizeof(PF_TRACE_RUN) > Header->Size ||
+        (ULONGLONG)Header->NameOffset + Header->NameLength > Header->Size)
+    {
+        return FALSE;
+    }
+
+    Files = (PPF_TRACE_FILE)((ULONG_PTR)Header + Header->FileOffset);
+    for (i = 0; i < Header->FileCount; i++)
+    {
+        if ((Files[i].NameOffset % sizeof(WCHAR)) ||
+            (Files[i].NameLength % sizeof(WCHAR)) ||
+            (ULONGLONG)Files[i].NameOffset + Files[i].NameLength > Header->NameLength ||
+            (ULONGLONG)Files[i].FirstRun + Files[i].RunCount > Header->RunCount)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/* Reads the pages of a file in the trace, keeping its section in the trace */
+static
+VOID
+CcPfpPrefetchFile(
+    _In_ PPFSN_TRACE_HEADER Trace,
+    _In_ PPF_TRACE_FILE_HEADER Header,
+    _In_ PPF_TRACE_FILE File)
+{
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    IO_STATUS_BLOCK IoStatusBlock;
+    UNICODE_STRING FileName;
+    PFILE_OBJECT FileObject;
+    PPF_TRACE_RUN Runs;
+    PSECTION Section;
+    BOOLEAN Image;
+    HANDLE Handle;
+    ULONG i, Page, PageCount;
+    ULONGLONG End;
+    NTSTATUS Status;
+
+    if (File->NameLength == 0 || File->RunCount == 0)
+        return;
+
+    FileName.Buffer = (PWCHAR)((ULONG_PTR)Header + Header->NameOffset + File->NameOffset);
+    FileName.Length = FileName.MaximumLength = File->NameLength;
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &FileName,
+                               OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                               NULL,
+                               NULL);
+
+    Image = BooleanFlagOn(File->Flags, PF_TRACE_FILE_IMAGE);
+    Status = ZwOpenFile(&Handle,
+                        FILE_READ_DATA | (Image ? FILE_EXECUTE : 0) | SYNCHRONIZE,
+                        &ObjectAttributes,
+                        &IoStatusBlock,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        FILE_NON_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT("Cannot open %wZ: %lx\n", &FileName, Status);
+        return;
+    }
+
+    Status = ObReferenceObjectByHandle(Handle,
+                                       0,
+                                       IoFileObjectType,
+                                       KernelMode,
+                                       (PVOID *)&FileObject,
+                                       NULL);
+    ZwClose(Handle);
+    if (!NT_SUCCESS(Status))
+        return;
+
+    Status = MmCreateSection((PVOID *)&Section,
+                             SECTION_MAP_READ,
+                             NULL,
+                             NULL,
+                             Image ? PAGE_EXECUTE : PAGE_READONLY,
+                             Image ? SEC_IMAGE : SEC_COMMIT,
+                             NULL,
+                             FileObject);
+    ObDereferenceObject(FileObject);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT("Cannot create a section for %wZ: %lx\n", &FileName, Status);
+        return;
+    }
+
+    /* Mm falls back to a data section if the image became invalid */
+    if (!!Section->u.Flags.Image != Image)
+    {
+        ObDereferenceObject(Section);
+        return;
+    }
+
+    /* Runs are sorted, read the close ones together */
+    Runs = (PPF_TRACE_RUN)((ULONG_PTR)Header + Header->RunOffset) + File->FirstRun;
+    Page = Runs[0].Page;
+    PageCount = Runs[0].PageCount;
+    for (i = 1; i <= File->RunCount; i++)
+    {
+        if (i < File->RunCount &&
+            Runs[i].Page >= Page &&
+            (ULONGLONG)Runs[i].Page - Page <= (ULONGLONG)PageCount + PF_MAXIMUM_RUN_GAP)
+        {
+            End = max((ULONGLONG)Page + PageCount, (ULONGLONG)Runs[i].Page + Runs[i].PageCount);
+            PageCount = (ULONG)min(End - Page, MAXULONG);
+            continue;
+        }
+
+        Status = MmPrefetchSectionPages(Section, Page, PageCount);
+        if (!NT_SUCCESS(Status))
+        {
+            DPRINT("Prefetching %wZ failed: %lx\n", &FileName, Status);
+            break;
+        }
+
+        if (i < File->RunCount)
+        {
+            Page = Runs[i].Page;
+            PageCount = Runs[i].PageCount;
+        }
+    }
+
+    /* Keep the section, so that the pages stay in it until the scenario ran */
+    Trace->PrefetchedSections[Trace->NumPrefetchedSections++] = Section;
+}
+
+/* Replays the trace of the previous run of the scenario, if there's one */
+static
+VOID
+CcPfpPrefetchScenario(
+    _In_ PPFSN_TRACE_HEADER Trace)
+{
+    PPF_TRACE_FILE_HEADER Header;
+    PPF_TRACE_FILE Files;
+    ULONG i;
+
+    Header = CcPfpReadTrace(&Trace->ScenarioId);
+    if (!Header)
+        return;
+
+    if (!CcPfpValidateTrace(Header, &Trace->ScenarioId))
+    {
+        DPRINT1("Ignoring invalid trace %S-%08lX\n", Trace->ScenarioId.ScenName, Trace->ScenarioId.HashId);
+        goto Quit;
+    }
+
+    Trace->LaunchCount = Header->LaunchCount + 1;
+
+    Trace->PrefetchedSections = ExAllocatePoolWithTag(PagedPool,
+                                                      max(Header->FileCount, 1) * sizeof(PVOID),
+                                                      TAG_PREFETCH);
+    if (!Trace->PrefetchedSections)
+        goto Quit;
+
+    InterlockedIncrement(&CcPfGlobals.ActivePrefetches);
+
+    Files = (PPF_TRACE_FILE)((ULONG_PTR)Header + Header->FileOffset);
+    for (i = 0; i < Header->FileCount; i++)
+    {
+        CcPfpPrefetchFile(Trace, Header, &Files[i]);
+    }
+
+    InterlockedDecrement(&CcPfGlobals.ActivePrefetches);
+
+    DbgPrintEx(DPFLTR_PREFETCHER_ID,
+               DPFLTR_TRACE_LEVEL,
+               "CCPF: %S-%08lX: prefetched %lu of %lu files\n",
+               Trace->ScenarioId.ScenName,
+               Trace->ScenarioId.HashId,
+               Trace->NumPrefetchedSections,
+               Header->FileCount);
+
+Quit:
+    ExFreePoolWithTag(Header, TAG_PREFETCH);
+}
+
+/* Logs a fault into a trace. The active traces lock is held */
+static
+VOID
+CcPfpLogPageFault(
+    _In_ PPFSN_TRACE_HEADER Trace,
+    _In_ PFILE_OBJECT FileObject,
+    _In_ ULONG Page,
+    _In_ ULONG Flags)
+{
+    PPFSN_LOG_ENTRIES Buffer;
+    PPF_LOG_ENTRY Entry;
+    ULONG File;
+
+    if (Trace->NumFaults >= Trace->MaxFaults)
+        return;
+
+    /* Most faults hit one of the last files that were used */
+    for (File = Trace->NumFiles; File > 0; File--)
+    {
+        if (Trace->Files[File - 1].SectionObjectPointer == FileObject->SectionObjectPointer &&
+            Trace->Files[File - 1].Flags == Flags)
+        {
+            break;
+        }
+    }
+
+    if (File == 0)
+    {
+        if (Trace->NumFiles == Trace->MaxFiles)
+            return;
+
+        File = Trace->NumFiles++;
+        Trace->Files[File].SectionObjectPointer = FileObject->SectionObjectPointer;
+        Trace->Files[File].FileObject = FileObject;
+        Trace->Files[File].Flags = Flags;
+        ObReferenceObject(FileObject);
+    }
+    else
+    {
+        File--;
+    }
+
+    Buffer = Trace->CurrentTraceBuffer;
+    if (Buffer->NumEntries == Buffer->MaxEntries)
+    {
+        Buffer = ExAllocatePoolWithTag(NonPagedPool, PAGE_SIZE, TAG_PREFETCH);
+        if (!Buffer)
+            return;
+
+        Buffer->NumEntries = 0;
+        Buffer->MaxEntries = PF_ENTRIES_PER_BUFFER;
+        InsertTailList(&Trace->TraceBuffersList, &Buffer->TraceBuffersLink);
+        Trace->CurrentTraceBuffer = Buffer;
+        Trace->NumTraceBuffers++;
+    }
+
+    Entry = &Buffer->Entries[Buffer->NumEntries++];
+    Entry->FileOffset = Page;
+    Entry->Type = 0;
+    Entry->FileKey = File;
+    Trace->NumFaults++;
+}
+
+/* PUBLIC FUNCTIONS *********************************************************/
+
+CODE_SEG("INIT")
+VOID
+NTAPI
+CcPfInitializePrefetcher(VOID)
+{
+    /* Notify debugger */
+    DbgPrintEx(DPFLTR_PREFETCHER_ID,
+               DPFLTR_TRACE_LEVEL,
+               "CCPF: InitializePrefetecher()\n");
+
+    /* Setup the Prefetcher Data */
+    InitializeListHead(&CcPfGlobals.ActiveTraces);
+    KeInitializeSpinLock(&CcPfGlobals.ActiveTracesLock);
+    InitializeListHead(&CcPfGlobals.CompletedTraces);
+    ExInitializeFastMutex(&CcPfGlobals.CompletedTracesLock);
+}
+
+VOID
+NTAPI
+CcPfLogPageFault(
+    _In_ PFILE_OBJECT FileObject,
+    _In_ ULONG Page,
+    _In_ BOOLEAN Image)
+{
+    PPFSN_TRACE_HEADER Trace;
+    PEPROCESS Process;
+    KIRQL OldIrql;
+    ULONG Flags;
+
+    /* Fast path: nothing is traced most of the time */
+    if (IsListEmpty(&CcPfGlobals.ActiveTraces) || Page > PF_MAXIMUM_PAGE)
+        return;
+
+    Flags = Image ? PF_TRACE_FILE_IMAGE : 0;
+    Process = PsGetCurrentProcess();
+
+    KeAcquireSpinLock(&CcPfGlobals.ActiveTracesLock, &OldIrql);
+
+    Trace = ExGetObjectFastReference(Process->PrefetchTrace);
+    if (Trace)
+        CcPfpLogPageFault(Trace, FileObject, Page, Flags);
+
+    Trace = CcPfGlobals.SystemWideTrace;
+    if (Trace)
+        CcPfpLogPageFault(Trace, FileObject, Page, Flags);
+
+    KeReleaseSpinLock(&CcPfGlobals.ActiveTracesLock, OldIrql);
+}
+
+NTSTATUS
+NTAPI
+CcPfBeginAppLaunch(
+    _In_ PEPROCESS Process)
+{
+    POBJECT_NAME_INFORMATION ImageName;
+    PPFSN_TRACE_HEADER Trace;
+    PF_SCENARIO_ID ScenarioId;
+    UNICODE_STRING FileName;
+    USHORT i;
+    NTSTATUS Status;
+
+    PAGED_CODE();
+
+    if (!(CcPfEnablePrefetcher & PF_ENABLE_APPLICATION_LAUNCH))
+        return STATUS_NOT_SUPPORTED;
+
+    ImageName = Process->SeAuditProcessCreationInfo.ImageFileName;
+    if (!ImageName || ImageName->Name.Length == 0)
+        return STATUS_OBJECT_NAME_NOT_FOUND;
+
+    /* The scenario is keyed by the upcased name of the image and the hash of its path */
+    Status = RtlHashUnicodeString(&ImageName->Name, TRUE, HASH_STRING_ALGORITHM_X65599, &ScenarioId.HashId);
+    if (!NT_SUCCESS(Status))
+        return Status;
+
+    FileName = ImageName->Name;
+    for (i = FileName.Length / sizeof(WCHAR); i > 0; i--)
+    {
+        if (FileName.Buffer[i - 1] == OBJ_NAME_PATH_SEPARATOR)
+            break;
+    }
+    FileName.Buffer += i;
+    FileName.Length -= i * sizeof(WCHAR);
+
+    RtlZeroMemory(ScenarioId.ScenName, sizeof(ScenarioId.ScenName));
+    for (i = 0; i < FileName.Length / sizeof(WCHAR) && i < RTL_NUMBER_OF(ScenarioId.ScenName) - 1; i++)
+    {
+        ScenarioId.ScenName[i] = RtlUpcaseUnicodeChar(FileName.Buffer[i]);
+    }
+
+    Trace = CcPfpAllocateTrace(&ScenarioId,
+                               PF_TRACE_APPLICATION_LAUNCH,
+                               Process,
+                               PF_LAUNCH_MAXIMUM_FAULTS,
+                               PF_LAUNCH_MAXIMUM_FILES);
+    if (!Trace)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    /* The process didn't run yet, get its pages before it faults them one by one */
+    CcPfpPrefetchScenario(Trace);
+    CcPfpActivateTrace(Trace, CcPfLaunchTraceTime);
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+NTAPI
+CcPfBeginBootPhase(
+    _In_ PF_BOOT_PHASE_ID Phase)
+{
+    PPFSN_TRACE_HEADER Trace;
+    PF_SCENARIO_ID ScenarioId;
+
+    PAGED_CODE();
+
+    if (!(CcPfEnablePrefetcher & PF_ENABLE_BOOT))
+        return STATUS_NOT_SUPPORTED;
+
+    /* The boot is traced from the start of the session manager, the disks are usable from there */
+    if (Phase != PfSessionManagerInitPhase)
+        return STATUS_SUCCESS;
+
+    RtlZeroMemory(&ScenarioId, sizeof(ScenarioId));
+    RtlCopyMemory(ScenarioId.ScenName, PF_TRACE_BOOT_NAME, sizeof(PF_TRACE_BOOT_NAME));
+    ScenarioId.HashId = PF_TRACE_BOOT_HASH;
+
+    Trace = CcPfpAllocateTrace(&ScenarioId,
+                               PF_TRACE_SYSTEM_BOOT,
+                               NULL,
+                               PF_BOOT_MAXIMUM_FAULTS,
+                               PF_BOOT_MAXIMUM_FILES);
+    if (!Trace)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    CcPfpPrefetchScenario(Trace);
+    CcPfpActivateTrace(Trace, CcPfBootTraceTime);
+
+    return STATUS_SUCCESS;
+}
@@ -39,7 +39,6 @@
 
 /* GLOBALS *******************************************************************/
 
-LIST_ENTRY DirtyVacbListHead;
 static LIST_ENTRY VacbLruListHead;
 
 NPAGED_LOOKASIDE_LIST iBcbLookasideList;
@@ -49,12 +48,14 @@ static NPAGED_LOOKASIDE_LIST VacbLookasideList;
 /* Internal vars (MS):
  * - Threshold above which lazy writer will start action
  * - Amount of dirty pages
+ * - List of volumes with cached files, each with its dirty VACBs
  * - List for deferred writes
  * - Spinlock when dealing with the deferred list
  * - List for "clean" shared cache maps
  */
 ULONG CcDirtyPageThreshold = 0;
 ULONG CcTotalDirtyPages = 0;
+LIST_ENTRY CcVolumeCacheMapList;
 LIST_ENTRY CcDeferredWrites;
 KSPIN_LOCK CcDeferredWriteSpinLock;
 LIST_ENTRY CcCleanSharedCacheMapList;
@@ -243,6 +244,7 @@ CcRosDeleteFileCache (
     /* Make sure there is no trace anymore of this map */
     FileObject->SectionObjectPointer->SharedCacheMap = NULL;
     RemoveEntryList(&SharedCacheMap->SharedCacheMapLinks);
+    CcRosDereferenceVolumeCacheMap(SharedCacheMap->VolumeCacheMap);
 
     KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
     KeReleaseQueuedSpinLock(LockQueueMasterLock, *OldIrql);
@@ -292,6 +294,12 @@ CcRosDeleteFileCache (
 #endif
     }
 
+    /* The views are gone, so is their index */
+    if (SharedCacheMap->Vacbs != SharedCacheMap->InitialVacbs)
+    {
+        ExFreePoolWithTag(SharedCacheMap->Vacbs, TAG_VACB);
+    }
+
     /* Release the references we own */
     if(SharedCacheMap->Section)
         ObDereferenceObject(SharedCacheMap->Section);
@@ -306,42 +314,48 @@ CcRosDeleteFileCache (
 }
 
 NTSTATUS
-CcRosFlushDirtyPages (
+CcRosFlushVolumeDirtyPages (
+    PROS_VOLUME_CACHE_MAP VolumeCacheMap,
     ULONG Target,
     PULONG Count,
     BOOLEAN Wait,
     BOOLEAN CalledFromLazy)
+/*
+ * FUNCTION: Flushes dirty VACBs of a single volume. The caller must hold
+ * a reference on the volume cache map.
+ */
 {
+    PLIST_ENTRY DirtyVacbListHead = &VolumeCacheMap->DirtyVacbListHead;
     PLIST_ENTRY current_entry;
     NTSTATUS Status;
     KIRQL OldIrql;
     BOOLEAN FlushAll = (Target == MAXULONG);
 
-    DPRINT("CcRosFlushDirtyPages(Target %lu)\n", Target);
+    DPRINT("CcRosFlushVolumeDirtyPages(%p, Target %lu)\n", VolumeCacheMap, Target);
 
     (*Count) = 0;
 
     KeEnterCriticalRegion();
     OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
 
-    current_entry = DirtyVacbListHead.Flink;
-    if (current_entry == &DirtyVacbListHead)
+    current_entry = DirtyVacbListHead->Flink;
+    if (current_entry == DirtyVacbListHead)
     {
         DPRINT("No Dirty pages\n");
     }
 
-    while (((current_entry != &DirtyVacbListHead) && (Target > 0)) || FlushAll)
+    while (((current_entry != DirtyVacbListHead) && (Target > 0)) || FlushAll)
     {
         PROS_SHARED_CACHE_MAP SharedCacheMap;
         PROS_VACB current;
         BOOLEAN Locked;
 
-        if (current_entry == &DirtyVacbListHead)
+        if (current_entry == DirtyVacbListHead)
         {
             ASSERT(FlushAll);
-            if (IsListEmpty(&DirtyVacbListHead))
+            if (IsListEmpty(DirtyVacbListHead))
                 break;
-            current_entry = DirtyVacbListHead.Flink;
+            current_entry = DirtyVacbListHead->Flink;
         }
 
         current = CONTAINING_RECORD(current_entry,
@@ -427,6 +441,7 @@ CcRosFlushDirtyPages (
             /* How many pages did we free? */
             PagesFreed = Iosb.Information / PAGE_SIZE;
             (*Count) += PagesFreed;
+            VolumeCacheMap->PagesFlushed += PagesFreed;
 
             if (!Wait)
             {
@@ -443,13 +458,62 @@ CcRosFlushDirtyPages (
             }
         }
 
-        current_entry = DirtyVacbListHead.Flink;
+        current_entry = DirtyVacbListHead->Flink;
     }
 
     KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
     KeLeaveCriticalRegion();
 
-    DPRINT("CcRosFlushDirtyPages() finished\n");
+    DPRINT("CcRosFlushVolumeDirtyPages() finished\n");
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+CcRosFlushDirtyPages (
+    ULONG Target,
+    PULONG Count,
+    BOOLEAN Wait,
+    BOOLEAN CalledFromLazy)
+/*
+ * FUNCTION: Flushes dirty VACBs, going through all the volumes in turn
+ */
+{
+    PROS_VOLUME_CACHE_MAP VolumeCacheMap;
+    PLIST_ENTRY current_entry;
+    KIRQL OldIrql;
+    ULONG Flushed;
+
+    DPRINT("CcRosFlushDirtyPages(Target %lu)\n", Target);
+
+    (*Count) = 0;
+
+    OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
+
+    current_entry = CcVolumeCacheMapList.Flink;
+    while (current_entry != &CcVolumeCacheMapList && Target > 0)
+    {
+        VolumeCacheMap = CONTAINING_RECORD(current_entry,
+                                           ROS_VOLUME_CACHE_MAP,
+                                           VolumeCacheMapLinks);
+
+        /* Keep it around while we don't hold the lock */
+        VolumeCacheMap->UseCount++;
+        KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
+
+        CcRosFlushVolumeDirtyPages(VolumeCacheMap, Target, &Flushed, Wait, CalledFromLazy);
+        (*Count) += Flushed;
+        if (Target != MAXULONG)
+        {
+            Target = (Flushed < Target) ? Target - Flushed : 0;
+        }
+
+        OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
+        current_entry = current_entry->Flink;
+        CcRosDereferenceVolumeCacheMap(VolumeCacheMap);
+    }
+
+    KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
+
     return STATUS_SUCCESS;
 }
 
@@ -537,7 +601,7 @@ retry:
             ASSERT(!current->MappedCount);
             ASSERT(Refs == 1);
 
-            RemoveEntryList(&current->CacheMapVacbListEntry);
+            CcRosRemoveVacbFromMap(current);
             RemoveEntryList(&current->VacbLruListEntry);
             InitializeListHead(&current->VacbLruListEntry);
             InsertHeadList(&FreeList, &current->CacheMapVacbListEntry);
@@ -619,6 +683,104 @@ CcRosReleaseVacb (
     return STATUS_SUCCESS;
 }
 
+static
+PROS_VACB *
+CcRosGetVacbSlot (
+    PROS_SHARED_CACHE_MAP SharedCacheMap,
+    LONGLONG FileOffset)
+/*
+ * FUNCTION: Returns the slot of the view covering FileOffset, or NULL if the
+ * array doesn't reach that far and the view can only be found in the list.
+ * Must be called with the shared cache map lock held.
+ */
+{
+    ULONGLONG Index = (ULONGLONG)FileOffset / VACB_MAPPING_GRANULARITY;
+
+    if (Index >= SharedCacheMap->VacbArraySize)
+        return NULL;
+
+    return &SharedCacheMap->Vacbs[Index];
+}
+
+VOID
+CcRosRemoveVacbFromMap (
+    PROS_VACB Vacb)
+/*
+ * FUNCTION: Unlinks a VACB from its shared cache map, both from the list and
+ * the array. Must be called with the shared cache map lock held.
+ */
+{
+    PROS_VACB *Slot;
+
+    Slot = CcRosGetVacbSlot(Vacb->SharedCacheMap, Vacb->FileOffset.QuadPart);
+    if (Slot && *Slot == Vacb)
+        *Slot = NULL;
+
+    RemoveEntryList(&Vacb->CacheMapVacbListEntry);
+}
+
+static
+VOID
+CcRosGrowVacbArray (
+    PROS_SHARED_CACHE_MAP SharedCacheMap,
+    LONGLONG FileOffset)
+/*
+ * FUNCTION: Makes sure the VACB array of a shared cache map has a slot for
+ * FileOffset. On failure, views past the end of the array stay in the list
+ * only, and are found by walking it.
+ */
+{
+    ULONGLONG Index = (ULONGLONG)FileOffset / VACB_MAPPING_GRANULARITY;
+    PROS_VACB *NewVacbs, *OldVacbs = NULL;
+    PLIST_ENTRY current_entry;
+    PROS_VACB current;
+    ULONG NewSize;
+    KIRQL oldIrql;
+
+    /* Don't eat non-paged pool for huge files */
+    if (Index < SharedCacheMap->VacbArraySize || Index >= CC_MAXIMUM_VACB_ARRAY_SIZE)
+        return;
+
+    NewSize = SharedCacheMap->VacbArraySize;
+    while (NewSize <= Index)
+        NewSize *= 2;
+
+    NewVacbs = ExAllocatePoolWithTag(NonPagedPool, NewSize * sizeof(PROS_VACB), TAG_VACB);
+    if (!NewVacbs)
+        return;
+    RtlZeroMemory(NewVacbs, NewSize * sizeof(PROS_VACB));
+
+    KeAcquireSpinLock(&SharedCacheMap->CacheMapLock, &oldIrql);
+
+    /* Someone else may have grown it in between */
+    if (NewSize > SharedCacheMap->VacbArraySize)
+    {
+        /* Index all views, including those which didn't fit the old array */
+        current_entry = SharedCacheMap->CacheMapVacbListHead.Flink;
+        while (current_entry != &SharedCacheMap->CacheMapVacbListHead)
+        {
+            current = CONTAINING_RECORD(current_entry, ROS_VACB, CacheMapVacbListEntry);
+            current_entry = current_entry->Flink;
+
+            Index = (ULONGLONG)current->FileOffset.QuadPart / VACB_MAPPING_GRANULARITY;
+            if (Index < NewSize)
+                NewVacbs[Index] = current;
+        }
+
+        OldVacbs = SharedCacheMap->Vacbs;
+        SharedCacheMap->Vacbs = NewVacbs;
+        SharedCacheMap->VacbArraySize = NewSize;
+        NewVacbs = NULL;
+    }
+
+    KeReleaseSpinLock(&SharedCacheMap->CacheMapLock, oldIrql);
+
+    if (NewVacbs)
+        ExFreePoolWithTag(NewVacbs, TAG_VACB);
+    if (OldVacbs && OldVacbs != SharedCacheMap->InitialVacbs)
+        ExFreePoolWithTag(OldVacbs, TAG_VACB);
+}
+
 /* Returns with VACB Lock Held! */
 PROS_VACB
 CcRosLookupVacb (
@@ -626,7 +788,8 @@ CcRosLookupVacb (
     LONGLONG FileOffset)
 {
     PLIST_ENTRY current_entry;
-    PROS_VACB current;
+    PROS_VACB current = NULL;
+    PROS_VACB *Slot;
     KIRQL oldIrql;
 
     ASSERT(SharedCacheMap);
@@ -637,30 +800,44 @@ CcRosLookupVacb (
     oldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
     KeAcquireSpinLockAtDpcLevel(&SharedCacheMap->CacheMapLock);
 
-    current_entry = SharedCacheMap->CacheMapVacbListHead.Flink;
-    while (current_entry != &SharedCacheMap->CacheMapVacbListHead)
+    Slot = CcRosGetVacbSlot(SharedCacheMap, FileOffset);
+    if (Slot)
     {
-        current = CONTAINING_RECORD(current_entry,
-                                    ROS_VACB,
-                                    CacheMapVacbListEntry);
-        if (IsPointInRange(current->FileOffset.QuadPart,
-                           VACB_MAPPING_GRANULARITY,
-                           FileOffset))
+        current = *Slot;
+        ASSERT(!current || IsPointInRange(current->FileOffset.QuadPart,
+                                          VACB_MAPPING_GRANULARITY,
+                                          FileOffset));
+    }
+    else
+    {
+        current_entry = SharedCacheMap->CacheMapVacbListHead.Flink;
+        while (current_entry != &SharedCacheMap->CacheMapVacbListHead)
         {
-            CcRosVacbIncRefCount(current);
-            KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
-            KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
-            return current;
+            PROS_VACB Vacb = CONTAINING_RECORD(current_entry,
+                                               ROS_VACB,
+                                               CacheMapVacbListEntry);
+            if (IsPointInRange(Vacb->FileOffset.QuadPart,
+                               VACB_MAPPING_GRANULARITY,
+                               FileOffset))
+            {
+                current = Vacb;
+                break;
+            }
+            if (Vacb->FileOffset.QuadPart > FileOffset)
+                break;
+            current_entry = current_entry->Flink;
         }
-        if (current->FileOffset.QuadPart > FileOffset)
-            break;
-        current_entry = current_entry->Flink;
+    }
+
+    if (current)
+    {
+        CcRosVacbIncRefCount(current);
     }
 
     KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
     KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
 
-    return NULL;
+    return current;
 }
 
 VOID
@@ -677,10 +854,11 @@ CcRosMarkDirtyVacb (
 
     ASSERT(!Vacb->Dirty);
 
-    InsertTailList(&DirtyVacbListHead, &Vacb->DirtyVacbListEntry);
+    InsertTailList(&SharedCacheMap->VolumeCacheMap->DirtyVacbListHead, &Vacb->DirtyVacbListEntry);
     /* FIXME: There is no reason to account for the whole VACB. */
     CcTotalDirtyPages += VACB_MAPPING_GRANULARITY / PAGE_SIZE;
     Vacb->SharedCacheMap->DirtyPages += VACB_MAPPING_GRANULARITY / PAGE_SIZE;
+    SharedCacheMap->VolumeCacheMap->DirtyPages += VACB_MAPPING_GRANULARITY / PAGE_SIZE;
     CcRosVacbIncRefCount(Vacb);
 
     /* Move to the tail of the LRU list */
@@ -724,6 +902,7 @@ CcRosUnmarkDirtyVacb (
 
     CcTotalDirtyPages -= VACB_MAPPING_GRANULARITY / PAGE_SIZE;
     Vacb->SharedCacheMap->DirtyPages -= VACB_MAPPING_GRANULARITY / PAGE_SIZE;
+    SharedCacheMap->VolumeCacheMap->DirtyPages -= VACB_MAPPING_GRANULARITY / PAGE_SIZE;
 
     CcRosVacbDecRefCount(Vacb);
 
@@ -766,7 +945,7 @@ CcRosFreeOneUnusedVacb(
             ASSERT(Refs == 1);
 
             /* Reset it, this is the one we want to free */
-            RemoveEntryList(&current->CacheMapVacbListEntry);
+            CcRosRemoveVacbFromMap(current);
             InitializeListHead(&current->CacheMapVacbListEntry);
             RemoveEntryList(&current->VacbLruListEntry);
             InitializeListHead(&current->VacbLruListEntry);
@@ -802,10 +981,11 @@ CcRosCreateVacb (
 {
     PROS_VACB current;
     PROS_VACB previous;
+    PROS_VACB *Slot;
     PLIST_ENTRY current_entry;
     NTSTATUS Status;
     KIRQL oldIrql;
-    ULONG Refs;
+    ULONG Refs, Index;
     SIZE_T ViewSize = VACB_MAPPING_GRANULARITY;
 
     ASSERT(SharedCacheMap);
@@ -858,55 +1038,82 @@ CcRosCreateVacb (
     }
 #endif
 
+    /* Make room for it in the array before taking the locks */
+    CcRosGrowVacbArray(SharedCacheMap, FileOffset);
+
     oldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
 
     *Vacb = current;
+    current = NULL;
+    previous = NULL;
     /* There is window between the call to CcRosLookupVacb
      * and CcRosCreateVacb. We must check if a VACB for the
      * file offset exist. If there is a VACB, we release
      * our newly created VACB and return the existing one.
      */
     KeAcquireSpinLockAtDpcLevel(&SharedCacheMap->CacheMapLock);
-    current_entry = SharedCacheMap->CacheMapVacbListHead.Flink;
-    previous = NULL;
-    while (current_entry != &SharedCacheMap->CacheMapVacbListHead)
+    Slot = CcRosGetVacbSlot(SharedCacheMap, FileOffset);
+    if (Slot)
     {
-        current = CONTAINING_RECORD(current_entry,
-                                    ROS_VACB,
-                                    CacheMapVacbListEntry);
-        if (IsPointInRange(current->FileOffset.QuadPart,
-                           VACB_MAPPING_GRANULARITY,
-                           FileOffset))
+        current = *Slot;
+        if (!current)
         {
-            CcRosVacbIncRefCount(current);
-            KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
-#if DBG
-            if (SharedCacheMap->Trace)
+            /* Find the closest view before ours, to keep the list sorted */
+            for (Index = (ULONG)(Slot - SharedCacheMap->Vacbs); Index > 0 && !previous; Index--)
             {
-                DPRINT1("CacheMap 0x%p: deleting newly created VACB 0x%p ( found existing one 0x%p )\n",
-                        SharedCacheMap,
-                        (*Vacb),
-                        current);
+                previous = SharedCacheMap->Vacbs[Index - 1];
             }
-#endif
-            KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
-
-            Refs = CcRosVacbDecRefCount(*Vacb);
-            ASSERT(Refs == 0);
-
-            *Vacb = current;
-            return STATUS_SUCCESS;
         }
-        if (current->FileOffset.QuadPart < FileOffset)
+    }
+    else
+    {
+        current_entry = SharedCacheMap->CacheMapVacbListHead.Flink;
+        while (current_entry != &SharedCacheMap->CacheMapVacbListHead)
         {
-            ASSERT(previous == NULL ||
-                   previous->FileOffset.QuadPart < current->FileOffset.QuadPart);
-            previous = current;
+            PROS_VACB Existing = CONTAINING_RECORD(current_entry,
+                                                   ROS_VACB,
+                                                   CacheMapVacbListEntry);
+            if (IsPointInRange(Existing->FileOffset.QuadPart,
+                               VACB_MAPPING_GRANULARITY,
+                               FileOffset))
+            {
+                current = Existing;
+                break;
+            }
+            if (Existing->FileOffset.QuadPart < FileOffset)
+            {
+                ASSERT(previous == NULL ||
+                       previous->FileOffset.QuadPart < Existing->FileOffset.QuadPart);
+                previous = Existing;
+            }
+            if (Existing->FileOffset.QuadPart > FileOffset)
+                break;
+            current_entry = current_entry->Flink;
         }
-        if (current->FileOffset.QuadPart > FileOffset)
-            break;
-        current_entry = current_entry->Flink;
     }
+
+    if (current)
+    {
+        CcRosVacbIncRefCount(current);
+        KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
+#if DBG
+        if (SharedCacheMap->Trace)
+        {
+            DPRINT1("CacheMap 0x%p: deleting newly created VACB 0x%p ( found existing one 0x%p )\n",
+                    SharedCacheMap,
+                    (*Vacb),
+                    current);
+        }
+#endif
+        KeReleaseQueuedSpinLock(LockQueueMasterLock, oldIrql);
+
+        Refs = CcRosVacbDecRefCount(*Vacb);
+        ASSERT(Refs == 0);
+
+        *Vacb = current;
+        return STATUS_SUCCESS;
+    }
+
     /* There was no existing VACB. */
     current = *Vacb;
     if (previous)
@@ -917,6 +1124,10 @@ CcRosCreateVacb (
     {
         InsertHeadList(&SharedCacheMap->CacheMapVacbListHead, &current->CacheMapVacbListEntry);
     }
+    if (Slot)
+    {
+        *Slot = current;
+    }
     KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
     InsertTailList(&VacbLruListHead, &current->VacbLruListEntry);
 
@@ -1260,7 +1471,7 @@ CcRosReleaseFileCache (
             KeReleaseSpinLockFromDpcLevel(&SharedCacheMap->CacheMapLock);
 
             /* And free it. */
-            if (PrivateMap != &SharedCacheMap->PrivateCacheMap)
+            if (PrivateMap != &SharedCacheMap->PrivateCacheMap.PrivateCacheMap)
             {
                 ExFreePoolWithTag(PrivateMap, TAG_PRIVATE_CACHE_MAP);
             }
@@ -1282,6 +1493,72 @@ CcRosReleaseFileCache (
     return STATUS_SUCCESS;
 }
 
+static
+PROS_VOLUME_CACHE_MAP
+CcRosReferenceVolumeCacheMap (
+    PDEVICE_OBJECT DeviceObject)
+/*
+ * FUNCTION: Returns the volume cache map for a device, creating it if needed.
+ * Must be called with the master lock held.
+ */
+{
+    PLIST_ENTRY current_entry;
+    PROS_VOLUME_CACHE_MAP VolumeCacheMap;
+
+    current_entry = CcVolumeCacheMapList.Flink;
+    while (current_entry != &CcVolumeCacheMapList)
+    {
+        VolumeCacheMap = CONTAINING_RECORD(current_entry,
+                                           ROS_VOLUME_CACHE_MAP,
+                                           VolumeCacheMapLinks);
+        if (VolumeCacheMap->DeviceObject == DeviceObject)
+        {
+            VolumeCacheMap->UseCount++;
+            return VolumeCacheMap;
+        }
+        current_entry = current_entry->Flink;
+    }
+
+    VolumeCacheMap = ExAllocatePoolWithTag(NonPagedPool, sizeof(*VolumeCacheMap), TAG_VOLUME_CACHE_MAP);
+    if (VolumeCacheMap == NULL)
+    {
+        return NULL;
+    }
+
+    RtlZeroMemory(VolumeCacheMap, sizeof(*VolumeCacheMap));
+    VolumeCacheMap->NodeTypeCode = NODE_TYPE_VOLUME_MAP;
+    VolumeCacheMap->NodeByteSize = sizeof(*VolumeCacheMap);
+    VolumeCacheMap->UseCount = 1;
+    VolumeCacheMap->DeviceObject = DeviceObject;
+    InitializeListHead(&VolumeCacheMap->DirtyVacbListHead);
+    /* A single volume may not take the whole dirty budget, keep some for the others */
+    VolumeCacheMap->DirtyPageThreshold = CcDirtyPageThreshold - CcDirtyPageThreshold / 4;
+    InsertTailList(&CcVolumeCacheMapList, &VolumeCacheMap->VolumeCacheMapLinks);
+
+    return VolumeCacheMap;
+}
+
+VOID
+CcRosDereferenceVolumeCacheMap (
+    PROS_VOLUME_CACHE_MAP VolumeCacheMap)
+/*
+ * FUNCTION: Drops a reference on a volume cache map, and frees it when
+ * no file of that volume is cached anymore.
+ * Must be called with the master lock held.
+ */
+{
+    ASSERT(VolumeCacheMap->UseCount > 0);
+
+    if (--VolumeCacheMap->UseCount != 0)
+        return;
+
+    ASSERT(VolumeCacheMap->DirtyPages == 0);
+    ASSERT(IsListEmpty(&VolumeCacheMap->DirtyVacbListHead));
+
+    RemoveEntryList(&VolumeCacheMap->VolumeCacheMapLinks);
+    ExFreePoolWithTag(VolumeCacheMap, TAG_VOLUME_CACHE_MAP);
+}
+
 NTSTATUS
 CcRosInitializeFileCache (
     PFILE_OBJECT FileObject,
@@ -1295,10 +1572,14 @@ CcRosInitializeFileCache (
 {
     KIRQL OldIrql;
     BOOLEAN Allocated;
+    PDEVICE_OBJECT DeviceObject;
     PROS_SHARED_CACHE_MAP SharedCacheMap;
 
     DPRINT("CcRosInitializeFileCache(FileObject 0x%p)\n", FileObject);
 
+    /* Dirty data is tracked per volume */
+    DeviceObject = IoGetRelatedDeviceObject(FileObject);
+
     OldIrql = KeAcquireQueuedSpinLock(LockQueueMasterLock);
 
     Allocated = FALSE;
@@ -1312,6 +1593,13 @@ CcRosInitializeFileCache (
             return STATUS_INSUFFICIENT_RESOURCES;
         }
         RtlZeroMemory(SharedCacheMap, sizeof(*SharedCacheMap));
+        SharedCacheMap->VolumeCacheMap = CcRosReferenceVolumeCacheMap(DeviceObject);
+        if (SharedCacheMap->VolumeCacheMap == NULL)
+        {
+            ExFreeToNPagedLookasideList(&SharedCacheMapLookasideList, SharedCacheMap);
+            KeReleaseQueuedSpinLock(LockQueueMasterLock, OldIrql);
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
         SharedCacheMap->NodeTypeCode = NODE_TYPE_SHARED_MAP;
         SharedCacheMap->NodeByteSize = sizeof(*SharedCacheMap);
         SharedCacheMap->FileObject = FileObject;
@@ -1326,6 +1614,8 @@ CcRosInitializeFileCache (
         InitializeListHead(&SharedCacheMap->PrivateList);
         KeInitializeSpinLock(&SharedCacheMap->CacheMapLock);
         InitializeListHead(&SharedCacheMap->CacheMapVacbListHead);
+        SharedCacheMap->Vacbs = SharedCacheMap->InitialVacbs;
+        SharedCacheMap->VacbArraySize = CC_INITIAL_VACB_ARRAY_SIZE;
         InitializeListHead(&SharedCacheMap->BcbList);
         KeInitializeGuardedMutex(&SharedCacheMap->FlushCacheLock);
 
@@ -1365,13 +1655,13 @@ CcRosInitializeFileCache (
         PPRIVATE_CACHE_MAP PrivateMap;
 
         /* Allocate the private cache map for this handle */
-        if (SharedCacheMap->PrivateCacheMap.NodeTypeCode != 0)
+        if (SharedCacheMap->PrivateCacheMap.PrivateCacheMap.NodeTypeCode != 0)
         {
-            PrivateMap = ExAllocatePoolWithTag(NonPagedPool, sizeof(PRIVATE_CACHE_MAP), TAG_PRIVATE_CACHE_MAP);
+            PrivateMap = ExAllocatePoolWithTag(NonPagedPool, sizeof(ROS_PRIVATE_CACHE_MAP), TAG_PRIVATE_CACHE_MAP);
         }
         else
         {
-            PrivateMap = &SharedCacheMap->PrivateCacheMap;
+            PrivateMap = &SharedCacheMap->PrivateCacheMap.PrivateCacheMap;
         }
 
         if (PrivateMap == NULL)
@@ -1380,6 +1670,7 @@ CcRosInitializeFileCache (
             if (Allocated)
             {
                 RemoveEntryList(&SharedCacheMap->SharedCacheMapLinks);
+                CcRosDereferenceVolumeCacheMap(SharedCacheMap->VolumeCacheMap);
 
                 FileObject->SectionObjectPointer->SharedCacheMap = NULL;
                 ObDereferenceObject(FileObject);
@@ -1391,7 +1682,7 @@ CcRosInitializeFileCache (
         }
 
         /* Initialize it */
-        RtlZeroMemory(PrivateMap, sizeof(PRIVATE_CACHE_MAP));
+        RtlZeroMemory(PrivateMap, sizeof(ROS_PRIVATE_CACHE_MAP));
         PrivateMap->NodeTypeCode = NODE_TYPE_PRIVATE_MAP;
         PrivateMap->ReadAheadMask = PAGE_SIZE - 1;
         PrivateMap->FileObject = FileObject;
@@ -1479,7 +1770,7 @@ CcInitView (
 {
     DPRINT("CcInitView()\n");
 
-    InitializeListHead(&DirtyVacbListHead);
+    InitializeListHead(&CcVolumeCacheMapList);
     InitializeListHead(&VacbLruListHead);
     InitializeListHead(&CcDeferredWrites);
     InitializeListHead(&CcCleanSharedCacheMapList);
@@ -1575,6 +1866,8 @@ ExpKdbgExtFileCache(ULONG Argc, PCHAR Argv[])
 BOOLEAN
 ExpKdbgExtDefWrites(ULONG Argc, PCHAR Argv[])
 {
+    PLIST_ENTRY ListEntry;
+
     KdbpPrint("CcTotalDirtyPages:\t%lu (%lu Kb)\n", CcTotalDirtyPages,
               (CcTotalDirtyPages * PAGE_SIZE) / 1024);
     KdbpPrint("CcDirtyPageThreshold:\t%lu (%lu Kb)\n", CcDirtyPageThreshold,
@@ -1601,6 +1894,25 @@ ExpKdbgExtDefWrites(ULONG Argc, PCHAR Argv[])
         KdbpPrint("CcTotalDirtyPages below the threshold, writes should not be throttled\n");
     }
 
+    KdbpPrint("CcLazyWritePagesPerSecond:\t%lu (%lu Kb)\n", CcLazyWritePagesPerSecond,
+              (CcLazyWritePagesPerSecond * PAGE_SIZE) / 1024);
+    KdbpPrint("CcThrottleEvents:\t%lu\n", CcThrottleEvents);
+
+    KdbpPrint("Device\t\tDirty\t\tThreshold\tFlushed/s\tThrottled\n");
+    for (ListEntry = CcVolumeCacheMapList.Flink;
+         ListEntry != &CcVolumeCacheMapList;
+         ListEntry = ListEntry->Flink)
+    {
+        PROS_VOLUME_CACHE_MAP VolumeCacheMap;
+
+        VolumeCacheMap = CONTAINING_RECORD(ListEntry, ROS_VOLUME_CACHE_MAP, VolumeCacheMapLinks);
+        KdbpPrint("%p\t%lu Kb\t%lu Kb\t%lu Kb\t%lu\n", VolumeCacheMap->DeviceObject,
+                  (VolumeCacheMap->DirtyPages * PAGE_SIZE) / 1024,
+                  (VolumeCacheMap->DirtyPageThreshold * PAGE_SIZE) / 1024,
+                  (VolumeCacheMap->PagesFlushedPerSecond * PAGE_SIZE) / 1024,
+                  VolumeCacheMap->ThrottleCount);
+    }
+
     return TRUE;
 }
 
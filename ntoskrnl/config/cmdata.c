@@ -486,6 +486,13 @@ DATA_SEG("INITDATA") CM_SYSTEM_CONTROL_VECTOR CmControlVector[] =
         NULL,
         NULL
     },
+    {
+        L"Session Manager\\Memory Management\\PrefetchParameters",
+        L"EnablePrefetcher",
+        &CcPfEnablePrefetcher,
+        NULL,
+        NULL
+    },
     {
         L"Session Manager\\Executive",
         L"AdditionalCriticalWorkerThreads",
@@ -365,7 +365,7 @@ NtQueryEvent(IN HANDLE EventHandle,
         _SEH2_TRY
         {
             /* Return Event Type and State */
-            BasicInfo->EventType = Event->Header.Type;
+            BasicInfo->EventType = Event->Header.Type & KOBJECT_TYPE_MASK;
             BasicInfo->EventState = KeReadStateEvent(Event);
 
             /* Return length */
@@ -20,6 +20,9 @@ EX_PUSH_LOCK HandleTableListLock;
 #define SizeOfHandle(x) (sizeof(HANDLE) * (x))
 #define INDEX_TO_HANDLE_VALUE(x) ((x) << HANDLE_TAG_BITS)
 
+/* Pool blocks are not cache aligned, the extra list leaves room to align them */
+#define SizeOfFreeLists (sizeof(HANDLE_TABLE_FREE_LIST) * (HANDLE_TABLE_FREE_LISTS + 1))
+
 /* PRIVATE FUNCTIONS *********************************************************/
 
 #ifdef _WIN64
@@ -197,6 +200,51 @@ ExpFreeLowLevelTable(IN PEPROCESS Process,
     ExpFreeTablePagedPool(Process, TableEntry, PAGE_SIZE);
 }
 
+PHANDLE_TABLE_FREE_LIST
+NTAPI
+ExpAllocateHandleFreeLists(IN PEPROCESS Process OPTIONAL)
+{
+    PVOID Buffer;
+    PHANDLE_TABLE_FREE_LIST FreeLists;
+    ULONG i;
+
+    /* Allocate the lists, zeroed, so they all start empty */
+    Buffer = ExpAllocateTablePagedPool(Process, SizeOfFreeLists);
+    if (!Buffer) return NULL;
+
+    /* Put each list on its own cache line */
+    FreeLists = ALIGN_UP_POINTER_BY(Buffer, SYSTEM_CACHE_ALIGNMENT_SIZE);
+    FreeLists[0].AllocationBase = Buffer;
+
+    /* Initialize the pop locks */
+    for (i = 0; i < HANDLE_TABLE_FREE_LISTS; i++)
+    {
+        ExInitializePushLock(&FreeLists[i].PopLock);
+    }
+
+    return FreeLists;
+}
+
+VOID
+NTAPI
+ExpFreeHandleFreeLists(IN PEPROCESS Process OPTIONAL,
+                       IN PHANDLE_TABLE_FREE_LIST FreeLists)
+{
+    /* Free the original allocation */
+    ExpFreeTablePagedPool(Process, FreeLists[0].AllocationBase, SizeOfFreeLists);
+}
+
+FORCEINLINE
+ULONG
+ExpGetFreeListIndex(IN PHANDLE_TABLE HandleTable)
+{
+    /* Strict FIFO tables only use one list, the order would be lost otherwise */
+    if (HandleTable->StrictFIFO) return 0;
+
+    /* Use the list of the current processor */
+    return KeGetCurrentProcessorNumber() % HANDLE_TABLE_FREE_LISTS;
+}
+
 VOID
 NTAPI
 ExpFreeHandleTable(IN PHANDLE_TABLE HandleTable)
@@ -265,6 +313,9 @@ ExpFreeHandleTable(IN PHANDLE_TABLE HandleTable)
                               SizeOfHandle(HIGH_LEVEL_ENTRIES));
     }
 
+    /* Free the free lists */
+    ExpFreeHandleFreeLists(Process, HandleTable->FreeLists);
+
     /* Free the actual table and check if we need to release quota */
     ExFreePoolWithTag(HandleTable, TAG_OBJECT_TABLE);
     if (Process)
@@ -281,7 +332,6 @@ ExpFreeHandleTableEntry(IN PHANDLE_TABLE HandleTable,
                         IN PHANDLE_TABLE_ENTRY HandleTableEntry)
 {
     ULONG OldValue, *Free;
-    ULONG LockIndex;
     PAGED_CODE();
 
     /* Sanity checks */
@@ -294,27 +344,14 @@ ExpFreeHandleTableEntry(IN PHANDLE_TABLE HandleTable,
     /* Mark the handle as free */
     Handle.TagBits = 0;
 
-    /* Check if we're FIFO */
-    if (!HandleTable->StrictFIFO)
-    {
-        /* Select a lock index */
-        LockIndex = Handle.Index % 4;
-
-        /* Select which entry to use */
-        Free = (HandleTable->HandleTableLock[LockIndex].Locked) ?
-                &HandleTable->FirstFree : &HandleTable->LastFree;
-    }
-    else
-    {
-        /* No need to worry about locking, take the last entry */
-        Free = &HandleTable->LastFree;
-    }
+    /* Push it on the last free list of our processor, the allocator does not use it */
+    Free = &HandleTable->FreeLists[ExpGetFreeListIndex(HandleTable)].LastFree;
 
     /* Start value change loop */
     for (;;)
     {
         /* Get the current value and write */
-        OldValue = *Free;
+        OldValue = *(volatile ULONG*)Free;
         HandleTableEntry->NextFreeTableEntry = OldValue;
         if (InterlockedCompareExchange((PLONG)Free, Handle.AsULONG, OldValue) == OldValue)
         {
@@ -374,6 +411,23 @@ ExpAllocateHandleTable(IN PEPROCESS Process OPTIONAL,
         return NULL;
     }
 
+    /* Allocate the free lists */
+    HandleTable->FreeLists = ExpAllocateHandleFreeLists(Process);
+    if (!HandleTable->FreeLists)
+    {
+        /* Failed, free the first level structures and the table */
+        ExpFreeTablePagedPool(Process, HandleTableTable, PAGE_SIZE);
+        ExFreePoolWithTag(HandleTable, TAG_OBJECT_TABLE);
+
+        /* Return the quota it was taking up */
+        if (Process)
+        {
+            PsReturnProcessPagedPoolQuota(Process, sizeof(HANDLE_TABLE));
+        }
+
+        return NULL;
+    }
+
     /* Write the pointer to our first level structures */
     HandleTable->TableCode = (ULONG_PTR)HandleTableTable;
 
@@ -402,7 +456,7 @@ ExpAllocateHandleTable(IN PEPROCESS Process OPTIONAL,
         /* Terminate the last entry */
         HandleEntry->Value = 0;
         HandleEntry->NextFreeTableEntry = 0;
-        HandleTable->FirstFree = INDEX_TO_HANDLE_VALUE(1);
+        HandleTable->FreeLists[0].FirstFree = INDEX_TO_HANDLE_VALUE(1);
     }
 
     /* Set the next handle needing pool after our allocated page from above */
@@ -500,11 +554,12 @@ ExpAllocateMidLevelTable(IN PHANDLE_TABLE HandleTable,
 BOOLEAN
 NTAPI
 ExpAllocateHandleTableEntrySlow(IN PHANDLE_TABLE HandleTable,
-                                IN BOOLEAN DoInit)
+                                IN BOOLEAN DoInit,
+                                IN ULONG FreeListIndex)
 {
     ULONG i, j, Index;
     PHANDLE_TABLE_ENTRY Low = NULL, *Mid, **High, *SecondLevel, **ThirdLevel;
-    ULONG NewFree, FirstFree;
+    ULONG NewFree, FirstFree, *Free;
     PVOID Value;
     ULONG_PTR TableCode = HandleTable->TableCode;
     ULONG_PTR TableBase = TableCode & ~3;
@@ -625,16 +680,15 @@ ExpAllocateHandleTableEntrySlow(IN PHANDLE_TABLE HandleTable,
         Index += INDEX_TO_HANDLE_VALUE(1);
 
         /* Start free index change loop */
+        Free = &HandleTable->FreeLists[FreeListIndex].FirstFree;
         for (;;)
         {
             /* Setup the first free index */
-            FirstFree = HandleTable->FirstFree;
+            FirstFree = *(volatile ULONG*)Free;
             Low[LOW_LEVEL_ENTRIES - 1].NextFreeTableEntry = FirstFree;
 
             /* Change the index */
-            NewFree = InterlockedCompareExchange((PLONG) &HandleTable->FirstFree,
-                                                 Index,
-                                                 FirstFree);
+            NewFree = InterlockedCompareExchange((PLONG)Free, Index, FirstFree);
             if (NewFree == FirstFree) break;
         }
     }
@@ -645,146 +699,186 @@ ExpAllocateHandleTableEntrySlow(IN PHANDLE_TABLE HandleTable,
 
 ULONG
 NTAPI
-ExpMoveFreeHandles(IN PHANDLE_TABLE HandleTable)
+ExpMoveFreeHandles(IN PHANDLE_TABLE HandleTable,
+                   IN ULONG FreeListIndex)
 {
-    ULONG LastFree, i;
+    PHANDLE_TABLE_FREE_LIST FreeList = &HandleTable->FreeLists[FreeListIndex];
+    ULONG LastFree, Previous, Next, i;
+    PHANDLE_TABLE_ENTRY Entry;
+    EXHANDLE Handle;
 
-    /* Clear the last free index */
-    LastFree = InterlockedExchange((PLONG) &HandleTable->LastFree, 0);
+    /* Take the handles freed on this list, or else on any other one */
+    for (i = 0; i < HANDLE_TABLE_FREE_LISTS; i++)
+    {
+        /* Clear the last free index */
+        Next = (FreeListIndex + i) % HANDLE_TABLE_FREE_LISTS;
+        LastFree = InterlockedExchange((PLONG)&HandleTable->FreeLists[Next].LastFree, 0);
+        if (LastFree) break;
+    }
 
     /* Check if we had no index */
     if (!LastFree) return LastFree;
 
-    /* Acquire the locks we need */
-    for (i = 1; i < 4; i++)
-    {
-        /* Acquire this lock exclusively */
-        ExWaitOnPushLock(&HandleTable->HandleTableLock[i]);
-    }
-
-    /* Check if we're not strict FIFO */
-    if (!HandleTable->StrictFIFO)
+    /* Check if we're strict FIFO */
+    if (HandleTable->StrictFIFO)
     {
-        /* Update the first free index */
-        if (!InterlockedCompareExchange((PLONG) &HandleTable->FirstFree, LastFree, 0))
+        /* The last freed handle is at the head, reverse the entries */
+        Previous = 0;
+        Handle.Value = LastFree;
+        while (Handle.Value)
         {
-            /* We're done, exit */
-            return LastFree;
+            Entry = ExpLookupHandleTableEntry(HandleTable, Handle);
+            Next = Entry->NextFreeTableEntry;
+            Entry->NextFreeTableEntry = Previous;
+            Previous = (ULONG)Handle.Value;
+            Handle.Value = Next;
         }
+        LastFree = Previous;
     }
 
-    /* We are strict FIFO, we need to reverse the entries */
-    ASSERT(FALSE);
+    /*
+     * One of these handles may have been allocated and freed again while
+     * another thread was popping it, wait for any pop in progress to see
+     * that the list changed before putting it back at the head.
+     */
+    ExWaitOnPushLock(&FreeList->PopLock);
+
+    /* Only the table lock owner fills an empty list, so it is still empty */
+    Next = InterlockedExchange((PLONG)&FreeList->FirstFree, LastFree);
+    ASSERT(Next == 0);
     return LastFree;
 }
 
 PHANDLE_TABLE_ENTRY
 NTAPI
-ExpAllocateHandleTableEntry(IN PHANDLE_TABLE HandleTable,
-                            OUT PEXHANDLE NewHandle)
+ExpPopFreeHandle(IN PHANDLE_TABLE HandleTable,
+                 IN PHANDLE_TABLE_FREE_LIST FreeList,
+                 OUT PEXHANDLE NewHandle)
 {
     ULONG OldValue, NewValue, NewValue1;
     PHANDLE_TABLE_ENTRY Entry;
-    EXHANDLE Handle, OldHandle;
-    BOOLEAN Result;
-    ULONG i;
+    EXHANDLE Handle;
 
-    /* Start allocation loop */
+    /* Start pop loop */
     for (;;)
     {
-        /* Get the current link */
-        OldValue = HandleTable->FirstFree;
-        while (!OldValue)
-        {
-            /* No free entries remain, lock the handle table */
-            KeEnterCriticalRegion();
-            ExAcquirePushLockExclusive(&HandleTable->HandleTableLock[0]);
-
-            /* Check the value again */
-            OldValue = HandleTable->FirstFree;
-            if (OldValue)
-            {
-                /* Another thread has already created a new level, bail out */
-                ExReleasePushLockExclusive(&HandleTable->HandleTableLock[0]);
-                KeLeaveCriticalRegion();
-                break;
-            }
-
-            /* Now move any free handles */
-            OldValue = ExpMoveFreeHandles(HandleTable);
-            if (OldValue)
-            {
-                /* Another thread has already moved them, bail out */
-                ExReleasePushLockExclusive(&HandleTable->HandleTableLock[0]);
-                KeLeaveCriticalRegion();
-                break;
-            }
-
-            /* We're the first one through, so do the actual allocation */
-            Result = ExpAllocateHandleTableEntrySlow(HandleTable, TRUE);
-
-            /* Unlock the table and get the value now */
-            ExReleasePushLockExclusive(&HandleTable->HandleTableLock[0]);
-            KeLeaveCriticalRegion();
-            OldValue = HandleTable->FirstFree;
-
-            /* Check if allocation failed */
-            if (!Result)
-            {
-                /* Check if nobody else went through here */
-                if (!OldValue)
-                {
-                    /* We're still the only thread around, so fail */
-                    NewHandle->GenericHandleOverlay = NULL;
-                    return NULL;
-                }
-            }
-        }
-
-        /* We made it, write the current value */
-        Handle.Value = (OldValue & FREE_HANDLE_MASK);
+        /* Get the current link, bail out if the list is empty */
+        OldValue = *(volatile ULONG*)&FreeList->FirstFree;
+        if (!OldValue) return NULL;
 
         /* Lookup the entry for this handle */
+        Handle.Value = (OldValue & FREE_HANDLE_MASK);
         Entry = ExpLookupHandleTableEntry(HandleTable, Handle);
 
-        /* Get an available lock and acquire it */
-        OldHandle.Value = OldValue;
-        i = OldHandle.Index % 4;
+        /* Acquire the pop lock so the entry cannot be moved back to the head */
         KeEnterCriticalRegion();
-        ExAcquirePushLockShared(&HandleTable->HandleTableLock[i]);
+        ExAcquirePushLockShared(&FreeList->PopLock);
 
         /* Check if the value changed after acquiring the lock */
-        if (OldValue != *(volatile ULONG*)&HandleTable->FirstFree)
+        if (OldValue != *(volatile ULONG*)&FreeList->FirstFree)
         {
             /* It did, so try again */
-            ExReleasePushLockShared(&HandleTable->HandleTableLock[i]);
+            ExReleasePushLockShared(&FreeList->PopLock);
             KeLeaveCriticalRegion();
             continue;
         }
 
         /* Now get the next value and do the compare */
         NewValue = *(volatile ULONG*)&Entry->NextFreeTableEntry;
-        NewValue1 = InterlockedCompareExchange((PLONG) &HandleTable->FirstFree,
+        NewValue1 = InterlockedCompareExchange((PLONG)&FreeList->FirstFree,
                                                NewValue,
                                                OldValue);
 
         /* The change was done, so release the lock */
-        ExReleasePushLockShared(&HandleTable->HandleTableLock[i]);
+        ExReleasePushLockShared(&FreeList->PopLock);
         KeLeaveCriticalRegion();
 
         /* Check if the compare was successful */
         if (NewValue1 == OldValue)
         {
-            /* Make sure that the new handle is in range, and break out */
+            /* Make sure that the new handle is in range, and return it */
             ASSERT((NewValue & FREE_HANDLE_MASK) <
                    HandleTable->NextHandleNeedingPool);
-            break;
+            *NewHandle = Handle;
+            return Entry;
         }
-        else
+
+        /* The compare failed, make sure we expected it */
+        ASSERT((NewValue1 & FREE_HANDLE_MASK) !=
+               (OldValue & FREE_HANDLE_MASK));
+    }
+}
+
+PHANDLE_TABLE_ENTRY
+NTAPI
+ExpAllocateHandleTableEntry(IN PHANDLE_TABLE HandleTable,
+                            OUT PEXHANDLE NewHandle)
+{
+    PHANDLE_TABLE_ENTRY Entry;
+    EXHANDLE Handle;
+    BOOLEAN Result;
+    ULONG Index, i;
+
+    /* Start with the list of our processor */
+    Index = ExpGetFreeListIndex(HandleTable);
+
+    /* Start allocation loop */
+    for (;;)
+    {
+        /* Try to pop a free handle */
+        Entry = ExpPopFreeHandle(HandleTable, &HandleTable->FreeLists[Index], &Handle);
+        if (Entry) break;
+
+        /* No free entries remain, lock the handle table */
+        KeEnterCriticalRegion();
+        ExAcquirePushLockExclusive(&HandleTable->HandleTableLock[0]);
+
+        /* Check the value again, then try to move the freed handles */
+        Result = (HandleTable->FreeLists[Index].FirstFree != 0) ||
+                 (ExpMoveFreeHandles(HandleTable, Index) != 0);
+        if (!Result)
         {
-            /* The compare failed, make sure we expected it */
-            ASSERT((NewValue1 & FREE_HANDLE_MASK) !=
-                   (OldValue & FREE_HANDLE_MASK));
+            /* Nothing was freed, check if another list has handles left */
+            for (i = 1; i < HANDLE_TABLE_FREE_LISTS; i++)
+            {
+                if (HandleTable->FreeLists[(Index + i) % HANDLE_TABLE_FREE_LISTS].FirstFree)
+                {
+                    /* It does, allocate from it instead */
+                    Index = (Index + i) % HANDLE_TABLE_FREE_LISTS;
+                    Result = TRUE;
+                    break;
+                }
+            }
+        }
+
+        /* Check if we need to do the actual allocation */
+        if (!Result)
+        {
+            /* We're the first one through, so grow the table */
+            Result = ExpAllocateHandleTableEntrySlow(HandleTable, TRUE, Index);
+        }
+
+        /* Unlock the table */
+        ExReleasePushLockExclusive(&HandleTable->HandleTableLock[0]);
+        KeLeaveCriticalRegion();
+
+        /* Check if allocation failed */
+        if (!Result)
+        {
+            /* Handles may have been freed meanwhile, try every list one last time */
+            for (i = 0; i < HANDLE_TABLE_FREE_LISTS; i++)
+            {
+                Entry = ExpPopFreeHandle(HandleTable, &HandleTable->FreeLists[i], &Handle);
+                if (Entry) break;
+            }
+
+            /* Fail if there was nothing */
+            if (!Entry)
+            {
+                NewHandle->GenericHandleOverlay = NULL;
+                return NULL;
+            }
+            break;
         }
     }
 
@@ -1089,7 +1183,7 @@ ExDupHandleTable(IN PEPROCESS Process,
            HandleTable->NextHandleNeedingPool)
     {
         /* Insert it into the duplicated copy */
-        if (!ExpAllocateHandleTableEntrySlow(NewTable, FALSE))
+        if (!ExpAllocateHandleTableEntrySlow(NewTable, FALSE, 0))
         {
             /* Insert failed, free the new copy and return */
             ExpFreeHandleTable(NewTable);
@@ -1100,7 +1194,6 @@ ExDupHandleTable(IN PEPROCESS Process,
     /* Setup the initial handle table data */
     NewTable->HandleCount = 0;
     NewTable->ExtraInfoPages = 0;
-    NewTable->FirstFree = 0;
 
     /* Setup the first handle value  */
     Handle.Value = INDEX_TO_HANDLE_VALUE(1);
@@ -1160,8 +1253,8 @@ ExDupHandleTable(IN PEPROCESS Process,
             {
                 /* Free this entry */
                 NewEntry->Object = NULL;
-                NewEntry->NextFreeTableEntry = NewTable->FirstFree;
-                NewTable->FirstFree = (ULONG)Handle.Value;
+                NewEntry->NextFreeTableEntry = NewTable->FreeLists[0].FirstFree;
+                NewTable->FreeLists[0].FirstFree = (ULONG)Handle.Value;
             }
 
             /* Increase the handle value and move to the next entry */
@@ -551,7 +551,7 @@ ExpLoadInitialProcess(IN PINIT_BUFFER InitBuffer,
     RtlAppendUnicodeStringToString(&Environment, &NullString);
 
     /* Prepare the prefetcher */
-    //CcPfBeginBootPhase(150);
+    CcPfBeginBootPhase(PfSessionManagerInitPhase);
 
     /* Create SMSS process */
     SmssName = ProcessParams->ImagePathName;
@@ -1604,6 +1604,12 @@ Phase1InitializationDiscard(IN PVOID Context)
     /* Initialize all processors */
     if (!HalAllProcessorsStarted()) KeBugCheck(HAL1_INITIALIZATION_FAILED);
 
+    /* Give every processor its own small pool lookaside lists */
+    ExpInitProcessorPoolLookasideLists();
+
+    /* And its own pool tag counters */
+    ExpInitializeProcessorPoolTrackers();
+
 #ifdef CONFIG_SMP
     /* HACK: We should use RtlFindMessage and not only fallback to this */
     MpString = "MultiProcessor Kernel\r\n";
@@ -23,6 +23,10 @@ LIST_ENTRY ExPoolLookasideListHead;
 GENERAL_LOOKASIDE ExpSmallNPagedPoolLookasideLists[NUMBER_POOL_LOOKASIDE_LISTS];
 GENERAL_LOOKASIDE ExpSmallPagedPoolLookasideLists[NUMBER_POOL_LOOKASIDE_LISTS];
 
+/* Depth tuning, run once per second by the balance set manager */
+#define MINIMUM_LOOKASIDE_DEPTH         4
+#define MINIMUM_ALLOCATION_THRESHOLD    25
+
 /* PRIVATE FUNCTIONS *********************************************************/
 
 CODE_SEG("INIT")
@@ -119,8 +123,157 @@ ExpInitLookasideLists(VOID)
     }
 }
 
+CODE_SEG("INIT")
+VOID
+NTAPI
+ExpInitProcessorPoolLookasideLists(VOID)
+{
+    ULONG Cpu, i;
+    PKPRCB Prcb;
+    PGENERAL_LOOKASIDE Lists;
+
+    /* With a single processor the shared lists already are per-processor */
+    if (KeNumberProcessors == 1) return;
+
+    /* Now allocate the per-processor lists */
+    for (Cpu = 0; Cpu < (ULONG)KeNumberProcessors; Cpu++)
+    {
+        /* Get the PRCB for this CPU */
+        Prcb = KiProcessorBlock[Cpu];
+
+        /* Allocate the non-paged and paged lists in one block */
+        Lists = ExAllocatePoolWithTag(NonPagedPoolCacheAligned,
+                                      2 * NUMBER_POOL_LOOKASIDE_LISTS *
+                                      sizeof(GENERAL_LOOKASIDE),
+                                      'looP');
+        if (!Lists)
+        {
+            /* No lists, keep using the shared ones */
+            continue;
+        }
+
+        for (i = 0; i < NUMBER_POOL_LOOKASIDE_LISTS; i++)
+        {
+            /* Initialize the non-paged list and link it */
+            ExInitializeSystemLookasideList(&Lists[i],
+                                            NonPagedPool,
+                                            (i + 1) * 8,
+                                            'looP',
+                                            256,
+                                            &ExPoolLookasideListHead);
+            Prcb->PPNPagedLookasideList[i].P = &Lists[i];
+
+            /* Initialize the paged list and link it */
+            ExInitializeSystemLookasideList(&Lists[NUMBER_POOL_LOOKASIDE_LISTS + i],
+                                            PagedPool,
+                                            (i + 1) * 8,
+                                            'looP',
+                                            256,
+                                            &ExPoolLookasideListHead);
+            Prcb->PPPagedLookasideList[i].P = &Lists[NUMBER_POOL_LOOKASIDE_LISTS + i];
+        }
+    }
+}
+
+static
+USHORT
+ExpComputeLookasideDepth(IN ULONG Allocates,
+                         IN ULONG Misses,
+                         IN USHORT MaximumDepth,
+                         IN USHORT Depth)
+{
+    ULONG MissRatio, Change;
+
+    /* Shrink lists that are barely used so they give back their memory */
+    if (Allocates < MINIMUM_ALLOCATION_THRESHOLD)
+    {
+        if (Depth > MINIMUM_LOOKASIDE_DEPTH + 10) return Depth - 10;
+        return min(Depth, MINIMUM_LOOKASIDE_DEPTH);
+    }
+
+    /* Get the miss ratio in tenths of a percent */
+    MissRatio = (ULONG)(((ULONGLONG)Misses * 1000) / Allocates);
+    if (MissRatio < 5)
+    {
+        /* Almost every allocation hits, slowly give back one entry */
+        if (Depth > MINIMUM_LOOKASIDE_DEPTH) Depth--;
+        return Depth;
+    }
+
+    /* Grow in proportion to the miss ratio and the room that is left */
+    Change = ((MissRatio - 5) * (MaximumDepth - Depth)) / 2000 + 5;
+    return (USHORT)min((ULONG)MaximumDepth, Depth + Change);
+}
+
+static
+VOID
+ExpScanGeneralLookasideList(IN PLIST_ENTRY ListHead,
+                            IN PKSPIN_LOCK Lock OPTIONAL,
+                            IN BOOLEAN ListUsesMisses)
+{
+    PGENERAL_LOOKASIDE Lookaside;
+    PLIST_ENTRY ListEntry;
+    ULONG Allocates, Misses, Hits;
+    KIRQL OldIrql = PASSIVE_LEVEL;
+
+    /* Lock the list if it can change at run time */
+    if (Lock) KeAcquireSpinLock(Lock, &OldIrql);
+
+    for (ListEntry = ListHead->Flink;
+         ListEntry != ListHead;
+         ListEntry = ListEntry->Flink)
+    {
+        Lookaside = CONTAINING_RECORD(ListEntry, GENERAL_LOOKASIDE, ListEntry);
+
+        /* Get the activity since the last scan */
+        Allocates = Lookaside->TotalAllocates - Lookaside->LastTotalAllocates;
+        Lookaside->LastTotalAllocates = Lookaside->TotalAllocates;
+        if (ListUsesMisses)
+        {
+            Misses = Lookaside->AllocateMisses - Lookaside->LastAllocateMisses;
+            Lookaside->LastAllocateMisses = Lookaside->AllocateMisses;
+        }
+        else
+        {
+            /* Pool lists count hits instead, and their counters are not interlocked */
+            Hits = Lookaside->AllocateHits - Lookaside->LastAllocateHits;
+            Lookaside->LastAllocateHits = Lookaside->AllocateHits;
+            Misses = (Hits < Allocates) ? Allocates - Hits : 0;
+        }
+
+        /* Retune the depth */
+        Lookaside->Depth = ExpComputeLookasideDepth(Allocates,
+                                                    min(Misses, Allocates),
+                                                    Lookaside->MaximumDepth,
+                                                    Lookaside->Depth);
+    }
+
+    if (Lock) KeReleaseSpinLock(Lock, OldIrql);
+}
+
 /* PUBLIC FUNCTIONS **********************************************************/
 
+/*
+ * @implemented
+ */
+VOID
+ExAdjustLookasideDepth(VOID)
+{
+    /* Scan the per-processor and shared pool lists */
+    ExpScanGeneralLookasideList(&ExPoolLookasideListHead, NULL, FALSE);
+
+    /* Scan the system lists, which never go away */
+    ExpScanGeneralLookasideList(&ExSystemLookasideListHead, NULL, TRUE);
+
+    /* Scan the driver lists */
+    ExpScanGeneralLookasideList(&ExpNonPagedLookasideListHead,
+                                &ExpNonPagedLookasideListLock,
+                                TRUE);
+    ExpScanGeneralLookasideList(&ExpPagedLookasideListHead,
+                                &ExpPagedLookasideListLock,
+                                TRUE);
+}
+
 /*
  * @implemented
  */
@@ -103,11 +103,11 @@ ExpVerifyResource(IN PERESOURCE Resource)
     /* Verify the resource data */
     ASSERT((((ULONG_PTR)Resource) & (sizeof(ULONG_PTR) - 1)) == 0);
     ASSERT(!Resource->SharedWaiters ||
-            Resource->SharedWaiters->Header.Type == SemaphoreObject);
+            (Resource->SharedWaiters->Header.Type & KOBJECT_TYPE_MASK) == SemaphoreObject);
     ASSERT(!Resource->SharedWaiters ||
             Resource->SharedWaiters->Header.Size == (sizeof(KSEMAPHORE) / sizeof(ULONG)));
     ASSERT(!Resource->ExclusiveWaiters ||
-            Resource->ExclusiveWaiters->Header.Type == SynchronizationEvent);
+            (Resource->ExclusiveWaiters->Header.Type & KOBJECT_TYPE_MASK) == SynchronizationEvent);
     ASSERT(!Resource->ExclusiveWaiters ||
             Resource->ExclusiveWaiters->Header.Size == (sizeof(KEVENT) / sizeof(ULONG)));
 }
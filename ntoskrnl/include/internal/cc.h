@@ -40,7 +40,7 @@
 // Global Cc Data
 //
 extern ULONG CcRosTraceLevel;
-extern LIST_ENTRY DirtyVacbListHead;
+extern LIST_ENTRY CcVolumeCacheMapList;
 extern ULONG CcDirtyPageThreshold;
 extern ULONG CcTotalDirtyPages;
 extern LIST_ENTRY CcDeferredWrites;
@@ -58,6 +58,8 @@ extern LARGE_INTEGER CcIdleDelay;
 //
 extern ULONG CcLazyWritePages;
 extern ULONG CcLazyWriteIos;
+extern ULONG CcLazyWritePagesPerSecond;
+extern ULONG CcThrottleEvents;
 extern ULONG CcMapDataWait;
 extern ULONG CcMapDataNoWait;
 extern ULONG CcPinReadWait;
@@ -123,6 +125,13 @@ typedef struct _PFSN_TRACE_DUMP
     PF_TRACE_HEADER Trace;
 } PFSN_TRACE_DUMP, *PPFSN_TRACE_DUMP;
 
+typedef struct _PFSN_FILE_ENTRY
+{
+    PSECTION_OBJECT_POINTERS SectionObjectPointer;
+    PFILE_OBJECT FileObject;
+    ULONG Flags; // PF_TRACE_FILE_*
+} PFSN_FILE_ENTRY, *PPFSN_FILE_ENTRY;
+
 typedef struct _PFSN_TRACE_HEADER
 {
     ULONG Magic;
@@ -153,8 +162,34 @@ typedef struct _PFSN_TRACE_HEADER
     LARGE_INTEGER LaunchTime;
     PPF_SECTION_INFO SectionInfo;
     ULONG SectionInfoCount;
+    PPFSN_FILE_ENTRY Files;
+    ULONG NumFiles;
+    ULONG MaxFiles;
+    PVOID *PrefetchedSections;
+    ULONG NumPrefetchedSections;
+    ULONG LaunchCount;
 } PFSN_TRACE_HEADER, *PPFSN_TRACE_HEADER;
 
+typedef enum _PF_BOOT_PHASE_ID
+{
+    PfKernelInitPhase = 0,
+    PfBootDriverInitPhase = 90,
+    PfSystemDriverInitPhase = 120,
+    PfSessionManagerInitPhase = 150,
+    PfSMRegistryInitPhase = 180,
+    PfVideoInitPhase = 210,
+    PfPostVideoInitPhase = 240,
+    PfBootAcceptedRegistryInitPhase = 270,
+    PfUserShellReadyPhase = 300,
+    PfMaxBootPhaseId = 900
+} PF_BOOT_PHASE_ID;
+
+/* CcPfEnablePrefetcher bits */
+#define PF_ENABLE_APPLICATION_LAUNCH    0x1
+#define PF_ENABLE_BOOT                  0x2
+
+extern ULONG CcPfEnablePrefetcher;
+
 typedef struct _PFSN_PREFETCHER_GLOBALS
 {
     LIST_ENTRY ActiveTraces;
@@ -167,6 +202,58 @@ typedef struct _PFSN_PREFETCHER_GLOBALS
     LONG ActivePrefetches;
 } PFSN_PREFETCHER_GLOBALS, *PPFSN_PREFETCHER_GLOBALS;
 
+/* Number of views tracked inline in a shared cache map before growing the array */
+#define CC_INITIAL_VACB_ARRAY_SIZE 4
+/* Beyond this many views (16 GB of file), views are only kept in the list */
+#define CC_MAXIMUM_VACB_ARRAY_SIZE 0x10000
+
+struct _ROS_VACB;
+
+typedef enum _CC_ACCESS_PATTERN
+{
+    CcAccessRandom = 0,
+    CcAccessSequential,
+    CcAccessStrided,
+} CC_ACCESS_PATTERN;
+
+/* Read ahead window bounds, the window doubles on each confirmed sequential read */
+#define CC_MINIMUM_READ_AHEAD_WINDOW (16 * PAGE_SIZE)
+#define CC_MAXIMUM_READ_AHEAD_WINDOW (8 * VACB_MAPPING_GRANULARITY)
+
+typedef struct _ROS_PRIVATE_CACHE_MAP
+{
+    PRIVATE_CACHE_MAP PrivateCacheMap;
+
+    /* ROS specific, protected by the ReadAheadSpinLock */
+    CC_ACCESS_PATTERN AccessPattern;
+    ULONG ConfirmedReads;
+    ULONG ReadAheadWindow;
+    LONGLONG Stride;
+    /* End of everything already scheduled for read ahead */
+    LONGLONG ReadAheadEnd;
+} ROS_PRIVATE_CACHE_MAP, *PROS_PRIVATE_CACHE_MAP;
+
+typedef struct _ROS_VOLUME_CACHE_MAP
+{
+    CSHORT NodeTypeCode;
+    CSHORT NodeByteSize;
+    ULONG UseCount;
+    PDEVICE_OBJECT DeviceObject;
+    LIST_ENTRY VolumeCacheMapLinks;
+    ULONG Flags;
+    ULONG DirtyPages;
+
+    /* ROS specific, protected by the master lock */
+    LIST_ENTRY DirtyVacbListHead;
+    ULONG DirtyPageThreshold;
+    ULONG PagesFlushed;
+    ULONG LastPagesFlushed;
+    ULONG PagesFlushedPerSecond;
+    ULONG ThrottleCount;
+} ROS_VOLUME_CACHE_MAP, *PROS_VOLUME_CACHE_MAP;
+
+#define VOLUME_CACHE_MAP_WRITE_BEHIND_QUEUED 0x1
+
 typedef struct _ROS_SHARED_CACHE_MAP
 {
     CSHORT NodeTypeCode;
@@ -187,10 +274,15 @@ typedef struct _ROS_SHARED_CACHE_MAP
     LIST_ENTRY PrivateList;
     ULONG DirtyPageThreshold;
     KSPIN_LOCK BcbSpinLock;
-    PRIVATE_CACHE_MAP PrivateCacheMap;
+    ROS_PRIVATE_CACHE_MAP PrivateCacheMap;
 
     /* ROS specific */
+    PROS_VOLUME_CACHE_MAP VolumeCacheMap;
     LIST_ENTRY CacheMapVacbListHead;
+    /* VACBs indexed by FileOffset / VACB_MAPPING_GRANULARITY, protected by CacheMapLock */
+    struct _ROS_VACB **Vacbs;
+    ULONG VacbArraySize;
+    struct _ROS_VACB *InitialVacbs[CC_INITIAL_VACB_ARRAY_SIZE];
     BOOLEAN PinAccess;
     KSPIN_LOCK CacheMapLock;
     KGUARDED_MUTEX FlushCacheLock;
@@ -215,7 +307,7 @@ typedef struct _ROS_VACB
     ULONG MappedCount;
     /* Entry in the list of VACBs for this shared cache map. */
     LIST_ENTRY CacheMapVacbListEntry;
-    /* Entry in the list of VACBs which are dirty. */
+    /* Entry in the list of VACBs which are dirty, on their volume. */
     LIST_ENTRY DirtyVacbListEntry;
     /* Entry in the list of VACBs. */
     LIST_ENTRY VacbLruListEntry;
@@ -263,6 +355,10 @@ typedef struct _WORK_QUEUE_ENTRY
             SHARED_CACHE_MAP *SharedCacheMap;
         } Write;
         struct
+        {
+            struct _ROS_VOLUME_CACHE_MAP *VolumeCacheMap;
+        } WriteBehind;
+        struct
         {
             KEVENT *Event;
         } Event;
@@ -285,6 +381,7 @@ typedef enum _WORK_QUEUE_FUNCTIONS
 extern LAZY_WRITER LazyWriter;
 
 #define NODE_TYPE_DEFERRED_WRITE 0x02FC
+#define NODE_TYPE_VOLUME_MAP     0x02FD
 #define NODE_TYPE_PRIVATE_MAP    0x02FE
 #define NODE_TYPE_SHARED_MAP     0x02FF
 
@@ -295,6 +392,26 @@ CcPfInitializePrefetcher(
     VOID
 );
 
+NTSTATUS
+NTAPI
+CcPfBeginBootPhase(
+    _In_ PF_BOOT_PHASE_ID Phase
+);
+
+NTSTATUS
+NTAPI
+CcPfBeginAppLaunch(
+    _In_ PEPROCESS Process
+);
+
+VOID
+NTAPI
+CcPfLogPageFault(
+    _In_ PFILE_OBJECT FileObject,
+    _In_ ULONG Page,
+    _In_ BOOLEAN Image
+);
+
 VOID
 NTAPI
 CcMdlReadComplete2(
@@ -351,6 +468,10 @@ CcRosLookupVacb(
     LONGLONG FileOffset
 );
 
+VOID
+CcRosRemoveVacbFromMap(
+    PROS_VACB Vacb);
+
 VOID
 NTAPI
 CcInitCacheZeroPage(VOID);
@@ -372,6 +493,19 @@ CcRosFlushDirtyPages(
     BOOLEAN CalledFromLazy
 );
 
+NTSTATUS
+CcRosFlushVolumeDirtyPages(
+    PROS_VOLUME_CACHE_MAP VolumeCacheMap,
+    ULONG Target,
+    PULONG Count,
+    BOOLEAN Wait,
+    BOOLEAN CalledFromLazy
+);
+
+VOID
+CcRosDereferenceVolumeCacheMap(
+    PROS_VOLUME_CACHE_MAP VolumeCacheMap);
+
 VOID
 CcRosDereferenceCache(PFILE_OBJECT FileObject);
 
@@ -163,6 +163,23 @@ typedef struct _HARDERROR_USER_PARAMETERS
 #define MAX_MID_INDEX       (MID_LEVEL_ENTRIES * LOW_LEVEL_ENTRIES)
 #define MAX_HIGH_INDEX      (MID_LEVEL_ENTRIES * MID_LEVEL_ENTRIES * LOW_LEVEL_ENTRIES)
 
+//
+// Free handles are cached in a few shards, each on its own cache line.
+// Freed handles are pushed on the LastFree list of the current processor's
+// shard and only moved to its FirstFree list, where they are allocated
+// from, once that one is empty. PopLock is held shared while popping so
+// that a handle cannot be moved back to FirstFree under a pending pop.
+//
+#define HANDLE_TABLE_FREE_LISTS 4
+
+typedef struct DECLSPEC_CACHEALIGN _HANDLE_TABLE_FREE_LIST
+{
+    ULONG FirstFree;
+    ULONG LastFree;
+    EX_PUSH_LOCK PopLock;
+    PVOID AllocationBase;
+} HANDLE_TABLE_FREE_LIST, *PHANDLE_TABLE_FREE_LIST;
+
 #define ExpChangeRundown(x, y, z)   (ULONG_PTR)InterlockedCompareExchangePointer(&(x)->Ptr, (PVOID)(y), (PVOID)(z))
 #define ExpChangePushlock(x, y, z)  InterlockedCompareExchangePointer((PVOID*)(x), (PVOID)(y), (PVOID)(z))
 #define ExpSetRundown(x, y)         InterlockedExchangePointer(&(x)->Ptr, (PVOID)(y))
@@ -175,6 +192,11 @@ ExGetPoolTagInfo(
     IN OUT PULONG ReturnLength OPTIONAL
 );
 
+CODE_SEG("INIT")
+VOID
+NTAPI
+ExpInitializeProcessorPoolTrackers(VOID);
+
 typedef struct _UUID_CACHED_VALUES_STRUCT
 {
     ULONGLONG Time;
@@ -319,6 +341,11 @@ VOID
 NTAPI
 ExInitPoolLookasidePointers(VOID);
 
+CODE_SEG("INIT")
+VOID
+NTAPI
+ExpInitProcessorPoolLookasideLists(VOID);
+
 /* Callback Functions ********************************************************/
 
 VOID
@@ -68,6 +68,32 @@ typedef struct _KI_SAMPLE_MAP
 
 #define MAX_TIMER_DPCS                      16
 
+//
+// Every processor inserts timers into, and expires them from, its own table.
+// The owner of an inserted timer is kept in the TimerControlFlags bits above
+// Absolute and Coalescable, in place of the unused KeepShifting and
+// EncodedTolerableDelay fields.
+//
+#define KI_TIMER_PROCESSOR_SHIFT            2
+C_ASSERT(MAXIMUM_PROCESSORS <= (0xFF >> KI_TIMER_PROCESSOR_SHIFT) + 1);
+
+typedef struct _KI_TIMER_TABLE
+{
+    KTIMER_TABLE_ENTRY Entry[TIMER_TABLE_SIZE];
+    KSPIN_LOCK Lock[LOCK_QUEUE_TIMER_TABLE_LOCKS];
+} KI_TIMER_TABLE, *PKI_TIMER_TABLE;
+
+//
+// Signals, resets and satisfied waits which neither wake nor block a thread
+// only lock the dispatcher object itself. Each processor counts how many of
+// them it is running, and the dispatcher lock waits for all the counts to
+// drop to zero before its owner may touch any dispatcher object.
+//
+typedef struct DECLSPEC_CACHEALIGN _KI_DISPATCHER_OBJECT_COUNT
+{
+    volatile LONG Count;
+} KI_DISPATCHER_OBJECT_COUNT, *PKI_DISPATCHER_OBJECT_COUNT;
+
 typedef struct _DPC_QUEUE_ENTRY
 {
     PKDPC Dpc;
@@ -134,7 +160,10 @@ extern ULONG KiServiceLimit;
 extern LIST_ENTRY KeBugcheckCallbackListHead, KeBugcheckReasonCallbackListHead;
 extern KSPIN_LOCK BugCheckCallbackLock;
 extern KDPC KiTimerExpireDpc;
-extern KTIMER_TABLE_ENTRY KiTimerTableListHead[TIMER_TABLE_SIZE];
+extern KI_TIMER_TABLE KiBootTimerTable;
+extern PKI_TIMER_TABLE KiTimerTable[MAXIMUM_PROCESSORS];
+extern KSPIN_LOCK KiDispatcherLock;
+extern KI_DISPATCHER_OBJECT_COUNT KiDispatcherObjectCount[MAXIMUM_PROCESSORS];
 extern FAST_MUTEX KiGenericCallDpcMutex;
 extern LIST_ENTRY KiProfileListHead, KiProfileSourceListHead;
 extern KSPIN_LOCK KiProfileLock;
@@ -307,6 +336,12 @@ KiCompleteTimer(
     IN PKSPIN_LOCK_QUEUE LockQueue
 );
 
+VOID
+FASTCALL
+KiInsertPeriodicTimer(
+    IN PKTIMER Timer
+);
+
 CODE_SEG("INIT")
 VOID
 NTAPI
@@ -655,6 +690,31 @@ KiInsertQueue(
     BOOLEAN Head
 );
 
+#if (NTDDI_VERSION < NTDDI_VISTA)
+ULONG
+NTAPI
+KeRemoveQueueEx(
+    IN PKQUEUE Queue,
+    IN KPROCESSOR_MODE WaitMode,
+    IN BOOLEAN Alertable,
+    IN PLARGE_INTEGER Timeout OPTIONAL,
+    OUT PLIST_ENTRY *EntryArray,
+    IN ULONG Count
+);
+#endif
+
+#if (NTDDI_VERSION < NTDDI_WIN7)
+BOOLEAN
+NTAPI
+KeSetCoalescableTimer(
+    IN OUT PKTIMER Timer,
+    IN LARGE_INTEGER DueTime,
+    IN ULONG Period,
+    IN ULONG TolerableDelay,
+    IN PKDPC Dpc OPTIONAL
+);
+#endif
+
 VOID
 NTAPI
 KiTimerExpiration(
@@ -826,6 +886,13 @@ FASTCALL
 KeZeroPages(IN PVOID Address,
             IN ULONG Size);
 
+#if defined(_M_IX86) || defined(_M_AMD64)
+VOID
+FASTCALL
+KeZeroPagesNonTemporal(IN PVOID Address,
+                       IN ULONG Size);
+#endif
+
 BOOLEAN
 FASTCALL
 KeInvalidAccessAllowed(IN PVOID TrapInformation OPTIONAL);
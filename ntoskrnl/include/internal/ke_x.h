@@ -144,6 +144,25 @@ KiReleaseDispatcherObject(IN DISPATCHER_HEADER* Object)
     UNREFERENCED_PARAMETER(Object);
 }
 
+//
+// At synchronization level, nothing else can run on UP, so the object is ours.
+//
+FORCEINLINE
+BOOLEAN
+KiTryEnterDispatcherObject(IN DISPATCHER_HEADER* Object)
+{
+    UNREFERENCED_PARAMETER(Object);
+    ASSERT(KeGetCurrentIrql() >= SYNCH_LEVEL);
+    return TRUE;
+}
+
+FORCEINLINE
+VOID
+KiLeaveDispatcherObject(IN DISPATCHER_HEADER* Object)
+{
+    UNREFERENCED_PARAMETER(Object);
+}
+
 FORCEINLINE
 KIRQL
 KiAcquireDispatcherLock(VOID)
@@ -302,6 +321,30 @@ KiReleaseTimerLock(IN PKSPIN_LOCK_QUEUE LockQueue)
     UNREFERENCED_PARAMETER(LockQueue);
 }
 
+FORCEINLINE
+VOID
+KiAcquireTimerTableLock(IN ULONG Processor,
+                        IN ULONG Hand,
+                        OUT PKLOCK_QUEUE_HANDLE LockHandle)
+{
+    ASSERT(KeGetCurrentIrql() >= DISPATCH_LEVEL);
+
+    /* Nothing to do on UP */
+    UNREFERENCED_PARAMETER(Processor);
+    UNREFERENCED_PARAMETER(Hand);
+    UNREFERENCED_PARAMETER(LockHandle);
+}
+
+FORCEINLINE
+VOID
+KiReleaseTimerTableLock(IN PKLOCK_QUEUE_HANDLE LockHandle)
+{
+    ASSERT(KeGetCurrentIrql() >= DISPATCH_LEVEL);
+
+    /* Nothing to do on UP */
+    UNREFERENCED_PARAMETER(LockHandle);
+}
+
 #else
 
 FORCEINLINE
@@ -344,12 +387,76 @@ KiReleaseDispatcherObject(IN DISPATCHER_HEADER* Object)
     InterlockedAnd(&Object->Lock, ~KOBJECT_LOCK_BIT);
 }
 
+//
+// Locks a dispatcher object without the dispatcher lock, for an operation
+// which neither wakes nor blocks any thread. This fails while the dispatcher
+// lock is held, and the caller must then take the dispatcher lock instead.
+//
+FORCEINLINE
+BOOLEAN
+KiTryEnterDispatcherObject(IN DISPATCHER_HEADER* Object)
+{
+    PKI_DISPATCHER_OBJECT_COUNT ObjectCount;
+
+    /* We can't be moved to another CPU until we leave the object */
+    ASSERT(KeGetCurrentIrql() >= SYNCH_LEVEL);
+    ObjectCount = &KiDispatcherObjectCount[KeGetCurrentProcessorNumber()];
+
+    /* Let the dispatcher lock know about us, then check if it's held */
+    InterlockedIncrement(&ObjectCount->Count);
+    if (*(volatile KSPIN_LOCK *)&KiDispatcherLock)
+    {
+        /* It is, so back off */
+        InterlockedDecrement(&ObjectCount->Count);
+        return FALSE;
+    }
+
+    /* Now only other CPUs doing the same can race us for the object */
+    KiAcquireDispatcherObject(Object);
+    return TRUE;
+}
+
+FORCEINLINE
+VOID
+KiLeaveDispatcherObject(IN DISPATCHER_HEADER* Object)
+{
+    /* Release the object, then let the dispatcher lock go ahead */
+    KiReleaseDispatcherObject(Object);
+    InterlockedDecrement(&KiDispatcherObjectCount[KeGetCurrentProcessorNumber()].Count);
+}
+
+//
+// Waits for the CPUs which entered a dispatcher object before we acquired the
+// dispatcher lock. Nobody can enter one anymore while we hold it.
+//
+FORCEINLINE
+VOID
+KiWaitForDispatcherObjects(VOID)
+{
+    ULONG i;
+
+    for (i = 0; i < (ULONG)KeNumberProcessors; i++)
+    {
+        while (KiDispatcherObjectCount[i].Count)
+        {
+            /* Let the CPU know that this is a loop */
+            YieldProcessor();
+        }
+    }
+}
+
 FORCEINLINE
 KIRQL
 KiAcquireDispatcherLock(VOID)
 {
+    KIRQL OldIrql;
+
     /* Raise to synchronization level and acquire the dispatcher lock */
-    return KeAcquireQueuedSpinLockRaiseToSynch(LockQueueDispatcherLock);
+    OldIrql = KeAcquireQueuedSpinLockRaiseToSynch(LockQueueDispatcherLock);
+
+    /* Wait for the objects locked without it */
+    KiWaitForDispatcherObjects();
+    return OldIrql;
 }
 
 FORCEINLINE
@@ -372,6 +479,9 @@ KiAcquireDispatcherLockAtSynchLevel(VOID)
     ASSERT(KeGetCurrentIrql() >= SYNCH_LEVEL);
     KeAcquireQueuedSpinLockAtDpcLevel(&KeGetCurrentPrcb()->
                                       LockQueue[LockQueueDispatcherLock]);
+
+    /* Wait for the objects locked without it */
+    KiWaitForDispatcherObjects();
 }
 
 FORCEINLINE
@@ -600,6 +710,38 @@ KiReleaseTimerLock(IN PKSPIN_LOCK_QUEUE LockQueue)
     KeReleaseQueuedSpinLockFromDpcLevel(LockQueue);
 }
 
+//
+// Locks a hand in the timer table of any processor, not just the current one.
+// Used to cancel a timer which was inserted on another processor.
+//
+FORCEINLINE
+VOID
+KiAcquireTimerTableLock(IN ULONG Processor,
+                        IN ULONG Hand,
+                        OUT PKLOCK_QUEUE_HANDLE LockHandle)
+{
+    ULONG LockIndex;
+    ASSERT(KeGetCurrentIrql() >= DISPATCH_LEVEL);
+
+    /* Get the lock index */
+    LockIndex = Hand >> LOCK_QUEUE_TIMER_LOCK_SHIFT;
+    LockIndex &= (LOCK_QUEUE_TIMER_TABLE_LOCKS - 1);
+
+    /* Acquire that processor's lock */
+    KeAcquireInStackQueuedSpinLockAtDpcLevel(&KiTimerTable[Processor]->Lock[LockIndex],
+                                             LockHandle);
+}
+
+FORCEINLINE
+VOID
+KiReleaseTimerTableLock(IN PKLOCK_QUEUE_HANDLE LockHandle)
+{
+    ASSERT(KeGetCurrentIrql() >= DISPATCH_LEVEL);
+
+    /* Release the lock */
+    KeReleaseInStackQueuedSpinLockFromDpcLevel(LockHandle);
+}
+
 #endif
 
 FORCEINLINE
@@ -754,7 +896,8 @@ KiReleaseDeviceQueueLock(IN PKLOCK_QUEUE_HANDLE DeviceLock)
         /* Synchronization Timers and Events just get un-signaled */        \
         (Object)->Header.SignalState = 0;                                   \
     }                                                                       \
-    else if ((Object)->Header.Type == SemaphoreObject)                      \
+    else if (((Object)->Header.Type & KOBJECT_TYPE_MASK) ==                 \
+             SemaphoreObject)                                               \
     {                                                                       \
         /* These ones can have multiple states, so we only decrease it */   \
         (Object)->Header.SignalState--;                                     \
@@ -883,6 +1026,26 @@ KiComputeTimerTableIndex(IN ULONGLONG DueTime)
     return (DueTime / KeMaximumIncrement) & (TIMER_TABLE_SIZE - 1);
 }
 
+FORCEINLINE
+ULONG
+KiGetTimerProcessor(IN PKTIMER Timer)
+{
+    return Timer->Header.TimerControlFlags >> KI_TIMER_PROCESSOR_SHIFT;
+}
+
+//
+// Must be called with the dispatcher lock held, before the timer goes into
+// the current processor's table, so that a canceller finds the right table
+//
+FORCEINLINE
+VOID
+KiSetTimerProcessor(IN PKTIMER Timer,
+                    IN ULONG Processor)
+{
+    Timer->Header.TimerControlFlags &= (1 << KI_TIMER_PROCESSOR_SHIFT) - 1;
+    Timer->Header.TimerControlFlags |= (UCHAR)(Processor << KI_TIMER_PROCESSOR_SHIFT);
+}
+
 //
 // Called from KiCompleteTimer, KiInsertTreeTimer, KeSetSystemTime
 // to remove timer entries
@@ -899,7 +1062,7 @@ KiRemoveEntryTimer(IN PKTIMER Timer)
     if (RemoveEntryList(&Timer->TimerListEntry))
     {
         /* Get the respective timer table entry */
-        TableEntry = &KiTimerTableListHead[Hand];
+        TableEntry = &KiTimerTable[KiGetTimerProcessor(Timer)]->Entry[Hand];
         if (&TableEntry->Entry == TableEntry->Entry.Flink)
         {
             /* Set the entry to an infinite absolute time */
@@ -926,6 +1089,9 @@ KxInsertTimer(IN PKTIMER Timer,
     PKSPIN_LOCK_QUEUE LockQueue;
     ASSERT(KeGetCurrentIrql() >= SYNCH_LEVEL);
 
+    /* The timer goes into this processor's table */
+    KiSetTimerProcessor(Timer, KeGetCurrentProcessorNumber());
+
     /* Acquire the lock and release the dispatcher lock */
     LockQueue = KiAcquireTimerLock(Hand);
     KiReleaseDispatcherLockFromSynchLevel();
@@ -1004,11 +1170,12 @@ VOID
 KxRemoveTreeTimer(IN PKTIMER Timer)
 {
     ULONG Hand = Timer->Header.Hand;
-    PKSPIN_LOCK_QUEUE LockQueue;
+    ULONG Processor = KiGetTimerProcessor(Timer);
+    KLOCK_QUEUE_HANDLE LockHandle;
     PKTIMER_TABLE_ENTRY TimerEntry;
 
-    /* Acquire timer lock */
-    LockQueue = KiAcquireTimerLock(Hand);
+    /* Acquire the timer lock of the processor which owns the timer */
+    KiAcquireTimerTableLock(Processor, Hand, &LockHandle);
 
     /* Set the timer as non-inserted */
     Timer->Header.Inserted = FALSE;
@@ -1017,7 +1184,7 @@ KxRemoveTreeTimer(IN PKTIMER Timer)
     if (RemoveEntryList(&Timer->TimerListEntry))
     {
         /* Get the entry and check if it's empty */
-        TimerEntry = &KiTimerTableListHead[Hand];
+        TimerEntry = &KiTimerTable[Processor]->Entry[Hand];
         if (IsListEmpty(&TimerEntry->Entry))
         {
             /* Clear the time then */
@@ -1026,7 +1193,7 @@ KxRemoveTreeTimer(IN PKTIMER Timer)
     }
 
     /* Release the timer lock */
-    KiReleaseTimerLock(LockQueue);
+    KiReleaseTimerTableLock(&LockHandle);
 }
 
 FORCEINLINE
@@ -183,6 +183,11 @@ typedef ULONG_PTR SWAPENTRY;
 #error Unsupported architecture!
 #endif
 
+//
+// Largest number of pages read from a paging file in a single I/O
+//
+#define MM_MAXIMUM_SWAP_CLUSTER  16
+
 #ifdef _M_AMD64
 #define InterlockedCompareExchangePte(PointerPte, Exchange, Comperand) \
     InterlockedCompareExchange64((PLONG64)(PointerPte), Exchange, Comperand)
@@ -264,6 +269,9 @@ typedef struct _MEMORY_AREA
         LONGLONG ViewOffset;
         PMM_SECTION_SEGMENT Segment;
         LIST_ENTRY RegionListHead;
+        /* Hard fault clustering: segment offset following the last cluster and its size */
+        LONGLONG NextFaultOffset;
+        ULONG FaultClusterSize;
     } SectionData;
 } MEMORY_AREA, *PMEMORY_AREA;
 
@@ -735,6 +743,20 @@ MmReadFromSwapPage(
     PFN_NUMBER Page
 );
 
+NTSTATUS
+NTAPI
+MmReadFromSwapPages(
+    SWAPENTRY SwapEntry,
+    PPFN_NUMBER Pages,
+    ULONG PageCount
+);
+
+SWAPENTRY
+NTAPI
+MmGetNextSwapEntry(
+    SWAPENTRY SwapEntry
+);
+
 NTSTATUS
 NTAPI
 MmWriteToSwapPage(
@@ -934,6 +956,12 @@ VOID
 NTAPI
 MmRebalanceMemoryConsumers(VOID);
 
+/* wslist.cpp ***************************************************************/
+
+VOID
+NTAPI
+MmWorkingSetManager(VOID);
+
 /* rmap.c **************************************************************/
 #define RMAP_SEGMENT_MASK ~((ULONG_PTR)0xff)
 #define RMAP_IS_SEGMENT(x) (((ULONG_PTR)(x) & RMAP_SEGMENT_MASK) == RMAP_SEGMENT_MASK)
@@ -1106,8 +1134,10 @@ MiUnmapPageInHyperSpace(IN PEPROCESS Process,
 
 PVOID
 NTAPI
-MiMapPagesInZeroSpace(IN PMMPFN Pfn1,
-                      IN PFN_NUMBER NumberOfPages);
+MiMapPagesInZeroSpace(IN PMMPTE ZeroingPte,
+                      IN PMMPFN Pfn1,
+                      IN PFN_NUMBER NumberOfPages,
+                      IN BOOLEAN Cached);
 
 VOID
 NTAPI
@@ -1329,6 +1359,17 @@ MmTrimUserMemory(
     PULONG NrFreedPages
 );
 
+VOID
+NTAPI
+MmAgeUserPages(VOID);
+
+ULONG
+NTAPI
+MmTrimProcessUserPages(
+    _In_ PEPROCESS Process,
+    _In_ ULONG Target
+);
+
 /* region.c ************************************************************/
 
 NTSTATUS
@@ -1529,6 +1570,13 @@ MmMakeDataSectionResident(
     _In_ ULONG Length,
     _In_ PLARGE_INTEGER ValidDataLength);
 
+NTSTATUS
+NTAPI
+MmPrefetchSectionPages(
+    _In_ PVOID SectionObject,
+    _In_ ULONG StartPage,
+    _In_ ULONG PageCount);
+
 BOOLEAN
 NTAPI
 MmPurgeSegment(
@@ -209,6 +209,18 @@ ObpLookupEntryDirectory(
     IN POBP_LOOKUP_CONTEXT Context
 );
 
+VOID
+NTAPI
+ObpGrowDirectory(
+    IN POBJECT_DIRECTORY Directory
+);
+
+VOID
+NTAPI
+ObpDeleteDirectory(
+    IN PVOID ObjectBody
+);
+
 //
 // Symbolic Link Functions
 //
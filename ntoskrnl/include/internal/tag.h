@@ -15,7 +15,9 @@
 #define TAG_VACB                    'aVcC'
 #define TAG_SHARED_CACHE_MAP        'cScC'
 #define TAG_PRIVATE_CACHE_MAP       'cPcC'
+#define TAG_VOLUME_CACHE_MAP        'cVcC'
 #define TAG_BCB                     'cBcC'
+#define TAG_PREFETCH                'fPcC'
 
 /* Executive Tags */
 #define TAG_CALLBACK_ROUTINE_BLOCK  'brbC'
@@ -116,6 +118,7 @@
 /* Object Manager Tags */
 #define OB_NAME_TAG             'mNbO'
 #define OB_DIR_TAG              'iDbO'
+#define OB_DIR_HASH_TAG         'hDbO'
 #define TAG_WAIT                'tiaW'
 #define TAG_SEC_QUERY           'qSbO'
 #define TAG_OBJECT_TYPE         'TjbO'
@@ -647,6 +647,319 @@ IopDeviceFsIoControl(IN HANDLE DeviceHandle,
                                         IopOtherTransfer);
 }
 
+NTSTATUS
+NTAPI
+IopReadWriteScatterGather(IN HANDLE FileHandle,
+                          IN HANDLE Event OPTIONAL,
+                          IN PIO_APC_ROUTINE ApcRoutine OPTIONAL,
+                          IN PVOID ApcContext OPTIONAL,
+                          OUT PIO_STATUS_BLOCK IoStatusBlock,
+                          IN FILE_SEGMENT_ELEMENT SegmentArray[],
+                          IN ULONG Length,
+                          IN PLARGE_INTEGER ByteOffset OPTIONAL,
+                          IN PULONG Key OPTIONAL,
+                          IN BOOLEAN IsWrite)
+{
+    NTSTATUS Status;
+    PFILE_OBJECT FileObject;
+    PIRP Irp;
+    PDEVICE_OBJECT DeviceObject;
+    PIO_STACK_LOCATION StackPtr;
+    KPROCESSOR_MODE PreviousMode = KeGetPreviousMode();
+    PKEVENT EventObject = NULL;
+    LARGE_INTEGER CapturedByteOffset;
+    ULONG CapturedKey = 0;
+    BOOLEAN Synchronous = FALSE;
+    PMDL Mdl;
+    OBJECT_HANDLE_INFORMATION ObjectHandleInfo = {0};
+    ULONG PageCount;
+
+    PAGED_CODE();
+    CapturedByteOffset.QuadPart = 0;
+    IOTRACE(IO_API_DEBUG, "FileHandle: %p\n", FileHandle);
+
+    /* Get the File Object, for write if we have to */
+    if (IsWrite)
+    {
+        Status = ObReferenceFileObjectForWrite(FileHandle,
+                                               PreviousMode,
+                                               &FileObject,
+                                               &ObjectHandleInfo);
+    }
+    else
+    {
+        Status = ObReferenceObjectByHandle(FileHandle,
+                                           FILE_READ_DATA,
+                                           IoFileObjectType,
+                                           PreviousMode,
+                                           (PVOID*)&FileObject,
+                                           NULL);
+    }
+    if (!NT_SUCCESS(Status)) return Status;
+
+    /* Get the device object */
+    DeviceObject = IoGetRelatedDeviceObject(FileObject);
+
+    /*
+     * The segments are whole pages which are only described by an MDL, so
+     * this can only be used for non-cached access, and the device has to
+     * accept an MDL in the first place.
+     */
+    if (!(FileObject->Flags & FO_NO_INTERMEDIATE_BUFFERING) ||
+        (DeviceObject->Flags & DO_BUFFERED_IO))
+    {
+        ObDereferenceObject(FileObject);
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    /* Each page of the transfer comes from its own segment */
+    PageCount = ADDRESS_AND_SIZE_TO_SPAN_PAGES(0, Length);
+
+    /* Validate User-Mode Buffers */
+    if (PreviousMode != KernelMode)
+    {
+        _SEH2_TRY
+        {
+            /* Probe the status block */
+            ProbeForWriteIoStatusBlock(IoStatusBlock);
+
+            /* Probe the segment array, the pages themselves get probed when locked */
+            ProbeForRead(SegmentArray,
+                         PageCount * sizeof(FILE_SEGMENT_ELEMENT),
+                         sizeof(ULONGLONG));
+
+            /* Check if we got a byte offset */
+            if (ByteOffset)
+            {
+                /* Capture and probe it */
+                CapturedByteOffset = ProbeForReadLargeInteger(ByteOffset);
+            }
+
+            /* Can't use an I/O completion port and an APC at the same time */
+            if ((FileObject->CompletionContext) && (ApcRoutine))
+            {
+                /* Fail */
+                ObDereferenceObject(FileObject);
+                return STATUS_INVALID_PARAMETER;
+            }
+
+            /* Fail if Length is not sector size aligned */
+            if ((DeviceObject->SectorSize != 0) &&
+                (Length % DeviceObject->SectorSize != 0))
+            {
+                /* Release the file object and and fail */
+                ObDereferenceObject(FileObject);
+                return STATUS_INVALID_PARAMETER;
+            }
+
+            if (ByteOffset)
+            {
+                /* Fail if ByteOffset is not sector size aligned */
+                if ((DeviceObject->SectorSize != 0) &&
+                    (CapturedByteOffset.QuadPart % DeviceObject->SectorSize != 0))
+                {
+                    /* Only if that's not specific values for synchronous IO */
+                    if ((!IsWrite ||
+                         CapturedByteOffset.QuadPart != FILE_WRITE_TO_END_OF_FILE) &&
+                        (CapturedByteOffset.QuadPart != FILE_USE_FILE_POINTER_POSITION ||
+                         !BooleanFlagOn(FileObject->Flags, FO_SYNCHRONOUS_IO)))
+                    {
+                        /* Release the file object and and fail */
+                        ObDereferenceObject(FileObject);
+                        return STATUS_INVALID_PARAMETER;
+                    }
+                }
+            }
+
+            /* Capture and probe the key */
+            if (Key) CapturedKey = ProbeForReadUlong(Key);
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            /* Release the file object and return the exception code */
+            ObDereferenceObject(FileObject);
+            _SEH2_YIELD(return _SEH2_GetExceptionCode());
+        }
+        _SEH2_END;
+    }
+    else
+    {
+        /* Kernel mode: capture directly */
+        if (ByteOffset) CapturedByteOffset = *ByteOffset;
+        if (Key) CapturedKey = *Key;
+    }
+
+    /* Check for invalid offset */
+    if (IsWrite)
+    {
+        if (CapturedByteOffset.QuadPart < -2)
+        {
+            /* -1 is FILE_WRITE_TO_END_OF_FILE */
+            /* -2 is FILE_USE_FILE_POINTER_POSITION */
+            ObDereferenceObject(FileObject);
+            return STATUS_INVALID_PARAMETER;
+        }
+
+        /* Check if this is an append operation */
+        if ((ObjectHandleInfo.GrantedAccess &
+            (FILE_APPEND_DATA | FILE_WRITE_DATA)) == FILE_APPEND_DATA)
+        {
+            /* Give the drivers something to understand */
+            CapturedByteOffset.u.LowPart = FILE_WRITE_TO_END_OF_FILE;
+            CapturedByteOffset.u.HighPart = -1;
+        }
+    }
+    else if ((CapturedByteOffset.QuadPart < 0) && (CapturedByteOffset.QuadPart != -2))
+    {
+        /* -2 is FILE_USE_FILE_POINTER_POSITION */
+        ObDereferenceObject(FileObject);
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    /* Check for event */
+    if (Event)
+    {
+        /* Reference it */
+        Status = ObReferenceObjectByHandle(Event,
+                                           EVENT_MODIFY_STATE,
+                                           ExEventObjectType,
+                                           PreviousMode,
+                                           (PVOID*)&EventObject,
+                                           NULL);
+        if (!NT_SUCCESS(Status))
+        {
+            /* Fail */
+            ObDereferenceObject(FileObject);
+            return Status;
+        }
+
+        /* Otherwise reset the event */
+        KeClearEvent(EventObject);
+    }
+
+    /* Check if we should use Sync IO or not */
+    if (FileObject->Flags & FO_SYNCHRONOUS_IO)
+    {
+        /* Lock the file object */
+        Status = IopLockFileObject(FileObject, PreviousMode);
+        if (Status != STATUS_SUCCESS)
+        {
+            if (EventObject) ObDereferenceObject(EventObject);
+            ObDereferenceObject(FileObject);
+            return Status;
+        }
+
+        /* Check if we don't have a byte offset available */
+        if (!(ByteOffset) ||
+            ((CapturedByteOffset.u.LowPart == FILE_USE_FILE_POINTER_POSITION) &&
+             (CapturedByteOffset.u.HighPart == -1)))
+        {
+            /* Use the Current Byte Offset instead */
+            CapturedByteOffset = FileObject->CurrentByteOffset;
+        }
+
+        /* Remember we are sync. There is no fast I/O, this is never cached */
+        Synchronous = TRUE;
+    }
+    else if (!ByteOffset)
+    {
+        /* Otherwise, this was async I/O without a byte offset, so fail */
+        if (EventObject) ObDereferenceObject(EventObject);
+        ObDereferenceObject(FileObject);
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    /* Clear the File Object's event */
+    KeClearEvent(&FileObject->Event);
+
+    /* Allocate the IRP */
+    Irp = IoAllocateIrp(DeviceObject->StackSize, FALSE);
+    if (!Irp) return IopCleanupFailedIrp(FileObject, EventObject, NULL);
+
+    /* Set the IRP */
+    Irp->Tail.Overlay.OriginalFileObject = FileObject;
+    Irp->Tail.Overlay.Thread = PsGetCurrentThread();
+    Irp->RequestorMode = PreviousMode;
+    Irp->Overlay.AsynchronousParameters.UserApcRoutine = ApcRoutine;
+    Irp->Overlay.AsynchronousParameters.UserApcContext = ApcContext;
+    Irp->UserIosb = IoStatusBlock;
+    Irp->UserEvent = EventObject;
+    Irp->PendingReturned = FALSE;
+    Irp->Cancel = FALSE;
+    Irp->CancelRoutine = NULL;
+    Irp->AssociatedIrp.SystemBuffer = NULL;
+    Irp->MdlAddress = NULL;
+    Irp->UserBuffer = NULL;
+
+    /* Set the Stack Data */
+    StackPtr = IoGetNextIrpStackLocation(Irp);
+    StackPtr->FileObject = FileObject;
+    if (IsWrite)
+    {
+        StackPtr->MajorFunction = IRP_MJ_WRITE;
+        StackPtr->Flags = FileObject->Flags & FO_WRITE_THROUGH ?
+                          SL_WRITE_THROUGH : 0;
+        StackPtr->Parameters.Write.Key = CapturedKey;
+        StackPtr->Parameters.Write.Length = Length;
+        StackPtr->Parameters.Write.ByteOffset = CapturedByteOffset;
+    }
+    else
+    {
+        StackPtr->MajorFunction = IRP_MJ_READ;
+        StackPtr->Parameters.Read.Key = CapturedKey;
+        StackPtr->Parameters.Read.Length = Length;
+        StackPtr->Parameters.Read.ByteOffset = CapturedByteOffset;
+    }
+
+    /* Check if we have a buffer length */
+    if (Length)
+    {
+        _SEH2_TRY
+        {
+            /*
+             * Describe the whole transfer with a single MDL whose PFN array
+             * is filled straight from the segments: the drivers only ever see
+             * offsets relative to the MDL, so the fact that the virtual
+             * addresses are discontiguous doesn't matter to them. The user
+             * buffer is the start of the MDL so these offsets add up.
+             */
+            Irp->UserBuffer = PAGE_ALIGN((ULONG_PTR)SegmentArray[0].Alignment);
+            Mdl = IoAllocateMdl(Irp->UserBuffer,
+                                Length,
+                                FALSE,
+                                TRUE,
+                                Irp);
+            if (!Mdl)
+                ExRaiseStatus(STATUS_INSUFFICIENT_RESOURCES);
+            MmProbeAndLockSelectedPages(Mdl,
+                                        SegmentArray,
+                                        PreviousMode,
+                                        IsWrite ? IoReadAccess : IoWriteAccess);
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            /* Allocating failed, clean up and return the exception code */
+            IopCleanupAfterException(FileObject, Irp, EventObject, NULL);
+            _SEH2_YIELD(return _SEH2_GetExceptionCode());
+        }
+        _SEH2_END;
+    }
+
+    /* Now set the deferred I/O flags */
+    Irp->Flags = (IsWrite ? IRP_WRITE_OPERATION : IRP_READ_OPERATION) |
+                 IRP_DEFER_IO_COMPLETION | IRP_NOCACHE;
+
+    /* Perform the call */
+    return IopPerformSynchronousRequest(DeviceObject,
+                                        Irp,
+                                        FileObject,
+                                        TRUE,
+                                        PreviousMode,
+                                        Synchronous,
+                                        IsWrite ? IopWriteTransfer :
+                                                  IopReadTransfer);
+}
+
 NTSTATUS
 NTAPI
 IopQueryDeviceInformation(IN PFILE_OBJECT FileObject,
@@ -2919,10 +3232,11 @@ NtReadFile(IN HANDLE FileHandle,
                 }
                 _SEH2_END;
 
-                /* Signal the completion event */
+                /* Signal the completion event, unless FILE_SKIP_SET_USER_EVENT_ON_FAST_IO was set */
                 if (EventObject)
                 {
-                    KeSetEvent(EventObject, 0, FALSE);
+                    if (!(FileObject->Flags & FO_SKIP_SET_FAST_IO))
+                        KeSetEvent(EventObject, 0, FALSE);
                     ObDereferenceObject(EventObject);
                 }
 
@@ -3056,7 +3370,7 @@ NtReadFile(IN HANDLE FileHandle,
 }
 
 /*
- * @unimplemented
+ * @implemented
  */
 NTSTATUS
 NTAPI
@@ -3070,8 +3384,17 @@ NtReadFileScatter(IN HANDLE FileHandle,
                   IN PLARGE_INTEGER  ByteOffset,
                   IN PULONG Key OPTIONAL)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    /* Build one IRP for all the segments */
+    return IopReadWriteScatterGather(FileHandle,
+                                     Event,
+                                     UserApcRoutine,
+                                     UserApcContext,
+                                     UserIoStatusBlock,
+                                     BufferDescription,
+                                     BufferLength,
+                                     ByteOffset,
+                                     Key,
+                                     FALSE);
 }
 
 /*
@@ -3114,6 +3437,8 @@ NtSetInformationFile(IN HANDLE FileHandle,
     PVOID Queue;
     PFILE_COMPLETION_INFORMATION CompletionInfo = FileInformation;
     PIO_COMPLETION_CONTEXT Context;
+    PFILE_IO_COMPLETION_NOTIFICATION_INFORMATION NotificationInfo;
+    ULONG Flags;
     PFILE_RENAME_INFORMATION RenameInfo;
     HANDLE TargetHandle = NULL;
     PAGED_CODE();
@@ -3375,6 +3700,39 @@ NtSetInformationFile(IN HANDLE FileHandle,
         Irp->IoStatus.Status = Status;
         Irp->IoStatus.Information = 0;
     }
+    else if (FileInformationClass == FileIoCompletionNotificationInformation)
+    {
+        /* Get the requested modes */
+        NotificationInfo = Irp->AssociatedIrp.SystemBuffer;
+
+        /* Reject anything we don't know about */
+        if (NotificationInfo->Flags & ~(FILE_SKIP_COMPLETION_PORT_ON_SUCCESS |
+                                        FILE_SKIP_SET_EVENT_ON_HANDLE |
+                                        FILE_SKIP_SET_USER_EVENT_ON_FAST_IO))
+        {
+            /* Fail */
+            Status = STATUS_INVALID_PARAMETER;
+        }
+        else
+        {
+            /* Build the file object flags; they can't be cleared again */
+            Flags = 0;
+            if (NotificationInfo->Flags & FILE_SKIP_COMPLETION_PORT_ON_SUCCESS)
+                Flags |= FO_SKIP_COMPLETION_PORT;
+            if (NotificationInfo->Flags & FILE_SKIP_SET_EVENT_ON_HANDLE)
+                Flags |= FO_SKIP_SET_EVENT;
+            if (NotificationInfo->Flags & FILE_SKIP_SET_USER_EVENT_ON_FAST_IO)
+                Flags |= FO_SKIP_SET_FAST_IO;
+
+            /* Set them */
+            InterlockedOr((PLONG)&FileObject->Flags, Flags);
+            Status = STATUS_SUCCESS;
+        }
+
+        /* Set the IRP Status */
+        Irp->IoStatus.Status = Status;
+        Irp->IoStatus.Information = 0;
+    }
     else if (FileInformationClass == FileRenameInformation ||
              FileInformationClass == FileLinkInformation ||
              FileInformationClass == FileMoveClusterInformation)
@@ -3990,10 +4348,11 @@ NtWriteFile(IN HANDLE FileHandle,
                 }
                 _SEH2_END;
 
-                /* Signal the completion event */
+                /* Signal the completion event, unless FILE_SKIP_SET_USER_EVENT_ON_FAST_IO was set */
                 if (EventObject)
                 {
-                    KeSetEvent(EventObject, 0, FALSE);
+                    if (!(FileObject->Flags & FO_SKIP_SET_FAST_IO))
+                        KeSetEvent(EventObject, 0, FALSE);
                     ObDereferenceObject(EventObject);
                 }
 
@@ -4127,6 +4486,9 @@ NtWriteFile(IN HANDLE FileHandle,
                                         IopWriteTransfer);
 }
 
+/*
+ * @implemented
+ */
 NTSTATUS
 NTAPI
 NtWriteFileGather(IN HANDLE FileHandle,
@@ -4139,8 +4501,17 @@ NtWriteFileGather(IN HANDLE FileHandle,
                   IN PLARGE_INTEGER ByteOffset,
                   IN PULONG Key OPTIONAL)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    /* Build one IRP for all the segments */
+    return IopReadWriteScatterGather(FileHandle,
+                                     Event,
+                                     UserApcRoutine,
+                                     UserApcContext,
+                                     UserIoStatusBlock,
+                                     BufferDescription,
+                                     BufferLength,
+                                     ByteOffset,
+                                     Key,
+                                     TRUE);
 }
 
 /*
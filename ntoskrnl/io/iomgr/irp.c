@@ -399,8 +399,17 @@ IopCompleteRequest(IN PKAPC Apc,
         }
         else if (FileObject)
         {
-            /* Signal the file object and set the status */
-            KeSetEvent(&FileObject->Event, 0, FALSE);
+            /*
+             * Signal the file object unless the caller asked us not to with
+             * FILE_SKIP_SET_EVENT_ON_HANDLE. Synch I/O waits on it, though.
+             */
+            if (!(FileObject->Flags & FO_SKIP_SET_EVENT) ||
+                (FileObject->Flags & FO_SYNCHRONOUS_IO))
+            {
+                KeSetEvent(&FileObject->Event, 0, FALSE);
+            }
+
+            /* Set the status */
             FileObject->FinalStatus = Irp->IoStatus.Status;
 
             /*
@@ -460,8 +469,16 @@ IopCompleteRequest(IN PKAPC Apc,
             KeInsertQueueApc(&Irp->Tail.Apc, Irp->UserIosb, NULL, 2);
         }
         else if ((Port) &&
-                 (Irp->Overlay.AsynchronousParameters.UserApcContext))
+                 (Irp->Overlay.AsynchronousParameters.UserApcContext) &&
+                 !((FileObject->Flags & FO_SKIP_COMPLETION_PORT) &&
+                   !(Irp->PendingReturned) &&
+                   NT_SUCCESS(Irp->IoStatus.Status)))
         {
+            /*
+             * Requests which succeeded inline on a FILE_SKIP_COMPLETION_PORT_ON_SUCCESS
+             * file were already seen by the caller, so they don't get a packet.
+             */
+
             /* We have an I/O Completion setup... create the special Overlay */
             Irp->Tail.CompletionKey = Key;
             Irp->Tail.Overlay.PacketType = IopCompletionPacketIrp;
@@ -469,7 +486,11 @@ IopCompleteRequest(IN PKAPC Apc,
         }
         else
         {
-            /* Free the IRP since we don't need it anymore */
+            /*
+             * Free the IRP since we don't need it anymore. This includes
+             * requests which succeeded inline on a FO_SKIP_COMPLETION_PORT
+             * file, since the caller already got their status.
+             */
             IoFreeIrp(Irp);
         }
 
@@ -2089,11 +2089,15 @@ KdbpCmdProc(
         KdbpPrint("%s"
                   "  PID:             0x%08x\n"
                   "  State:           %s (0x%x)\n"
-                  "  Image Filename:  %s\n",
+                  "  Image Filename:  %s\n"
+                  "  Hard Faults:     %lu (%lu pages, largest cluster %lu)\n",
                   (Argc < 2) ? "Current process:\n" : "",
                   Process->UniqueProcessId,
                   State, Process->Pcb.State,
-                  Process->ImageFileName);
+                  Process->ImageFileName,
+                  Process->HardFaultCount,
+                  Process->HardFaultPageCount,
+                  Process->PeakFaultClusterSize);
 
         /* Release our reference, if any */
         if (ReferencedProcess)
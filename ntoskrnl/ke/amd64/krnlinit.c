@@ -230,7 +230,6 @@ KiInitializeKernel(IN PKPROCESS InitProcess,
 {
     ULONG_PTR PageDirectory[2];
     PVOID DpcStack;
-    ULONG i;
 
     /* Initialize 8/16 bit SList support */
     RtlpUse16ByteSLists = (KeFeatureBits & KF_CMPXCHG16B) ? TRUE : FALSE;
@@ -252,15 +251,6 @@ KiInitializeKernel(IN PKPROCESS InitProcess,
     InitializeListHead(&KiProfileListHead);
     InitializeListHead(&KiProfileSourceListHead);
 
-    /* Loop the timer table */
-    for (i = 0; i < TIMER_TABLE_SIZE; i++)
-    {
-        /* Initialize the list and entries */
-        InitializeListHead(&KiTimerTableListHead[i].Entry);
-        KiTimerTableListHead[i].Time.HighPart = 0xFFFFFFFF;
-        KiTimerTableListHead[i].Time.LowPart = 0;
-    }
-
     /* Initialize the Swap event and all swap lists */
     KeInitializeEvent(&KiSwapEvent, SynchronizationEvent, FALSE);
     InitializeListHead(&KiProcessInSwapListHead);
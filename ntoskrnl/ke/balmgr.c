@@ -176,10 +176,10 @@ KeBalanceSetManager(IN PVOID Context)
             case STATUS_WAIT_0:
 
                 /* Adjust lookaside lists */
-                //ExAdjustLookasideDepth();
+                ExAdjustLookasideDepth();
 
                 /* Call the working set manager */
-                //MmWorkingSetManager();
+                MmWorkingSetManager();
 
                 /* FIXME: Outswap stacks */
 
@@ -36,8 +36,9 @@ KeSetSystemTime(IN PLARGE_INTEGER NewTime,
     PLIST_ENTRY ListHead, NextEntry;
     PKTIMER Timer;
     PKSPIN_LOCK_QUEUE LockQueue;
+    KLOCK_QUEUE_HANDLE LockHandle;
     LIST_ENTRY TempList, TempList2;
-    ULONG Hand, i;
+    ULONG Hand, i, Processor;
 
     /* Sanity checks */
     ASSERT((NewTime->HighPart & 0xF0000000) == 0);
@@ -78,32 +79,35 @@ KeSetSystemTime(IN PLARGE_INTEGER NewTime,
     /* Setup a temporary list of absolute timers */
     InitializeListHead(&TempList);
 
-    /* Loop current timers */
-    for (i = 0; i < TIMER_TABLE_SIZE; i++)
+    /* Loop current timers, in the timer table of every processor */
+    for (Processor = 0; Processor < (ULONG)KeNumberProcessors; Processor++)
     {
-        /* Loop the entries in this table and lock the timers */
-        ListHead = &KiTimerTableListHead[i].Entry;
-        LockQueue = KiAcquireTimerLock(i);
-        NextEntry = ListHead->Flink;
-        while (NextEntry != ListHead)
+        for (i = 0; i < TIMER_TABLE_SIZE; i++)
         {
-            /* Get the timer */
-            Timer = CONTAINING_RECORD(NextEntry, KTIMER, TimerListEntry);
-            NextEntry = NextEntry->Flink;
-
-            /* Is it absolute? */
-            if (Timer->Header.Absolute)
+            /* Loop the entries in this table and lock the timers */
+            ListHead = &KiTimerTable[Processor]->Entry[i].Entry;
+            KiAcquireTimerTableLock(Processor, i, &LockHandle);
+            NextEntry = ListHead->Flink;
+            while (NextEntry != ListHead)
             {
-                /* Remove it from the timer list */
-                KiRemoveEntryTimer(Timer);
-
-                /* Insert it into our temporary list */
-                InsertTailList(&TempList, &Timer->TimerListEntry);
+                /* Get the timer */
+                Timer = CONTAINING_RECORD(NextEntry, KTIMER, TimerListEntry);
+                NextEntry = NextEntry->Flink;
+
+                /* Is it absolute? */
+                if (Timer->Header.Absolute)
+                {
+                    /* Remove it from the timer list */
+                    KiRemoveEntryTimer(Timer);
+
+                    /* Insert it into our temporary list */
+                    InsertTailList(&TempList, &Timer->TimerListEntry);
+                }
             }
-        }
 
-        /* Release the lock */
-        KiReleaseTimerLock(LockQueue);
+            /* Release the lock */
+            KiReleaseTimerTableLock(&LockHandle);
+        }
     }
 
     /* Setup a temporary list of expired timers */
@@ -116,10 +120,11 @@ KeSetSystemTime(IN PLARGE_INTEGER NewTime,
         Timer = CONTAINING_RECORD(TempList.Flink, KTIMER, TimerListEntry);
         RemoveEntryList(&Timer->TimerListEntry);
 
-        /* Update the due time and handle */
+        /* Update the due time and handle, it now goes into our own table */
         Timer->DueTime.QuadPart -= DeltaTime.QuadPart;
         Hand = KiComputeTimerTableIndex(Timer->DueTime.QuadPart);
         Timer->Header.Hand = (UCHAR)Hand;
+        KiSetTimerProcessor(Timer, KeGetCurrentProcessorNumber());
 
         /* Lock the timer and re-insert it */
         LockQueue = KiAcquireTimerLock(Hand);
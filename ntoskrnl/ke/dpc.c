@@ -37,13 +37,15 @@ KiCheckTimerTable(IN ULARGE_INTEGER CurrentTime)
     PLIST_ENTRY ListHead, NextEntry;
     KIRQL OldIrql;
     PKTIMER Timer;
+    PKI_TIMER_TABLE TimerTable;
 
-    /* Raise IRQL to high and loop timers */
+    /* Raise IRQL to high and loop this processor's timers */
     KeRaiseIrql(HIGH_LEVEL, &OldIrql);
+    TimerTable = KiTimerTable[KeGetCurrentProcessorNumber()];
     do
     {
         /* Loop the current list */
-        ListHead = &KiTimerTableListHead[i].Entry;
+        ListHead = &TimerTable->Entry[i].Entry;
         NextEntry = ListHead->Flink;
         while (NextEntry != ListHead)
         {
@@ -82,7 +84,6 @@ KiTimerExpiration(IN PKDPC Dpc,
                   IN PVOID SystemArgument2)
 {
     ULARGE_INTEGER SystemTime, InterruptTime;
-    LARGE_INTEGER Interval;
     LONG Limit, Index, i;
     ULONG Timers, ActiveTimers, DpcCalls;
     PLIST_ENTRY ListHead, NextEntry;
@@ -93,6 +94,7 @@ KiTimerExpiration(IN PKDPC Dpc,
     DPC_QUEUE_ENTRY DpcEntry[MAX_TIMER_DPCS];
     PKSPIN_LOCK_QUEUE LockQueue;
     PKPRCB Prcb = KeGetCurrentPrcb();
+    PKI_TIMER_TABLE TimerTable = KiTimerTable[Prcb->Number];
 
     /* Disable interrupts */
     _disable();
@@ -132,7 +134,7 @@ KiTimerExpiration(IN PKDPC Dpc,
         Index = (Index + 1) & (TIMER_TABLE_SIZE - 1);
 
         /* Get list pointers and loop the list */
-        ListHead = &KiTimerTableListHead[Index].Entry;
+        ListHead = &TimerTable->Entry[Index].Entry;
         while (ListHead != ListHead->Flink)
         {
             /* Lock the timer and go to the next entry */
@@ -174,13 +176,8 @@ KiTimerExpiration(IN PKDPC Dpc,
                     }
                 }
 
-                /* Check if we have a period */
-                if (Period)
-                {
-                    /* Calculate the interval and insert the timer */
-                    Interval.QuadPart = Int32x32To64(Period, -10000);
-                    while (!KiInsertTreeTimer(Timer, Interval));
-                }
+                /* Check if we have a period, and insert the timer again */
+                if (Period) KiInsertPeriodicTimer(Timer);
 
                 /* Check if we have a DPC */
                 if (TimerDpc)
@@ -251,12 +248,12 @@ KiTimerExpiration(IN PKDPC Dpc,
                 if (NextEntry != ListHead)
                 {
                     /* Sanity check */
-                    ASSERT(KiTimerTableListHead[Index].Time.QuadPart <=
+                    ASSERT(TimerTable->Entry[Index].Time.QuadPart <=
                            Timer->DueTime.QuadPart);
 
                     /* Update the time */
                     _disable();
-                    KiTimerTableListHead[Index].Time.QuadPart =
+                    TimerTable->Entry[Index].Time.QuadPart =
                         Timer->DueTime.QuadPart;
                     _enable();
                 }
@@ -339,7 +336,6 @@ KiTimerListExpire(IN PLIST_ENTRY ExpiredListHead,
                   IN KIRQL OldIrql)
 {
     ULARGE_INTEGER SystemTime;
-    LARGE_INTEGER Interval;
     LONG i;
     ULONG DpcCalls = 0;
     PKTIMER Timer;
@@ -386,13 +382,8 @@ KiTimerListExpire(IN PLIST_ENTRY ExpiredListHead,
             }
         }
 
-        /* Check if we have a period */
-        if (Period)
-        {
-            /* Calculate the interval and insert the timer */
-            Interval.QuadPart = Int32x32To64(Period, -10000);
-            while (!KiInsertTreeTimer(Timer, Interval));
-        }
+        /* Check if we have a period, and insert the timer again */
+        if (Period) KiInsertPeriodicTimer(Timer);
 
         /* Check if we have a DPC */
         if (TimerDpc)
@@ -138,8 +138,22 @@ KeResetEvent(IN PKEVENT Event)
     ASSERT_EVENT(Event);
     ASSERT_IRQL_LESS_OR_EQUAL(DISPATCH_LEVEL);
 
+    /* Resetting wakes nobody, so try to lock only the event */
+    OldIrql = KeRaiseIrqlToSynchLevel();
+    if (KiTryEnterDispatcherObject(&Event->Header))
+    {
+        /* Save the Previous State and set it to zero */
+        PreviousState = Event->Header.SignalState;
+        Event->Header.SignalState = 0;
+
+        /* Unlock the event and return previous state */
+        KiLeaveDispatcherObject(&Event->Header);
+        KeLowerIrql(OldIrql);
+        return PreviousState;
+    }
+
     /* Lock the Dispatcher Database */
-    OldIrql = KiAcquireDispatcherLock();
+    KiAcquireDispatcherLockAtSynchLevel();
 
     /* Save the Previous State */
     PreviousState = Event->Header.SignalState;
@@ -168,19 +182,41 @@ KeSetEvent(IN PKEVENT Event,
     ASSERT_IRQL_LESS_OR_EQUAL(DISPATCH_LEVEL);
 
     /*
-     * Check if this is an signaled notification event without an upcoming wait.
-     * In this case, we can immediately return TRUE, without locking.
+     * Check if this is an already signaled event without an upcoming wait.
+     * Setting it again changes nothing, whatever the event type, so we can
+     * immediately return TRUE, without locking. The barrier makes the caller's
+     * earlier writes visible to whoever consumes the signal we rely on.
      */
-    if ((Event->Header.Type == EventNotificationObject) &&
-        (Event->Header.SignalState == 1) &&
-        !(Wait))
+    KeMemoryBarrier();
+    if ((Event->Header.SignalState == 1) && !(Wait))
     {
         /* Return the signal state (TRUE/Signalled) */
         return TRUE;
     }
 
+    /* Without waiters, signaling wakes nobody, so try to lock only the event */
+    OldIrql = KeRaiseIrqlToSynchLevel();
+    if (!(Wait) && (KiTryEnterDispatcherObject(&Event->Header)))
+    {
+        /* Waiters can only be added under the dispatcher lock */
+        if (IsListEmpty(&Event->Header.WaitListHead))
+        {
+            /* Save the Previous State and set the Event to Signaled */
+            PreviousState = Event->Header.SignalState;
+            Event->Header.SignalState = 1;
+
+            /* Unlock the event and return the previous state */
+            KiLeaveDispatcherObject(&Event->Header);
+            KeLowerIrql(OldIrql);
+            return PreviousState;
+        }
+
+        /* Somebody has to be woken up */
+        KiLeaveDispatcherObject(&Event->Header);
+    }
+
     /* Lock the Dispathcer Database */
-    OldIrql = KiAcquireDispatcherLock();
+    KiAcquireDispatcherLockAtSynchLevel();
 
     /* Save the Previous State */
     PreviousState = Event->Header.SignalState;
@@ -233,7 +269,7 @@ KeSetEventBoostPriority(IN PKEVENT Event,
     KIRQL OldIrql;
     PKWAIT_BLOCK WaitBlock;
     PKTHREAD Thread = KeGetCurrentThread(), WaitThread;
-    ASSERT(Event->Header.Type == EventSynchronizationObject);
+    ASSERT((Event->Header.Type & KOBJECT_TYPE_MASK) == EventSynchronizationObject);
     ASSERT_IRQL_LESS_OR_EQUAL(DISPATCH_LEVEL);
 
     /* Acquire Dispatcher Database Lock */
@@ -23,6 +23,7 @@ typedef struct _APINFO
     KTSS Tss;
     KTSS TssDoubleFault;
     KTSS TssNMI;
+    KI_TIMER_TABLE TimerTable;
 } APINFO, *PAPINFO;
 
 typedef struct _AP_SETUP_STACK
@@ -143,10 +144,14 @@ KeStartAllProcessors(VOID)
         KeLoaderBlock->Prcb = (ULONG_PTR)&APInfo->Pcr.Prcb;
         KeLoaderBlock->Thread = (ULONG_PTR)&APInfo->Pcr.Prcb->IdleThread;
 
+        // The new CPU initializes its own timer table
+        KiTimerTable[ProcessorCount] = &APInfo->TimerTable;
+
         // Start the CPU
         DPRINT("Attempting to Start a CPU with number: %lu\n", ProcessorCount);
         if (!HalStartNextProcessor(KeLoaderBlock, ProcessorState))
         {
+            KiTimerTable[ProcessorCount] = NULL;
             break;
         }
 
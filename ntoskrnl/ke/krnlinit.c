@@ -42,6 +42,7 @@ EPROCESS KiInitialProcess;
 
 /* System-defined Spinlocks */
 KSPIN_LOCK KiDispatcherLock;
+KI_DISPATCHER_OBJECT_COUNT KiDispatcherObjectCount[MAXIMUM_PROCESSORS];
 KSPIN_LOCK MmPfnLock;
 KSPIN_LOCK MmSystemSpaceLock;
 KSPIN_LOCK CcBcbSpinLock;
@@ -56,7 +57,6 @@ KSPIN_LOCK IopDatabaseLock;
 KSPIN_LOCK IopCompletionLock;
 KSPIN_LOCK NtfsStructLock;
 KSPIN_LOCK AfdWorkQueueSpinLock;
-KSPIN_LOCK KiTimerTableLock[LOCK_QUEUE_TIMER_TABLE_LOCKS];
 KSPIN_LOCK KiReverseStallIpiLock;
 
 /* FUNCTIONS *****************************************************************/
@@ -66,8 +66,6 @@ VOID
 NTAPI
 KiInitSystem(VOID)
 {
-    ULONG i;
-
     /* Initialize Bugcheck Callback data */
     InitializeListHead(&KeBugcheckCallbackListHead);
     InitializeListHead(&KeBugcheckReasonCallbackListHead);
@@ -82,15 +80,6 @@ KiInitSystem(VOID)
     InitializeListHead(&KiProfileListHead);
     InitializeListHead(&KiProfileSourceListHead);
 
-    /* Loop the timer table */
-    for (i = 0; i < TIMER_TABLE_SIZE; i++)
-    {
-        /* Initialize the list and entries */
-        InitializeListHead(&KiTimerTableListHead[i].Entry);
-        KiTimerTableListHead[i].Time.HighPart = 0xFFFFFFFF;
-        KiTimerTableListHead[i].Time.LowPart = 0;
-    }
-
     /* Initialize the Swap event and all swap lists */
     KeInitializeEvent(&KiSwapEvent, SynchronizationEvent, FALSE);
     InitializeListHead(&KiProcessInSwapListHead);
@@ -183,6 +172,7 @@ NTAPI
 KiInitSpinLocks(IN PKPRCB Prcb,
                 IN CCHAR Number)
 {
+    PKI_TIMER_TABLE TimerTable = KiTimerTable[Number];
     ULONG i;
 
     /* Initialize Dispatcher Fields */
@@ -247,17 +237,26 @@ KiInitSpinLocks(IN PKPRCB Prcb,
     Prcb->LockQueue[LockQueueUnusedSpare16].Next = NULL;
     Prcb->LockQueue[LockQueueUnusedSpare16].Lock = NULL;
 
-    /* Loop timer locks (shared amongst all CPUs) */
+    /* Loop this CPU's timer table, its storage was set up by whoever started the CPU */
+    ASSERT(TimerTable != NULL);
+    for (i = 0; i < TIMER_TABLE_SIZE; i++)
+    {
+        /* Initialize the list and entries */
+        InitializeListHead(&TimerTable->Entry[i].Entry);
+        TimerTable->Entry[i].Time.HighPart = 0xFFFFFFFF;
+        TimerTable->Entry[i].Time.LowPart = 0;
+    }
+
+    /* Loop timer locks (each CPU has its own, for its own table) */
     for (i = 0; i < LOCK_QUEUE_TIMER_TABLE_LOCKS; i++)
     {
-        /* Setup the Queued Spinlock (done only once by the boot CPU) */
-        if (!Number)
-            KeInitializeSpinLock(&KiTimerTableLock[i]);
+        /* Setup the Queued Spinlock */
+        KeInitializeSpinLock(&TimerTable->Lock[i]);
 
         /* Initialize the lock */
         Prcb->LockQueue[LockQueueTimerTableLock + i].Next = NULL;
         Prcb->LockQueue[LockQueueTimerTableLock + i].Lock =
-            &KiTimerTableLock[i];
+            &TimerTable->Lock[i];
     }
 
     /* Initialize the PRCB lock */
@@ -138,6 +138,48 @@ KiInsertQueue(IN PKQUEUE Queue,
     return InitialState;
 }
 
+/*
+ * Removes the first entry of a non-empty queue. The dispatcher lock is held
+ */
+FORCEINLINE
+PLIST_ENTRY
+KiRemoveQueueEntry(IN PKQUEUE Queue)
+{
+    PLIST_ENTRY QueueEntry = Queue->EntryListHead.Flink;
+
+    /* Decrease the number of entries */
+    Queue->Header.SignalState--;
+
+    /* Check if the entry is valid. If not, bugcheck */
+    if (!(QueueEntry->Flink) || !(QueueEntry->Blink))
+    {
+        /* Invalid item */
+        KeBugCheckEx(INVALID_WORK_QUEUE_ITEM,
+                     (ULONG_PTR)QueueEntry,
+                     (ULONG_PTR)Queue,
+                     (ULONG_PTR)NULL,
+                     (ULONG_PTR)((PWORK_QUEUE_ITEM)QueueEntry)->
+                                 WorkerRoutine);
+    }
+
+    /* Remove the Entry */
+    RemoveEntryList(QueueEntry);
+    QueueEntry->Flink = NULL;
+    return QueueEntry;
+}
+
+/*
+ * Tells a wait status apart from a queue entry handed over by KiInsertQueue
+ */
+FORCEINLINE
+BOOLEAN
+KiIsQueueWaitStatus(IN LONG_PTR Status)
+{
+    return (Status == STATUS_TIMEOUT) ||
+           (Status == STATUS_USER_APC) ||
+           (Status == STATUS_ALERTED);
+}
+
 /* PUBLIC FUNCTIONS **********************************************************/
 
 /*
@@ -233,14 +275,18 @@ KeReadStateQueue(IN PKQUEUE Queue)
 /*
  * @implemented
  */
-PLIST_ENTRY
+ULONG
 NTAPI
-KeRemoveQueue(IN PKQUEUE Queue,
-              IN KPROCESSOR_MODE WaitMode,
-              IN PLARGE_INTEGER Timeout OPTIONAL)
+KeRemoveQueueEx(IN PKQUEUE Queue,
+                IN KPROCESSOR_MODE WaitMode,
+                IN BOOLEAN Alertable,
+                IN PLARGE_INTEGER Timeout OPTIONAL,
+                OUT PLIST_ENTRY *EntryArray,
+                IN ULONG Count)
 {
     PLIST_ENTRY QueueEntry;
     LONG_PTR Status;
+    ULONG Removed = 0;
     PKTHREAD Thread = KeGetCurrentThread();
     PKQUEUE PreviousQueue;
     PKWAIT_BLOCK WaitBlock = &Thread->WaitBlock[0];
@@ -249,9 +295,11 @@ KeRemoveQueue(IN PKQUEUE Queue,
     BOOLEAN Swappable;
     PLARGE_INTEGER OriginalDueTime = Timeout;
     LARGE_INTEGER DueTime = {{0}}, NewDueTime, InterruptTime;
+    KIRQL OldIrql;
     ULONG Hand = 0;
     ASSERT_QUEUE(Queue);
     ASSERT_IRQL_LESS_OR_EQUAL(DISPATCH_LEVEL);
+    ASSERT(Count != 0);
 
     /* Check if the Lock is already held */
     if (Thread->WaitNext)
@@ -259,12 +307,14 @@ KeRemoveQueue(IN PKQUEUE Queue,
         /* It is, so next time don't do expect this */
         Thread->WaitNext = FALSE;
         KxQueueThreadWait();
+        Thread->Alertable = Alertable;
     }
     else
     {
         /* Raise IRQL to synch, prepare the wait, then lock the database */
         Thread->WaitIrql = KeRaiseIrqlToSynchLevel();
         KxQueueThreadWait();
+        Thread->Alertable = Alertable;
         KiAcquireDispatcherLockAtSynchLevel();
     }
 
@@ -306,27 +356,14 @@ KeRemoveQueue(IN PKQUEUE Queue,
         if ((Queue->CurrentCount < Queue->MaximumCount) &&
             (QueueEntry != &Queue->EntryListHead))
         {
-            /* Decrease the number of entries */
-            Queue->Header.SignalState--;
-
             /* Increase numbef of running threads */
             Queue->CurrentCount++;
 
-            /* Check if the entry is valid. If not, bugcheck */
-            if (!(QueueEntry->Flink) || !(QueueEntry->Blink))
+            /* Take as many entries as the caller wants */
+            do
             {
-                /* Invalid item */
-                KeBugCheckEx(INVALID_WORK_QUEUE_ITEM,
-                             (ULONG_PTR)QueueEntry,
-                             (ULONG_PTR)Queue,
-                             (ULONG_PTR)NULL,
-                             (ULONG_PTR)((PWORK_QUEUE_ITEM)QueueEntry)->
-                                         WorkerRoutine);
-            }
-
-            /* Remove the Entry */
-            RemoveEntryList(QueueEntry);
-            QueueEntry->Flink = NULL;
+                EntryArray[Removed++] = KiRemoveQueueEntry(Queue);
+            } while ((Removed < Count) && !IsListEmpty(&Queue->EntryListHead));
 
             /* Nothing to wait on */
             break;
@@ -344,12 +381,12 @@ KeRemoveQueue(IN PKQUEUE Queue,
             }
             else
             {
-                /* Fail if there's a User APC Pending */
-                if ((WaitMode != KernelMode) &&
-                    (Thread->ApcState.UserApcPending))
+                /* Fail if we were alerted or there's a User APC Pending */
+                Status = KiCheckAlertability(Thread, Alertable, WaitMode);
+                if (Status != STATUS_WAIT_0)
                 {
                     /* Return the status and increase the pending threads */
-                    QueueEntry = (PLIST_ENTRY)STATUS_USER_APC;
+                    EntryArray[Removed++] = (PLIST_ENTRY)Status;
                     Queue->CurrentCount++;
                     break;
                 }
@@ -362,7 +399,7 @@ KeRemoveQueue(IN PKQUEUE Queue,
                     if ((ULONG64)InterruptTime.QuadPart >= Timer->DueTime.QuadPart)
                     {
                         /* It did, so we don't need to wait */
-                        QueueEntry = (PLIST_ENTRY)STATUS_TIMEOUT;
+                        EntryArray[Removed++] = (PLIST_ENTRY)STATUS_TIMEOUT;
                         Queue->CurrentCount++;
                         break;
                     }
@@ -404,7 +441,23 @@ KeRemoveQueue(IN PKQUEUE Queue,
                 Thread->WaitReason = 0;
 
                 /* Check if we were executing an APC */
-                if (Status != STATUS_KERNEL_APC) return (PLIST_ENTRY)Status;
+                if (Status != STATUS_KERNEL_APC)
+                {
+                    /* We got an entry handed over, or the wait failed */
+                    EntryArray[Removed++] = (PLIST_ENTRY)Status;
+                    if ((Count == 1) || KiIsQueueWaitStatus(Status)) return Removed;
+
+                    /* Pick up whatever else was queued meanwhile */
+                    OldIrql = KeRaiseIrqlToSynchLevel();
+                    KiAcquireDispatcherLockAtSynchLevel();
+                    while ((Removed < Count) && !IsListEmpty(&Queue->EntryListHead))
+                    {
+                        EntryArray[Removed++] = KiRemoveQueueEntry(Queue);
+                    }
+                    KiReleaseDispatcherLockFromSynchLevel();
+                    KiExitDispatcher(OldIrql);
+                    return Removed;
+                }
 
                 /* Check if we had a timeout */
                 if (Timeout)
@@ -419,6 +472,7 @@ KeRemoveQueue(IN PKQUEUE Queue,
             /* Start another wait */
             Thread->WaitIrql = KeRaiseIrqlToSynchLevel();
             KxQueueThreadWait();
+            Thread->Alertable = Alertable;
             KiAcquireDispatcherLockAtSynchLevel();
             Queue->CurrentCount--;
         }
@@ -427,6 +481,22 @@ KeRemoveQueue(IN PKQUEUE Queue,
     /* Unlock Database and return */
     KiReleaseDispatcherLockFromSynchLevel();
     KiExitDispatcher(Thread->WaitIrql);
+    return Removed;
+}
+
+/*
+ * @implemented
+ */
+PLIST_ENTRY
+NTAPI
+KeRemoveQueue(IN PKQUEUE Queue,
+              IN KPROCESSOR_MODE WaitMode,
+              IN PLARGE_INTEGER Timeout OPTIONAL)
+{
+    PLIST_ENTRY QueueEntry;
+
+    /* Remove a single entry, a failed wait leaves its status in its place */
+    KeRemoveQueueEx(Queue, WaitMode, FALSE, Timeout, &QueueEntry, 1);
     return QueueEntry;
 }
 
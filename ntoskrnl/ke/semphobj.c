@@ -62,8 +62,39 @@ KeReleaseSemaphore(IN PKSEMAPHORE Semaphore,
     ASSERT_SEMAPHORE(Semaphore);
     ASSERT_IRQL_LESS_OR_EQUAL(DISPATCH_LEVEL);
 
+    /* Without waiters, releasing wakes nobody, so try to lock only the semaphore */
+    OldIrql = KeRaiseIrqlToSynchLevel();
+    if (!(Wait) && (KiTryEnterDispatcherObject(&Semaphore->Header)))
+    {
+        /* Waiters can only be added under the dispatcher lock */
+        if (IsListEmpty(&Semaphore->Header.WaitListHead))
+        {
+            /* Save the Old State and get new one */
+            InitialState = Semaphore->Header.SignalState;
+            State = InitialState + Adjustment;
+
+            /* Check if the Limit was exceeded */
+            if ((Semaphore->Limit < State) || (InitialState > State))
+            {
+                /* Raise an error if it was exceeded */
+                KiLeaveDispatcherObject(&Semaphore->Header);
+                KeLowerIrql(OldIrql);
+                ExRaiseStatus(STATUS_SEMAPHORE_LIMIT_EXCEEDED);
+            }
+
+            /* Now set the new state, unlock the semaphore and return */
+            Semaphore->Header.SignalState = State;
+            KiLeaveDispatcherObject(&Semaphore->Header);
+            KeLowerIrql(OldIrql);
+            return InitialState;
+        }
+
+        /* Somebody has to be woken up */
+        KiLeaveDispatcherObject(&Semaphore->Header);
+    }
+
     /* Lock the Dispatcher Database */
-    OldIrql = KiAcquireDispatcherLock();
+    KiAcquireDispatcherLockAtSynchLevel();
 
     /* Save the Old State and get new one */
     InitialState = Semaphore->Header.SignalState;
@@ -44,9 +44,9 @@ KiCheckForTimerExpiration(
 {
     ULONG Hand;
 
-    /* Check for timer expiration */
+    /* Check for timer expiration in this processor's table */
     Hand = KeTickCount.LowPart & (TIMER_TABLE_SIZE - 1);
-    if (KiTimerTableListHead[Hand].Time.QuadPart <= InterruptTime.QuadPart)
+    if (KiTimerTable[Prcb->Number]->Entry[Hand].Time.QuadPart <= InterruptTime.QuadPart)
     {
         /* Check if we are already doing expiration */
         if (!Prcb->TimerRequest)
@@ -59,94 +59,14 @@ KiCheckForTimerExpiration(
     }
 }
 
+FORCEINLINE
 VOID
-FASTCALL
-KeUpdateSystemTime(IN PKTRAP_FRAME TrapFrame,
-                   IN ULONG Increment,
-                   IN KIRQL Irql)
-{
-    PKPRCB Prcb = KeGetCurrentPrcb();
-    ULARGE_INTEGER CurrentTime, InterruptTime;
-    LONG OldTickOffset;
-
-    /* Check if this tick is being skipped */
-    if (Prcb->SkipTick)
-    {
-        /* Handle it next time */
-        Prcb->SkipTick = FALSE;
-
-        /* Increase interrupt count and end the interrupt */
-        Prcb->InterruptCount++;
-
-#ifdef _M_IX86 // x86 optimization
-        KiEndInterrupt(Irql, TrapFrame);
-#endif
-
-        /* Note: non-x86 return back to the caller! */
-        return;
-    }
-
-    /* Add the increment time to the shared data */
-    InterruptTime.QuadPart = *(ULONGLONG*)&SharedUserData->InterruptTime;
-    InterruptTime.QuadPart += Increment;
-    KiWriteSystemTime(&SharedUserData->InterruptTime, InterruptTime);
-
-    /* Check for timer expiration */
-    KiCheckForTimerExpiration(Prcb, TrapFrame, InterruptTime);
-
-    /* Update the tick offset */
-    OldTickOffset = InterlockedExchangeAdd(&KiTickOffset, -(LONG)Increment);
-
-    /* If the debugger is enabled, check for break-in request */
-    if (KdDebuggerEnabled && KdPollBreakIn())
-    {
-        /* Break-in requested! */
-        DbgBreakPointWithStatus(DBG_STATUS_CONTROL_C);
-    }
-
-    /* Check for full tick */
-    if (OldTickOffset <= (LONG)Increment)
-    {
-        /* Update the system time */
-        CurrentTime.QuadPart = *(ULONGLONG*)&SharedUserData->SystemTime;
-        CurrentTime.QuadPart += KeTimeAdjustment;
-        KiWriteSystemTime(&SharedUserData->SystemTime, CurrentTime);
-
-        /* Update the tick count */
-        CurrentTime.QuadPart = (*(ULONGLONG*)&KeTickCount) + 1;
-        KiWriteSystemTime(&KeTickCount, CurrentTime);
-
-        /* Update it in the shared user data */
-        KiWriteSystemTime(&SharedUserData->TickCount, CurrentTime);
-
-        /* Check for expiration with the new tick count as well */
-        KiCheckForTimerExpiration(Prcb, TrapFrame, InterruptTime);
-
-        /* Reset the tick offset */
-        KiTickOffset += KeMaximumIncrement;
-
-        /* Update processor/thread runtime */
-        KeUpdateRunTime(TrapFrame, Irql);
-    }
-    else
-    {
-        /* Increase interrupt count only */
-        Prcb->InterruptCount++;
-    }
-
-#ifdef _M_IX86 // x86 optimization
-    /* Disable interrupts and end the interrupt */
-    KiEndInterrupt(Irql, TrapFrame);
-#endif
-}
-
-VOID
-NTAPI
-KeUpdateRunTime(IN PKTRAP_FRAME TrapFrame,
-                IN KIRQL Irql)
+KiUpdateRunTime(
+    PKPRCB Prcb,
+    PKTRAP_FRAME TrapFrame,
+    KIRQL Irql)
 {
     PKTHREAD Thread = KeGetCurrentThread();
-    PKPRCB Prcb = KeGetCurrentPrcb();
 
     /* Check if this tick is being skipped */
     if (Prcb->SkipTick)
@@ -255,3 +175,119 @@ KeUpdateRunTime(IN PKTRAP_FRAME TrapFrame,
         HalRequestSoftwareInterrupt(DISPATCH_LEVEL);
     }
 }
+
+VOID
+FASTCALL
+KeUpdateSystemTime(IN PKTRAP_FRAME TrapFrame,
+                   IN ULONG Increment,
+                   IN KIRQL Irql)
+{
+    PKPRCB Prcb = KeGetCurrentPrcb();
+    ULARGE_INTEGER CurrentTime, InterruptTime;
+    LONG OldTickOffset;
+
+    /* Check if this tick is being skipped */
+    if (Prcb->SkipTick)
+    {
+        /* Handle it next time */
+        Prcb->SkipTick = FALSE;
+
+        /* Increase interrupt count and end the interrupt */
+        Prcb->InterruptCount++;
+
+#ifdef _M_IX86 // x86 optimization
+        KiEndInterrupt(Irql, TrapFrame);
+#endif
+
+        /* Note: non-x86 return back to the caller! */
+        return;
+    }
+
+    /* Add the increment time to the shared data */
+    InterruptTime.QuadPart = *(ULONGLONG*)&SharedUserData->InterruptTime;
+    InterruptTime.QuadPart += Increment;
+    KiWriteSystemTime(&SharedUserData->InterruptTime, InterruptTime);
+
+    /* Check for timer expiration */
+    KiCheckForTimerExpiration(Prcb, TrapFrame, InterruptTime);
+
+    /* Update the tick offset */
+    OldTickOffset = InterlockedExchangeAdd(&KiTickOffset, -(LONG)Increment);
+
+    /* If the debugger is enabled, check for break-in request */
+    if (KdDebuggerEnabled && KdPollBreakIn())
+    {
+        /* Break-in requested! */
+        DbgBreakPointWithStatus(DBG_STATUS_CONTROL_C);
+    }
+
+    /* Check for full tick */
+    if (OldTickOffset <= (LONG)Increment)
+    {
+        /* Update the system time */
+        CurrentTime.QuadPart = *(ULONGLONG*)&SharedUserData->SystemTime;
+        CurrentTime.QuadPart += KeTimeAdjustment;
+        KiWriteSystemTime(&SharedUserData->SystemTime, CurrentTime);
+
+        /* Update the tick count */
+        CurrentTime.QuadPart = (*(ULONGLONG*)&KeTickCount) + 1;
+        KiWriteSystemTime(&KeTickCount, CurrentTime);
+
+        /* Update it in the shared user data */
+        KiWriteSystemTime(&SharedUserData->TickCount, CurrentTime);
+
+        /* Check for expiration with the new tick count as well */
+        KiCheckForTimerExpiration(Prcb, TrapFrame, InterruptTime);
+
+        /* Reset the tick offset */
+        KiTickOffset += KeMaximumIncrement;
+
+        /* Update processor/thread runtime */
+        KiUpdateRunTime(Prcb, TrapFrame, Irql);
+    }
+    else
+    {
+        /* Increase interrupt count only */
+        Prcb->InterruptCount++;
+    }
+
+#ifdef _M_IX86 // x86 optimization
+    /* Disable interrupts and end the interrupt */
+    KiEndInterrupt(Irql, TrapFrame);
+#endif
+}
+
+VOID
+NTAPI
+KeUpdateRunTime(IN PKTRAP_FRAME TrapFrame,
+                IN KIRQL Irql)
+{
+    PKPRCB Prcb = KeGetCurrentPrcb();
+    ULARGE_INTEGER InterruptTime;
+    PKI_TIMER_TABLE TimerTable;
+    ULONG Hand;
+
+    /*
+     * This processor doesn't take the clock interrupt, so check its own timer
+     * table here. The clock IPI may arrive before the clock processor updates
+     * the tick count, so look at the hand before the current one as well.
+     */
+    if (!Prcb->TimerRequest)
+    {
+        InterruptTime.QuadPart = KeQueryInterruptTime();
+        TimerTable = KiTimerTable[Prcb->Number];
+        Hand = (KeTickCount.LowPart - 1) & (TIMER_TABLE_SIZE - 1);
+        if ((TimerTable->Entry[Hand].Time.QuadPart <= InterruptTime.QuadPart) ||
+            (TimerTable->Entry[(Hand + 1) & (TIMER_TABLE_SIZE - 1)].Time.QuadPart <=
+             InterruptTime.QuadPart))
+        {
+            /* Request a DPC to handle this */
+            Prcb->TimerRequest = (ULONG_PTR)TrapFrame;
+            Prcb->TimerHand = Hand;
+            HalRequestSoftwareInterrupt(DISPATCH_LEVEL);
+        }
+    }
+
+    /* Update processor/thread runtime */
+    KiUpdateRunTime(Prcb, TrapFrame, Irql);
+}
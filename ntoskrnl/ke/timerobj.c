@@ -14,7 +14,8 @@
 
 /* GLOBALS *******************************************************************/
 
-KTIMER_TABLE_ENTRY KiTimerTableListHead[TIMER_TABLE_SIZE];
+KI_TIMER_TABLE KiBootTimerTable;
+PKI_TIMER_TABLE KiTimerTable[MAXIMUM_PROCESSORS] = { &KiBootTimerTable };
 LARGE_INTEGER KiTimeIncrementReciprocal;
 UCHAR KiTimeIncrementShiftCount;
 BOOLEAN KiEnableTimerWatchdog = FALSE;
@@ -34,6 +35,9 @@ KiInsertTreeTimer(IN PKTIMER Timer,
     /* Setup the timer's due time */
     if (KiComputeDueTime(Timer, Interval, &Hand))
     {
+        /* The timer goes into this processor's table */
+        KiSetTimerProcessor(Timer, KeGetCurrentProcessorNumber());
+
         /* Acquire the lock */
         LockQueue = KiAcquireTimerLock(Hand);
 
@@ -68,16 +72,19 @@ KiInsertTimerTable(IN PKTIMER Timer,
     BOOLEAN Expired = FALSE;
     PLIST_ENTRY ListHead, NextEntry;
     PKTIMER CurrentTimer;
+    PKTIMER_TABLE_ENTRY TableEntry;
     DPRINT("KiInsertTimerTable(): Timer %p, Hand: %lu\n", Timer, Hand);
 
     /* Check if the period is zero */
     if (!Timer->Period) Timer->Header.SignalState = FALSE;
 
-    /* Sanity check */
+    /* Sanity checks */
     ASSERT(Hand == KiComputeTimerTableIndex(DueTime));
+    ASSERT(KiGetTimerProcessor(Timer) == KeGetCurrentProcessorNumber());
 
     /* Loop the timer list backwards */
-    ListHead = &KiTimerTableListHead[Hand].Entry;
+    TableEntry = &KiTimerTable[KiGetTimerProcessor(Timer)]->Entry[Hand];
+    ListHead = &TableEntry->Entry;
     NextEntry = ListHead->Blink;
     while (NextEntry != ListHead)
     {
@@ -98,7 +105,7 @@ KiInsertTimerTable(IN PKTIMER Timer,
     if (NextEntry == ListHead)
     {
         /* Set the time */
-        KiTimerTableListHead[Hand].Time.QuadPart = DueTime;
+        TableEntry->Time.QuadPart = DueTime;
 
         /* Make sure it hasn't expired already */
         InterruptTime = KeQueryInterruptTime();
@@ -116,7 +123,7 @@ KiSignalTimer(IN PKTIMER Timer)
     BOOLEAN RequestInterrupt = FALSE;
     PKDPC Dpc = Timer->Dpc;
     ULONG Period = Timer->Period;
-    LARGE_INTEGER Interval, SystemTime;
+    LARGE_INTEGER SystemTime;
     DPRINT("KiSignalTimer(): Timer %p\n", Timer);
 
     /* Set default values */
@@ -139,13 +146,8 @@ KiSignalTimer(IN PKTIMER Timer)
         }
     }
 
-    /* Check if we have a period */
-    if (Period)
-    {
-        /* Calculate the interval and insert the timer */
-        Interval.QuadPart = Int32x32To64(Period, -10000);
-        while (!KiInsertTreeTimer(Timer, Interval));
-    }
+    /* Check if we have a period, and insert the timer again */
+    if (Period) KiInsertPeriodicTimer(Timer);
 
     /* Check if we have a DPC */
     if (Dpc)
@@ -196,6 +198,145 @@ KiCompleteTimer(IN PKTIMER Timer,
     if (RequestInterrupt) HalRequestSoftwareInterrupt(DISPATCH_LEVEL);
 }
 
+VOID
+FASTCALL
+KiInsertPeriodicTimer(IN PKTIMER Timer)
+{
+    LARGE_INTEGER Interval;
+    ULONGLONG Period, DueTime, InterruptTime;
+    PKSPIN_LOCK_QUEUE LockQueue;
+    ULONG Hand;
+    DPRINT("KiInsertPeriodicTimer(): Timer %p, Period %lu\n", Timer, Timer->Period);
+
+    /* Check if this is a regular periodic timer */
+    if (!Timer->Header.Coalescable)
+    {
+        /* Calculate the interval and insert the timer */
+        Interval.QuadPart = Int32x32To64(Timer->Period, -10000);
+        while (!KiInsertTreeTimer(Timer, Interval));
+        return;
+    }
+
+    /*
+     * A coalesced timer keeps the phase it was aligned to, instead of drifting
+     * by its expiration latency, so it keeps expiring along with its neighbours
+     */
+    Period = UInt32x32To64(Timer->Period, 10000);
+    DueTime = Timer->DueTime.QuadPart;
+    Timer->Header.Absolute = FALSE;
+    KiSetTimerProcessor(Timer, KeGetCurrentProcessorNumber());
+    for (;;)
+    {
+        /* Move to the next period, skipping the ones which were missed */
+        DueTime += Period;
+        InterruptTime = KeQueryInterruptTime();
+        if (DueTime <= InterruptTime)
+        {
+            DueTime += ((InterruptTime - DueTime) / Period + 1) * Period;
+        }
+
+        /* Set the new due time and hand */
+        Timer->DueTime.QuadPart = DueTime;
+        Hand = KiComputeTimerTableIndex(DueTime);
+        Timer->Header.Hand = (UCHAR)Hand;
+        Timer->Header.Inserted = TRUE;
+
+        /* Insert the timer, and we're done unless it expired meanwhile */
+        LockQueue = KiAcquireTimerLock(Hand);
+        if (!KiInsertTimerTable(Timer, Hand))
+        {
+            KiReleaseTimerLock(LockQueue);
+            break;
+        }
+
+        /* Take it out again and try the next period */
+        KiRemoveEntryTimer(Timer);
+        Timer->Header.Inserted = FALSE;
+        KiReleaseTimerLock(LockQueue);
+    }
+}
+
+static
+VOID
+KiCoalesceTimer(IN PKTIMER Timer,
+                IN ULONG TolerableDelay,
+                IN OUT PULONG Hand)
+{
+    ULONGLONG Delay, Boundary, DueTime;
+
+    /* Timers which expire within the same clock tick are already expired together */
+    Delay = UInt32x32To64(TolerableDelay, 10000);
+    Boundary = KeMaximumIncrement;
+    if (Boundary > Delay) return;
+
+    /* Use the coarsest power of two of clock ticks the caller can tolerate */
+    while ((Boundary << 1) <= Delay) Boundary <<= 1;
+
+    /* Push the due time out to that boundary, where the neighbours expire too */
+    DueTime = Timer->DueTime.QuadPart + Boundary - 1;
+    DueTime -= DueTime % Boundary;
+    Timer->DueTime.QuadPart = DueTime;
+
+    /* Recalculate the hand */
+    *Hand = KiComputeTimerTableIndex(DueTime);
+    Timer->Header.Hand = (UCHAR)*Hand;
+    Timer->Header.Coalescable = TRUE;
+}
+
+static
+BOOLEAN
+KiSetTimerEx(IN OUT PKTIMER Timer,
+             IN LARGE_INTEGER DueTime,
+             IN LONG Period,
+             IN ULONG TolerableDelay,
+             IN PKDPC Dpc OPTIONAL)
+{
+    KIRQL OldIrql;
+    BOOLEAN Inserted;
+    ULONG Hand = 0;
+    BOOLEAN RequestInterrupt = FALSE;
+    ASSERT_TIMER(Timer);
+    ASSERT(KeGetCurrentIrql() <= DISPATCH_LEVEL);
+
+    /* Lock the Database and Raise IRQL */
+    OldIrql = KiAcquireDispatcherLock();
+
+    /* Check if it's inserted, and remove it if it is */
+    Inserted = Timer->Header.Inserted;
+    if (Inserted) KxRemoveTreeTimer(Timer);
+
+    /* Set Default Timer Data */
+    Timer->Dpc = Dpc;
+    Timer->Period = Period;
+    Timer->Header.Coalescable = FALSE;
+    if (!KiComputeDueTime(Timer, DueTime, &Hand))
+    {
+        /* Signal the timer */
+        RequestInterrupt = KiSignalTimer(Timer);
+
+        /* Release the dispatcher lock */
+        KiReleaseDispatcherLockFromSynchLevel();
+
+        /* Check if we need to do an interrupt */
+        if (RequestInterrupt) HalRequestSoftwareInterrupt(DISPATCH_LEVEL);
+    }
+    else
+    {
+        /* Align the due time with other timers, if the caller allows it */
+        if (TolerableDelay) KiCoalesceTimer(Timer, TolerableDelay, &Hand);
+
+        /* Insert the timer */
+        Timer->Header.SignalState = FALSE;
+        KxInsertTimer(Timer, Hand);
+    }
+
+    /* Exit the dispatcher */
+    KiExitDispatcher(OldIrql);
+
+    /* Return old state */
+    return Inserted;
+}
+
 /* PUBLIC FUNCTIONS **********************************************************/
 
 /*
@@ -297,47 +438,28 @@ KeSetTimerEx(IN OUT PKTIMER Timer,
              IN LONG Period,
              IN PKDPC Dpc OPTIONAL)
 {
-    KIRQL OldIrql;
-    BOOLEAN Inserted;
-    ULONG Hand = 0;
-    BOOLEAN RequestInterrupt = FALSE;
-    ASSERT_TIMER(Timer);
-    ASSERT(KeGetCurrentIrql() <= DISPATCH_LEVEL);
     DPRINT("KeSetTimerEx(): Timer %p, DueTime %I64d, Period %d, Dpc %p\n",
            Timer, DueTime.QuadPart, Period, Dpc);
 
-    /* Lock the Database and Raise IRQL */
-    OldIrql = KiAcquireDispatcherLock();
-
-    /* Check if it's inserted, and remove it if it is */
-    Inserted = Timer->Header.Inserted;
-    if (Inserted) KxRemoveTreeTimer(Timer);
-
-    /* Set Default Timer Data */
-    Timer->Dpc = Dpc;
-    Timer->Period = Period;
-    if (!KiComputeDueTime(Timer, DueTime, &Hand))
-    {
-        /* Signal the timer */
-        RequestInterrupt = KiSignalTimer(Timer);
-
-        /* Release the dispatcher lock */
-        KiReleaseDispatcherLockFromSynchLevel();
-
-        /* Check if we need to do an interrupt */
-        if (RequestInterrupt) HalRequestSoftwareInterrupt(DISPATCH_LEVEL);
-    }
-    else
-    {
-        /* Insert the timer */
-        Timer->Header.SignalState = FALSE;
-        KxInsertTimer(Timer, Hand);
-    }
+    /* Call the internal function, without any tolerance */
+    return KiSetTimerEx(Timer, DueTime, Period, 0, Dpc);
+}
 
-    /* Exit the dispatcher */
-    KiExitDispatcher(OldIrql);
+/*
+ * @implemented
+ */
+BOOLEAN
+NTAPI
+KeSetCoalescableTimer(IN OUT PKTIMER Timer,
+                      IN LARGE_INTEGER DueTime,
+                      IN ULONG Period,
+                      IN ULONG TolerableDelay,
+                      IN PKDPC Dpc OPTIONAL)
+{
+    DPRINT("KeSetCoalescableTimer(): Timer %p, DueTime %I64d, Period %lu, TolerableDelay %lu, Dpc %p\n",
+           Timer, DueTime.QuadPart, Period, TolerableDelay, Dpc);
 
-    /* Return old state */
-    return Inserted;
+    /* Call the internal function, letting it delay the timer up to the tolerance */
+    return KiSetTimerEx(Timer, DueTime, (LONG)Period, TolerableDelay, Dpc);
 }
 
@@ -438,11 +438,64 @@ KeWaitForSingleObject(IN PVOID Object,
                 Timeout && Timeout->QuadPart == 0));
 
     /* Check if the lock is already held */
-    if (!Thread->WaitNext) goto WaitStart;
+    if (!Thread->WaitNext)
+    {
+        /*
+         * Polling an object which isn't signaled doesn't change any state, so
+         * it doesn't need the dispatcher lock, only the object. A mutant we
+         * own can't be released behind our back, nor can one we don't own
+         * become ours, so reading its owner without the lock is safe too.
+         */
+        if ((Timeout) && !(Timeout->QuadPart) && !(Alertable) &&
+            ((WaitMode == KernelMode) || !(Thread->ApcState.UserApcPending)))
+        {
+            KeMemoryBarrier();
+            if ((CurrentObject->Header.SignalState <= 0) &&
+                (((CurrentObject->Header.Type & KOBJECT_TYPE_MASK) != MutantObject) ||
+                 (CurrentObject->OwnerThread != Thread)))
+            {
+                /* Adjust the Quantum like any other wait, and time out */
+                Thread->WaitIrql = KeRaiseIrqlToSynchLevel();
+                KiAdjustQuantumThread(Thread);
+                return STATUS_TIMEOUT;
+            }
+        }
 
-    /*  Otherwise, we already have the lock, so initialize the wait */
-    Thread->WaitNext = FALSE;
-    KxSingleThreadWait();
+        /*
+         * Acquiring a signaled event or semaphore doesn't block us nor wake
+         * anybody, so it only needs the object. Mutants also change their
+         * owner's state, and timers are locked by their timer table instead.
+         */
+        Thread->WaitIrql = KeRaiseIrqlToSynchLevel();
+        if ((((CurrentObject->Header.Type & KOBJECT_TYPE_MASK) == EventNotificationObject) ||
+             ((CurrentObject->Header.Type & KOBJECT_TYPE_MASK) == EventSynchronizationObject) ||
+             ((CurrentObject->Header.Type & KOBJECT_TYPE_MASK) == SemaphoreObject)) &&
+            (KiTryEnterDispatcherObject(&CurrentObject->Header)))
+        {
+            /* Check its signal state now that we own it */
+            if (CurrentObject->Header.SignalState > 0)
+            {
+                /* Satisfy it, unlock it and adjust the quantum */
+                KiSatisfyNonMutantWait(CurrentObject);
+                KiLeaveDispatcherObject(&CurrentObject->Header);
+                KiAdjustQuantumThread(Thread);
+                return STATUS_WAIT_0;
+            }
+
+            /* We'll have to wait for it */
+            KiLeaveDispatcherObject(&CurrentObject->Header);
+        }
+
+        /* Set up the wait and lock the dispatcher */
+        KxSingleThreadWait();
+        KiAcquireDispatcherLockAtSynchLevel();
+    }
+    else
+    {
+        /*  Otherwise, we already have the lock, so initialize the wait */
+        Thread->WaitNext = FALSE;
+        KxSingleThreadWait();
+    }
 
     /* Start wait loop */
     for (;;)
@@ -558,7 +611,7 @@ KeWaitForSingleObject(IN PVOID Object,
                                                &NewDueTime);
             }
         }
-WaitStart:
+
         /* Setup a new wait */
         Thread->WaitIrql = KeRaiseIrqlToSynchLevel();
         KxSingleThreadWait();
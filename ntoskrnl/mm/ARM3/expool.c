@@ -47,6 +47,7 @@ SIZE_T PoolTrackTableSize, PoolTrackTableMask;
 SIZE_T PoolBigPageTableSize, PoolBigPageTableHash;
 ULONG ExpBigTableExpansionFailed;
 PPOOL_TRACKER_TABLE PoolTrackTable;
+PPOOL_TRACKER_TABLE ExPoolTagTables[MAXIMUM_PROCESSORS];
 PPOOL_TRACKER_BIG_PAGES PoolBigPageTable;
 KSPIN_LOCK ExpTaggedPoolLock;
 ULONG PoolHitTag;
@@ -470,6 +471,52 @@ ExpComputePartialHashForAddress(IN PVOID BaseAddress)
     return (Result >> 24) ^ (Result >> 16) ^ (Result >> 8) ^ Result;
 }
 
+FORCEINLINE
+PPOOL_TRACKER_TABLE
+ExpGetProcessorPoolTracker(IN ULONG Hash,
+                           IN PPOOL_TRACKER_TABLE TableEntry)
+{
+    PPOOL_TRACKER_TABLE ProcessorTable;
+
+    //
+    // The global table owns the keys, but on MP systems the counters are kept
+    // in a table per processor, so that charging a tag only ever writes to a
+    // cache line local to this processor. We may get rescheduled elsewhere
+    // after reading the number, which is why the counters stay interlocked.
+    //
+    ProcessorTable = ExPoolTagTables[KeGetCurrentProcessorNumber()];
+    return ProcessorTable ? &ProcessorTable[Hash] : TableEntry;
+}
+
+static
+VOID
+ExpCollectPoolTracker(IN SIZE_T Index,
+                      OUT PPOOL_TRACKER_TABLE Tracker)
+{
+    PPOOL_TRACKER_TABLE ProcessorEntry;
+    ULONG i;
+
+    //
+    // Start with what was charged before the processor tables existed, then
+    // add up every processor's share. A block freed on another processor than
+    // the one that allocated it makes individual shares negative, but never
+    // the total.
+    //
+    *Tracker = PoolTrackTable[Index];
+    for (i = 0; i < (ULONG)KeNumberProcessors; i++)
+    {
+        if (!ExPoolTagTables[i]) continue;
+
+        ProcessorEntry = &ExPoolTagTables[i][Index];
+        Tracker->NonPagedAllocs += ProcessorEntry->NonPagedAllocs;
+        Tracker->NonPagedFrees += ProcessorEntry->NonPagedFrees;
+        Tracker->NonPagedBytes += ProcessorEntry->NonPagedBytes;
+        Tracker->PagedAllocs += ProcessorEntry->PagedAllocs;
+        Tracker->PagedFrees += ProcessorEntry->PagedFrees;
+        Tracker->PagedBytes += ProcessorEntry->PagedBytes;
+    }
+}
+
 #if DBG
 /*
  * FORCEINLINE
@@ -538,9 +585,11 @@ MiDumpPoolConsumers(BOOLEAN CalledFromDbg, ULONG Tag, ULONG Mask, ULONG Flags)
     //
     for (i = 0; i < PoolTrackTableSize; ++i)
     {
+        POOL_TRACKER_TABLE Tracker;
         PPOOL_TRACKER_TABLE TableEntry;
 
-        TableEntry = &PoolTrackTable[i];
+        ExpCollectPoolTracker(i, &Tracker);
+        TableEntry = &Tracker;
 
         //
         // We only care about tags which have allocated memory
@@ -806,6 +855,7 @@ ExpRemovePoolTracker(IN ULONG Key,
             // Decrement the counters depending on if this was paged or nonpaged
             // pool
             //
+            TableEntry = ExpGetProcessorPoolTracker(Hash, TableEntry);
             if ((PoolType & BASE_POOL_TYPE_MASK) == NonPagedPool)
             {
                 InterlockedIncrement(&TableEntry->NonPagedFrees);
@@ -908,6 +958,7 @@ ExpInsertPoolTracker(IN ULONG Key,
             // Increment the counters depending on if this was paged or nonpaged
             // pool
             //
+            TableEntry = ExpGetProcessorPoolTracker(Hash, TableEntry);
             if ((PoolType & BASE_POOL_TYPE_MASK) == NonPagedPool)
             {
                 InterlockedIncrement(&TableEntry->NonPagedAllocs);
@@ -1268,6 +1319,36 @@ InitializePool(IN POOL_TYPE PoolType,
     }
 }
 
+CODE_SEG("INIT")
+VOID
+NTAPI
+ExpInitializeProcessorPoolTrackers(VOID)
+{
+    PPOOL_TRACKER_TABLE Table;
+    ULONG i;
+
+    //
+    // With a single processor there is no cache line to fight over
+    //
+    if (KeNumberProcessors == 1) return;
+
+    //
+    // Give each processor a counter table with the same layout as the global
+    // one. If we run out of memory, that processor keeps charging the global
+    // table, which is still correct, just slower.
+    //
+    for (i = 0; i < (ULONG)KeNumberProcessors; i++)
+    {
+        Table = ExAllocatePoolWithTag(NonPagedPool,
+                                      PoolTrackTableSize * sizeof(POOL_TRACKER_TABLE),
+                                      'looP');
+        if (!Table) continue;
+
+        RtlZeroMemory(Table, PoolTrackTableSize * sizeof(POOL_TRACKER_TABLE));
+        InterlockedExchangePointer((PVOID*)&ExPoolTagTables[i], Table);
+    }
+}
+
 FORCEINLINE
 KIRQL
 ExLockPool(IN PPOOL_DESCRIPTOR Descriptor)
@@ -1324,17 +1405,21 @@ ExpGetPoolTagInfoTarget(IN PKDPC Dpc,
                         IN PVOID SystemArgument2)
 {
     PPOOL_DPC_CONTEXT Context = DeferredContext;
+    SIZE_T i;
     UNREFERENCED_PARAMETER(Dpc);
     ASSERT(KeGetCurrentIrql() == DISPATCH_LEVEL);
 
     //
-    // Make sure we win the race, and if we did, copy the data atomically
+    // Make sure we win the race, and if we did, merge the global and the
+    // per-processor data atomically, since every other processor is now
+    // spinning at DISPATCH_LEVEL and cannot allocate pool
     //
     if (KeSignalCallDpcSynchronize(SystemArgument2))
     {
-        RtlCopyMemory(Context->PoolTrackTable,
-                      PoolTrackTable,
-                      Context->PoolTrackTableSize * sizeof(POOL_TRACKER_TABLE));
+        for (i = 0; i < Context->PoolTrackTableSize; i++)
+        {
+            ExpCollectPoolTracker(i, &Context->PoolTrackTable[i]);
+        }
 
         //
         // This is here because ReactOS does not yet support expansion
@@ -1912,7 +1997,7 @@ ExAllocatePoolWithTag(IN POOL_TYPE PoolType,
     USHORT BlockSize, i;
     ULONG OriginalType;
     PKPRCB Prcb = KeGetCurrentPrcb();
-    PGENERAL_LOOKASIDE LookasideList;
+    PGENERAL_LOOKASIDE LookasideList, GlobalList;
 
     //
     // Some sanity checks
@@ -2096,13 +2181,18 @@ ExAllocatePoolWithTag(IN POOL_TYPE PoolType,
         if (!Entry)
         {
             //
-            // We failed, try popping it from the global list
+            // We failed, try popping it from the global list, unless this
+            // processor has no list of its own and we just tried it
             //
-            LookasideList = (PoolType == PagedPool) ?
-                             Prcb->PPPagedLookasideList[i - 1].L :
-                             Prcb->PPNPagedLookasideList[i - 1].L;
-            LookasideList->TotalAllocates++;
-            Entry = (PPOOL_HEADER)InterlockedPopEntrySList(&LookasideList->ListHead);
+            GlobalList = (PoolType == PagedPool) ?
+                          Prcb->PPPagedLookasideList[i - 1].L :
+                          Prcb->PPNPagedLookasideList[i - 1].L;
+            if (GlobalList != LookasideList)
+            {
+                LookasideList = GlobalList;
+                LookasideList->TotalAllocates++;
+                Entry = (PPOOL_HEADER)InterlockedPopEntrySList(&LookasideList->ListHead);
+            }
         }
 
         //
@@ -2503,7 +2593,7 @@ ExFreePoolWithTag(IN PVOID P,
     BOOLEAN Combined = FALSE;
     PFN_NUMBER PageCount, RealPageCount;
     PKPRCB Prcb = KeGetCurrentPrcb();
-    PGENERAL_LOOKASIDE LookasideList;
+    PGENERAL_LOOKASIDE LookasideList, GlobalList;
     PEPROCESS Process;
 
     //
@@ -2745,17 +2835,22 @@ ExFreePoolWithTag(IN PVOID P,
         }
 
         //
-        // We failed, try to push it into the global lookaside list
+        // We failed, try to push it into the global lookaside list, unless
+        // this processor has no list of its own and we just tried it
         //
-        LookasideList = (PoolType == PagedPool) ?
-                         Prcb->PPPagedLookasideList[BlockSize - 1].L :
-                         Prcb->PPNPagedLookasideList[BlockSize - 1].L;
-        LookasideList->TotalFrees++;
-        if (ExQueryDepthSList(&LookasideList->ListHead) < LookasideList->Depth)
+        GlobalList = (PoolType == PagedPool) ?
+                      Prcb->PPPagedLookasideList[BlockSize - 1].L :
+                      Prcb->PPNPagedLookasideList[BlockSize - 1].L;
+        if (GlobalList != LookasideList)
         {
-            LookasideList->FreeHits++;
-            InterlockedPushEntrySList(&LookasideList->ListHead, P);
-            return;
+            LookasideList = GlobalList;
+            LookasideList->TotalFrees++;
+            if (ExQueryDepthSList(&LookasideList->ListHead) < LookasideList->Depth)
+            {
+                LookasideList->FreeHits++;
+                InterlockedPushEntrySList(&LookasideList->ListHead, P);
+                return;
+            }
         }
     }
 
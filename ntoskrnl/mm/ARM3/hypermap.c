@@ -108,8 +108,10 @@ MiUnmapPageInHyperSpace(IN PEPROCESS Process,
 
 PVOID
 NTAPI
-MiMapPagesInZeroSpace(IN PMMPFN Pfn1,
-                      IN PFN_NUMBER NumberOfPages)
+MiMapPagesInZeroSpace(IN PMMPTE ZeroingPte,
+                      IN PMMPFN Pfn1,
+                      IN PFN_NUMBER NumberOfPages,
+                      IN BOOLEAN Cached)
 {
     MMPTE TempPte;
     PMMPTE PointerPte;
@@ -123,9 +125,10 @@ MiMapPagesInZeroSpace(IN PMMPFN Pfn1,
     ASSERT(NumberOfPages <= MI_ZERO_PTES);
 
     //
-    // Pick the first zeroing PTE
+    // Pick the first zeroing PTE of the caller's window. The first PTE
+    // of each window is the counter, the mappings follow it
     //
-    PointerPte = MiFirstReservedZeroingPte;
+    PointerPte = ZeroingPte;
 
     //
     // Now get the first free PTE
@@ -150,9 +153,13 @@ MiMapPagesInZeroSpace(IN PMMPFN Pfn1,
     PointerPte += (Offset + 1);
     TempPte = ValidKernelPte;
 
-    /* Disable cache. Write through */
-    MI_PAGE_DISABLE_CACHE(&TempPte);
-    MI_PAGE_WRITE_THROUGH(&TempPte);
+    /* Disable cache. Write through. Unless the caller uses non-temporal
+     * stores, which don't pollute the caches and are much faster on WB */
+    if (!Cached)
+    {
+        MI_PAGE_DISABLE_CACHE(&TempPte);
+        MI_PAGE_WRITE_THROUGH(&TempPte);
+    }
 
     /* Make sure the list isn't empty and loop it */
     ASSERT(Pfn1 != (PVOID)LIST_HEAD);
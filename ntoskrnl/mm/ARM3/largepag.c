@@ -25,18 +25,357 @@ WCHAR MmLargePageDriverBuffer[512] = {0};
 ULONG MmLargePageDriverBufferLength = -1;
 LIST_ENTRY MiLargePageDriverList;
 BOOLEAN MiLargePageAllDrivers;
+SIZE_T MmLargePageMinimum;
 
 /* FUNCTIONS ******************************************************************/
 
+#ifndef _M_ARM
+static
+VOID
+MiFreeLargePageFrames(
+    _In_ PFN_NUMBER PageFrameIndex)
+{
+    PMMPFN Pfn1;
+    ULONG i;
+
+    /* PFN lock must be held */
+    MI_ASSERT_PFN_LOCK_HELD();
+
+    /* Every page is freed as soon as its last reference (from an MDL) goes away */
+    Pfn1 = MiGetPfnEntry(PageFrameIndex);
+    for (i = 0; i < PTE_PER_PAGE; i++, Pfn1++, PageFrameIndex++)
+    {
+        ASSERT(Pfn1->u3.e1.PageLocation == ActiveAndValid);
+        ASSERT(Pfn1->u2.ShareCount == 1);
+        MI_SET_PFN_DELETED(Pfn1);
+        MiDecrementShareCount(Pfn1, PageFrameIndex);
+    }
+}
+
+static
+PFN_NUMBER
+MiAllocateLargePageFrames(VOID)
+{
+    PFN_NUMBER PageFrameIndex;
+    ULONG i;
+
+    /* Look for a free physical run that a single PDE can map */
+    PageFrameIndex = MiFindContiguousPages(0,
+                                           MmHighestPhysicalPage,
+                                           PTE_PER_PAGE,
+                                           PTE_PER_PAGE,
+                                           MmCached);
+    if (!PageFrameIndex) return 0;
+    ASSERT((PageFrameIndex & (PTE_PER_PAGE - 1)) == 0);
+
+    /* The run comes from the free and zeroed lists alike, so clear it all */
+    for (i = 0; i < PTE_PER_PAGE; i++)
+    {
+        MiZeroPhysicalPage(PageFrameIndex + i);
+    }
+
+    return PageFrameIndex;
+}
+
+static
+NTSTATUS
+MiMapLargePage(
+    _In_ PMMPDE PointerPde,
+    _In_ PFN_NUMBER PageFrameIndex,
+    _In_ ULONG ProtectionMask,
+    _In_ PEPROCESS Process)
+{
+    MMPDE TempPde;
+    PFN_NUMBER PdeFrame;
+    PMMPFN Pfn1;
+    KIRQL OldIrql;
+    ULONG i;
+
+    /* Working set must be exclusively locked */
+    ASSERT(MM_ANY_WS_LOCK_HELD_EXCLUSIVE(PsGetCurrentThread()));
+
+    /* Make the page directory itself exist, exactly like MiMakePdeExistAndMakeValid */
+#if _MI_PAGING_LEVELS == 4
+    if (!MiPdeToPxe(PointerPde)->u.Hard.Valid)
+    {
+        MiMakeSystemAddressValid(MiPdeToPpe(PointerPde), Process);
+    }
+#endif
+#if _MI_PAGING_LEVELS >= 3
+    if (!MiPdeToPpe(PointerPde)->u.Hard.Valid)
+    {
+        MiMakeSystemAddressValid(PointerPde, Process);
+    }
+#endif
+
+    /* Something already lives there, maybe a page table from a racing fault */
+    if (PointerPde->u.Long != 0) return STATUS_CONFLICTING_ADDRESSES;
+
+    /* Build a user large PDE by hand, MI_MAKE_HARDWARE_PTE_USER only takes real PTEs */
+    TempPde.u.Long = 0;
+    TempPde.u.Hard.Valid = 1;
+    TempPde.u.Hard.Owner = 1;
+    TempPde.u.Hard.LargePage = 1;
+    TempPde.u.Hard.PageFrameNumber = PageFrameIndex;
+    TempPde.u.Long |= MmProtectToPteMask[ProtectionMask];
+
+    /* These pages can never be trimmed, so don't make the CPU track them */
+    MI_MAKE_ACCESSED_PAGE(&TempPde);
+    MI_MAKE_DIRTY_PAGE(&TempPde);
+
+    /* Hook the pages to the page directory, like MiInitializePfn does for a PTE */
+    PdeFrame = PFN_FROM_PTE(MiAddressToPte(PointerPde));
+    OldIrql = MiAcquirePfnLock();
+    Pfn1 = MiGetPfnEntry(PageFrameIndex);
+    for (i = 0; i < PTE_PER_PAGE; i++, Pfn1++)
+    {
+        Pfn1->PteAddress = PointerPde;
+        Pfn1->OriginalPte = DemandZeroPte;
+        Pfn1->OriginalPte.u.Soft.Protection = ProtectionMask;
+        Pfn1->u3.e1.StartOfAllocation = 0;
+        Pfn1->u3.e1.EndOfAllocation = 0;
+        Pfn1->u3.e1.Modified = 1;
+        Pfn1->u3.e1.CacheAttribute = MiCached;
+        Pfn1->u4.PteFrame = PdeFrame;
+    }
+    MiGetPfnEntry(PdeFrame)->u2.ShareCount++;
+    MiReleasePfnLock(OldIrql);
+
+    /* Write the PDE and account for it in the page directory */
+    MI_WRITE_VALID_PDE(PointerPde, TempPde);
+#if _MI_PAGING_LEVELS >= 3
+    MiIncrementPageTableReferences(MiPdeToPte(PointerPde));
+#endif
+    return STATUS_SUCCESS;
+}
+#endif
+
+VOID
+NTAPI
+MiDeleteLargePde(
+    _In_ PMMPDE PointerPde,
+    _In_ PEPROCESS CurrentProcess)
+{
+#ifndef _M_ARM
+    MMPDE TempPde;
+    PFN_NUMBER PdeFrame;
+
+    /* PFN lock and working set must be held, like for MiDeletePde */
+    MI_ASSERT_PFN_LOCK_HELD();
+    ASSERT(MM_ANY_WS_LOCK_HELD_EXCLUSIVE(PsGetCurrentThread()));
+    ASSERT(CurrentProcess == PsGetCurrentProcess());
+    ASSERT(MiIsUserPde(PointerPde));
+
+    /* Capture the PDE, kill it and make sure no processor still uses it */
+    TempPde = *PointerPde;
+    ASSERT(MI_IS_PAGE_LARGE(&TempPde) && (TempPde.u.Hard.Valid == 1));
+    MI_ERASE_PTE(PointerPde);
+    KeFlushCurrentTb();
+
+    /* Release the pages, then our reference on the page directory */
+    PdeFrame = MiGetPfnEntry(PFN_FROM_PTE(&TempPde))->u4.PteFrame;
+    MiFreeLargePageFrames(PFN_FROM_PTE(&TempPde));
+    MiDecrementShareCount(MiGetPfnEntry(PdeFrame), PdeFrame);
+
+#if _MI_PAGING_LEVELS >= 3
+    /* Cascade down, see MiDeletePde */
+    if (MiDecrementPageTableReferences(MiPdeToPte(PointerPde)) == 0)
+    {
+        MiDeletePte(MiPdeToPpe(PointerPde), PointerPde, CurrentProcess, NULL);
+#if _MI_PAGING_LEVELS == 4
+        if (MiDecrementPageTableReferences(PointerPde) == 0)
+        {
+            MiDeletePte(MiPdeToPxe(PointerPde), MiPdeToPpe(PointerPde), CurrentProcess, NULL);
+        }
+#endif
+    }
+#endif
+#else
+    /* ARM doesn't create large PDEs */
+    UNREFERENCED_PARAMETER(PointerPde);
+    UNREFERENCED_PARAMETER(CurrentProcess);
+    ASSERT(FALSE);
+#endif
+}
+
+NTSTATUS
+NTAPI
+MiAllocateLargePages(
+    _In_ PEPROCESS Process,
+    _Inout_ PULONG_PTR BaseAddress,
+    _In_ SIZE_T RegionSize,
+    _In_ ULONG_PTR HighestAddress,
+    _In_ ULONG AllocationType,
+    _In_ ULONG ProtectionMask)
+{
+#ifndef _M_ARM
+    PETHREAD CurrentThread = PsGetCurrentThread();
+    PMMSUPPORT AddressSpace;
+    PFN_NUMBER PageFrameIndex;
+    PMMPDE PointerPde, LastPde;
+    ULONG_PTR StartingAddress;
+    PMMVAD Vad;
+    KIRQL OldIrql;
+    NTSTATUS Status;
+    PAGED_CODE();
+
+    /* The processor must support them */
+    if (!MmLargePageMinimum)
+    {
+        DPRINT1("Large pages are not supported on this processor\n");
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    /* Both the address and the size must be a multiple of the large page size */
+    if ((*BaseAddress & (MmLargePageMinimum - 1)) ||
+        (RegionSize & (MmLargePageMinimum - 1)))
+    {
+        DPRINT1("Large page allocation is not aligned: %p/%Ix\n", (PVOID)*BaseAddress, RegionSize);
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    /* Large pages are plain cached memory that is always accessible and never shared */
+    if (!(ProtectionMask & MM_PROTECT_ACCESS) ||
+        (ProtectionMask & MM_PROTECT_SPECIAL) ||
+        (ProtectionMask == MM_WRITECOPY) ||
+        (ProtectionMask == MM_EXECUTE_WRITECOPY))
+    {
+        DPRINT1("Invalid protection for large pages: %lx\n", ProtectionMask);
+        return STATUS_INVALID_PAGE_PROTECTION;
+    }
+
+    /* Charge quotas for the VAD */
+    Status = PsChargeProcessNonPagedPoolQuota(Process, sizeof(MMVAD_LONG));
+    if (!NT_SUCCESS(Status)) return Status;
+
+    /* Allocate and initialize the VAD, it is committed from the start */
+    Vad = ExAllocatePoolWithTag(NonPagedPool, sizeof(MMVAD_LONG), 'SdaV');
+    if (Vad == NULL)
+    {
+        PsReturnProcessNonPagedPoolQuota(Process, sizeof(MMVAD_LONG));
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlZeroMemory(Vad, sizeof(MMVAD_LONG));
+    Vad->u.VadFlags.VadType = VadLargePages;
+    Vad->u.VadFlags.MemCommit = 1;
+    Vad->u.VadFlags.Protection = ProtectionMask;
+    Vad->u.VadFlags.PrivateMemory = 1;
+
+    /* Insert it where a PDE can map it */
+    StartingAddress = *BaseAddress;
+    Status = MiInsertVadEx(Vad,
+                           &StartingAddress,
+                           RegionSize,
+                           HighestAddress,
+                           MmLargePageMinimum,
+                           AllocationType);
+    if (!NT_SUCCESS(Status))
+    {
+        ExFreePoolWithTag(Vad, 'SdaV');
+        PsReturnProcessNonPagedPoolQuota(Process, sizeof(MMVAD_LONG));
+        return Status;
+    }
+
+    /* Lock the address space and make sure the process isn't already dead */
+    AddressSpace = MmGetCurrentAddressSpace();
+    MmLockAddressSpace(AddressSpace);
+    if (Process->VmDeleted)
+    {
+        /* The VAD is now owned by process rundown */
+        MmUnlockAddressSpace(AddressSpace);
+        return STATUS_PROCESS_IS_TERMINATING;
+    }
+
+    /* Another thread could have released the range before we got the lock */
+    if (MiLocateAddress((PVOID)StartingAddress) != Vad)
+    {
+        MmUnlockAddressSpace(AddressSpace);
+        return STATUS_CONFLICTING_ADDRESSES;
+    }
+
+    /* Now map every large page, there is no demand paging for them */
+    PointerPde = MiAddressToPde(StartingAddress);
+    LastPde = MiAddressToPde(StartingAddress + RegionSize - 1);
+    Status = STATUS_SUCCESS;
+    while (PointerPde <= LastPde)
+    {
+        /* Grab and clear the physical pages outside of the working set lock */
+        PageFrameIndex = MiAllocateLargePageFrames();
+        if (!PageFrameIndex)
+        {
+            DPRINT1("No physically contiguous memory for a large page\n");
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            break;
+        }
+
+        MiLockProcessWorkingSetUnsafe(Process, CurrentThread);
+        Status = MiMapLargePage(PointerPde, PageFrameIndex, ProtectionMask, Process);
+        MiUnlockProcessWorkingSetUnsafe(Process, CurrentThread);
+        if (!NT_SUCCESS(Status))
+        {
+            OldIrql = MiAcquirePfnLock();
+            MiFreeLargePageFrames(PageFrameIndex);
+            MiReleasePfnLock(OldIrql);
+            break;
+        }
+
+        PointerPde++;
+    }
+
+    if (!NT_SUCCESS(Status))
+    {
+        /* Tear down what we managed to map, and the VAD along with it */
+        MiLockProcessWorkingSetUnsafe(Process, CurrentThread);
+        MiRemoveNode((PMMADDRESS_NODE)Vad, &Process->VadRoot);
+        MiDeleteVirtualAddresses(StartingAddress, StartingAddress + RegionSize - 1, NULL);
+        MiUnlockProcessWorkingSetUnsafe(Process, CurrentThread);
+        Process->VirtualSize -= RegionSize;
+        MmUnlockAddressSpace(AddressSpace);
+
+        ExFreePoolWithTag(Vad, 'SdaV');
+        PsReturnProcessNonPagedPoolQuota(Process, sizeof(MMVAD_LONG));
+        return Status;
+    }
+
+    /* The whole range is committed */
+    Process->CommitCharge += Vad->u.VadFlags.CommitCharge;
+    if (Process->CommitCharge > Process->CommitChargePeak)
+    {
+        Process->CommitChargePeak = Process->CommitCharge;
+    }
+
+    MmUnlockAddressSpace(AddressSpace);
+    *BaseAddress = StartingAddress;
+    return STATUS_SUCCESS;
+#else
+    UNREFERENCED_PARAMETER(Process);
+    UNREFERENCED_PARAMETER(BaseAddress);
+    UNREFERENCED_PARAMETER(RegionSize);
+    UNREFERENCED_PARAMETER(HighestAddress);
+    UNREFERENCED_PARAMETER(AllocationType);
+    UNREFERENCED_PARAMETER(ProtectionMask);
+    return STATUS_NOT_SUPPORTED;
+#endif
+}
+
 CODE_SEG("INIT")
 VOID
 NTAPI
 MiInitializeLargePageSupport(VOID)
 {
-#if _MI_PAGING_LEVELS > 2
-    DPRINT1("MiInitializeLargePageSupport: PAE/x64 Not Implemented\n");
-    //ASSERT(FALSE);
-#else
+#if defined(_M_IX86)
+    /* Large PDEs need PSE, which was enabled on all processors by KiInitializeKernel */
+    if ((KeFeatureBits & KF_LARGE_PAGE) && (__readcr4() & CR4_PSE))
+    {
+        MmLargePageMinimum = PDE_MAPPED_VA;
+    }
+#elif defined(_M_AMD64)
+    /* Long mode always supports 2MB pages */
+    MmLargePageMinimum = PDE_MAPPED_VA;
+#endif
+
+#if _MI_PAGING_LEVELS == 2
     /* Initialize the large-page hyperspace PTE used for initial mapping */
     MiLargePageHyperPte = MiReserveSystemPtes(1, SystemPteSpace);
     ASSERT(MiLargePageHyperPte);
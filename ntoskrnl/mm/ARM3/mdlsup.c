@@ -1011,8 +1011,8 @@ MmProbeAndLockPages(IN PMDL Mdl,
     TotalPages = LockPages;
     StartAddress = Address;
 
-    /* Large pages not supported */
-    ASSERT(!MI_IS_PHYSICAL_ADDRESS(Address));
+    /* Large pages are only supported in user mode */
+    ASSERT((Address <= MM_HIGHEST_USER_ADDRESS) || !MI_IS_PHYSICAL_ADDRESS(Address));
 
     //
     // Now probe them
@@ -1196,7 +1196,7 @@ MmProbeAndLockPages(IN PMDL Mdl,
                (PointerPpe->u.Hard.Valid == 0) ||
 #endif
                (PointerPde->u.Hard.Valid == 0) ||
-               (PointerPte->u.Hard.Valid == 0))
+               (!MI_IS_PAGE_LARGE(PointerPde) && (PointerPte->u.Hard.Valid == 0)))
         {
             //
             // What kind of lock were we using?
@@ -1253,9 +1253,18 @@ MmProbeAndLockPages(IN PMDL Mdl,
         if (Operation != IoReadAccess)
         {
             //
-            // Check if the PTE is not writable
+            // Check if the PTE (or the PDE of a large page) is not writable.
+            // Large pages are never copy on write.
             //
-            if (MI_IS_PAGE_WRITEABLE(PointerPte) == FALSE)
+            if (MI_IS_PAGE_LARGE(PointerPde))
+            {
+                if (MI_IS_PAGE_WRITEABLE((PMMPTE)PointerPde) == FALSE)
+                {
+                    Status = STATUS_ACCESS_VIOLATION;
+                    goto CleanupWithLock;
+                }
+            }
+            else if (MI_IS_PAGE_WRITEABLE(PointerPte) == FALSE)
             {
                 //
                 // Check if it's copy on write
@@ -1331,9 +1340,16 @@ MmProbeAndLockPages(IN PMDL Mdl,
         }
 
         //
-        // Grab the PFN
+        // Grab the PFN, large pages are physically contiguous
         //
-        PageFrameIndex = PFN_FROM_PTE(PointerPte);
+        if (MI_IS_PAGE_LARGE(PointerPde))
+        {
+            PageFrameIndex = PFN_FROM_PTE((PMMPTE)PointerPde) + (PointerPte - MiPdeToPte(PointerPde));
+        }
+        else
+        {
+            PageFrameIndex = PFN_FROM_PTE(PointerPte);
+        }
         Pfn1 = MiGetPfnEntry(PageFrameIndex);
         if (Pfn1)
         {
@@ -1920,17 +1936,100 @@ MmProbeAndLockProcessPages(
     _SEH2_END;
 }
 
-/*
- * @unimplemented
+/**
+ * @brief
+ * Probes and locks a list of discontiguous virtual pages, as used by
+ * scatter/gather I/O.
+ *
+ * @param[in,out] MemoryDescriptorList
+ * Memory Descriptor List (MDL) which will receive the locked pages. Its byte
+ * count gives the number of pages described by the segment array.
+ *
+ * @param[in] SegmentArray
+ * Array of page-aligned virtual addresses, one per page of the MDL.
+ *
+ * @param[in] AccessMode
+ * Access mode for probing the pages. Can be KernelMode or UserMode.
+ *
+ * @param[in] Operation
+ * The type of the probing and locking operation. Can be IoReadAccess, IoWriteAccess or IoModifyAccess.
+ *
+ * @return
+ * Nothing. Raises an exception if a page could not be locked, in which case
+ * the pages already locked are released again.
+ *
+ * @see MmProbeAndLockPages
+ *
+ * @remarks Must be called at IRQL <= APC_LEVEL
  */
+_IRQL_requires_max_(APC_LEVEL)
 VOID
 NTAPI
-MmProbeAndLockSelectedPages(IN OUT PMDL MemoryDescriptorList,
-                            IN LARGE_INTEGER PageList[],
-                            IN KPROCESSOR_MODE AccessMode,
-                            IN LOCK_OPERATION Operation)
+MmProbeAndLockSelectedPages(
+    _Inout_ PMDL MemoryDescriptorList,
+    _In_ PFILE_SEGMENT_ELEMENT SegmentArray,
+    _In_ KPROCESSOR_MODE AccessMode,
+    _In_ LOCK_OPERATION Operation)
 {
-    UNIMPLEMENTED;
+    PFN_NUMBER MdlBuffer[(sizeof(MDL) / sizeof(PFN_NUMBER)) + 1];
+    PMDL PageMdl = (PMDL)MdlBuffer;
+    PPFN_NUMBER MdlPages;
+    ULONG PageCount, i;
+    ULONG ByteCount;
+    NTSTATUS Status = STATUS_SUCCESS;
+    PVOID Address;
+
+    ASSERT(MemoryDescriptorList->ByteCount != 0);
+    ASSERT(MemoryDescriptorList->ByteOffset == 0);
+    ASSERT((MemoryDescriptorList->MdlFlags & (MDL_PAGES_LOCKED |
+                                              MDL_MAPPED_TO_SYSTEM_VA |
+                                              MDL_SOURCE_IS_NONPAGED_POOL |
+                                              MDL_PARTIAL |
+                                              MDL_IO_SPACE)) == 0);
+
+    MdlPages = MmGetMdlPfnArray(MemoryDescriptorList);
+    PageCount = ADDRESS_AND_SIZE_TO_SPAN_PAGES(0, MemoryDescriptorList->ByteCount);
+
+    /* Keep MmUnlockPages from walking past what we have locked so far */
+    for (i = 0; i < PageCount; i++)
+        MdlPages[i] = LIST_HEAD;
+
+    _SEH2_TRY
+    {
+        for (i = 0; i < PageCount; i++)
+        {
+            /* Lock this page through a single page MDL and steal its PFN */
+            Address = (PVOID)(ULONG_PTR)SegmentArray[i].Alignment;
+            MmInitializeMdl(PageMdl, PAGE_ALIGN(Address), PAGE_SIZE);
+            MmProbeAndLockPages(PageMdl, AccessMode, Operation);
+
+            MdlPages[i] = *MmGetMdlPfnArray(PageMdl);
+            MemoryDescriptorList->MdlFlags |= (PageMdl->MdlFlags & (MDL_IO_SPACE | MDL_WRITE_OPERATION));
+            MemoryDescriptorList->Process = PageMdl->Process;
+            MemoryDescriptorList->MdlFlags |= MDL_PAGES_LOCKED;
+        }
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        Status = _SEH2_GetExceptionCode();
+    }
+    _SEH2_END;
+
+    if (!NT_SUCCESS(Status))
+    {
+        /* Release the pages we did lock, then let the caller know */
+        if (i != 0)
+        {
+            ByteCount = MemoryDescriptorList->ByteCount;
+            MemoryDescriptorList->ByteCount = i * PAGE_SIZE;
+            MmUnlockPages(MemoryDescriptorList);
+            MemoryDescriptorList->ByteCount = ByteCount;
+        }
+
+        MemoryDescriptorList->Process = NULL;
+        MemoryDescriptorList->MdlFlags &= ~(MDL_IO_SPACE | MDL_WRITE_OPERATION);
+        ExRaiseStatus(Status);
+    }
 }
 
 /*
@@ -549,6 +549,7 @@ extern LIST_ENTRY MiLargePageDriverList;
 extern BOOLEAN MiLargePageAllDrivers;
 extern ULONG MmVerifyDriverBufferLength;
 extern ULONG MmLargePageDriverBufferLength;
+extern SIZE_T MmLargePageMinimum;
 extern SIZE_T MmSizeOfNonPagedPoolInBytes;
 extern SIZE_T MmMaximumNonPagedPoolInBytes;
 extern PFN_NUMBER MmMaximumNonPagedPoolInPages;
@@ -595,6 +596,8 @@ extern SIZE_T MmAllocatedNonPagedPool;
 extern ULONG MmSpecialPoolTag;
 extern PVOID MmHyperSpaceEnd;
 extern PMMWSL MmSystemCacheWorkingSetList;
+extern SIZE_T MmMinimumWorkingSetSize;
+extern SIZE_T MmMaximumWorkingSetSize;
 extern SIZE_T MmMinimumNonPagedPoolSize;
 extern ULONG MmMinAdditionNonPagedPoolPerMb;
 extern SIZE_T MmDefaultMaximumNonPagedPool;
@@ -636,6 +639,8 @@ extern PFN_NUMBER MmSystemPageDirectory[PPE_PER_PAGE];
 extern PMMPTE MmSharedUserDataPte;
 extern LIST_ENTRY MmProcessList;
 extern KEVENT MmZeroingPageEvent;
+extern ULONG MmZeroedPagesByWorkers;
+extern ULONG MmZeroedPageListMisses;
 extern ULONG MmSystemPageColor;
 extern ULONG MmProcessColorSeed;
 extern PMMWSL MmWorkingSetList;
@@ -2165,6 +2170,24 @@ MiSyncCachedRanges(
     VOID
 );
 
+NTSTATUS
+NTAPI
+MiAllocateLargePages(
+    _In_ PEPROCESS Process,
+    _Inout_ PULONG_PTR BaseAddress,
+    _In_ SIZE_T RegionSize,
+    _In_ ULONG_PTR HighestAddress,
+    _In_ ULONG AllocationType,
+    _In_ ULONG ProtectionMask
+);
+
+VOID
+NTAPI
+MiDeleteLargePde(
+    _In_ PMMPDE PointerPde,
+    _In_ PEPROCESS CurrentProcess
+);
+
 BOOLEAN
 NTAPI
 MiIsPfnInUse(
@@ -1201,6 +1201,10 @@ MiAdjustWorkingSetManagerParameters(IN BOOLEAN Client)
         /* Double the minimum amount of pages we consider for a "plenty free" scenario */
         MmPlentyFreePages *= 2;
     }
+
+    /* Bounds for the working set sizes a process can ask for */
+    MmMinimumWorkingSetSize = 20;
+    MmMaximumWorkingSetSize = (MmAvailablePages > 1024) ? (MmAvailablePages - 512) : (MmAvailablePages / 2);
 }
 
 CODE_SEG("INIT")
@@ -2461,7 +2465,7 @@ MmArmInitSystem(IN ULONG Phase,
         /* Now setup the shared user data fields */
         ASSERT(SharedUserData->NumberOfPhysicalPages == 0);
         SharedUserData->NumberOfPhysicalPages = MmNumberOfPhysicalPages;
-        SharedUserData->LargePageMinimum = 0;
+        SharedUserData->LargePageMinimum = (ULONG)MmLargePageMinimum;
 
         /* Check for workstation (Wi for WinNT) */
         if (MmProductType == '\0i\0W')
@@ -48,6 +48,7 @@ MmAdjustWorkingSetSize(IN SIZE_T WorkingSetMinimumInBytes,
 {
     SIZE_T MinimumWorkingSetSize, MaximumWorkingSetSize;
     SSIZE_T Delta;
+    SIZE_T TrimPages = 0;
     PMMSUPPORT Ws;
     NTSTATUS Status;
 
@@ -147,10 +148,23 @@ MmAdjustWorkingSetSize(IN SIZE_T WorkingSetMinimumInBytes,
     Ws->MinimumWorkingSetSize = MinimumWorkingSetSize;
     Ws->MaximumWorkingSetSize = MaximumWorkingSetSize;
 
+    /* Check if the working set is now above its maximum */
+    if ((Ws->WorkingSetSize >> PAGE_SHIFT) > MaximumWorkingSetSize)
+    {
+        TrimPages = (Ws->WorkingSetSize >> PAGE_SHIFT) - MaximumWorkingSetSize;
+    }
+
 Cleanup:
 
-    /* Unlock the working set and return the status */
+    /* Unlock the working set */
     MiUnlockWorkingSet(PsGetCurrentThread(), Ws);
+
+    /* Give back the cold pages above the new maximum */
+    if (TrimPages != 0)
+    {
+        MmTrimProcessUserPages(PsGetCurrentProcess(), (ULONG)TrimPages);
+    }
+
     return Status;
 }
 
@@ -186,6 +200,9 @@ MmIsAddressValid(IN PVOID VirtualAddress)
 #if _MI_PAGING_LEVELS >= 2
     /* Check if the PDE is valid */
     if (MiAddressToPde(VirtualAddress)->u.Hard.Valid == 0) return FALSE;
+
+    /* Large pages have no PTE */
+    if (MI_IS_PAGE_LARGE(MiAddressToPde(VirtualAddress))) return TRUE;
 #endif
 
     /* Check if the PTE is valid */
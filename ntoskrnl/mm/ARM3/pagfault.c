@@ -271,6 +271,13 @@ MiCheckVirtualAddress(IN PVOID VirtualAddress,
         /* ReactOS does not handle physical memory VADs yet */
         ASSERT(Vad->u.VadFlags.VadType != VadDevicePhysicalMemory);
 
+        /* Large pages are mapped when they are allocated, never on demand */
+        if (Vad->u.VadFlags.VadType == VadLargePages)
+        {
+            *ProtectCode = MM_NOACCESS;
+            return NULL;
+        }
+
         /* Check if it's a section, or just an allocation */
         if (Vad->u.VadFlags.PrivateMemory)
         {
@@ -1740,7 +1747,7 @@ MmArmAccessFault(IN ULONG FaultCode,
             (PointerPpe->u.Hard.Valid == 0) ||
 #endif
             (PointerPde->u.Hard.Valid == 0) ||
-            (PointerPte->u.Hard.Valid == 0))
+            (!MI_IS_PAGE_LARGE(PointerPde) && (PointerPte->u.Hard.Valid == 0)))
         {
             /* This fault is not valid, print out some debugging help */
             DbgPrint("MM:***PAGE FAULT AT IRQL > 1  Va %p, IRQL %lx\n",
@@ -1768,8 +1775,24 @@ MmArmAccessFault(IN ULONG FaultCode,
             return STATUS_IN_PAGE_ERROR | 0x10000000;
         }
 
+        /* A large page has no PTE and is never paged out */
+        if (MI_IS_PAGE_LARGE(PointerPde))
+        {
+            /* So this can only be a write to a read-only one */
+            if (MI_IS_WRITE_ACCESS(FaultCode) && !MI_IS_PAGE_WRITEABLE((PMMPTE)PointerPde))
+            {
+                KeBugCheckEx(ATTEMPTED_WRITE_TO_READONLY_MEMORY,
+                             (ULONG_PTR)Address,
+                             PointerPde->u.Long,
+                             (ULONG_PTR)TrapInformation,
+                             10);
+            }
+
+            /* Or a stale TLB entry */
+            return STATUS_SUCCESS;
+        }
+
         /* Not yet implemented in ReactOS */
-        ASSERT(MI_IS_PAGE_LARGE(PointerPde) == FALSE);
         ASSERT((!MI_IS_NOT_PRESENT_FAULT(FaultCode) && MI_IS_PAGE_COPY_ON_WRITE(PointerPte)) == FALSE);
 
         /* Check if this was a write */
@@ -2262,10 +2285,22 @@ UserFault:
         ASSERT(KeAreAllApcsDisabled() == TRUE);
         ASSERT(PointerPde->u.Hard.Valid == 1);
     }
-    else
+    else if (MI_IS_PAGE_LARGE(PointerPde))
     {
-        /* Not yet implemented in ReactOS */
-        ASSERT(MI_IS_PAGE_LARGE(PointerPde) == FALSE);
+        /* Large pages are always resident, so this can only be a protection fault */
+        if ((MI_IS_WRITE_ACCESS(FaultCode) && !MI_IS_PAGE_WRITEABLE((PMMPTE)PointerPde)) ||
+            (MI_IS_INSTRUCTION_FETCH(FaultCode) && !MI_IS_PAGE_EXECUTABLE((PMMPTE)PointerPde)))
+        {
+            Status = STATUS_ACCESS_VIOLATION;
+        }
+        else
+        {
+            /* Someone else mapped it, or the TLB was stale */
+            Status = STATUS_SUCCESS;
+        }
+
+        MiUnlockProcessWorkingSet(CurrentProcess, CurrentThread);
+        return Status;
     }
 
     /* Now capture the PTE. */
@@ -623,6 +623,21 @@ MiDeleteVirtualAddresses(
             continue;
         }
 
+        /* Large pages don't have a page table, they go away with their PDE */
+        if (MI_IS_PAGE_LARGE(PointerPde) && PointerPde->u.Hard.Valid)
+        {
+            /* They can only be released as a whole */
+            ASSERT((Va & (PDE_MAPPED_VA - 1)) == 0);
+            ASSERT((EndingAddress - Va) >= (PDE_MAPPED_VA - 1));
+
+            OldIrql = MiAcquirePfnLock();
+            MiDeleteLargePde(PointerPde, CurrentProcess);
+            MiReleasePfnLock(OldIrql);
+
+            Va = (ULONG_PTR)MiPdeToAddress(PointerPde + 1);
+            continue;
+        }
+
         /* Now check if the PDE is mapped in */
         if (!PointerPde->u.Hard.Valid)
         {
@@ -1494,6 +1509,14 @@ MiQueryAddressState(IN PVOID Va,
     ASSERT((Vad->StartingVpn <= ((ULONG_PTR)Va >> PAGE_SHIFT)) &&
            (Vad->EndingVpn >= ((ULONG_PTR)Va >> PAGE_SHIFT)));
 
+    /* Large pages are committed as long as their VAD exists */
+    if (Vad->u.VadFlags.VadType == VadLargePages)
+    {
+        *NextVa = (PVOID)((Vad->EndingVpn + 1) << PAGE_SHIFT);
+        *ReturnedProtect = MmProtectToValue[Vad->u.VadFlags.Protection];
+        return MEM_COMMIT;
+    }
+
     /* Only normal VADs supported */
     ASSERT(Vad->u.VadFlags.VadType == VadNone);
 
@@ -4512,10 +4535,10 @@ NtAllocateVirtualMemory(IN HANDLE ProcessHandle,
     /* Check if large pages are being used */
     if (AllocationType & MEM_LARGE_PAGES)
     {
-        /* Large page allocations MUST be committed */
-        if (!(AllocationType & MEM_COMMIT))
+        /* Large page allocations MUST be reserved and committed at once */
+        if ((AllocationType & (MEM_RESERVE | MEM_COMMIT)) != (MEM_RESERVE | MEM_COMMIT))
         {
-            DPRINT1("Must supply MEM_COMMIT with MEM_LARGE_PAGES\n");
+            DPRINT1("Must supply MEM_RESERVE and MEM_COMMIT with MEM_LARGE_PAGES\n");
             return STATUS_INVALID_PARAMETER_5;
         }
 
@@ -4656,14 +4679,34 @@ NtAllocateVirtualMemory(IN HANDLE ProcessHandle,
     }
 
     //
-    // Fail on the things we don't yet support
+    // Large pages are physically contiguous and mapped right away by their PDE,
+    // so they get their own path
     //
-    if ((AllocationType & MEM_LARGE_PAGES) == MEM_LARGE_PAGES)
+    if (AllocationType & MEM_LARGE_PAGES)
     {
-        DPRINT1("MEM_LARGE_PAGES not supported\n");
-        Status = STATUS_INVALID_PARAMETER;
+        if (ZeroBits != 0)
+        {
+            HighestAddress = MAXULONG_PTR >> ZeroBits;
+            if (HighestAddress > (ULONG_PTR)MM_HIGHEST_VAD_ADDRESS)
+            {
+                Status = STATUS_INVALID_PARAMETER_3;
+                goto FailPathNoLock;
+            }
+        }
+
+        StartingAddress = (ULONG_PTR)PBaseAddress;
+        Status = MiAllocateLargePages(Process,
+                                      &StartingAddress,
+                                      PRegionSize,
+                                      HighestAddress,
+                                      AllocationType,
+                                      ProtectionMask);
         goto FailPathNoLock;
     }
+
+    //
+    // Fail on the things we don't yet support
+    //
     if ((AllocationType & MEM_PHYSICAL) == MEM_PHYSICAL)
     {
         DPRINT1("MEM_PHYSICAL not supported\n");
@@ -5365,9 +5408,28 @@ NtFreeVirtualMemory(IN HANDLE ProcessHandle,
     if (FreeType & MEM_RELEASE)
     {
         //
-        // ARM3 only supports this VAD in this path
+        // ARM3 only supports these VADs in this path
+        //
+        ASSERT((Vad->u.VadFlags.VadType == VadNone) ||
+               (Vad->u.VadFlags.VadType == VadLargePages));
+
+        //
+        // Large pages can only be released as a whole, and they take their
+        // commit charge with them
         //
-        ASSERT(Vad->u.VadFlags.VadType == VadNone);
+        if (Vad->u.VadFlags.VadType == VadLargePages)
+        {
+            if ((PRegionSize) &&
+                (((StartingAddress >> PAGE_SHIFT) != Vad->StartingVpn) ||
+                 ((EndingAddress >> PAGE_SHIFT) != Vad->EndingVpn)))
+            {
+                DPRINT1("Cannot release part of a large page allocation\n");
+                Status = STATUS_INVALID_PARAMETER;
+                goto FailPath;
+            }
+
+            CommitReduction = Vad->u.VadFlags.CommitCharge;
+        }
 
         //
         // Is the caller trying to remove the whole VAD, or remove only a portion
@@ -15,6 +15,10 @@
 #define MODULE_INVOLVED_IN_ARM3
 #include "miarm.h"
 
+/* Working sets which fault this much between two samples get room to grow */
+#define MI_WS_GROWTH_FAULTS     100
+#define MI_WS_GROWTH_PAGES      128
+
 /* GLOBALS ********************************************************************/
 PMMWSL MmWorkingSetList;
 KEVENT MmWorkingSetManagerEvent;
@@ -216,92 +220,29 @@ RemoveFromWsList(PMMWSL WsList, PVOID Address)
 }
 
 static
-ULONG
-TrimWsList(PMMWSL WsList)
+VOID
+GrowWorkingSet(PMMSUPPORT Vm)
 {
-    /* This should be done under WS lock */
-    ASSERT(MM_ANY_WS_LOCK_HELD(PsGetCurrentThread()));
-
-    ULONG Ret = 0;
-
-    /* Walk the array */
-    for (ULONG i = WsList->FirstDynamic; i < WsList->LastEntry; i++)
+    /* Faults since the last sample, counted by MmAccessFault */
+    ULONG Faults = InterlockedExchange(reinterpret_cast<PLONG>(&Vm->GrowthSinceLastEstimate), 0);
+
+    /*
+     * A process which keeps faulting at its maximum loses pages it actually needs to the balancer.
+     * Raise its limit while we can afford it, unless it was asked to be a hard one.
+     */
+    ULONG WorkingSetPages = Vm->WorkingSetSize >> PAGE_SHIFT;
+    if ((Faults < MI_WS_GROWTH_FAULTS) ||
+        Vm->Flags.MaximumWorkingSetHard ||
+        ((WorkingSetPages + MI_WS_GROWTH_PAGES) < Vm->MaximumWorkingSetSize) ||
+        (Vm->MaximumWorkingSetSize >= MmMaximumWorkingSetSize) ||
+        (MmAvailablePages < (MmPlentyFreePages + MI_WS_GROWTH_PAGES)))
     {
-        MMWSLE& Entry = WsList->Wsle[i];
-        if (!Entry.u1.e1.Valid)
-            continue;
-
-        /* Only direct entries for now */
-        ASSERT(Entry.u1.e1.Direct == 1);
-
-        /* Check the PTE */
-        PMMPTE PointerPte = MiAddressToPte(Entry.u1.VirtualAddress);
-
-        /* This must be valid */
-        ASSERT(PointerPte->u.Hard.Valid);
-
-        /* If the PTE was accessed, simply reset and that's the end of it */
-        if (PointerPte->u.Hard.Accessed)
-        {
-            Entry.u1.e1.Age = 0;
-            PointerPte->u.Hard.Accessed = 0;
-            KeInvalidateTlbEntry(Entry.u1.VirtualAddress);
-            continue;
-        }
-
-        /* If the entry is not so old, just age it */
-        if (Entry.u1.e1.Age < 3)
-        {
-            Entry.u1.e1.Age++;
-            continue;
-        }
-
-        if ((Entry.u1.e1.LockedInMemory) || (Entry.u1.e1.LockedInWs))
-        {
-            /* This one is locked. Next time, maybe... */
-            continue;
-        }
-
-        /* FIXME: Invalidating PDEs breaks legacy MMs */
-        if (MI_IS_PAGE_TABLE_ADDRESS(Entry.u1.VirtualAddress))
-            continue;
-
-        /* Please put yourself aside and make place for the younger ones */
-        PFN_NUMBER Page = PFN_FROM_PTE(PointerPte);
-        {
-            ntoskrnl::MiPfnLockGuard PfnLock;
-
-            PMMPFN Pfn = MiGetPfnEntry(Page);
-
-            /* Not supported yet */
-            ASSERT(Pfn->u3.e1.PrototypePte == 0);
-            ASSERT(!MI_IS_ROS_PFN(Pfn));
-
-            /* FIXME: Remove this hack when possible */
-            if (Pfn->Wsle.u1.e1.LockedInMemory || (Pfn->Wsle.u1.e1.LockedInWs))
-            {
-                continue;
-            }
-
-            /* We can remove it from the list. Save Protection first */
-            ULONG Protection = Entry.u1.e1.Protection;
-            RemoveFromWsList(WsList, Entry.u1.VirtualAddress);
-
-            /* Dirtify the page, if needed */
-            if (PointerPte->u.Hard.Dirty)
-                Pfn->u3.e1.Modified = 1;
-
-            /* Make this a transition PTE */
-            MI_MAKE_TRANSITION_PTE(PointerPte, Page, Protection);
-            KeInvalidateTlbEntry(MiAddressToPte(PointerPte));
-
-            /* Drop the share count. This will take care of putting it in the standby or modified list. */
-            MiDecrementShareCount(Pfn, Page);
-        }
-
-        Ret++;
+        return;
     }
-    return Ret;
+
+    DPRINT("Growing working set %p: %lu faults, %lu pages\n", Vm, Faults, WorkingSetPages);
+    SIZE_T NewMaximum = Vm->MaximumWorkingSetSize + MI_WS_GROWTH_PAGES;
+    Vm->MaximumWorkingSetSize = static_cast<ULONG>(min(NewMaximum, MmMaximumWorkingSetSize));
 }
 
 /* GLOBAL FUNCTIONS ***********************************************************/
@@ -411,7 +352,6 @@ NTAPI
 MmWorkingSetManager(VOID)
 {
     PLIST_ENTRY VmListEntry;
-    PMMSUPPORT Vm = NULL;
     KIRQL OldIrql;
 
     OldIrql = MiAcquireExpansionLock();
@@ -420,70 +360,41 @@ MmWorkingSetManager(VOID)
          VmListEntry != &MmWorkingSetExpansionHead;
          VmListEntry = VmListEntry->Flink)
     {
-        BOOLEAN TrimHard = MmAvailablePages < MmMinimumFreePages;
-        PEPROCESS Process = NULL;
-
-        /* Don't do anything if we have plenty of free pages. */
-        if ((MmAvailablePages + MmModifiedPageListHead.Total) >= MmPlentyFreePages)
-            break;
-
-        Vm = CONTAINING_RECORD(VmListEntry, MMSUPPORT, WorkingSetExpansionLinks);
+        PMMSUPPORT Vm = CONTAINING_RECORD(VmListEntry, MMSUPPORT, WorkingSetExpansionLinks);
 
         /* Let the legacy Mm System space alone */
         if (Vm == MmGetKernelAddressSpace())
             continue;
 
-        if (MI_IS_PROCESS_WORKING_SET(Vm))
-        {
-            Process = CONTAINING_RECORD(Vm, EPROCESS, Vm);
+        /* FIXME: Session & system space unsupported */
+        if (!MI_IS_PROCESS_WORKING_SET(Vm))
+            continue;
 
-            /* Make sure the process is not terminating abd attach to it */
-            if (!ExAcquireRundownProtection(&Process->RundownProtect))
-                continue;
-            ASSERT(!KeIsAttachedProcess());
-            KeAttachProcess(&Process->Pcb);
-        }
-        else
-        {
-            /* FIXME: Session & system space unsupported */
+        /* Make sure the process is not terminating. This also keeps it in the list */
+        PEPROCESS Process = CONTAINING_RECORD(Vm, EPROCESS, Vm);
+        if (!ExAcquireRundownProtection(&Process->RundownProtect))
             continue;
-        }
 
         MiReleaseExpansionLock(OldIrql);
 
-        /* Share-lock for now, we're only reading */
-        MiLockWorkingSetShared(PsGetCurrentThread(), Vm);
-
-        if (((Vm->WorkingSetSize > Vm->MaximumWorkingSetSize) ||
-            (TrimHard && (Vm->WorkingSetSize > Vm->MinimumWorkingSetSize))) &&
-            MiConvertSharedWorkingSetLockToExclusive(PsGetCurrentThread(), Vm))
-        {
-            /* We're done */
-            Vm->Flags.BeingTrimmed = 1;
-
-            ULONG Trimmed = TrimWsList(Vm->VmWorkingSetList);
-
-            /* We're done */
-            Vm->WorkingSetSize -= Trimmed * PAGE_SIZE;
-            Vm->Flags.BeingTrimmed = 0;
-            MiUnlockWorkingSet(PsGetCurrentThread(), Vm);
-        }
-        else
-        {
-            MiUnlockWorkingSetShared(PsGetCurrentThread(), Vm);
-        }
+        /* Only the limits are looked at, no need to attach */
+        MiLockWorkingSet(PsGetCurrentThread(), Vm);
+        GrowWorkingSet(Vm);
+        MiUnlockWorkingSet(PsGetCurrentThread(), Vm);
 
         /* Lock again */
         OldIrql = MiAcquireExpansionLock();
-
-        if (Process)
-        {
-            KeDetachProcess();
-            ExReleaseRundownProtection(&Process->RundownProtect);
-        }
+        ExReleaseRundownProtection(&Process->RundownProtect);
     }
 
     MiReleaseExpansionLock(OldIrql);
+
+    /* Faulted user pages don't go in the working set lists, they are aged through their reverse mappings */
+    MmAgeUserPages();
+
+    /* Let the balancer take the cold pages of the working sets above their maximum */
+    if ((MmAvailablePages + MmModifiedPageListHead.Total) < MmPlentyFreePages)
+        MmRebalanceMemoryConsumers();
 }
 
 } // extern "C"
@@ -19,6 +19,24 @@
 
 KEVENT MmZeroingPageEvent;
 
+/* Wakes up a zero page worker once in a while, to zero the pages which were
+ * freed too few at a time to signal MmZeroingPageEvent. The workers run at
+ * priority 0, so this only happens when the processor is idle anyway */
+static KTIMER MiZeroingIdleTimer;
+#define MI_ZEROING_IDLE_PERIOD 1000
+
+/* One worker per processor, each owning the colors equal to its index modulo
+ * the number of workers */
+static ULONG MiNumberOfZeroPageWorkers;
+static BOOLEAN MiZeroPagesNonTemporal;
+
+/* Counters:
+ * - Pages zeroed by the zero page workers
+ * - Times MiRemoveZeroPage found no zeroed page and had to zero one inline
+ */
+ULONG MmZeroedPagesByWorkers;
+ULONG MmZeroedPageListMisses;
+
 /* PRIVATE FUNCTIONS **********************************************************/
 
 VOID
@@ -31,32 +49,79 @@ NTAPI
 MiFreeInitializationCode(IN PVOID StartVa,
 IN PVOID EndVa);
 
-VOID
-NTAPI
-MmZeroPageThread(VOID)
+static
+PMMPFN
+MiGatherPagesToZero(IN ULONG Worker,
+                    OUT PULONG PageCount)
 {
-    PKTHREAD Thread = KeGetCurrentThread();
-    PVOID StartAddress, EndAddress;
-    PVOID WaitObjects[2];
+    PMMPFN Pfn1 = (PMMPFN)LIST_HEAD;
+    PFN_NUMBER PageIndex, FreePage;
+    ULONG Color;
 
-    /* Get the discardable sections to free them */
-    MiFindInitializationCode(&StartAddress, &EndAddress);
-    if (StartAddress) MiFreeInitializationCode(StartAddress, EndAddress);
-    DPRINT("Free pages: %lx\n", MmAvailablePages);
+    MI_ASSERT_PFN_LOCK_HELD();
 
-    /* Set our priority to 0 */
-    Thread->BasePriority = 0;
-    KeSetPriorityThread(Thread, 0);
+    *PageCount = 0;
+    Color = Worker;
+    while (*PageCount < MI_ZERO_PTES && MmFreePageListHead.Total)
+    {
+        PMMPFN Pfn2;
+
+        /* Drain our own colors first, so that the workers don't fight for
+         * the same lists. When they're empty, help with the others */
+        while (Color < MmSecondaryColors &&
+               MmFreePagesByColor[FreePageList][Color].Flink == LIST_HEAD)
+        {
+            Color += MiNumberOfZeroPageWorkers;
+        }
+
+        if (Color < MmSecondaryColors)
+        {
+            PageIndex = MmFreePagesByColor[FreePageList][Color].Flink;
+        }
+        else
+        {
+            PageIndex = MmFreePageListHead.Flink;
+        }
+        ASSERT(PageIndex != LIST_HEAD);
+
+        MI_SET_USAGE(MI_USAGE_ZERO_LOOP);
+        MI_SET_PROCESS2("Kernel 0 Loop");
+        FreePage = MiRemoveAnyPage(MI_GET_PAGE_COLOR(PageIndex));
+
+        /* The first free page should also be the first on its own list */
+        if (FreePage != PageIndex)
+        {
+            KeBugCheckEx(PFN_LIST_CORRUPT,
+                        0x8F,
+                        FreePage,
+                        PageIndex,
+                        0);
+        }
+
+        Pfn2 = MiGetPfnEntry(PageIndex);
+        Pfn2->u1.Flink = (PFN_NUMBER)Pfn1;
+        Pfn1 = Pfn2;
+        (*PageCount)++;
+    }
+
+    return Pfn1;
+}
+
+static
+VOID
+MiZeroPageWorker(IN ULONG Worker,
+                 IN PMMPTE ZeroingPte)
+{
+    PVOID WaitObjects[2];
+    KIRQL OldIrql;
 
     /* Setup the wait objects */
     WaitObjects[0] = &MmZeroingPageEvent;
-//    WaitObjects[1] = &PoSystemIdleTimer; FIXME: Implement idle timer
+    WaitObjects[1] = &MiZeroingIdleTimer;
 
     while (TRUE)
     {
-        KIRQL OldIrql;
-
-        KeWaitForMultipleObjects(1, // 2
+        KeWaitForMultipleObjects(2,
                                  WaitObjects,
                                  WaitAny,
                                  WrFreePage,
@@ -68,52 +133,34 @@ MmZeroPageThread(VOID)
 
         while (TRUE)
         {
-            ULONG PageCount = 0;
-            PMMPFN Pfn1 = (PMMPFN)LIST_HEAD;
+            ULONG PageCount;
+            PMMPFN Pfn1;
             PVOID ZeroAddress;
-            PFN_NUMBER PageIndex, FreePage;
-
-            while (PageCount < MI_ZERO_PTES)
-            {
-                PMMPFN Pfn2;
-
-                if (!MmFreePageListHead.Total)
-                    break;
-
-                PageIndex = MmFreePageListHead.Flink;
-                ASSERT(PageIndex != LIST_HEAD);
-                MI_SET_USAGE(MI_USAGE_ZERO_LOOP);
-                MI_SET_PROCESS2("Kernel 0 Loop");
-                FreePage = MiRemoveAnyPage(MI_GET_PAGE_COLOR(PageIndex));
-
-                /* The first global free page should also be the first on its own list */
-                if (FreePage != PageIndex)
-                {
-                    KeBugCheckEx(PFN_LIST_CORRUPT,
-                                0x8F,
-                                FreePage,
-                                PageIndex,
-                                0);
-                }
-
-                Pfn2 = MiGetPfnEntry(PageIndex);
-                Pfn2->u1.Flink = (PFN_NUMBER)Pfn1;
-                Pfn1 = Pfn2;
-                PageCount++;
-            }
-            MiReleasePfnLock(OldIrql);
+            PFN_NUMBER PageIndex;
 
+            Pfn1 = MiGatherPagesToZero(Worker, &PageCount);
             if (PageCount == 0)
             {
+                /* Clear the event while still holding the PFN lock, otherwise
+                 * we could miss pages freed in between */
                 KeClearEvent(&MmZeroingPageEvent);
+                MiReleasePfnLock(OldIrql);
                 break;
             }
+            MiReleasePfnLock(OldIrql);
 
-            ZeroAddress = MiMapPagesInZeroSpace(Pfn1, PageCount);
+            ZeroAddress = MiMapPagesInZeroSpace(ZeroingPte, Pfn1, PageCount, MiZeroPagesNonTemporal);
             ASSERT(ZeroAddress);
-            KeZeroPages(ZeroAddress, PageCount * PAGE_SIZE);
+#if defined(_M_IX86) || defined(_M_AMD64)
+            if (MiZeroPagesNonTemporal)
+                KeZeroPagesNonTemporal(ZeroAddress, PageCount * PAGE_SIZE);
+            else
+#endif
+                KeZeroPages(ZeroAddress, PageCount * PAGE_SIZE);
             MiUnmapPagesInZeroSpace(ZeroAddress, PageCount);
 
+            InterlockedExchangeAdd((PLONG)&MmZeroedPagesByWorkers, PageCount);
+
             OldIrql = MiAcquirePfnLock();
 
             while (Pfn1 != (PMMPFN)LIST_HEAD)
@@ -126,4 +173,91 @@ MmZeroPageThread(VOID)
     }
 }
 
+static
+VOID
+NTAPI
+MiZeroPageWorkerThread(IN PVOID Context)
+{
+    PKTHREAD Thread = KeGetCurrentThread();
+    ULONG Worker = PtrToUlong(Context);
+    PMMPTE ZeroingPte;
+
+    /* Stay on our processor: the zeroing PTEs are only flushed from the
+     * local TB when they get reused */
+    KeSetSystemAffinityThread(AFFINITY_MASK(Worker));
+    Thread->BasePriority = 0;
+    KeSetPriorityThread(Thread, 0);
+
+    /* Each worker has its own zeroing PTEs, with the counter at the start */
+    ZeroingPte = MiReserveSystemPtes(MI_ZERO_PTES + 1, SystemPteSpace);
+    if (ZeroingPte == NULL)
+    {
+        /* The other workers will take care of our colors */
+        DPRINT1("No zeroing PTEs for zero page worker %lu\n", Worker);
+        PsTerminateSystemThread(STATUS_INSUFFICIENT_RESOURCES);
+    }
+    RtlZeroMemory(ZeroingPte, (MI_ZERO_PTES + 1) * sizeof(MMPTE));
+    ZeroingPte->u.Hard.PageFrameNumber = MI_ZERO_PTES;
+
+    MiZeroPageWorker(Worker, ZeroingPte);
+}
+
+VOID
+NTAPI
+MmZeroPageThread(VOID)
+{
+    PKTHREAD Thread = KeGetCurrentThread();
+    PVOID StartAddress, EndAddress;
+    LARGE_INTEGER DueTime;
+    HANDLE ThreadHandle;
+    NTSTATUS Status;
+    ULONG Worker;
+
+    /* Get the discardable sections to free them */
+    MiFindInitializationCode(&StartAddress, &EndAddress);
+    if (StartAddress) MiFreeInitializationCode(StartAddress, EndAddress);
+    DPRINT("Free pages: %lx\n", MmAvailablePages);
+
+    /* Non-temporal stores need SSE2 on x86 */
+#if defined(_M_AMD64)
+    MiZeroPagesNonTemporal = TRUE;
+#elif defined(_M_IX86)
+    MiZeroPagesNonTemporal = (KeFeatureBits & KF_XMMI64) != 0;
+#endif
+
+    /* Start the idle timer */
+    KeInitializeTimerEx(&MiZeroingIdleTimer, SynchronizationTimer);
+    DueTime.QuadPart = Int32x32To64(MI_ZEROING_IDLE_PERIOD, -10000);
+    KeSetTimerEx(&MiZeroingIdleTimer, DueTime, MI_ZEROING_IDLE_PERIOD, NULL);
+
+    /* One worker per processor, but there is no point having more than colors */
+    MiNumberOfZeroPageWorkers = min((ULONG)KeNumberProcessors, MmSecondaryColors);
+
+    /* We are the first one, start the others */
+    for (Worker = 1; Worker < MiNumberOfZeroPageWorkers; Worker++)
+    {
+        Status = PsCreateSystemThread(&ThreadHandle,
+                                      THREAD_ALL_ACCESS,
+                                      NULL,
+                                      NULL,
+                                      NULL,
+                                      MiZeroPageWorkerThread,
+                                      UlongToPtr(Worker));
+        if (!NT_SUCCESS(Status))
+        {
+            DPRINT1("Failed to start zero page worker %lu: 0x%lx\n", Worker, Status);
+            continue;
+        }
+        ObCloseHandle(ThreadHandle, KernelMode);
+    }
+
+    /* Set our priority to 0, and stay on the boot processor */
+    KeSetSystemAffinityThread(AFFINITY_MASK(0));
+    Thread->BasePriority = 0;
+    KeSetPriorityThread(Thread, 0);
+
+    /* And use the zeroing PTEs reserved at init time */
+    MiZeroPageWorker(0, MiFirstReservedZeroingPte);
+}
+
 /* EOF */
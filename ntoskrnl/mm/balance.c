@@ -23,6 +23,15 @@ typedef struct _MM_ALLOCATION_REQUEST
     KEVENT Event;
 }
 MM_ALLOCATION_REQUEST, *PMM_ALLOCATION_REQUEST;
+
+typedef struct _MM_TRIM_PROCESS_REQUEST
+{
+    PEPROCESS Process;
+    ULONG Target;
+    ULONG Trimmed;
+}
+MM_TRIM_PROCESS_REQUEST, *PMM_TRIM_PROCESS_REQUEST;
+
 /* GLOBALS ******************************************************************/
 
 MM_MEMORY_CONSUMER MiMemoryConsumers[MC_MAXIMUM];
@@ -36,6 +45,9 @@ static KTIMER MiBalancerTimer;
 
 static LONG PageOutThreadActive;
 
+static KGUARDED_MUTEX MiTrimProcessLock;
+static MM_TRIM_PROCESS_REQUEST MiTrimProcessRequest;
+
 /* FUNCTIONS ****************************************************************/
 
 CODE_SEG("INIT")
@@ -49,6 +61,8 @@ MmInitializeBalancer(ULONG NrAvailablePages, ULONG NrSystemPages)
     MiMinimumAvailablePages = 256;
     MiMinimumPagesPerRun = 256;
     MiMemoryConsumers[MC_USER].PagesTarget = NrAvailablePages / 2;
+
+    KeInitializeGuardedMutex(&MiTrimProcessLock);
 }
 
 CODE_SEG("INIT")
@@ -134,145 +148,296 @@ MiTrimMemoryConsumer(ULONG Consumer, ULONG InitialTarget)
     return (InitialTarget > NrFreedPages) ? (InitialTarget - NrFreedPages) : 0;
 }
 
-NTSTATUS
-MmTrimUserMemory(ULONG Target, ULONG Priority, PULONG NrFreedPages)
+VOID
+NTAPI
+MmRebalanceMemoryConsumers(VOID)
 {
-    PFN_NUMBER FirstPage, CurrentPage;
-    NTSTATUS Status;
+    if (InterlockedCompareExchange(&PageOutThreadActive, 1, 0) == 0)
+    {
+        KeSetEvent(&MiBalancerEvent, IO_NO_INCREMENT, FALSE);
+    }
+}
 
-    (*NrFreedPages) = 0;
+VOID
+NTAPI
+MmRebalanceMemoryConsumersAndWait(VOID)
+{
+    ASSERT(PsGetCurrentProcess()->AddressCreationLock.Owner != KeGetCurrentThread());
+    ASSERT(!MM_ANY_WS_LOCK_HELD(PsGetCurrentThread()));
+    ASSERT(KeGetCurrentIrql() < DISPATCH_LEVEL);
+
+    KeResetEvent(&MiBalancerDoneEvent);
+    MmRebalanceMemoryConsumers();
+    KeWaitForSingleObject(&MiBalancerDoneEvent, Executive, KernelMode, FALSE, NULL);
+}
 
-    DPRINT("MM BALANCER: %s\n", Priority ? "Paging out!" : "Removing access bit!");
+/* The age lives in the 2 bits of the PFN's working set entry: 3 samples without an access is as cold as a page gets */
+#define MI_USER_PAGE_MAXIMUM_AGE    3
 
-    FirstPage = MmGetLRUFirstUserPage();
-    CurrentPage = FirstPage;
-    while (CurrentPage != 0 && Target > 0)
+/* How many pages the working set manager samples each second, the clock hand resumes where it stopped */
+#define MI_USER_PAGES_PER_SAMPLE    1024
+
+/* Pages unused for this many samples are taken when a process lowers its working set maximum */
+#define MI_USER_PAGE_PROCESS_TRIM_AGE   2
+
+/* Which working sets give their pages to a global trim, one pass each. Only a priority trim goes past the first */
+#define MI_WS_LIMIT_MAXIMUM     0   /* The ones above their maximum */
+#define MI_WS_LIMIT_MINIMUM     1   /* The ones above their minimum */
+#define MI_WS_LIMIT_NONE        2   /* Anybody, we are running out of pages */
+
+static
+BOOLEAN
+MiSampleUserPage(
+    _In_ PFN_NUMBER Page,
+    _In_ BOOLEAN ResetAccessed)
+{
+    PEPROCESS Process = NULL;
+    PVOID Address = NULL;
+    BOOLEAN Accessed = FALSE;
+
+    /*
+     * We have a lock-ordering problem here. We cant lock the PFN DB before the Process address space.
+     * So we must use circonvoluted loops.
+     * Well...
+     */
+    while (TRUE)
     {
-        if (Priority)
+        KAPC_STATE ApcState;
+        KIRQL OldIrql = MiAcquirePfnLock();
+        PMM_RMAP_ENTRY Entry = MmGetRmapListHeadPage(Page);
+        while (Entry)
         {
-            Status = MmPageOutPhysicalAddress(CurrentPage);
-            if (NT_SUCCESS(Status))
+            if (RMAP_IS_SEGMENT(Entry->Address))
             {
-                DPRINT("Succeeded\n");
-                Target--;
-                (*NrFreedPages)++;
-                if (CurrentPage == FirstPage)
-                {
-                    FirstPage = 0;
-                }
+                Entry = Entry->Next;
+                continue;
+            }
+
+            /* Check that we didn't treat this entry before */
+            if (Entry->Address < Address)
+            {
+                Entry = Entry->Next;
+                continue;
+            }
+
+            if ((Entry->Address == Address) && (Entry->Process <= Process))
+            {
+                Entry = Entry->Next;
+                continue;
             }
+
+            break;
         }
-        else
+
+        if (!Entry)
         {
-            /* When not paging-out agressively, just reset the accessed bit */
-            PEPROCESS Process = NULL;
-            PVOID Address = NULL;
-            BOOLEAN Accessed = FALSE;
-
-            /*
-             * We have a lock-ordering problem here. We cant lock the PFN DB before the Process address space.
-             * So we must use circonvoluted loops.
-             * Well...
-             */
-            while (TRUE)
-            {
-                KAPC_STATE ApcState;
-                KIRQL OldIrql = MiAcquirePfnLock();
-                PMM_RMAP_ENTRY Entry = MmGetRmapListHeadPage(CurrentPage);
-                while (Entry)
-                {
-                    if (RMAP_IS_SEGMENT(Entry->Address))
-                    {
-                        Entry = Entry->Next;
-                        continue;
-                    }
-
-                    /* Check that we didn't treat this entry before */
-                    if (Entry->Address < Address)
-                    {
-                        Entry = Entry->Next;
-                        continue;
-                    }
-
-                    if ((Entry->Address == Address) && (Entry->Process <= Process))
-                    {
-                        Entry = Entry->Next;
-                        continue;
-                    }
-
-                    break;
-                }
+            MiReleasePfnLock(OldIrql);
+            break;
+        }
 
-                if (!Entry)
-                {
-                    MiReleasePfnLock(OldIrql);
-                    break;
-                }
+        Process = Entry->Process;
+        Address = Entry->Address;
 
-                Process = Entry->Process;
-                Address = Entry->Address;
+        ObReferenceObject(Process);
 
-                ObReferenceObject(Process);
+        if (!ExAcquireRundownProtection(&Process->RundownProtect))
+        {
+            ObDereferenceObject(Process);
+            MiReleasePfnLock(OldIrql);
+            continue;
+        }
 
-                if (!ExAcquireRundownProtection(&Process->RundownProtect))
-                {
-                    ObDereferenceObject(Process);
-                    MiReleasePfnLock(OldIrql);
-                    continue;
-                }
+        MiReleasePfnLock(OldIrql);
 
-                MiReleasePfnLock(OldIrql);
+        KeStackAttachProcess(&Process->Pcb, &ApcState);
+        MiLockProcessWorkingSet(Process, PsGetCurrentThread());
 
-                KeStackAttachProcess(&Process->Pcb, &ApcState);
-                MiLockProcessWorkingSet(Process, PsGetCurrentThread());
+        /* Be sure this is still valid. */
+        if (MmIsAddressValid(Address))
+        {
+            PMMPTE Pte = MiAddressToPte(Address);
+            Accessed = Accessed || Pte->u.Hard.Accessed;
 
-                /* Be sure this is still valid. */
-                if (MmIsAddressValid(Address))
-                {
-                    PMMPTE Pte = MiAddressToPte(Address);
-                    Accessed = Accessed || Pte->u.Hard.Accessed;
-                    Pte->u.Hard.Accessed = 0;
+            /* Other processors may still cache the translation, MmAgeUserPages flushes them once per sweep */
+            if (ResetAccessed)
+                Pte->u.Hard.Accessed = 0;
+        }
 
-                    /* There is no need to invalidate, the balancer thread is never on a user process */
-                    //KeInvalidateTlbEntry(Address);
-                }
+        MiUnlockProcessWorkingSet(Process, PsGetCurrentThread());
+
+        KeUnstackDetachProcess(&ApcState);
+        ExReleaseRundownProtection(&Process->RundownProtect);
+        ObDereferenceObject(Process);
+    }
+
+    return Accessed;
+}
+
+static
+VOID
+MiUpdateUserPageAge(
+    _In_ PFN_NUMBER Page,
+    _In_ BOOLEAN Accessed)
+{
+    KIRQL OldIrql = MiAcquirePfnLock();
+    PMMPFN Pfn = MiGetPfnEntry(Page);
+
+    if (Accessed)
+        Pfn->Wsle.u1.e1.Age = 0;
+    else if (Pfn->Wsle.u1.e1.Age < MI_USER_PAGE_MAXIMUM_AGE)
+        Pfn->Wsle.u1.e1.Age++;
+
+    MiReleasePfnLock(OldIrql);
+}
 
-                MiUnlockProcessWorkingSet(Process, PsGetCurrentThread());
+static
+BOOLEAN
+MiIsWorkingSetWithinLimit(
+    _In_ PEPROCESS Process,
+    _In_ ULONG Limit)
+{
+    PMMSUPPORT Vm = &Process->Vm;
+    SIZE_T WorkingSetPages = Vm->WorkingSetSize >> PAGE_SHIFT;
+
+    switch (Limit)
+    {
+        case MI_WS_LIMIT_MAXIMUM:
+            return WorkingSetPages <= Vm->MaximumWorkingSetSize;
+        case MI_WS_LIMIT_MINIMUM:
+            return WorkingSetPages <= Vm->MinimumWorkingSetSize;
+        default:
+            return FALSE;
+    }
+}
 
-                KeUnstackDetachProcess(&ApcState);
-                ExReleaseRundownProtection(&Process->RundownProtect);
-                ObDereferenceObject(Process);
+/* Cheap checks under the PFN lock, before any mapping gets looked at */
+static
+BOOLEAN
+MiIsUserPageCandidate(
+    _In_ PFN_NUMBER Page,
+    _In_ ULONG MinimumAge,
+    _In_opt_ PEPROCESS Process,
+    _In_ ULONG Limit)
+{
+    KIRQL OldIrql = MiAcquirePfnLock();
+    PMMPFN Pfn = MiGetPfnEntry(Page);
+    BOOLEAN Candidate;
+
+    Candidate = (Pfn->Wsle.u1.e1.Age >= MinimumAge) &&
+                !Pfn->Wsle.u1.e1.LockedInWs &&
+                !Pfn->Wsle.u1.e1.LockedInMemory;
+
+    /* When working for one process, leave alone the pages someone else maps too */
+    if (Candidate && Process)
+    {
+        PMM_RMAP_ENTRY Entry;
+        BOOLEAN Mapped = FALSE;
+
+        for (Entry = MmGetRmapListHeadPage(Page); Entry; Entry = Entry->Next)
+        {
+            if (RMAP_IS_SEGMENT(Entry->Address))
+                continue;
+
+            if (Entry->Process != Process)
+            {
+                Candidate = FALSE;
+                break;
             }
 
-            if (!Accessed)
+            Mapped = TRUE;
+        }
+
+        Candidate = Candidate && Mapped;
+    }
+
+    /* Otherwise a page stays as long as one of the processes mapping it is within its limit */
+    if (Candidate && !Process && (Limit != MI_WS_LIMIT_NONE))
+    {
+        PMM_RMAP_ENTRY Entry;
+
+        for (Entry = MmGetRmapListHeadPage(Page); Entry; Entry = Entry->Next)
+        {
+            if (RMAP_IS_SEGMENT(Entry->Address))
+                continue;
+
+            if (MiIsWorkingSetWithinLimit(Entry->Process, Limit))
             {
-                /* Nobody accessed this page since the last time we check. Time to clean up */
+                Candidate = FALSE;
+                break;
+            }
+        }
+    }
+
+    MiReleasePfnLock(OldIrql);
+    return Candidate;
+}
+
+static
+VOID
+MiAgeUserPages(
+    _In_ ULONG Count,
+    _In_opt_ PEPROCESS Process)
+{
+    PFN_NUMBER CurrentPage;
+
+    CurrentPage = MmGetLRUFirstUserPage();
+    while (CurrentPage != 0 && Count-- > 0)
+    {
+        if (MiIsUserPageCandidate(CurrentPage, 0, Process, MI_WS_LIMIT_NONE))
+        {
+            MiUpdateUserPageAge(CurrentPage, MiSampleUserPage(CurrentPage, TRUE));
+        }
+
+        /* Sampled pages go to the end of the list, so the next sweep starts with the ones we didn't get to */
+        CurrentPage = MmGetLRUNextUserPage(CurrentPage, TRUE);
+    }
+
+    if (CurrentPage)
+    {
+        KIRQL OldIrql = MiAcquirePfnLock();
+        MmDereferencePage(CurrentPage);
+        MiReleasePfnLock(OldIrql);
+    }
+
+    /* Processors which cached a translation don't set its accessed bit again until it is flushed */
+    KeFlushEntireTb(TRUE, TRUE);
+}
+
+static
+ULONG
+MiTrimUserPages(
+    _In_ ULONG Target,
+    _In_ ULONG MinimumAge,
+    _In_opt_ PEPROCESS Process,
+    _In_ ULONG Limit)
+{
+    PFN_NUMBER CurrentPage;
+    ULONG Count = MiMemoryConsumers[MC_USER].PagesUsed;
+    ULONG NrFreedPages = 0;
+    NTSTATUS Status;
 
+    CurrentPage = MmGetLRUFirstUserPage();
+    while (CurrentPage != 0 && Count-- > 0 && NrFreedPages < Target)
+    {
+        if (MiIsUserPageCandidate(CurrentPage, MinimumAge, Process, Limit))
+        {
+            /* A page used since it was last sampled is hot again, whatever its age says */
+            if (MinimumAge && MiSampleUserPage(CurrentPage, FALSE))
+            {
+                MiUpdateUserPageAge(CurrentPage, TRUE);
+            }
+            else
+            {
                 Status = MmPageOutPhysicalAddress(CurrentPage);
                 if (NT_SUCCESS(Status))
                 {
-                    if (CurrentPage == FirstPage)
-                    {
-                        FirstPage = 0;
-                    }
+                    DPRINT("Succeeded\n");
+                    NrFreedPages++;
                 }
-                // DPRINT1("Paged-out one page: %s\n", NT_SUCCESS(Status) ? "Yes" : "No");
             }
-
-            /* Done for this page. */
-            Target--;
         }
 
         CurrentPage = MmGetLRUNextUserPage(CurrentPage, TRUE);
-        if (FirstPage == 0)
-        {
-            FirstPage = CurrentPage;
-        }
-        else if (CurrentPage == FirstPage)
-        {
-            DPRINT1("We are back at the start, abort!\n");
-            return STATUS_SUCCESS;
-        }
     }
 
     if (CurrentPage)
@@ -282,30 +447,92 @@ MmTrimUserMemory(ULONG Target, ULONG Priority, PULONG NrFreedPages)
         MiReleasePfnLock(OldIrql);
     }
 
-    return STATUS_SUCCESS;
+    return NrFreedPages;
 }
 
 VOID
 NTAPI
-MmRebalanceMemoryConsumers(VOID)
+MmAgeUserPages(VOID)
 {
-    if (InterlockedCompareExchange(&PageOutThreadActive, 1, 0) == 0)
+    MiAgeUserPages(MI_USER_PAGES_PER_SAMPLE, NULL);
+}
+
+NTSTATUS
+MmTrimUserMemory(ULONG Target, ULONG Priority, PULONG NrFreedPages)
+{
+    ULONG MinimumAge;
+    ULONG Limit;
+
+    (*NrFreedPages) = 0;
+
+    DPRINT("MM BALANCER: %s\n", Priority ? "Paging out!" : "Paging out cold pages!");
+
+    /* The working sets above their maximum give first. Only a priority trim goes on to the others */
+    for (Limit = MI_WS_LIMIT_MAXIMUM; (*NrFreedPages) < Target; Limit++)
     {
-        KeSetEvent(&MiBalancerEvent, IO_NO_INCREMENT, FALSE);
+        /* Coldest pages first. Only a priority trim goes on to the pages used since the last sample */
+        for (MinimumAge = MI_USER_PAGE_MAXIMUM_AGE; (*NrFreedPages) < Target; MinimumAge--)
+        {
+            (*NrFreedPages) += MiTrimUserPages(Target - (*NrFreedPages), MinimumAge, NULL, Limit);
+
+            if (MinimumAge == (Priority ? 0 : 1))
+                break;
+        }
+
+        if (!Priority || (Limit == MI_WS_LIMIT_NONE))
+            break;
     }
+
+    return STATUS_SUCCESS;
 }
 
+static
 VOID
+MiTrimProcessUserPages(
+    _Inout_ PMM_TRIM_PROCESS_REQUEST Request)
+{
+    ULONG MinimumAge;
+
+    /* Take a fresh sample of the pages only this process maps, then page out the cold ones */
+    MiAgeUserPages(MiMemoryConsumers[MC_USER].PagesUsed, Request->Process);
+
+    for (MinimumAge = MI_USER_PAGE_MAXIMUM_AGE;
+         MinimumAge >= MI_USER_PAGE_PROCESS_TRIM_AGE && Request->Trimmed < Request->Target;
+         MinimumAge--)
+    {
+        Request->Trimmed += MiTrimUserPages(Request->Target - Request->Trimmed,
+                                            MinimumAge,
+                                            Request->Process,
+                                            MI_WS_LIMIT_NONE);
+    }
+}
+
+ULONG
 NTAPI
-MmRebalanceMemoryConsumersAndWait(VOID)
+MmTrimProcessUserPages(
+    _In_ PEPROCESS Process,
+    _In_ ULONG Target)
 {
-    ASSERT(PsGetCurrentProcess()->AddressCreationLock.Owner != KeGetCurrentThread());
-    ASSERT(!MM_ANY_WS_LOCK_HELD(PsGetCurrentThread()));
-    ASSERT(KeGetCurrentIrql() < DISPATCH_LEVEL);
+    ULONG Trimmed;
 
-    KeResetEvent(&MiBalancerDoneEvent);
-    MmRebalanceMemoryConsumers();
-    KeWaitForSingleObject(&MiBalancerDoneEvent, Executive, KernelMode, FALSE, NULL);
+    KeAcquireGuardedMutex(&MiTrimProcessLock);
+
+    MiTrimProcessRequest.Trimmed = 0;
+    MiTrimProcessRequest.Target = Target;
+    InterlockedExchangePointer((PVOID*)&MiTrimProcessRequest.Process, Process);
+
+    /* Paging out attaches to every process mapping the page and may wait for I/O, leave it to the balancer thread */
+    do
+    {
+        MmRebalanceMemoryConsumersAndWait();
+    }
+    while (InterlockedCompareExchangePointer((PVOID*)&MiTrimProcessRequest.Process, NULL, NULL) != NULL);
+
+    Trimmed = MiTrimProcessRequest.Trimmed;
+
+    KeReleaseGuardedMutex(&MiTrimProcessLock);
+
+    return Trimmed;
 }
 
 NTSTATUS
@@ -377,6 +604,19 @@ MiBalancerThread(PVOID Unused)
             ULONG Target;
             ULONG NrFreedPages;
 
+            /* Someone lowered the working set maximum of a process */
+            if (MiTrimProcessRequest.Process)
+            {
+                MiTrimProcessUserPages(&MiTrimProcessRequest);
+                InterlockedExchangePointer((PVOID*)&MiTrimProcessRequest.Process, NULL);
+            }
+
+            /* Take the cold pages of the working sets above their maximum first, they are the cheapest to lose */
+            if (MmAvailablePages < MmPlentyFreePages)
+            {
+                MmTrimUserMemory((ULONG)(MmPlentyFreePages - MmAvailablePages), FALSE, &NrFreedPages);
+            }
+
             do
             {
                 ULONG OldTarget = InitialTarget;
@@ -239,6 +239,15 @@ MmAccessFault(IN ULONG FaultCode,
 #endif
     }
 
+    /* Count the faults of the process, the working set manager grows the ones which fault a lot */
+    if ((Address <= MM_HIGHEST_USER_ADDRESS) && MI_IS_NOT_PRESENT_FAULT(FaultCode))
+    {
+        PEPROCESS Process = PsGetCurrentProcess();
+
+        InterlockedIncrementUL(&Process->Vm.PageFaultCount);
+        InterlockedIncrementUL(&Process->Vm.GrowthSinceLastEstimate);
+    }
+
     /* Handle shared user page / page table, which don't have a VAD / MemoryArea */
     if ((PAGE_ALIGN(Address) == (PVOID)MM_SHARED_USER_DATA_VA) ||
         MI_IS_PAGE_TABLE_ADDRESS(Address))
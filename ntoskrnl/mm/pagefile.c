@@ -100,6 +100,14 @@ static PFN_COUNT MiReservedSwapPages;
 /* Make sure there can be only 16 paging files */
 C_ASSERT(FILE_FROM_ENTRY(0xffffffff) < MAX_PAGING_FILES);
 
+static
+NTSTATUS
+MiReadPageFileCluster(
+    _In_ PPFN_NUMBER Pages,
+    _In_ ULONG PageCount,
+    _In_ ULONG PageFileIndex,
+    _In_ ULONG_PTR PageFileOffset);
+
 static BOOLEAN MmSwapSpaceMessage = FALSE;
 
 static BOOLEAN MmSystemPageFileLocated = FALSE;
@@ -206,20 +214,47 @@ MmReadFromSwapPage(SWAPENTRY SwapEntry, PFN_NUMBER Page)
     return MiReadPageFile(Page, FILE_FROM_ENTRY(SwapEntry), OFFSET_FROM_ENTRY(SwapEntry));
 }
 
+NTSTATUS
+NTAPI
+MmReadFromSwapPages(SWAPENTRY SwapEntry, PPFN_NUMBER Pages, ULONG PageCount)
+{
+    return MiReadPageFileCluster(Pages, PageCount, FILE_FROM_ENTRY(SwapEntry), OFFSET_FROM_ENTRY(SwapEntry));
+}
+
+SWAPENTRY
+NTAPI
+MmGetNextSwapEntry(SWAPENTRY SwapEntry)
+{
+    /* The entry of the following page in the same paging file */
+    return ENTRY_FROM_FILE_OFFSET(FILE_FROM_ENTRY(SwapEntry), OFFSET_FROM_ENTRY(SwapEntry) + 1);
+}
+
 NTSTATUS
 NTAPI
 MiReadPageFile(
     _In_ PFN_NUMBER Page,
     _In_ ULONG PageFileIndex,
     _In_ ULONG_PTR PageFileOffset)
+{
+    return MiReadPageFileCluster(&Page, 1, PageFileIndex, PageFileOffset);
+}
+
+static
+NTSTATUS
+MiReadPageFileCluster(
+    _In_ PPFN_NUMBER Pages,
+    _In_ ULONG PageCount,
+    _In_ ULONG PageFileIndex,
+    _In_ ULONG_PTR PageFileOffset)
 {
     LARGE_INTEGER file_offset;
     IO_STATUS_BLOCK Iosb;
     NTSTATUS Status;
     KEVENT Event;
-    UCHAR MdlBase[sizeof(MDL) + sizeof(PFN_NUMBER)];
+    UCHAR MdlBase[sizeof(MDL) + MM_MAXIMUM_SWAP_CLUSTER * sizeof(PFN_NUMBER)];
     PMDL Mdl = (PMDL)MdlBase;
     PMMPAGING_FILE PagingFile;
+    PKPRCB Prcb;
 
     DPRINT("MiReadSwapFile\n");
 
@@ -229,6 +264,8 @@ MiReadPageFile(
         return(STATUS_UNSUCCESSFUL);
     }
 
+    ASSERT(PageCount != 0 && PageCount <= MM_MAXIMUM_SWAP_CLUSTER);
+
     /* Normalize offset. */
     PageFileOffset--;
 
@@ -242,11 +279,16 @@ MiReadPageFile(
         KeBugCheck(MEMORY_MANAGEMENT);
     }
 
-    MmInitializeMdl(Mdl, NULL, PAGE_SIZE);
-    MmBuildMdlFromPages(Mdl, &Page);
+    MmInitializeMdl(Mdl, NULL, PageCount * PAGE_SIZE);
+    MmBuildMdlFromPages(Mdl, Pages);
     Mdl->MdlFlags |= MDL_PAGES_LOCKED | MDL_IO_PAGE_READ;
 
-    file_offset.QuadPart = PageFileOffset * PAGE_SIZE;
+    file_offset.QuadPart = (LONGLONG)PageFileOffset * PAGE_SIZE;
+
+    /* Account the paging I/O */
+    Prcb = KeGetCurrentPrcb();
+    Prcb->MmPageReadCount += PageCount;
+    Prcb->MmPageReadIoCount++;
 
     KeInitializeEvent(&Event, NotificationEvent, FALSE);
     Status = IoPageRead(PagingFile->FileObject,
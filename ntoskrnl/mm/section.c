@@ -60,6 +60,15 @@ extern MMSESSION MmSession;
 
 static LARGE_INTEGER TinyTime = {{-1L, -1L}};
 
+/*
+ * Hard fault clustering. The cluster of a view grows while its faults are
+ * sequential and shrinks otherwise. The largest one must fit in the page
+ * bitmap of MmMakeSegmentResident.
+ */
+#define MM_MINIMUM_FAULT_CLUSTER    (4 * PAGE_SIZE)
+#define MM_DEFAULT_FAULT_CLUSTER    _64K
+#define MM_MAXIMUM_FAULT_CLUSTER    (RTL_BITS_OF(ULONG) * PAGE_SIZE)
+
 #ifndef NEWCC
 KEVENT MmWaitPageEvent;
 
@@ -1184,6 +1193,55 @@ MiCopyFromUserPage(PFN_NUMBER DestPage, const VOID *SrcAddress)
     return STATUS_SUCCESS;
 }
 
+static
+ULONG
+MmGetFaultClusterLimit(VOID)
+{
+    /* Don't make things worse when memory is scarce */
+    if (MmAvailablePages <= MmLowMemoryThreshold)
+        return PAGE_SIZE;
+
+    if (MmAvailablePages < MmPlentyFreePages)
+        return MM_MINIMUM_FAULT_CLUSTER;
+
+    return MM_MAXIMUM_FAULT_CLUSTER;
+}
+
+static
+ULONG
+MmGetFaultClusterSize(
+    _In_ PMEMORY_AREA MemoryArea,
+    _In_ LONGLONG Offset)
+{
+    ULONG ClusterSize = MemoryArea->SectionData.FaultClusterSize;
+    ULONG MinimumSize;
+
+    /* Code is seldom faulted in order, but it has locality: keep 64K there */
+    if (MemoryArea->VadNode.u.VadFlags.VadType == VadImageMap)
+        MinimumSize = MM_DEFAULT_FAULT_CLUSTER;
+    else
+        MinimumSize = MM_MINIMUM_FAULT_CLUSTER;
+
+    if (Offset == MemoryArea->SectionData.NextFaultOffset)
+    {
+        /* We are right behind the previous cluster, read more */
+        ClusterSize = min(ClusterSize * 2, MM_MAXIMUM_FAULT_CLUSTER);
+    }
+    else
+    {
+        /* Random access, read less */
+        ClusterSize = max(ClusterSize / 2, MinimumSize);
+    }
+    MemoryArea->SectionData.FaultClusterSize = ClusterSize;
+
+    ClusterSize = min(ClusterSize, MmGetFaultClusterLimit());
+
+    /* This is where the next fault will be, if the view is read sequentially */
+    MemoryArea->SectionData.NextFaultOffset = Offset - (Offset % ClusterSize) + ClusterSize;
+
+    return ClusterSize;
+}
+
 static
 NTSTATUS
 NTAPI
@@ -1192,35 +1250,39 @@ MmMakeSegmentResident(
     _In_ LONGLONG Offset,
     _In_ ULONG Length,
     _In_opt_ PLARGE_INTEGER ValidDataLength,
-    _In_ BOOLEAN SetDirty)
+    _In_ BOOLEAN SetDirty,
+    _In_ ULONG ClusterSize,
+    _Out_opt_ PULONG PagesRead)
 {
-    /* Let's use a 64K granularity. */
     LONGLONG RangeStart, RangeEnd;
     NTSTATUS Status;
     PFILE_OBJECT FileObject = Segment->FileObject;
+    PKPRCB Prcb;
+
+    ASSERT(ClusterSize >= PAGE_SIZE && ClusterSize <= MM_MAXIMUM_FAULT_CLUSTER);
+    ASSERT((ClusterSize & (ClusterSize - 1)) == 0);
+
+    if (PagesRead)
+        *PagesRead = 0;
 
-    /* Calculate our range, aligned on 64K if possible. */
+    /* Calculate our range, aligned on the cluster size if possible. */
     Status = RtlLongLongAdd(Offset, Length, &RangeEnd);
     ASSERT(NT_SUCCESS(Status));
     if (!NT_SUCCESS(Status))
         return Status;
 
-    /* If the file is not random access and we are not the page out thread
-     * read a 64K Chunk. */
-    if (((ULONG_PTR)IoGetTopLevelIrp() != FSRTL_MOD_WRITE_TOP_LEVEL_IRP)
-        && !FlagOn(FileObject->Flags, FO_RANDOM_ACCESS))
+    /* If the file is random access or we are the page out thread, only
+     * read what was asked. */
+    if (((ULONG_PTR)IoGetTopLevelIrp() == FSRTL_MOD_WRITE_TOP_LEVEL_IRP)
+        || FlagOn(FileObject->Flags, FO_RANDOM_ACCESS))
     {
-        RangeStart = Offset - (Offset % _64K);
-        if (RangeEnd % _64K)
-            RangeEnd += _64K - (RangeEnd % _64K);
-    }
-    else
-    {
-        RangeStart = Offset  - (Offset % PAGE_SIZE);
-        if (RangeEnd % PAGE_SIZE)
-            RangeEnd += PAGE_SIZE - (RangeEnd % PAGE_SIZE);
+        ClusterSize = PAGE_SIZE;
     }
 
+    RangeStart = Offset - (Offset % ClusterSize);
+    if (RangeEnd % ClusterSize)
+        RangeEnd += ClusterSize - (RangeEnd % ClusterSize);
+
     /* Clamp if needed */
     if (!FlagOn(*Segment->Flags, MM_DATAFILE_SEGMENT))
     {
@@ -1229,11 +1291,11 @@ MmMakeSegmentResident(
     }
 
     /* Let's gooooooooo */
-    for ( ; RangeStart < RangeEnd; RangeStart += _64K)
+    for ( ; RangeStart < RangeEnd; RangeStart += ClusterSize)
     {
         /* First take a look at where we miss pages */
         ULONG ToReadPageBits = 0;
-        LONGLONG ChunkEnd = RangeStart + _64K;
+        LONGLONG ChunkEnd = RangeStart + ClusterSize;
 
         if (ChunkEnd > RangeEnd)
             ChunkEnd = RangeEnd;
@@ -1315,10 +1377,14 @@ MmMakeSegmentResident(
             ASSERT(ChunkOffset < ChunkEnd);
 
             /* Get the range we have to read */
-            _BitScanForward(&BitSet, ~ToReadPageBits);
+            if (!_BitScanForward(&BitSet, ~ToReadPageBits))
+            {
+                /* The whole cluster is missing */
+                BitSet = RTL_BITS_OF(ULONG);
+            }
             ULONG ReadLength = BitSet * PAGE_SIZE;
 
-            ASSERT(ReadLength <= _64K);
+            ASSERT(ReadLength <= MM_MAXIMUM_FAULT_CLUSTER);
 
             /* Clamp (This is for image mappings */
             if ((ChunkOffset + ReadLength) > ChunkEnd)
@@ -1383,6 +1449,11 @@ MmMakeSegmentResident(
             KEVENT Event;
             KeInitializeEvent(&Event, NotificationEvent, FALSE);
 
+            /* Account the paging I/O */
+            Prcb = KeGetCurrentPrcb();
+            Prcb->MmPageReadCount += BYTES_TO_PAGES(ReadLength);
+            Prcb->MmPageReadIoCount++;
+
             /* Disable APCs */
             KIRQL OldIrql;
             KeRaiseIrql(APC_LEVEL, &OldIrql);
@@ -1453,6 +1524,12 @@ AssignPagesToSegment:
             MmUnlockSectionSegment(Segment);
 
             IoFreeMdl(Mdl);
+            if (PagesRead)
+                *PagesRead += BYTES_TO_PAGES(ReadLength);
+
+            /* Shifting by the full width is undefined */
+            if (BitSet == RTL_BITS_OF(ULONG))
+                break;
             ToReadPageBits >>= BitSet;
             ChunkOffset += BitSet * PAGE_SIZE;
         }
@@ -1551,6 +1628,19 @@ MmAlterViewAttributes(PMMSUPPORT AddressSpace,
     MmUnlockSectionSegment(Segment);
 }
 
+static
+VOID
+MmUpdateHardFaultCounters(
+    _In_ PEPROCESS Process,
+    _In_ ULONG PageCount)
+{
+    /* The address space lock protects those */
+    Process->HardFaultCount++;
+    Process->HardFaultPageCount += PageCount;
+    if (PageCount > Process->PeakFaultClusterSize)
+        Process->PeakFaultClusterSize = PageCount;
+}
+
 NTSTATUS
 NTAPI
 MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
@@ -1570,6 +1660,8 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
     PVOID PAddress;
     PEPROCESS Process = MmGetAddressSpaceOwner(AddressSpace);
     SWAPENTRY SwapEntry;
+    ULONG ClusterSize;
+    ULONG PagesRead;
 
     ASSERT(Locked);
 
@@ -1676,6 +1768,8 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
         }
 
         MmLockAddressSpace(AddressSpace);
+        if (Process)
+            MmUpdateHardFaultCounters(Process, 1);
         MmDeletePageFileMapping(Process, PAddress, &DummyEntry);
         ASSERT(DummyEntry == MM_WAIT_ENTRY);
 
@@ -1752,6 +1846,20 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
         Attributes = Region->Protect;
     }
 
+    /* Let the prefetcher trace file backed faults */
+    if (Segment->FileObject)
+    {
+        if (MemoryArea->VadNode.u.VadFlags.VadType == VadImageMap)
+        {
+            CcPfLogPageFault(Segment->FileObject,
+                             (ULONG)((Segment->Image.VirtualAddress + Offset.QuadPart) >> PAGE_SHIFT),
+                             TRUE);
+        }
+        else
+        {
+            CcPfLogPageFault(Segment->FileObject, (ULONG)(Offset.QuadPart >> PAGE_SHIFT), FALSE);
+        }
+    }
 
     /*
      * Get the entry corresponding to the offset within the section
@@ -1792,6 +1900,10 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
         }
 
         MmUnlockSectionSegment(Segment);
+
+        /* Pick the cluster size while we still own the view */
+        ClusterSize = MmGetFaultClusterSize(MemoryArea, Offset.QuadPart);
+
         MmUnlockAddressSpace(AddressSpace);
 
         /* The data must be paged in. Lock the file, so that the VDL doesn't get updated behind us. */
@@ -1799,7 +1911,7 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
 
         PFSRTL_COMMON_FCB_HEADER FcbHeader = Segment->FileObject->FsContext;
 
-        Status = MmMakeSegmentResident(Segment, Offset.QuadPart, PAGE_SIZE, &FcbHeader->ValidDataLength, FALSE);
+        Status = MmMakeSegmentResident(Segment, Offset.QuadPart, PAGE_SIZE, &FcbHeader->ValidDataLength, FALSE, ClusterSize, &PagesRead);
 
         FsRtlReleaseFile(Segment->FileObject);
 
@@ -1816,12 +1928,18 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
             return STATUS_IN_PAGE_ERROR;
         }
 
+        if (Process && PagesRead)
+            MmUpdateHardFaultCounters(Process, PagesRead);
+
         /* Everything went fine. Restart the operation */
         return STATUS_MM_RESTART_OPERATION;
     }
     else if (IS_SWAP_FROM_SSE(Entry))
     {
-        SWAPENTRY SwapEntry;
+        SWAPENTRY SwapEntry, NextSwapEntry;
+        PFN_NUMBER Pages[MM_MAXIMUM_SWAP_CLUSTER];
+        LARGE_INTEGER ClusterOffset;
+        ULONG MaximumCount;
 
         SwapEntry = SWAPENTRY_FROM_SSE(Entry);
 
@@ -1846,11 +1964,37 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
         * Release all our locks and read in the page from disk
         */
         MmSetPageEntrySectionSegment(Segment, &Offset, MAKE_SWAP_SSE(MM_WAIT_ENTRY));
+
+        /*
+         * Pages written out together usually got adjacent paging file
+         * entries. Bring the following ones of the segment along, as long
+         * as they are still in the paging file, in the same order.
+         */
+        Pages[0] = Page;
+        MaximumCount = min(MM_MAXIMUM_SWAP_CLUSTER, MmGetFaultClusterLimit() >> PAGE_SHIFT);
+        NextSwapEntry = SwapEntry;
+        for (PagesRead = 1; PagesRead < MaximumCount; PagesRead++)
+        {
+            ClusterOffset.QuadPart = Offset.QuadPart + ((LONGLONG)PagesRead << PAGE_SHIFT);
+            if (ClusterOffset.QuadPart >= Segment->Length.QuadPart)
+                break;
+
+            NextSwapEntry = MmGetNextSwapEntry(NextSwapEntry);
+            Entry1 = MmGetPageEntrySectionSegment(Segment, &ClusterOffset);
+            if (!IS_SWAP_FROM_SSE(Entry1) || (SWAPENTRY_FROM_SSE(Entry1) != NextSwapEntry))
+                break;
+
+            /* Don't wait for memory for pages nobody asked for yet */
+            if (!NT_SUCCESS(MmRequestPageMemoryConsumer(MC_USER, FALSE, &Pages[PagesRead])))
+                break;
+
+            MmSetPageEntrySectionSegment(Segment, &ClusterOffset, MAKE_SWAP_SSE(MM_WAIT_ENTRY));
+        }
         MmUnlockSectionSegment(Segment);
 
         MmUnlockAddressSpace(AddressSpace);
 
-        Status = MmReadFromSwapPage(SwapEntry, Page);
+        Status = MmReadFromSwapPages(SwapEntry, Pages, PagesRead);
         if (!NT_SUCCESS(Status))
         {
             KeBugCheck(MEMORY_MANAGEMENT);
@@ -1878,6 +2022,22 @@ MmNotPresentFaultSectionView(PMMSUPPORT AddressSpace,
          */
         MmSetSavedSwapEntryPage(Page, SwapEntry);
 
+        /* The other pages of the cluster are resident now, but not mapped */
+        NextSwapEntry = SwapEntry;
+        for (ULONG i = 1; i < PagesRead; i++)
+        {
+            ClusterOffset.QuadPart = Offset.QuadPart + ((LONGLONG)i << PAGE_SHIFT);
+            NextSwapEntry = MmGetNextSwapEntry(NextSwapEntry);
+
+            ASSERT(MM_IS_WAIT_PTE(MmGetPageEntrySectionSegment(Segment, &ClusterOffset)));
+
+            MmSetSavedSwapEntryPage(Pages[i], NextSwapEntry);
+            MmSetPageEntrySectionSegment(Segment, &ClusterOffset, MAKE_SSE(Pages[i] << PAGE_SHIFT, 0));
+        }
+
+        if (Process)
+            MmUpdateHardFaultCounters(Process, PagesRead);
+
         /* Map the page into the process address space */
         Status = MmCreateVirtualMapping(Process,
                                         PAddress,
@@ -3462,6 +3622,8 @@ MmMapViewOfSegment(
 
     MArea->SectionData.Segment = Segment;
     MArea->SectionData.ViewOffset = ViewOffset;
+    MArea->SectionData.NextFaultOffset = -1;
+    MArea->SectionData.FaultClusterSize = MM_DEFAULT_FAULT_CLUSTER;
     if (AsImage)
     {
         MArea->VadNode.u.VadFlags.VadType = VadImageMap;
@@ -5044,13 +5206,81 @@ MmMakeDataSectionResident(
     /* There must be a segment for this call */
     ASSERT(Segment);
 
-    NTSTATUS Status = MmMakeSegmentResident(Segment, Offset, Length, ValidDataLength, FALSE);
+    NTSTATUS Status = MmMakeSegmentResident(Segment, Offset, Length, ValidDataLength, FALSE, MM_DEFAULT_FAULT_CLUSTER, NULL);
 
     MmDereferenceSegment(Segment);
 
     return Status;
 }
 
+NTSTATUS
+NTAPI
+MmPrefetchSectionPages(
+    _In_ PVOID SectionObject,
+    _In_ ULONG StartPage,
+    _In_ ULONG PageCount)
+{
+    PSECTION Section = SectionObject;
+    PMM_IMAGE_SECTION_OBJECT ImageSectionObject;
+    PMM_SECTION_SEGMENT Segments, Segment;
+    PFSRTL_COMMON_FCB_HEADER FcbHeader;
+    LONGLONG RangeStart, RangeEnd, Start, End;
+    ULONG i, NrSegments;
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    PAGED_CODE();
+
+    /* Pages are relative to the image base for images, to the file start otherwise */
+    if (Section->u.Flags.Image)
+    {
+        ImageSectionObject = (PMM_IMAGE_SECTION_OBJECT)Section->Segment;
+        Segments = ImageSectionObject->Segments;
+        NrSegments = ImageSectionObject->NrSegments;
+    }
+    else
+    {
+        Segments = (PMM_SECTION_SEGMENT)Section->Segment;
+        NrSegments = 1;
+    }
+
+    RangeStart = (LONGLONG)StartPage << PAGE_SHIFT;
+    RangeEnd = RangeStart + ((LONGLONG)PageCount << PAGE_SHIFT);
+
+    for (i = 0; i < NrSegments; i++)
+    {
+        Segment = &Segments[i];
+        if (!Segment->FileObject)
+            continue;
+
+        /* Only the part of the segment which is backed by the file can be read */
+        Start = max(RangeStart, (LONGLONG)Segment->Image.VirtualAddress);
+        End = min(RangeEnd, (LONGLONG)Segment->Image.VirtualAddress + Segment->RawLength.QuadPart);
+        if (Start >= End)
+            continue;
+
+        if ((End - Start) > MAXULONG - PAGE_SIZE)
+            End = Start + (MAXULONG & ~(PAGE_SIZE - 1));
+
+        FsRtlAcquireFileExclusive(Segment->FileObject);
+
+        FcbHeader = Segment->FileObject->FsContext;
+        Status = MmMakeSegmentResident(Segment,
+                                       Start - Segment->Image.VirtualAddress,
+                                       (ULONG)(End - Start),
+                                       &FcbHeader->ValidDataLength,
+                                       FALSE,
+                                       MM_MAXIMUM_FAULT_CLUSTER,
+                                       NULL);
+
+        FsRtlReleaseFile(Segment->FileObject);
+
+        if (!NT_SUCCESS(Status))
+            break;
+    }
+
+    return Status;
+}
+
 NTSTATUS
 NTAPI
 MmMakeSegmentDirty(
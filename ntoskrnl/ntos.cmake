@@ -39,6 +39,7 @@ else()
         ${REACTOS_SOURCE_DIR}/ntoskrnl/cc/lazywrite.c
         ${REACTOS_SOURCE_DIR}/ntoskrnl/cc/mdl.c
         ${REACTOS_SOURCE_DIR}/ntoskrnl/cc/pin.c
+        ${REACTOS_SOURCE_DIR}/ntoskrnl/cc/prefetch.c
         ${REACTOS_SOURCE_DIR}/ntoskrnl/cc/view.c)
 endif()
 
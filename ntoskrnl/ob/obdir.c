@@ -19,8 +19,130 @@
 
 POBJECT_TYPE ObpDirectoryObjectType = NULL;
 
+/* Average chain length above which a directory gets more buckets */
+#define OBP_DIRECTORY_LOAD_FACTOR   4
+
+/* Bucket counts a directory goes through, they must fit in the USHORT hash index */
+static const ULONG ObpDirectoryBucketCounts[] =
+{
+    NUMBER_HASH_BUCKETS, 251, 1021, 4093, 16381, 65521
+};
+
 /* PRIVATE FUNCTIONS ******************************************************/
 
+FORCEINLINE
+ULONG
+ObpGetDirectoryBucketCount(IN POBJECT_DIRECTORY Directory)
+{
+    /* Small directories only use their own buckets */
+    return Directory->ExtendedBuckets ? Directory->ExtendedBucketCount :
+                                        NUMBER_HASH_BUCKETS;
+}
+
+FORCEINLINE
+POBJECT_DIRECTORY_ENTRY*
+ObpGetDirectoryBucket(IN POBJECT_DIRECTORY Directory,
+                      IN ULONG HashIndex)
+{
+    ASSERT(HashIndex < ObpGetDirectoryBucketCount(Directory));
+    return Directory->ExtendedBuckets ? &Directory->ExtendedBuckets[HashIndex] :
+                                        &Directory->HashBuckets[HashIndex];
+}
+
+/*++
+* @name ObpGrowDirectory
+*
+*     The ObpGrowDirectory routine moves the entries of a directory to a
+*     larger hash table, so that lookups keep walking short chains.
+*
+* @param Directory
+*        Directory to grow. It must be locked exclusively.
+*
+* @return None.
+*
+* @remarks Failing to allocate the new table is not an error, the directory
+*          simply keeps its current buckets.
+*
+*--*/
+VOID
+NTAPI
+ObpGrowDirectory(IN POBJECT_DIRECTORY Directory)
+{
+    POBJECT_DIRECTORY_ENTRY *NewBuckets, *OldBucket;
+    POBJECT_DIRECTORY_ENTRY CurrentEntry;
+    ULONG OldCount, NewCount, i;
+
+    /* Find the next size */
+    OldCount = ObpGetDirectoryBucketCount(Directory);
+    for (i = 0; i < RTL_NUMBER_OF(ObpDirectoryBucketCounts); i++)
+    {
+        if (ObpDirectoryBucketCounts[i] > OldCount) break;
+    }
+
+    /* Already as large as it gets */
+    if (i == RTL_NUMBER_OF(ObpDirectoryBucketCounts)) return;
+    NewCount = ObpDirectoryBucketCounts[i];
+
+    /* Allocate the new table */
+    NewBuckets = ExAllocatePoolZero(PagedPool,
+                                    NewCount * sizeof(POBJECT_DIRECTORY_ENTRY),
+                                    OB_DIR_HASH_TAG);
+    if (!NewBuckets) return;
+
+    /* Move every entry to its new chain, the hash was saved for this */
+    for (i = 0; i < OldCount; i++)
+    {
+        OldBucket = ObpGetDirectoryBucket(Directory, i);
+        while ((CurrentEntry = *OldBucket))
+        {
+            *OldBucket = CurrentEntry->ChainLink;
+            CurrentEntry->ChainLink = NewBuckets[CurrentEntry->HashValue % NewCount];
+            NewBuckets[CurrentEntry->HashValue % NewCount] = CurrentEntry;
+        }
+    }
+
+    /* Free the previous table if it was already an extended one */
+    if (Directory->ExtendedBuckets)
+    {
+        ExFreePoolWithTag(Directory->ExtendedBuckets, OB_DIR_HASH_TAG);
+    }
+
+    /* And switch to the new one */
+    Directory->ExtendedBuckets = NewBuckets;
+    Directory->ExtendedBucketCount = NewCount;
+
+    DPRINT("OB: Directory %p now has %lu buckets for %lu entries\n",
+           Directory, NewCount, Directory->EntryCount);
+}
+
+/*++
+* @name ObpDeleteDirectory
+*
+*     The ObpDeleteDirectory routine is the delete procedure of directory
+*     objects. It frees the extended hash table, if any.
+*
+* @param ObjectBody
+*        Directory being deleted.
+*
+* @return None.
+*
+* @remarks None.
+*
+*--*/
+VOID
+NTAPI
+ObpDeleteDirectory(IN PVOID ObjectBody)
+{
+    POBJECT_DIRECTORY Directory = ObjectBody;
+
+    /* Free the extended table, the built-in buckets are part of the body */
+    if (Directory->ExtendedBuckets)
+    {
+        ExFreePoolWithTag(Directory->ExtendedBuckets, OB_DIR_HASH_TAG);
+        Directory->ExtendedBuckets = NULL;
+    }
+}
+
 /*++
 * @name ObpInsertEntryDirectory
 *
@@ -78,7 +200,7 @@ ObpInsertEntryDirectory(IN POBJECT_DIRECTORY Parent,
     HeaderNameInfo = OBJECT_HEADER_TO_NAME_INFO(ObjectHeader);
 
     /* Get the Allocated entry */
-    AllocatedEntry = &Parent->HashBuckets[Context->HashIndex];
+    AllocatedEntry = ObpGetDirectoryBucket(Parent, Context->HashIndex);
 
     /* Set it */
     NewEntry->ChainLink = *AllocatedEntry;
@@ -89,6 +211,13 @@ ObpInsertEntryDirectory(IN POBJECT_DIRECTORY Parent,
 
     /* Associate the Directory */
     HeaderNameInfo->Directory = Parent;
+
+    /* Give the directory more buckets if its chains became too long */
+    Parent->EntryCount++;
+    if (Parent->EntryCount > ObpGetDirectoryBucketCount(Parent) * OBP_DIRECTORY_LOAD_FACTOR)
+    {
+        ObpGrowDirectory(Parent);
+    }
     return TRUE;
 }
 
@@ -174,6 +303,7 @@ ObpLookupEntryDirectory(IN POBJECT_DIRECTORY Directory,
     PVOID FoundObject = NULL;
     PWSTR Buffer;
     POBJECT_DIRECTORY ShadowDirectory;
+    BOOLEAN SearchingShadow = FALSE;
 
     PAGED_CODE();
 
@@ -208,18 +338,10 @@ ObpLookupEntryDirectory(IN POBJECT_DIRECTORY Directory,
         else HashValue += (CurrentChar - ('a'-'A'));
     }
 
-    /* Merge it with our number of hash buckets */
-    HashIndex = HashValue % 37;
-
     /* Save the result */
     Context->HashValue = HashValue;
-    Context->HashIndex = (USHORT)HashIndex;
 
 DoItAgain:
-    /* Get the root entry and set it as our lookup bucket */
-    AllocatedEntry = &Directory->HashBuckets[HashIndex];
-    LookupBucket = AllocatedEntry;
-
     /* Check if the directory is already locked */
     if (!Context->DirectoryLocked)
     {
@@ -227,6 +349,16 @@ DoItAgain:
         ObpAcquireDirectoryLockShared(Directory, Context);
     }
 
+    /* Merge it with our number of hash buckets, which can only change under the lock */
+    HashIndex = HashValue % ObpGetDirectoryBucketCount(Directory);
+
+    /* Insertion and deletion happen in the directory we were given, not in its shadow */
+    if (!SearchingShadow) Context->HashIndex = (USHORT)HashIndex;
+
+    /* Get the root entry and set it as our lookup bucket */
+    AllocatedEntry = ObpGetDirectoryBucket(Directory, HashIndex);
+    LookupBucket = AllocatedEntry;
+
     /* Start looping */
     while ((CurrentEntry = *AllocatedEntry))
     {
@@ -294,6 +426,7 @@ DoItAgain:
             if (ShadowDirectory != NULL)
             {
                 Directory = ShadowDirectory;
+                SearchingShadow = TRUE;
                 goto DoItAgain;
             }
         }
@@ -352,12 +485,13 @@ ObpDeleteEntryDirectory(POBP_LOOKUP_CONTEXT Context)
     if (!Directory) return FALSE;
 
     /* Get the Entry */
-    AllocatedEntry = &Directory->HashBuckets[Context->HashIndex];
+    AllocatedEntry = ObpGetDirectoryBucket(Directory, Context->HashIndex);
     CurrentEntry = *AllocatedEntry;
 
     /* Unlink the Entry */
     *AllocatedEntry = CurrentEntry->ChainLink;
     CurrentEntry->ChainLink = NULL;
+    Directory->EntryCount--;
 
     /* Free it */
     ExFreePoolWithTag(CurrentEntry, OB_DIR_TAG);
@@ -578,10 +712,10 @@ NtQueryDirectoryObject(IN HANDLE DirectoryHandle,
 
     /* Set default status and start looping */
     Status = STATUS_NO_MORE_ENTRIES;
-    for (Hash = 0; Hash < 37; Hash++)
+    for (Hash = 0; Hash < ObpGetDirectoryBucketCount(Directory); Hash++)
     {
         /* Get this entry and loop all of them */
-        Entry = Directory->HashBuckets[Hash];
+        Entry = *ObpGetDirectoryBucket(Directory, Hash);
         while (Entry)
         {
             /* Check if we should process this entry */
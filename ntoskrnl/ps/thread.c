@@ -15,7 +15,6 @@
 
 /* GLOBALS ******************************************************************/
 
-extern BOOLEAN CcPfEnablePrefetcher;
 extern ULONG MmReadClusterSize;
 POBJECT_TYPE PsThreadType = NULL;
 
@@ -63,9 +62,14 @@ PspUserThreadStartup(IN PKSTART_ROUTINE StartRoutine,
     if (!DeadThread)
     {
         /* Check if the Prefetcher is enabled */
-        if (CcPfEnablePrefetcher)
+        if (CcPfEnablePrefetcher & PF_ENABLE_APPLICATION_LAUNCH)
         {
-            /* FIXME: Prepare to prefetch this process */
+            /* Prefetch this process, only from its first thread */
+            if (!(PspSetProcessFlag(Thread->ThreadsProcess,
+                                    PSF_LAUNCH_PREFETCHED_BIT) & PSF_LAUNCH_PREFETCHED_BIT))
+            {
+                CcPfBeginAppLaunch(Thread->ThreadsProcess);
+            }
         }
 
         /* Raise to APC */
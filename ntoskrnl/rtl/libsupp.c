@@ -223,6 +223,13 @@ RtlLeaveHeapLock(IN OUT PHEAP_LOCK Lock)
     return STATUS_SUCCESS;
 }
 
+ULONG
+NTAPI
+RtlpGetHeapAffinity(VOID)
+{
+    return KeGetCurrentProcessorNumber();
+}
+
 struct _HEAP;
 
 VOID
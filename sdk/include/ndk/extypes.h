@@ -824,6 +824,11 @@ typedef struct _HANDLE_TABLE
         ULONG Flags;
         UCHAR StrictFIFO:1;
     };
+    //
+    // ReactOS specific: free handles are kept in per-processor shards,
+    // FirstFree and LastFree are unused
+    //
+    struct _HANDLE_TABLE_FREE_LIST *FreeLists;
 #endif
 } HANDLE_TABLE, *PHANDLE_TABLE;
 
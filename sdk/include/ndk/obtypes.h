@@ -422,6 +422,13 @@ typedef struct _OBJECT_DIRECTORY
     USHORT Reserved;
     USHORT SymbolicLinkUsageCount;
 #endif
+    //
+    // ReactOS specific: once a directory holds too many entries for
+    // HashBuckets, all its chains move to a larger table
+    //
+    struct _OBJECT_DIRECTORY_ENTRY **ExtendedBuckets;
+    ULONG ExtendedBucketCount;
+    ULONG EntryCount;
 } OBJECT_DIRECTORY, *POBJECT_DIRECTORY;
 
 //
@@ -1541,6 +1541,13 @@ typedef struct _EPROCESS
     UCHAR PriorityClass;
     MM_AVL_TABLE VadRoot;
     ULONG Cookie;
+
+    //
+    // ReactOS specific: hard fault statistics
+    //
+    ULONG HardFaultCount;
+    ULONG HardFaultPageCount;
+    ULONG PeakFaultClusterSize;
 } EPROCESS;
 
 //
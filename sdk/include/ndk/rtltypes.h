@@ -1129,6 +1129,23 @@ typedef struct _RTL_PROCESS_HEAPS
     RTL_HEAP_INFORMATION Heaps[1];
 } RTL_PROCESS_HEAPS, *PRTL_PROCESS_HEAPS;
 
+//
+// Low fragmentation front end statistics (ReactOS specific information class)
+//
+#define HeapFrontEndInformation ((HEAP_INFORMATION_CLASS)0x100)
+
+typedef struct _RTL_HEAP_FRONT_END_INFORMATION
+{
+    ULONG FrontEndHeapType;
+    ULONG NumberOfSlots;
+    SIZE_T MaximumBlockSize;
+    SIZE_T CachedBlocks;
+    ULONG Hits;
+    ULONG Misses;
+    ULONG Frees;
+    ULONG Overflows;
+} RTL_HEAP_FRONT_END_INFORMATION, *PRTL_HEAP_FRONT_END_INFORMATION;
+
 typedef struct _RTL_PROCESS_LOCK_INFORMATION
 {
     PVOID Address;
@@ -567,6 +567,7 @@ extern "C" {
 #define FILE_NAME_OPENED 0x8
 #define FILE_SKIP_COMPLETION_PORT_ON_SUCCESS 0x1
 #define FILE_SKIP_SET_EVENT_ON_HANDLE 0x2
+#define FILE_SKIP_SET_USER_EVENT_ON_FAST_IO 0x4
 #endif
 #if (_WIN32_WINNT >= 0x0500)
 #define GET_MODULE_HANDLE_EX_FLAG_PIN 0x1
@@ -0,0 +1,72 @@
+/*
+ * PROJECT:     ReactOS Kernel
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     On-disk format of the prefetcher traces
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#ifndef REACTOS_PFTRACE_H_INCLUDED
+#define REACTOS_PFTRACE_H_INCLUDED
+
+/*
+ * A scenario (the boot, or the launch of an image) is stored as
+ * \SystemRoot\Prefetch\<NAME>-<HASH>.pf, with:
+ *
+ *   PF_TRACE_FILE_HEADER
+ *   PF_TRACE_FILE[FileCount]   In the order the files were first used
+ *   PF_TRACE_RUN[RunCount]     Sorted by file, then by page
+ *   WCHAR Names[]              NT paths of the files, NUL terminated
+ *
+ * Offsets are from the start of the file. Pages are 4K, they are relative
+ * to the image base for image files and to the start of the file otherwise.
+ */
+
+#define PF_TRACE_MAGIC              0x46505352 /* 'RSPF' */
+#define PF_TRACE_VERSION            1
+#define PF_TRACE_PAGE_SHIFT         12
+#define PF_TRACE_MAXIMUM_SIZE       (4 * 1024 * 1024)
+
+#define PF_TRACE_BOOT_NAME          L"NTOSBOOT"
+#define PF_TRACE_BOOT_HASH          0xB00DFAAD
+
+/* Scenario types */
+#define PF_TRACE_APPLICATION_LAUNCH 0
+#define PF_TRACE_SYSTEM_BOOT        1
+
+/* File flags */
+#define PF_TRACE_FILE_IMAGE         0x0001
+
+typedef struct _PF_TRACE_FILE_HEADER
+{
+    ULONG Magic;
+    USHORT Version;
+    USHORT ScenarioType;
+    ULONG Size;
+    ULONG HashId;
+    WCHAR ScenarioName[30];
+    ULONG LaunchCount;
+    ULONG FaultCount;
+    ULONG FileCount;
+    ULONG FileOffset;
+    ULONG RunCount;
+    ULONG RunOffset;
+    ULONG NameOffset;
+    ULONG NameLength;
+} PF_TRACE_FILE_HEADER, *PPF_TRACE_FILE_HEADER;
+
+typedef struct _PF_TRACE_FILE
+{
+    ULONG NameOffset;   /* In bytes, from the start of the names */
+    USHORT NameLength;  /* In bytes, without the NUL */
+    USHORT Flags;
+    ULONG FirstRun;
+    ULONG RunCount;
+} PF_TRACE_FILE, *PPF_TRACE_FILE;
+
+typedef struct _PF_TRACE_RUN
+{
+    ULONG Page;
+    ULONG PageCount;
+} PF_TRACE_RUN, *PPF_TRACE_RUN;
+
+#endif /* REACTOS_PFTRACE_H_INCLUDED */
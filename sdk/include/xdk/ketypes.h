@@ -246,11 +246,11 @@ $if(_WDMDDK_)
     NT_ASSERT((Object)->Header.Type == MutantObject)
 
 #define ASSERT_SEMAPHORE(Object) \
-    NT_ASSERT((Object)->Header.Type == SemaphoreObject)
+    NT_ASSERT(((Object)->Header.Type & KOBJECT_TYPE_MASK) == SemaphoreObject)
 
 #define ASSERT_EVENT(Object) \
-    NT_ASSERT(((Object)->Header.Type == NotificationEvent) || \
-              ((Object)->Header.Type == SynchronizationEvent))
+    NT_ASSERT((((Object)->Header.Type & KOBJECT_TYPE_MASK) == NotificationEvent) || \
+              (((Object)->Header.Type & KOBJECT_TYPE_MASK) == SynchronizationEvent))
 
 #define DPC_NORMAL 0
 #define DPC_THREADED 1
@@ -614,6 +614,16 @@ NTAPI
 MmSetAddressRangeModified(
   _In_reads_bytes_ (Length) PVOID Address,
   _In_ SIZE_T Length);
+
+_IRQL_requires_max_ (APC_LEVEL)
+NTKERNELAPI
+VOID
+NTAPI
+MmProbeAndLockSelectedPages(
+  _Inout_ PMDL MemoryDescriptorList,
+  _In_ PFILE_SEGMENT_ELEMENT SegmentArray,
+  _In_ KPROCESSOR_MODE AccessMode,
+  _In_ LOCK_OPERATION Operation);
 $endif (_NTIFS_)
 
 #endif /* (NTDDI_VERSION >= NTDDI_WIN2K) */
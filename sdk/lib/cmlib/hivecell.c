@@ -170,32 +170,73 @@ HvIsCellDirty(IN PHHIVE Hive,
     return IsDirty;
 }
 
+/*
+ * Free cells are on doubly linked lists, through their data, so that they
+ * can be removed in constant time when they are merged with a neighbor.
+ * Cells too small to hold both links can never be allocated anyway, they
+ * are left out of the lists until they get merged.
+ */
+typedef struct _HCELL_FREE_LINKS
+{
+    HCELL_INDEX Next;
+    HCELL_INDEX Previous;
+} HCELL_FREE_LINKS, *PHCELL_FREE_LINKS;
+
+#define HFREE_MINIMUM_SIZE  (LONG)(sizeof(HCELL) + sizeof(HCELL_FREE_LINKS))
+
+#define HvpGetFreeLinks(Hive, Cell) \
+    ((PHCELL_FREE_LINKS)HvGetCell((Hive), (Cell)))
+
 static __inline ULONG CMAPI
 HvpComputeFreeListIndex(
     ULONG Size)
 {
     ULONG Index;
-    static CCHAR FindFirstSet[128] = {
-        0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3,
-        4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
-        5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
-        5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
-        6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
-        6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
-        6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
-        6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6};
 
     ASSERT(Size >= (1 << 3));
-    Index = (Size >> 3) - 1;
-    if (Index >= 16)
+
+    /* Small cells have a list for each size */
+    if (Size <= HFREE_EXACT_LIMIT)
+        return (Size >> 3) - 1;
+
+    /* Larger ones have a list for each power of two */
+    Index = HFREE_EXACT_LISTS;
+    for (Size /= 2 * HFREE_EXACT_LIMIT; Size != 0; Size >>= 1)
+        Index++;
+
+    ASSERT(Index < HFREE_LIST_COUNT);
+    return Index;
+}
+
+static __inline ULONG CMAPI
+HvpFindFreeList(
+    PDUAL Dual,
+    ULONG Index)
+{
+    ULONG Word, Mask, Bit;
+
+    if (Index >= HFREE_LIST_COUNT)
+        return HFREE_LIST_COUNT;
+
+    /* Find the first non-empty list from this one in the summary */
+    Word = Index / 32;
+    Mask = Dual->FreeSummary[Word] & (MAXULONG << (Index % 32));
+    while (Mask == 0)
     {
-        if (Index > 127)
-            Index = 23;
-        else
-            Index = FindFirstSet[Index] + 16;
+        if (++Word == HFREE_SUMMARY_SIZE)
+            return HFREE_LIST_COUNT;
+        Mask = Dual->FreeSummary[Word];
     }
 
-    return Index;
+    /* Get the lowest set bit */
+    Bit = 0;
+    if (!(Mask & 0xFFFF)) { Bit += 16; Mask >>= 16; }
+    if (!(Mask & 0xFF))   { Bit += 8;  Mask >>= 8;  }
+    if (!(Mask & 0xF))    { Bit += 4;  Mask >>= 4;  }
+    if (!(Mask & 0x3))    { Bit += 2;  Mask >>= 2;  }
+    if (!(Mask & 0x1))    { Bit += 1; }
+
+    return Word * 32 + Bit;
 }
 
 static NTSTATUS CMAPI
@@ -204,19 +245,29 @@ HvpAddFree(
     PHCELL FreeBlock,
     HCELL_INDEX FreeIndex)
 {
-    PHCELL_INDEX FreeBlockData;
-    HSTORAGE_TYPE Storage;
+    PHCELL_FREE_LINKS Links;
+    PDUAL Dual;
     ULONG Index;
 
     ASSERT(RegistryHive != NULL);
     ASSERT(FreeBlock != NULL);
 
-    Storage = HvGetCellType(FreeIndex);
+    /* This one can't be used, leave it out */
+    if (FreeBlock->Size < HFREE_MINIMUM_SIZE)
+        return STATUS_SUCCESS;
+
+    Dual = &RegistryHive->Storage[HvGetCellType(FreeIndex)];
     Index = HvpComputeFreeListIndex((ULONG)FreeBlock->Size);
 
-    FreeBlockData = (PHCELL_INDEX)(FreeBlock + 1);
-    *FreeBlockData = RegistryHive->Storage[Storage].FreeDisplay[Index];
-    RegistryHive->Storage[Storage].FreeDisplay[Index] = FreeIndex;
+    /* Insert it at the head of its list */
+    Links = (PHCELL_FREE_LINKS)(FreeBlock + 1);
+    Links->Next = Dual->FreeDisplay[Index];
+    Links->Previous = HCELL_NIL;
+    if (Links->Next != HCELL_NIL)
+        HvpGetFreeLinks(RegistryHive, Links->Next)->Previous = FreeIndex;
+    else
+        Dual->FreeSummary[Index / 32] |= 1UL << (Index % 32);
+    Dual->FreeDisplay[Index] = FreeIndex;
 
     /* FIXME: Eventually get rid of free bins. */
 
@@ -229,47 +280,42 @@ HvpRemoveFree(
     PHCELL CellBlock,
     HCELL_INDEX CellIndex)
 {
-    PHCELL_INDEX FreeCellData;
-    PHCELL_INDEX pFreeCellOffset;
-    HSTORAGE_TYPE Storage;
-    ULONG Index, FreeListIndex;
+    PHCELL_FREE_LINKS Links;
+    PDUAL Dual;
+    ULONG Index;
 
     ASSERT(RegistryHive->ReadOnly == FALSE);
 
-    Storage = HvGetCellType(CellIndex);
+    /* It was never put on a list */
+    if (CellBlock->Size < HFREE_MINIMUM_SIZE)
+        return;
+
+    Dual = &RegistryHive->Storage[HvGetCellType(CellIndex)];
     Index = HvpComputeFreeListIndex((ULONG)CellBlock->Size);
 
-    pFreeCellOffset = &RegistryHive->Storage[Storage].FreeDisplay[Index];
-    while (*pFreeCellOffset != HCELL_NIL)
+    Links = (PHCELL_FREE_LINKS)(CellBlock + 1);
+    if (Links->Previous == HCELL_NIL)
     {
-        FreeCellData = (PHCELL_INDEX)HvGetCell(RegistryHive, *pFreeCellOffset);
-        if (*pFreeCellOffset == CellIndex)
+        /* It is the head of its list, anything else means the lists are corrupted */
+        if (Dual->FreeDisplay[Index] != CellIndex)
         {
-            *pFreeCellOffset = *FreeCellData;
+            CMLTRACE(CMLIB_HCELL_DEBUG, "%s - Cell 0x%x is not on free list %u\n",
+                     __FUNCTION__, CellIndex, Index);
+            ASSERT(FALSE);
             return;
         }
-        pFreeCellOffset = FreeCellData;
-    }
 
-    /* Something bad happened, print a useful trace info and bugcheck */
-    CMLTRACE(CMLIB_HCELL_DEBUG, "-- beginning of HvpRemoveFree trace --\n");
-    CMLTRACE(CMLIB_HCELL_DEBUG, "block we are about to free: %08x\n", CellIndex);
-    CMLTRACE(CMLIB_HCELL_DEBUG, "chosen free list index: %u\n", Index);
-    for (FreeListIndex = 0; FreeListIndex < 24; FreeListIndex++)
+        Dual->FreeDisplay[Index] = Links->Next;
+        if (Links->Next == HCELL_NIL)
+            Dual->FreeSummary[Index / 32] &= ~(1UL << (Index % 32));
+    }
+    else
     {
-        CMLTRACE(CMLIB_HCELL_DEBUG, "free list [%u]: ", FreeListIndex);
-        pFreeCellOffset = &RegistryHive->Storage[Storage].FreeDisplay[FreeListIndex];
-        while (*pFreeCellOffset != HCELL_NIL)
-        {
-            CMLTRACE(CMLIB_HCELL_DEBUG, "%08x ", *pFreeCellOffset);
-            FreeCellData = (PHCELL_INDEX)HvGetCell(RegistryHive, *pFreeCellOffset);
-            pFreeCellOffset = FreeCellData;
-        }
-        CMLTRACE(CMLIB_HCELL_DEBUG, "\n");
+        HvpGetFreeLinks(RegistryHive, Links->Previous)->Next = Links->Next;
     }
-    CMLTRACE(CMLIB_HCELL_DEBUG, "-- end of HvpRemoveFree trace --\n");
 
-    ASSERT(FALSE);
+    if (Links->Next != HCELL_NIL)
+        HvpGetFreeLinks(RegistryHive, Links->Next)->Previous = Links->Previous;
 }
 
 static HCELL_INDEX CMAPI
@@ -278,24 +324,38 @@ HvpFindFree(
     ULONG Size,
     HSTORAGE_TYPE Storage)
 {
-    PHCELL_INDEX FreeCellData;
+    PDUAL Dual = &RegistryHive->Storage[Storage];
+    PHCELL_FREE_LINKS Links;
     HCELL_INDEX FreeCellOffset;
-    PHCELL_INDEX pFreeCellOffset;
-    ULONG Index;
+    ULONG Index, List;
+
+    Index = HvpComputeFreeListIndex(Size);
+
+    /*
+     * Every cell of the lists above ours is big enough, and so are the
+     * cells of our own list when it holds a single size.
+     */
+    List = HvpFindFreeList(Dual, (Index < HFREE_EXACT_LISTS) ? Index : Index + 1);
+    if (List < HFREE_LIST_COUNT)
+    {
+        FreeCellOffset = Dual->FreeDisplay[List];
+        HvpRemoveFree(RegistryHive, HvpGetCellHeader(RegistryHive, FreeCellOffset), FreeCellOffset);
+        return FreeCellOffset;
+    }
 
-    for (Index = HvpComputeFreeListIndex(Size); Index < 24; Index++)
+    /* Otherwise, look for a cell that is big enough in our list */
+    if (Index >= HFREE_EXACT_LISTS)
     {
-        pFreeCellOffset = &RegistryHive->Storage[Storage].FreeDisplay[Index];
-        while (*pFreeCellOffset != HCELL_NIL)
+        for (FreeCellOffset = Dual->FreeDisplay[Index];
+             FreeCellOffset != HCELL_NIL;
+             FreeCellOffset = Links->Next)
         {
-            FreeCellData = (PHCELL_INDEX)HvGetCell(RegistryHive, *pFreeCellOffset);
-            if ((ULONG)HvpGetCellFullSize(RegistryHive, FreeCellData) >= Size)
+            Links = HvpGetFreeLinks(RegistryHive, FreeCellOffset);
+            if ((ULONG)HvpGetCellFullSize(RegistryHive, Links) >= Size)
             {
-                FreeCellOffset = *pFreeCellOffset;
-                *pFreeCellOffset = *FreeCellData;
+                HvpRemoveFree(RegistryHive, (PHCELL)Links - 1, FreeCellOffset);
                 return FreeCellOffset;
             }
-            pFreeCellOffset = FreeCellData;
         }
     }
 
@@ -314,12 +374,14 @@ HvpCreateHiveFreeCellList(
     NTSTATUS Status;
     ULONG Index;
 
-    /* Initialize the free cell list */
-    for (Index = 0; Index < 24; Index++)
+    /* Initialize the free cell lists and their summary */
+    for (Index = 0; Index < HFREE_LIST_COUNT; Index++)
     {
         Hive->Storage[Stable].FreeDisplay[Index] = HCELL_NIL;
         Hive->Storage[Volatile].FreeDisplay[Index] = HCELL_NIL;
     }
+    RtlZeroMemory(Hive->Storage[Stable].FreeSummary, sizeof(Hive->Storage[Stable].FreeSummary));
+    RtlZeroMemory(Hive->Storage[Volatile].FreeSummary, sizeof(Hive->Storage[Volatile].FreeSummary));
 
     BlockOffset = 0;
     BlockIndex = 0;
@@ -516,15 +578,10 @@ HvFreeCell(
                     ((HCELL_INDEX)((ULONG_PTR)Neighbor - (ULONG_PTR)Bin +
                      Bin->FileOffset)) | (CellIndex & HCELL_TYPE_MASK);
 
-                if (HvpComputeFreeListIndex(Neighbor->Size) !=
-                    HvpComputeFreeListIndex(Neighbor->Size + Free->Size))
-                {
-                   HvpRemoveFree(RegistryHive, Neighbor, NeighborCellIndex);
-                   Neighbor->Size += Free->Size;
-                   HvpAddFree(RegistryHive, Neighbor, NeighborCellIndex);
-                }
-                else
-                    Neighbor->Size += Free->Size;
+                /* The merged cell most likely belongs to another list */
+                HvpRemoveFree(RegistryHive, Neighbor, NeighborCellIndex);
+                Neighbor->Size += Free->Size;
+                HvpAddFree(RegistryHive, Neighbor, NeighborCellIndex);
 
                 if (CellType == Stable)
                     HvMarkCellDirty(RegistryHive, NeighborCellIndex, FALSE);
@@ -82,6 +82,15 @@
 //
 #define HTYPE_COUNT                     2
 
+//
+// Free cell lists (ReactOS specific): one list per cell size up to
+// HFREE_EXACT_LIMIT bytes, then one list per power of two
+//
+#define HFREE_EXACT_LISTS               128
+#define HFREE_EXACT_LIMIT               (HFREE_EXACT_LISTS * 8)
+#define HFREE_LIST_COUNT                160
+#define HFREE_SUMMARY_SIZE              (HFREE_LIST_COUNT / 32)
+
 //
 // Hive boot types
 //
@@ -302,8 +311,8 @@ typedef struct _DUAL
     PHMAP_DIRECTORY Map;
     PHMAP_ENTRY BlockList; // PHMAP_TABLE SmallDir;
     ULONG Guard;
-    HCELL_INDEX FreeDisplay[24]; // FREE_DISPLAY FreeDisplay[24];
-    ULONG FreeSummary;
+    HCELL_INDEX FreeDisplay[HFREE_LIST_COUNT]; // FREE_DISPLAY FreeDisplay[24];
+    ULONG FreeSummary[HFREE_SUMMARY_SIZE];
     LIST_ENTRY FreeBins;
 } DUAL, *PDUAL;
 
@@ -275,11 +275,15 @@ HvpCreateHive(
     RegistryHive->BaseBlock = BaseBlock;
     RegistryHive->Version = BaseBlock->Minor; // == HSYS_MINOR
 
-    for (Index = 0; Index < 24; Index++)
+    for (Index = 0; Index < HFREE_LIST_COUNT; Index++)
     {
         RegistryHive->Storage[Stable].FreeDisplay[Index] = HCELL_NIL;
         RegistryHive->Storage[Volatile].FreeDisplay[Index] = HCELL_NIL;
     }
+    RtlZeroMemory(RegistryHive->Storage[Stable].FreeSummary,
+                  sizeof(RegistryHive->Storage[Stable].FreeSummary));
+    RtlZeroMemory(RegistryHive->Storage[Volatile].FreeSummary,
+                  sizeof(RegistryHive->Storage[Volatile].FreeSummary));
 
     HvpInitFileName(BaseBlock, FileName);
 
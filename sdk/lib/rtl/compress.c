@@ -216,28 +216,181 @@ out:
 }
 
 
+/* LZNT1 compression workspace: hash chains over the current 4 KiB chunk */
+#define LZNT1_CHUNK_SIZE        0x1000
+#define LZNT1_HASH_BITS         12
+#define LZNT1_HASH_SIZE         (1 << LZNT1_HASH_BITS)
+#define LZNT1_MIN_MATCH         3
+
+/* Maximum number of chain links followed per position for each engine */
+#define LZNT1_CHAIN_STANDARD    16
+#define LZNT1_CHAIN_MAXIMUM     LZNT1_CHUNK_SIZE
+
+typedef struct _RTLP_LZNT1_WORKSPACE
+{
+    /* Most recent position (+ 1) for each hash value, 0 if none */
+    USHORT HashHead[LZNT1_HASH_SIZE];
+    /* Previous position (+ 1) with the same hash value, 0 if none */
+    USHORT HashChain[LZNT1_CHUNK_SIZE];
+} RTLP_LZNT1_WORKSPACE, *PRTLP_LZNT1_WORKSPACE;
+
+C_ASSERT(sizeof(RTLP_LZNT1_WORKSPACE) <= 0x8010);
+
+static __inline ULONG
+lznt1_hash(const UCHAR *src)
+{
+    ULONG value = src[0] | (src[1] << 8) | (src[2] << 16);
+    return (value * 2654435761U) >> (32 - LZNT1_HASH_BITS);
+}
+
+static __inline VOID
+lznt1_insert(PRTLP_LZNT1_WORKSPACE ws, const UCHAR *chunk, ULONG chunk_size, ULONG pos)
+{
+    ULONG hash;
+
+    if (pos + LZNT1_MIN_MATCH > chunk_size)
+        return;
+
+    hash = lznt1_hash(chunk + pos);
+    ws->HashChain[pos] = ws->HashHead[hash];
+    ws->HashHead[hash] = (USHORT)(pos + 1);
+}
+
+/* compress a single LZNT1 chunk, returns the size of the chunk data or 0 if it doesn't fit */
+static ULONG
+lznt1_compress_chunk(const UCHAR *src, ULONG src_size, UCHAR *dst, ULONG dst_size,
+                     ULONG max_chain, PRTLP_LZNT1_WORKSPACE ws)
+{
+    UCHAR *dst_cur = dst, *dst_end = dst + dst_size;
+    UCHAR *flags_ptr = NULL;
+    ULONG displacement_bits, length_bits;
+    ULONG pos = 0, flag_bit = 8;
+    ULONG max_length, best_length, best_offset;
+    ULONG candidate, length, chain;
+    UCHAR flags = 0;
+
+    RtlZeroMemory(ws->HashHead, sizeof(ws->HashHead));
+
+    while (pos < src_size)
+    {
+        /* start a new group of 8 entities */
+        if (flag_bit == 8)
+        {
+            if (flags_ptr) *flags_ptr = flags;
+            if (dst_cur >= dst_end) return 0;
+            flags_ptr = dst_cur++;
+            flags = 0;
+            flag_bit = 0;
+        }
+
+        /* the split between length and displacement depends on the position in the chunk */
+        for (displacement_bits = 12; displacement_bits > 4; displacement_bits--)
+            if ((1U << (displacement_bits - 1)) < pos) break;
+        length_bits = 16 - displacement_bits;
+        max_length  = min((1U << length_bits) - 1 + LZNT1_MIN_MATCH, src_size - pos);
+
+        /* walk the hash chain looking for the longest match. Every earlier position in the
+         * chunk is within reach of the displacement field, so only the length is limited. */
+        best_length = 0;
+        best_offset = 0;
+        if (max_length >= LZNT1_MIN_MATCH)
+        {
+            candidate = ws->HashHead[lznt1_hash(src + pos)];
+            for (chain = max_chain; candidate && chain; chain--)
+            {
+                candidate--;
+                if (src[candidate + best_length] == src[pos + best_length])
+                {
+                    for (length = 0; length < max_length; length++)
+                        if (src[candidate + length] != src[pos + length]) break;
+
+                    if (length > best_length)
+                    {
+                        best_length = length;
+                        best_offset = pos - candidate;
+                        if (length == max_length) break;
+                    }
+                }
+                candidate = ws->HashChain[candidate];
+            }
+        }
+
+        if (best_length >= LZNT1_MIN_MATCH)
+        {
+            /* backwards reference */
+            if (dst_cur + sizeof(WORD) > dst_end) return 0;
+            *(WORD *)dst_cur = (WORD)(((best_offset - 1) << length_bits) |
+                                      (best_length - LZNT1_MIN_MATCH));
+            dst_cur += sizeof(WORD);
+            flags |= 1 << flag_bit;
+
+            for (length = 0; length < best_length; length++)
+                lznt1_insert(ws, src, src_size, pos++);
+        }
+        else
+        {
+            /* uncompressed data */
+            if (dst_cur >= dst_end) return 0;
+            *dst_cur++ = src[pos];
+            lznt1_insert(ws, src, src_size, pos++);
+        }
+        flag_bit++;
+    }
+
+    if (flags_ptr) *flags_ptr = flags;
+    return dst_cur - dst;
+}
+
 static NTSTATUS
 RtlpCompressBufferLZNT1(UCHAR *src, ULONG src_size, UCHAR *dst, ULONG dst_size,
-                        ULONG chunk_size, ULONG *final_size, UCHAR *workspace)
+                        ULONG chunk_size, ULONG *final_size, UCHAR *workspace, USHORT engine)
 {
         UCHAR *src_cur = src, *src_end = src + src_size;
         UCHAR *dst_cur = dst, *dst_end = dst + dst_size;
-        ULONG block_size;
+        ULONG block_size, compressed_size, max_chain;
+
+        max_chain = (engine == COMPRESSION_ENGINE_MAXIMUM) ? LZNT1_CHAIN_MAXIMUM
+                                                           : LZNT1_CHAIN_STANDARD;
 
         while (src_cur < src_end)
         {
             /* determine size of current chunk */
-            block_size = min(0x1000, src_end - src_cur);
-            if (dst_cur + sizeof(WORD) + block_size > dst_end)
+            block_size = min(LZNT1_CHUNK_SIZE, src_end - src_cur);
+            if (dst_cur + sizeof(WORD) > dst_end)
                 return STATUS_BUFFER_TOO_SMALL;
 
-            /* write (uncompressed) chunk header */
-            *(WORD *)dst_cur = 0x3000 | (block_size - 1);
-            dst_cur += sizeof(WORD);
+            /* try to compress the chunk, it is only kept if it ends up smaller */
+            compressed_size = 0;
+            if (workspace)
+            {
+                compressed_size = lznt1_compress_chunk(src_cur, block_size,
+                                                       dst_cur + sizeof(WORD),
+                                                       min(block_size - 1,
+                                                           dst_end - dst_cur - sizeof(WORD)),
+                                                       max_chain,
+                                                       (PRTLP_LZNT1_WORKSPACE)workspace);
+            }
+
+            if (compressed_size)
+            {
+                /* write compressed chunk header, the content is already in place */
+                *(WORD *)dst_cur = 0xB000 | (compressed_size - 1);
+                dst_cur += sizeof(WORD) + compressed_size;
+            }
+            else
+            {
+                if (dst_cur + sizeof(WORD) + block_size > dst_end)
+                    return STATUS_BUFFER_TOO_SMALL;
+
+                /* write (uncompressed) chunk header */
+                *(WORD *)dst_cur = 0x3000 | (block_size - 1);
+                dst_cur += sizeof(WORD);
+
+                /* write chunk content */
+                memcpy(dst_cur, src_cur, block_size);
+                dst_cur += block_size;
+            }
 
-            /* write chunk content */
-            memcpy(dst_cur, src_cur, block_size);
-            dst_cur += block_size;
             src_cur += block_size;
         }
 
@@ -261,7 +414,8 @@ RtlpWorkSpaceSizeLZNT1(USHORT Engine,
    }
    else if (Engine == COMPRESSION_ENGINE_MAXIMUM)
    {
-      *BufferAndWorkSpaceSize = 0x10;
+      /* Same hash chains as the standard engine, they are only walked further */
+      *BufferAndWorkSpaceSize = 0x8010;
       *FragmentWorkSpaceSize = 0x1000;
       return(STATUS_SUCCESS);
    }
@@ -270,6 +424,957 @@ RtlpWorkSpaceSizeLZNT1(USHORT Engine,
 }
 
 
+/* XPRESS (LZ77) and XPRESS Huffman (LZ77 + Huffman), see [MS-XCA] */
+#define XPRESS_MIN_MATCH            3
+#define XPRESS_MAX_MATCH            (0xFFFF + XPRESS_MIN_MATCH)
+#define XPRESS_WINDOW_SIZE          0x2000
+#define XPRESS_HASH_BITS            13
+#define XPRESS_HASH_SIZE            (1 << XPRESS_HASH_BITS)
+
+#define XPRESS_HUFF_WINDOW_SIZE     0x10000
+#define XPRESS_HUFF_BLOCK_SIZE      0x10000
+#define XPRESS_HUFF_SYMBOLS         512
+#define XPRESS_HUFF_TABLE_SIZE      (XPRESS_HUFF_SYMBOLS / 2)
+#define XPRESS_HUFF_MAX_CODE_LENGTH 15
+#define XPRESS_HUFF_FAST_BITS       9
+#define XPRESS_HUFF_EOF_SYMBOL      256
+
+/* Maximum number of chain links followed per position for each engine */
+#define XPRESS_CHAIN_STANDARD       16
+#define XPRESS_CHAIN_MAXIMUM        256
+
+typedef struct _RTLP_XPRESS_WORKSPACE
+{
+    /* Most recent position (+ 1) for each hash value, 0 if none */
+    ULONG HashHead[XPRESS_HASH_SIZE];
+    /* Distance to the previous position with the same hash value, 0 if none */
+    USHORT HashChain[XPRESS_WINDOW_SIZE];
+} RTLP_XPRESS_WORKSPACE, *PRTLP_XPRESS_WORKSPACE;
+
+typedef struct _RTLP_XPRESS_HUFF_WORKSPACE
+{
+    ULONG HashHead[XPRESS_HASH_SIZE];
+    USHORT HashChain[XPRESS_HUFF_WINDOW_SIZE];
+    /* Literal (offset 0) or (offset << 16 | length - 3) for each symbol of the block */
+    ULONG Tokens[XPRESS_HUFF_BLOCK_SIZE];
+    ULONG Frequencies[XPRESS_HUFF_SYMBOLS];
+    ULONG Weights[2 * XPRESS_HUFF_SYMBOLS];
+    USHORT Parents[2 * XPRESS_HUFF_SYMBOLS];
+    USHORT Leaves[XPRESS_HUFF_SYMBOLS];
+    USHORT Codes[XPRESS_HUFF_SYMBOLS];
+    UCHAR Depths[2 * XPRESS_HUFF_SYMBOLS];
+    UCHAR Lengths[XPRESS_HUFF_SYMBOLS];
+} RTLP_XPRESS_HUFF_WORKSPACE, *PRTLP_XPRESS_HUFF_WORKSPACE;
+
+typedef struct _XPRESS_MATCH_FINDER
+{
+    PULONG HashHead;
+    PUSHORT HashChain;
+    ULONG ChainMask;
+    ULONG MaxOffset;
+    ULONG MaxChain;
+} XPRESS_MATCH_FINDER, *PXPRESS_MATCH_FINDER;
+
+/* Decoder output; data before the requested fragment offset only goes to the history ring */
+typedef struct _XPRESS_OUTPUT
+{
+    PUCHAR Start;
+    PUCHAR Current;
+    PUCHAR End;
+    PUCHAR History;
+    ULONG HistoryMask;
+    ULONG Offset;
+    ULONG Total;
+} XPRESS_OUTPUT, *PXPRESS_OUTPUT;
+
+typedef struct _XPRESS_HUFF_DECODER
+{
+    /* (symbol << 4) | length for codes up to XPRESS_HUFF_FAST_BITS long, 0 otherwise */
+    USHORT Fast[1 << XPRESS_HUFF_FAST_BITS];
+    /* Symbols sorted by code length, then by value */
+    USHORT Sorted[XPRESS_HUFF_SYMBOLS];
+    USHORT Count[XPRESS_HUFF_MAX_CODE_LENGTH + 1];
+    USHORT First[XPRESS_HUFF_MAX_CODE_LENGTH + 1];
+    USHORT Index[XPRESS_HUFF_MAX_CODE_LENGTH + 1];
+} XPRESS_HUFF_DECODER, *PXPRESS_HUFF_DECODER;
+
+static __inline ULONG
+xpress_hash(const UCHAR *src)
+{
+    ULONG value = src[0] | (src[1] << 8) | (src[2] << 16);
+    return (value * 2654435761U) >> (32 - XPRESS_HASH_BITS);
+}
+
+static __inline VOID
+xpress_insert(PXPRESS_MATCH_FINDER mf, const UCHAR *src, ULONG src_size, ULONG pos)
+{
+    ULONG hash, previous;
+
+    if (!mf->HashHead || pos + XPRESS_MIN_MATCH > src_size)
+        return;
+
+    hash = xpress_hash(src + pos);
+    previous = mf->HashHead[hash];
+    if (previous && pos - (previous - 1) <= mf->MaxOffset)
+        mf->HashChain[pos & mf->ChainMask] = (USHORT)(pos - (previous - 1));
+    else
+        mf->HashChain[pos & mf->ChainMask] = 0;
+    mf->HashHead[hash] = pos + 1;
+}
+
+static ULONG
+xpress_find_match(PXPRESS_MATCH_FINDER mf, const UCHAR *src, ULONG src_size, ULONG pos,
+                  ULONG max_length, ULONG *match_offset)
+{
+    ULONG best_length = 0, candidate, distance, length, chain;
+
+    if (!mf->HashHead || max_length < XPRESS_MIN_MATCH || pos + XPRESS_MIN_MATCH > src_size)
+        return 0;
+
+    candidate = mf->HashHead[xpress_hash(src + pos)];
+    if (!candidate || pos - (candidate - 1) > mf->MaxOffset)
+        return 0;
+    distance = pos - (candidate - 1);
+
+    for (chain = mf->MaxChain; chain; chain--)
+    {
+        candidate = pos - distance;
+        if (src[candidate + best_length] == src[pos + best_length])
+        {
+            for (length = 0; length < max_length; length++)
+                if (src[candidate + length] != src[pos + length]) break;
+
+            if (length > best_length)
+            {
+                best_length = length;
+                *match_offset = pos - candidate;
+                if (length == max_length) break;
+            }
+        }
+
+        /* follow the chain as long as it stays inside the window */
+        if (!mf->HashChain[candidate & mf->ChainMask]) break;
+        distance += mf->HashChain[candidate & mf->ChainMask];
+        if (distance > mf->MaxOffset) break;
+    }
+
+    return best_length;
+}
+
+static __inline BOOLEAN
+xpress_put_byte(PXPRESS_OUTPUT out, UCHAR value)
+{
+    if (out->Total < out->Offset)
+    {
+        out->History[out->Total & out->HistoryMask] = value;
+    }
+    else
+    {
+        if (out->Current >= out->End) return FALSE;
+        *out->Current++ = value;
+    }
+    out->Total++;
+    return TRUE;
+}
+
+/* copy a match that has already been validated against the total output, FALSE if full */
+static __inline BOOLEAN
+xpress_copy_match(PXPRESS_OUTPUT out, ULONG offset, ULONG length)
+{
+    ULONG source;
+
+    /* fast path: both source and destination are in the output buffer */
+    if (out->Total >= out->Offset && offset <= (ULONG)(out->Current - out->Start))
+    {
+        if (length > (ULONG)(out->End - out->Current))
+        {
+            length = out->End - out->Current;
+            if (!length) return FALSE;
+        }
+
+        out->Total += length;
+        if (offset >= length)
+        {
+            memcpy(out->Current, out->Current - offset, length);
+            out->Current += length;
+        }
+        else
+        {
+            /* source and dest are overlapping */
+            while (length--)
+            {
+                *out->Current = *(out->Current - offset);
+                out->Current++;
+            }
+        }
+        return TRUE;
+    }
+
+    while (length--)
+    {
+        source = out->Total - offset;
+        if (source < out->Offset)
+        {
+            if (!xpress_put_byte(out, out->History[source & out->HistoryMask]))
+                return FALSE;
+        }
+        else
+        {
+            if (!xpress_put_byte(out, out->Start[source - out->Offset]))
+                return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* decompress data encoded with plain LZ77 XPRESS */
+static NTSTATUS
+xpress_decompress(UCHAR *src, ULONG src_size, PXPRESS_OUTPUT out)
+{
+    UCHAR *src_cur = src, *src_end = src + src_size;
+    UCHAR *nibble = NULL;
+    ULONG flags = 0, flag_count = 0;
+    ULONG length, offset;
+
+    for (;;)
+    {
+        /* read next 32 flags */
+        if (!flag_count)
+        {
+            if (src_cur + sizeof(ULONG) > src_end)
+                return STATUS_BAD_COMPRESSION_BUFFER;
+            flags = *(ULONG *)src_cur;
+            src_cur += sizeof(ULONG);
+            flag_count = 32;
+        }
+        flag_count--;
+
+        if (!(flags & (1U << flag_count)))
+        {
+            /* uncompressed data */
+            if (src_cur >= src_end)
+                return STATUS_BAD_COMPRESSION_BUFFER;
+            if (!xpress_put_byte(out, *src_cur++))
+                return STATUS_SUCCESS;
+            continue;
+        }
+
+        /* the unused flags at the end of the stream are all set */
+        if (src_cur == src_end)
+            return STATUS_SUCCESS;
+
+        /* backwards reference */
+        if (src_cur + sizeof(WORD) > src_end)
+            return STATUS_BAD_COMPRESSION_BUFFER;
+        length = *(WORD *)src_cur;
+        src_cur += sizeof(WORD);
+        offset = (length >> 3) + 1;
+        length &= 7;
+
+        if (length == 7)
+        {
+            /* two length extensions share one byte */
+            if (!nibble)
+            {
+                if (src_cur >= src_end)
+                    return STATUS_BAD_COMPRESSION_BUFFER;
+                nibble = src_cur++;
+                length = *nibble & 0xF;
+            }
+            else
+            {
+                length = *nibble >> 4;
+                nibble = NULL;
+            }
+
+            if (length == 15)
+            {
+                if (src_cur >= src_end)
+                    return STATUS_BAD_COMPRESSION_BUFFER;
+                length = *src_cur++;
+
+                if (length == 255)
+                {
+                    if (src_cur + sizeof(WORD) > src_end)
+                        return STATUS_BAD_COMPRESSION_BUFFER;
+                    length = *(WORD *)src_cur;
+                    src_cur += sizeof(WORD);
+
+                    if (!length)
+                    {
+                        if (src_cur + sizeof(ULONG) > src_end)
+                            return STATUS_BAD_COMPRESSION_BUFFER;
+                        length = *(ULONG *)src_cur;
+                        src_cur += sizeof(ULONG);
+                    }
+
+                    if (length < 15 + 7)
+                        return STATUS_BAD_COMPRESSION_BUFFER;
+                    length -= 15 + 7;
+                }
+                length += 15;
+            }
+            length += 7;
+        }
+        length += XPRESS_MIN_MATCH;
+
+        /* ensure reference is valid */
+        if (offset > out->Total)
+            return STATUS_BAD_COMPRESSION_BUFFER;
+
+        if (!xpress_copy_match(out, offset, length))
+            return STATUS_SUCCESS;
+    }
+}
+
+static BOOLEAN
+xpress_huff_build_decoder(PXPRESS_HUFF_DECODER decoder, const UCHAR *table)
+{
+    USHORT next[XPRESS_HUFF_MAX_CODE_LENGTH + 1];
+    ULONG symbol, length, code, available, fill;
+
+    RtlZeroMemory(decoder, sizeof(*decoder));
+
+    /* each byte of the table holds the code lengths of two symbols */
+    for (symbol = 0; symbol < XPRESS_HUFF_SYMBOLS; symbol++)
+        decoder->Count[(table[symbol / 2] >> (4 * (symbol & 1))) & 0xF]++;
+    decoder->Count[0] = 0;
+
+    /* assign the first canonical code of each length and reject oversubscribed tables */
+    code = 0;
+    available = 1;
+    for (length = 1; length <= XPRESS_HUFF_MAX_CODE_LENGTH; length++)
+    {
+        code = (code + decoder->Count[length - 1]) << 1;
+        decoder->First[length] = (USHORT)code;
+        decoder->Index[length] = decoder->Index[length - 1] + decoder->Count[length - 1];
+        next[length] = decoder->Index[length];
+
+        available <<= 1;
+        if (decoder->Count[length] > available)
+            return FALSE;
+        available -= decoder->Count[length];
+    }
+
+    for (symbol = 0; symbol < XPRESS_HUFF_SYMBOLS; symbol++)
+    {
+        length = (table[symbol / 2] >> (4 * (symbol & 1))) & 0xF;
+        if (!length) continue;
+
+        if (length <= XPRESS_HUFF_FAST_BITS)
+        {
+            code = decoder->First[length] + next[length] - decoder->Index[length];
+            for (fill = code << (XPRESS_HUFF_FAST_BITS - length);
+                 fill < (code + 1) << (XPRESS_HUFF_FAST_BITS - length);
+                 fill++)
+            {
+                decoder->Fast[fill] = (USHORT)((symbol << 4) | length);
+            }
+        }
+        decoder->Sorted[next[length]++] = (USHORT)symbol;
+    }
+
+    return TRUE;
+}
+
+static __inline LONG
+xpress_huff_decode_symbol(PXPRESS_HUFF_DECODER decoder, ULONG bits, ULONG *symbol_length)
+{
+    ULONG entry, length, code;
+
+    entry = decoder->Fast[bits >> (32 - XPRESS_HUFF_FAST_BITS)];
+    if (entry)
+    {
+        *symbol_length = entry & 0xF;
+        return entry >> 4;
+    }
+
+    for (length = XPRESS_HUFF_FAST_BITS + 1; length <= XPRESS_HUFF_MAX_CODE_LENGTH; length++)
+    {
+        code = bits >> (32 - length);
+        if (code - decoder->First[length] < decoder->Count[length])
+        {
+            *symbol_length = length;
+            return decoder->Sorted[decoder->Index[length] + code - decoder->First[length]];
+        }
+    }
+
+    return -1;
+}
+
+static __inline ULONG
+xpress_huff_read_word(const UCHAR *src, ULONG src_size, ULONG pos)
+{
+    /* the bit reader runs ahead of the data, missing words read as zero */
+    return (pos + sizeof(WORD) <= src_size) ? *(WORD *)(src + pos) : 0;
+}
+
+/* decompress data encoded with XPRESS Huffman */
+static NTSTATUS
+xpress_huff_decompress(UCHAR *src, ULONG src_size, PXPRESS_OUTPUT out)
+{
+    XPRESS_HUFF_DECODER decoder;
+    ULONG pos = 0, next_bits, block_end;
+    ULONG length, offset, offset_bits;
+    LONG symbol, extra_bits;
+
+    for (;;)
+    {
+        /* every block starts with a table of code lengths */
+        if (pos + XPRESS_HUFF_TABLE_SIZE + 2 * sizeof(WORD) > src_size)
+            return STATUS_SUCCESS;
+        if (!xpress_huff_build_decoder(&decoder, src + pos))
+            return STATUS_BAD_COMPRESSION_BUFFER;
+        pos += XPRESS_HUFF_TABLE_SIZE;
+
+        next_bits = xpress_huff_read_word(src, src_size, pos) << 16;
+        next_bits |= xpress_huff_read_word(src, src_size, pos + sizeof(WORD));
+        pos += 2 * sizeof(WORD);
+        extra_bits = 16;
+
+        block_end = out->Total + XPRESS_HUFF_BLOCK_SIZE;
+        while (out->Total < block_end)
+        {
+            symbol = xpress_huff_decode_symbol(&decoder, next_bits, &length);
+            if (symbol < 0)
+                return STATUS_BAD_COMPRESSION_BUFFER;
+
+            next_bits <<= length;
+            extra_bits -= length;
+            if (extra_bits < 0)
+            {
+                next_bits |= xpress_huff_read_word(src, src_size, pos) << -extra_bits;
+                extra_bits += 16;
+                pos += sizeof(WORD);
+            }
+
+            if (symbol < 256)
+            {
+                /* uncompressed data */
+                if (!xpress_put_byte(out, (UCHAR)symbol))
+                    return STATUS_SUCCESS;
+                continue;
+            }
+
+            if (symbol == XPRESS_HUFF_EOF_SYMBOL && pos >= src_size)
+                return STATUS_SUCCESS;
+
+            /* backwards reference */
+            symbol -= 256;
+            length = symbol & 0xF;
+            offset_bits = symbol >> 4;
+
+            if (length == 15)
+            {
+                if (pos >= src_size)
+                    return STATUS_BAD_COMPRESSION_BUFFER;
+                length = src[pos++];
+
+                if (length == 255)
+                {
+                    if (pos + sizeof(WORD) > src_size)
+                        return STATUS_BAD_COMPRESSION_BUFFER;
+                    length = *(WORD *)(src + pos);
+                    pos += sizeof(WORD);
+
+                    if (!length)
+                    {
+                        if (pos + sizeof(ULONG) > src_size)
+                            return STATUS_BAD_COMPRESSION_BUFFER;
+                        length = *(ULONG *)(src + pos);
+                        pos += sizeof(ULONG);
+                    }
+
+                    if (length < 15)
+                        return STATUS_BAD_COMPRESSION_BUFFER;
+                    length -= 15;
+                }
+                length += 15;
+            }
+            length += XPRESS_MIN_MATCH;
+
+            offset = 1 << offset_bits;
+            if (offset_bits)
+            {
+                offset |= next_bits >> (32 - offset_bits);
+                next_bits <<= offset_bits;
+                extra_bits -= offset_bits;
+                if (extra_bits < 0)
+                {
+                    next_bits |= xpress_huff_read_word(src, src_size, pos) << -extra_bits;
+                    extra_bits += 16;
+                    pos += sizeof(WORD);
+                }
+            }
+
+            /* ensure reference is valid */
+            if (offset > out->Total)
+                return STATUS_BAD_COMPRESSION_BUFFER;
+
+            if (!xpress_copy_match(out, offset, length))
+                return STATUS_SUCCESS;
+        }
+    }
+}
+
+static NTSTATUS
+RtlpDecompressFragmentXpress(USHORT format, UCHAR *dst, ULONG dst_size, UCHAR *src,
+                             ULONG src_size, ULONG offset, ULONG *final_size, UCHAR *workspace)
+{
+    XPRESS_OUTPUT out;
+    NTSTATUS status;
+
+    /* data in front of the fragment is still needed as match history */
+    if (offset && !workspace)
+        return STATUS_ACCESS_VIOLATION;
+
+    out.Start = out.Current = dst;
+    out.End = dst + dst_size;
+    out.History = workspace;
+    out.HistoryMask = (format == COMPRESSION_FORMAT_XPRESS) ? XPRESS_WINDOW_SIZE - 1
+                                                            : XPRESS_HUFF_WINDOW_SIZE - 1;
+    out.Offset = offset;
+    out.Total = 0;
+
+    if (format == COMPRESSION_FORMAT_XPRESS)
+        status = xpress_decompress(src, src_size, &out);
+    else
+        status = xpress_huff_decompress(src, src_size, &out);
+
+    if (NT_SUCCESS(status) && final_size)
+        *final_size = out.Current - out.Start;
+
+    return status;
+}
+
+static VOID
+xpress_init_match_finder(PXPRESS_MATCH_FINDER mf, PULONG hash_head, PUSHORT hash_chain,
+                         ULONG window_size, USHORT engine)
+{
+    mf->HashHead = hash_head;
+    mf->HashChain = hash_chain;
+    mf->ChainMask = window_size - 1;
+    mf->MaxOffset = window_size - 1;
+    mf->MaxChain = (engine == COMPRESSION_ENGINE_MAXIMUM) ? XPRESS_CHAIN_MAXIMUM
+                                                          : XPRESS_CHAIN_STANDARD;
+    if (hash_head)
+        RtlZeroMemory(hash_head, XPRESS_HASH_SIZE * sizeof(ULONG));
+}
+
+static NTSTATUS
+RtlpCompressBufferXpress(UCHAR *src, ULONG src_size, UCHAR *dst, ULONG dst_size,
+                         ULONG *final_size, UCHAR *workspace, USHORT engine)
+{
+    PRTLP_XPRESS_WORKSPACE ws = (PRTLP_XPRESS_WORKSPACE)workspace;
+    UCHAR *dst_cur = dst, *dst_end = dst + dst_size;
+    UCHAR *flags_ptr, *nibble = NULL;
+    ULONG flags = 0, flag_count = 0;
+    ULONG pos = 0, length, extra, offset = 0;
+    XPRESS_MATCH_FINDER mf;
+
+    /* without a workspace the data is only stored as literals */
+    xpress_init_match_finder(&mf, ws ? ws->HashHead : NULL, ws ? ws->HashChain : NULL,
+                             XPRESS_WINDOW_SIZE, engine);
+    mf.MaxOffset = XPRESS_WINDOW_SIZE;
+
+    if (dst_size < sizeof(ULONG))
+        return STATUS_BUFFER_TOO_SMALL;
+    flags_ptr = dst_cur;
+    dst_cur += sizeof(ULONG);
+
+    while (pos < src_size)
+    {
+        length = xpress_find_match(&mf, src, src_size, pos,
+                                   min(src_size - pos, XPRESS_MAX_MATCH), &offset);
+        if (length >= XPRESS_MIN_MATCH)
+        {
+            /* backwards reference */
+            if (dst_cur + sizeof(WORD) > dst_end)
+                return STATUS_BUFFER_TOO_SMALL;
+
+            extra = length - XPRESS_MIN_MATCH;
+            *(WORD *)dst_cur = (WORD)(((offset - 1) << 3) | min(extra, 7));
+            dst_cur += sizeof(WORD);
+
+            if (extra >= 7)
+            {
+                /* two length extensions share one byte */
+                extra -= 7;
+                if (!nibble)
+                {
+                    if (dst_cur >= dst_end)
+                        return STATUS_BUFFER_TOO_SMALL;
+                    nibble = dst_cur++;
+                    *nibble = (UCHAR)min(extra, 15);
+                }
+                else
+                {
+                    *nibble |= (UCHAR)(min(extra, 15) << 4);
+                    nibble = NULL;
+                }
+
+                if (extra >= 15)
+                {
+                    extra -= 15;
+                    if (extra < 255)
+                    {
+                        if (dst_cur >= dst_end)
+                            return STATUS_BUFFER_TOO_SMALL;
+                        *dst_cur++ = (UCHAR)extra;
+                    }
+                    else
+                    {
+                        if (dst_cur + 1 + sizeof(WORD) > dst_end)
+                            return STATUS_BUFFER_TOO_SMALL;
+                        *dst_cur++ = 255;
+                        *(WORD *)dst_cur = (WORD)(extra + 15 + 7);
+                        dst_cur += sizeof(WORD);
+                    }
+                }
+            }
+
+            flags = (flags << 1) | 1;
+            while (length--)
+                xpress_insert(&mf, src, src_size, pos++);
+        }
+        else
+        {
+            /* uncompressed data */
+            if (dst_cur >= dst_end)
+                return STATUS_BUFFER_TOO_SMALL;
+            *dst_cur++ = src[pos];
+            flags <<= 1;
+            xpress_insert(&mf, src, src_size, pos++);
+        }
+
+        if (++flag_count == 32)
+        {
+            *(ULONG *)flags_ptr = flags;
+            if (dst_cur + sizeof(ULONG) > dst_end)
+                return STATUS_BUFFER_TOO_SMALL;
+            flags_ptr = dst_cur;
+            dst_cur += sizeof(ULONG);
+            flags = 0;
+            flag_count = 0;
+        }
+    }
+
+    /* the unused flags are set, so that the decoder stops at the end of the input */
+    if (flag_count)
+        flags = (flags << (32 - flag_count)) | ((1U << (32 - flag_count)) - 1);
+    else
+        flags = 0xFFFFFFFF;
+    *(ULONG *)flags_ptr = flags;
+
+    if (final_size)
+        *final_size = dst_cur - dst;
+
+    return STATUS_SUCCESS;
+}
+
+/* compute code lengths limited to XPRESS_HUFF_MAX_CODE_LENGTH bits */
+static VOID
+xpress_huff_build_lengths(PRTLP_XPRESS_HUFF_WORKSPACE ws)
+{
+    ULONG symbol, count, leaf, node, next, i, max_depth, child[2], weight;
+
+    for (;;)
+    {
+        RtlZeroMemory(ws->Lengths, sizeof(ws->Lengths));
+
+        /* collect the used symbols, sorted by frequency */
+        count = 0;
+        for (symbol = 0; symbol < XPRESS_HUFF_SYMBOLS; symbol++)
+        {
+            weight = ws->Frequencies[symbol];
+            if (!weight) continue;
+
+            for (i = count; i > 0 && ws->Weights[i - 1] > weight; i--)
+            {
+                ws->Weights[i] = ws->Weights[i - 1];
+                ws->Leaves[i] = ws->Leaves[i - 1];
+            }
+            ws->Weights[i] = weight;
+            ws->Leaves[i] = (USHORT)symbol;
+            count++;
+        }
+
+        if (count == 0)
+            return;
+
+        if (count == 1)
+        {
+            ws->Lengths[ws->Leaves[0]] = 1;
+            return;
+        }
+
+        /* two queue construction: leaves are sorted, internal nodes are created in order */
+        leaf = 0;
+        node = count;
+        for (next = count; next < 2 * count - 1; next++)
+        {
+            for (i = 0; i < 2; i++)
+            {
+                if (leaf < count && (node >= next || ws->Weights[leaf] <= ws->Weights[node]))
+                    child[i] = leaf++;
+                else
+                    child[i] = node++;
+            }
+            ws->Weights[next] = ws->Weights[child[0]] + ws->Weights[child[1]];
+            ws->Parents[child[0]] = ws->Parents[child[1]] = (USHORT)next;
+        }
+
+        ws->Depths[2 * count - 2] = 0;
+        max_depth = 0;
+        for (i = 2 * count - 2; i-- > 0;)
+        {
+            ws->Depths[i] = ws->Depths[ws->Parents[i]] + 1;
+            if (i < count && ws->Depths[i] > max_depth)
+                max_depth = ws->Depths[i];
+        }
+
+        if (max_depth <= XPRESS_HUFF_MAX_CODE_LENGTH)
+        {
+            for (i = 0; i < count; i++)
+                ws->Lengths[ws->Leaves[i]] = ws->Depths[i];
+            return;
+        }
+
+        /* the tree is too deep, flatten the distribution and try again */
+        for (symbol = 0; symbol < XPRESS_HUFF_SYMBOLS; symbol++)
+        {
+            if (ws->Frequencies[symbol])
+                ws->Frequencies[symbol] = (ws->Frequencies[symbol] >> 1) | 1;
+        }
+    }
+}
+
+/* assign canonical codes: shorter codes first, then by symbol value */
+static VOID
+xpress_huff_build_codes(PRTLP_XPRESS_HUFF_WORKSPACE ws)
+{
+    USHORT next[XPRESS_HUFF_MAX_CODE_LENGTH + 1];
+    ULONG count[XPRESS_HUFF_MAX_CODE_LENGTH + 1];
+    ULONG symbol, length, code;
+
+    RtlZeroMemory(count, sizeof(count));
+    for (symbol = 0; symbol < XPRESS_HUFF_SYMBOLS; symbol++)
+        count[ws->Lengths[symbol]]++;
+    count[0] = 0;
+
+    code = 0;
+    for (length = 1; length <= XPRESS_HUFF_MAX_CODE_LENGTH; length++)
+    {
+        code = (code + count[length - 1]) << 1;
+        next[length] = (USHORT)code;
+    }
+
+    for (symbol = 0; symbol < XPRESS_HUFF_SYMBOLS; symbol++)
+    {
+        if (ws->Lengths[symbol])
+            ws->Codes[symbol] = next[ws->Lengths[symbol]]++;
+    }
+}
+
+typedef struct _XPRESS_BIT_WRITER
+{
+    PUCHAR Current;
+    PUCHAR End;
+    /* reserved words that receive the bits, the decoder reads them ahead of the byte data */
+    PUCHAR Word1;
+    PUCHAR Word2;
+    ULONG Bits;
+    ULONG FreeBits;
+} XPRESS_BIT_WRITER, *PXPRESS_BIT_WRITER;
+
+static __inline BOOLEAN
+xpress_write_bits(PXPRESS_BIT_WRITER writer, ULONG value, ULONG count)
+{
+    if (count <= writer->FreeBits)
+    {
+        writer->Bits = (writer->Bits << count) | value;
+        writer->FreeBits -= count;
+        return TRUE;
+    }
+
+    count -= writer->FreeBits;
+    *(WORD *)writer->Word1 = (WORD)((writer->Bits << writer->FreeBits) | (value >> count));
+
+    if (writer->Current + sizeof(WORD) > writer->End)
+        return FALSE;
+    writer->Word1 = writer->Word2;
+    writer->Word2 = writer->Current;
+    writer->Current += sizeof(WORD);
+
+    writer->Bits = value & ((1 << count) - 1);
+    writer->FreeBits = 16 - count;
+    return TRUE;
+}
+
+static NTSTATUS
+RtlpCompressBufferXpressHuff(UCHAR *src, ULONG src_size, UCHAR *dst, ULONG dst_size,
+                             ULONG *final_size, UCHAR *workspace, USHORT engine)
+{
+    PRTLP_XPRESS_HUFF_WORKSPACE ws = (PRTLP_XPRESS_HUFF_WORKSPACE)workspace;
+    UCHAR *dst_cur = dst, *dst_end = dst + dst_size;
+    ULONG pos = 0, block_end, length, extra, offset = 0, offset_bits;
+    ULONG token, token_count, symbol, i;
+    XPRESS_MATCH_FINDER mf;
+    XPRESS_BIT_WRITER writer;
+    BOOLEAN last;
+
+    /* the tokens of a block are buffered to count the symbol frequencies first */
+    if (!ws)
+        return STATUS_INVALID_PARAMETER;
+
+    xpress_init_match_finder(&mf, ws->HashHead, ws->HashChain, XPRESS_HUFF_WINDOW_SIZE, engine);
+
+    do
+    {
+        block_end = pos + min(src_size - pos, XPRESS_HUFF_BLOCK_SIZE);
+        last = (block_end == src_size);
+
+        RtlZeroMemory(ws->Frequencies, sizeof(ws->Frequencies));
+        token_count = 0;
+
+        while (pos < block_end)
+        {
+            length = xpress_find_match(&mf, src, src_size, pos,
+                                       min(block_end - pos, XPRESS_MAX_MATCH), &offset);
+
+            /* offset 1 with minimal length encodes like the end of stream marker */
+            if (length > XPRESS_MIN_MATCH || (length == XPRESS_MIN_MATCH && offset != 1))
+            {
+                BitScanReverse(&offset_bits, offset);
+                symbol = 256 | (offset_bits << 4) | min(length - XPRESS_MIN_MATCH, 15);
+                ws->Tokens[token_count++] = (offset << 16) | (length - XPRESS_MIN_MATCH);
+                ws->Frequencies[symbol]++;
+
+                while (length--)
+                    xpress_insert(&mf, src, src_size, pos++);
+            }
+            else
+            {
+                ws->Tokens[token_count++] = src[pos];
+                ws->Frequencies[src[pos]]++;
+                xpress_insert(&mf, src, src_size, pos++);
+            }
+        }
+
+        if (last)
+            ws->Frequencies[XPRESS_HUFF_EOF_SYMBOL]++;
+
+        xpress_huff_build_lengths(ws);
+        xpress_huff_build_codes(ws);
+
+        /* write the table of code lengths, followed by the two reserved bit words */
+        if (dst_cur + XPRESS_HUFF_TABLE_SIZE + 2 * sizeof(WORD) > dst_end)
+            return STATUS_BUFFER_TOO_SMALL;
+
+        for (i = 0; i < XPRESS_HUFF_TABLE_SIZE; i++)
+            dst_cur[i] = ws->Lengths[2 * i] | (ws->Lengths[2 * i + 1] << 4);
+        dst_cur += XPRESS_HUFF_TABLE_SIZE;
+
+        writer.Word1 = dst_cur;
+        writer.Word2 = dst_cur + sizeof(WORD);
+        writer.Current = dst_cur + 2 * sizeof(WORD);
+        writer.End = dst_end;
+        writer.Bits = 0;
+        writer.FreeBits = 16;
+
+        for (i = 0; i < token_count; i++)
+        {
+            token = ws->Tokens[i];
+            offset = token >> 16;
+
+            if (!offset)
+            {
+                /* uncompressed data */
+                if (!xpress_write_bits(&writer, ws->Codes[token], ws->Lengths[token]))
+                    return STATUS_BUFFER_TOO_SMALL;
+                continue;
+            }
+
+            /* backwards reference */
+            extra = token & 0xFFFF;
+            BitScanReverse(&offset_bits, offset);
+            symbol = 256 | (offset_bits << 4) | min(extra, 15);
+            if (!xpress_write_bits(&writer, ws->Codes[symbol], ws->Lengths[symbol]))
+                return STATUS_BUFFER_TOO_SMALL;
+
+            /* long lengths are stored as bytes in between the bit words */
+            if (extra >= 15)
+            {
+                if (extra - 15 < 255)
+                {
+                    if (writer.Current >= dst_end)
+                        return STATUS_BUFFER_TOO_SMALL;
+                    *writer.Current++ = (UCHAR)(extra - 15);
+                }
+                else
+                {
+                    if (writer.Current + 1 + sizeof(WORD) > dst_end)
+                        return STATUS_BUFFER_TOO_SMALL;
+                    *writer.Current++ = 255;
+                    *(WORD *)writer.Current = (WORD)extra;
+                    writer.Current += sizeof(WORD);
+                }
+            }
+
+            if (offset_bits &&
+                !xpress_write_bits(&writer, offset & ((1 << offset_bits) - 1), offset_bits))
+            {
+                return STATUS_BUFFER_TOO_SMALL;
+            }
+        }
+
+        if (last &&
+            !xpress_write_bits(&writer,
+                               ws->Codes[XPRESS_HUFF_EOF_SYMBOL],
+                               ws->Lengths[XPRESS_HUFF_EOF_SYMBOL]))
+        {
+            return STATUS_BUFFER_TOO_SMALL;
+        }
+
+        /* flush the remaining bits, the next block starts after the bytes read so far */
+        *(WORD *)writer.Word1 = (WORD)(writer.Bits << writer.FreeBits);
+        *(WORD *)writer.Word2 = 0;
+        dst_cur = writer.Current;
+    }
+    while (!last);
+
+    if (final_size)
+        *final_size = dst_cur - dst;
+
+    return STATUS_SUCCESS;
+}
+
+
+static NTSTATUS
+RtlpWorkSpaceSizeXpress(USHORT Format,
+                        USHORT Engine,
+                        PULONG BufferAndWorkSpaceSize,
+                        PULONG FragmentWorkSpaceSize)
+{
+    if (Engine != COMPRESSION_ENGINE_STANDARD && Engine != COMPRESSION_ENGINE_MAXIMUM)
+        return STATUS_NOT_SUPPORTED;
+
+    /* The fragment workspace holds the match history in front of the requested offset */
+    if (Format == COMPRESSION_FORMAT_XPRESS)
+    {
+        *BufferAndWorkSpaceSize = sizeof(RTLP_XPRESS_WORKSPACE);
+        *FragmentWorkSpaceSize = XPRESS_WINDOW_SIZE;
+    }
+    else
+    {
+        *BufferAndWorkSpaceSize = sizeof(RTLP_XPRESS_HUFF_WORKSPACE);
+        *FragmentWorkSpaceSize = XPRESS_HUFF_WINDOW_SIZE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
 /*
  * @implemented
  */
@@ -284,7 +1389,7 @@ RtlCompressBuffer(IN USHORT CompressionFormatAndEngine,
                   IN PVOID WorkSpace)
 {
    USHORT Format = CompressionFormatAndEngine & COMPRESSION_FORMAT_MASK;
-   /* USHORT Engine = CompressionFormatAndEngine & COMPRESSION_ENGINE_MASK; */
+   USHORT Engine = CompressionFormatAndEngine & COMPRESSION_ENGINE_MASK;
 
    if ((Format == COMPRESSION_FORMAT_NONE) ||
          (Format == COMPRESSION_FORMAT_DEFAULT))
@@ -297,14 +1402,33 @@ RtlCompressBuffer(IN USHORT CompressionFormatAndEngine,
                                      CompressedBufferSize,
                                      UncompressedChunkSize,
                                      FinalCompressedSize,
-                                     WorkSpace));
+                                     WorkSpace,
+                                     Engine));
+
+   if (Format == COMPRESSION_FORMAT_XPRESS)
+      return(RtlpCompressBufferXpress(UncompressedBuffer,
+                                      UncompressedBufferSize,
+                                      CompressedBuffer,
+                                      CompressedBufferSize,
+                                      FinalCompressedSize,
+                                      WorkSpace,
+                                      Engine));
+
+   if (Format == COMPRESSION_FORMAT_XPRESS_HUFF)
+      return(RtlpCompressBufferXpressHuff(UncompressedBuffer,
+                                          UncompressedBufferSize,
+                                          CompressedBuffer,
+                                          CompressedBufferSize,
+                                          FinalCompressedSize,
+                                          WorkSpace,
+                                          Engine));
 
    return(STATUS_UNSUPPORTED_COMPRESSION);
 }
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 NTSTATUS NTAPI
 RtlCompressChunks(IN PUCHAR UncompressedBuffer,
@@ -315,12 +1439,69 @@ RtlCompressChunks(IN PUCHAR UncompressedBuffer,
                   IN ULONG CompressedDataInfoLength,
                   IN PVOID WorkSpace)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    PUCHAR Source = UncompressedBuffer, SourceEnd = UncompressedBuffer + UncompressedBufferSize;
+    PUCHAR Dest = CompressedBuffer, DestEnd = CompressedBuffer + CompressedBufferSize;
+    ULONG ChunkSize, BlockSize, FinalSize, Chunk, NumberOfChunks, i;
+    NTSTATUS Status;
+
+    ChunkSize = 1 << CompressedDataInfo->ChunkShift;
+    NumberOfChunks = (UncompressedBufferSize + ChunkSize - 1) >> CompressedDataInfo->ChunkShift;
+
+    if (CompressedDataInfoLength < FIELD_OFFSET(COMPRESSED_DATA_INFO,
+                                                CompressedChunkSizes[NumberOfChunks]))
+        return STATUS_BUFFER_TOO_SMALL;
+
+    for (Chunk = 0; Source < SourceEnd; Chunk++, Source += BlockSize)
+    {
+        BlockSize = min(ChunkSize, SourceEnd - Source);
+
+        /* Chunks of zeros are not stored at all */
+        for (i = 0; i < BlockSize; i++)
+            if (Source[i]) break;
+
+        if (i == BlockSize)
+        {
+            CompressedDataInfo->CompressedChunkSizes[Chunk] = 0;
+            continue;
+        }
+
+        /*
+         * Chunks are stored uncompressed as a whole chunk, padded with zeros
+         * if it is the short last one, so that a chunk of exactly ChunkSize
+         * bytes is always uncompressed, and any smaller one is compressed.
+         */
+        Status = RtlCompressBuffer(CompressedDataInfo->CompressionFormatAndEngine,
+                                   Source,
+                                   BlockSize,
+                                   Dest,
+                                   min(ChunkSize - 1, DestEnd - Dest),
+                                   ChunkSize,
+                                   &FinalSize,
+                                   WorkSpace);
+        if (Status == STATUS_BUFFER_TOO_SMALL)
+        {
+            if (Dest + ChunkSize > DestEnd)
+                return STATUS_BUFFER_TOO_SMALL;
+
+            RtlCopyMemory(Dest, Source, BlockSize);
+            RtlZeroMemory(Dest + BlockSize, ChunkSize - BlockSize);
+            FinalSize = ChunkSize;
+        }
+        else if (!NT_SUCCESS(Status))
+        {
+            return Status;
+        }
+
+        CompressedDataInfo->CompressedChunkSizes[Chunk] = FinalSize;
+        Dest += FinalSize;
+    }
+
+    CompressedDataInfo->NumberOfChunks = (USHORT)Chunk;
+    return STATUS_SUCCESS;
 }
 
 /*
- * @unimplemented
+ * @implemented
  */
 NTSTATUS NTAPI
 RtlDecompressChunks(OUT PUCHAR UncompressedBuffer,
@@ -331,8 +1512,63 @@ RtlDecompressChunks(OUT PUCHAR UncompressedBuffer,
                     IN ULONG CompressedTailSize,
                     IN PCOMPRESSED_DATA_INFO CompressedDataInfo)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    PUCHAR Dest = UncompressedBuffer, DestEnd = UncompressedBuffer + UncompressedBufferSize;
+    PUCHAR Source = CompressedBuffer, SourceEnd = CompressedBuffer + CompressedBufferSize;
+    ULONG ChunkSize, BlockSize, CompressedSize, FinalSize, Chunk;
+    BOOLEAN InTail = FALSE;
+    NTSTATUS Status;
+
+    ChunkSize = 1 << CompressedDataInfo->ChunkShift;
+
+    for (Chunk = 0; Chunk < CompressedDataInfo->NumberOfChunks && Dest < DestEnd; Chunk++)
+    {
+        BlockSize = min(ChunkSize, DestEnd - Dest);
+        CompressedSize = CompressedDataInfo->CompressedChunkSizes[Chunk];
+
+        /* Chunks that do not fit in the buffer anymore continue in the tail */
+        if (Source + CompressedSize > SourceEnd)
+        {
+            if (InTail)
+                return STATUS_BAD_COMPRESSION_BUFFER;
+
+            InTail = TRUE;
+            Source = CompressedTail;
+            SourceEnd = CompressedTail + CompressedTailSize;
+            if (Source + CompressedSize > SourceEnd)
+                return STATUS_BAD_COMPRESSION_BUFFER;
+        }
+
+        if (CompressedSize == 0)
+        {
+            /* Chunk of zeros */
+            RtlZeroMemory(Dest, BlockSize);
+        }
+        else if (CompressedSize == ChunkSize)
+        {
+            /* Chunk that was stored uncompressed, whatever part of it we need */
+            RtlCopyMemory(Dest, Source, BlockSize);
+        }
+        else
+        {
+            Status = RtlDecompressBuffer(CompressedDataInfo->CompressionFormatAndEngine,
+                                         Dest,
+                                         BlockSize,
+                                         Source,
+                                         CompressedSize,
+                                         &FinalSize);
+            if (!NT_SUCCESS(Status))
+                return Status;
+
+            /* Short chunks are only allowed at the end of the data */
+            if (FinalSize < BlockSize)
+                RtlZeroMemory(Dest + FinalSize, BlockSize - FinalSize);
+        }
+
+        Source += CompressedSize;
+        Dest += BlockSize;
+    }
+
+    return STATUS_SUCCESS;
 }
 
 /*
@@ -357,6 +1593,12 @@ RtlDecompressFragment(IN USHORT format,
             return lznt1_decompress(uncompressed, uncompressed_size, compressed,
                                     compressed_size, offset, final_size, workspace);
 
+        case COMPRESSION_FORMAT_XPRESS:
+        case COMPRESSION_FORMAT_XPRESS_HUFF:
+            return RtlpDecompressFragmentXpress(format & COMPRESSION_FORMAT_MASK, uncompressed,
+                                                uncompressed_size, compressed, compressed_size,
+                                                offset, final_size, workspace);
+
         case COMPRESSION_FORMAT_NONE:
         case COMPRESSION_FORMAT_DEFAULT:
             return STATUS_INVALID_PARAMETER;
@@ -417,6 +1659,13 @@ RtlGetCompressionWorkSpaceSize(IN USHORT CompressionFormatAndEngine,
                                     CompressBufferAndWorkSpaceSize,
                                     CompressFragmentWorkSpaceSize));
 
+   if ((Format == COMPRESSION_FORMAT_XPRESS) ||
+         (Format == COMPRESSION_FORMAT_XPRESS_HUFF))
+      return(RtlpWorkSpaceSizeXpress(Format,
+                                     Engine,
+                                     CompressBufferAndWorkSpaceSize,
+                                     CompressFragmentWorkSpaceSize));
+
    return(STATUS_UNSUPPORTED_COMPRESSION);
 }
 
@@ -223,6 +223,10 @@ RtlpInitializeHeap(OUT PHEAP Heap,
     /* Initialise the Heap Virtual Allocated Blocks list */
     InitializeListHead(&Heap->VirtualAllocdBlocks);
 
+    /* No front end until RtlSetHeapInformation asks for one */
+    Heap->FrontEndHeap = NULL;
+    Heap->FrontEndHeapType = HEAP_FRONT_END_NONE;
+
     /* Initialise the Heap UnCommitted Region lists */
     InitializeListHead(&Heap->UCRSegments);
     InitializeListHead(&Heap->UCRList);
@@ -1785,6 +1789,18 @@ RtlDestroyHeap(HANDLE HeapPtr) /* [in] Handle of heap */
                             MEM_RELEASE);
     }
 
+    /* Free the front end, the blocks it caches go away with the segments */
+    if (Heap->FrontEndHeap)
+    {
+        BaseAddress = Heap->FrontEndHeap;
+        Size = 0;
+        ZwFreeVirtualMemory(NtCurrentProcess(),
+                            &BaseAddress,
+                            &Size,
+                            MEM_RELEASE);
+        Heap->FrontEndHeap = NULL;
+    }
+
     /* Delete tags and remove heap from the process heaps list in user mode */
     if (RtlpGetMode() == UserMode)
     {
@@ -2056,6 +2072,245 @@ RtlpAllocateNonDedicated(PHEAP Heap,
     return NULL;
 }
 
+/* Low fragmentation front end *********************************************/
+
+FORCEINLINE
+USHORT
+RtlpLowFragHeapDepth(SIZE_T Index)
+{
+    SIZE_T Depth = HEAP_LFH_BUCKET_BYTES / (Index << HEAP_ENTRY_SHIFT);
+
+    /* Cache many small blocks but only a few big ones */
+    if (Depth < HEAP_LFH_MIN_DEPTH) return HEAP_LFH_MIN_DEPTH;
+    if (Depth > HEAP_LFH_MAX_DEPTH) return HEAP_LFH_MAX_DEPTH;
+    return (USHORT)Depth;
+}
+
+static
+PSLIST_ENTRY
+RtlpLowFragHeapRefill(PHEAP Heap,
+                      PHEAP_LFH_SLOT Slot,
+                      SIZE_T Index)
+{
+    PSLIST_HEADER ListHead = &Slot->Buckets[Index - HEAP_LFH_MIN_INDEX];
+    PSLIST_ENTRY Result = NULL;
+    PHEAP_ENTRY HeapEntry;
+    PVOID Block;
+    ULONG Count;
+
+    Count = min(RtlpLowFragHeapDepth(Index) / 2, HEAP_LFH_REFILL);
+
+    /* Carve a batch of blocks from the back end under a single lock acquisition */
+    RtlEnterHeapLock(Heap->LockVariable, TRUE);
+
+    _SEH2_TRY
+    {
+        while (Count--)
+        {
+            Block = RtlAllocateHeap(Heap,
+                                    HEAP_NO_SERIALIZE,
+                                    (Index << HEAP_ENTRY_SHIFT) - sizeof(HEAP_ENTRY));
+            if (!Block) break;
+
+            HeapEntry = (PHEAP_ENTRY)Block - 1;
+            if ((HeapEntry->Size != Index) ||
+                ((HeapEntry->Flags & ~HEAP_ENTRY_LAST_ENTRY) != HEAP_ENTRY_BUSY))
+            {
+                /* The back end didn't give us a block of the bucket size */
+                RtlFreeHeap(Heap, HEAP_NO_SERIALIZE, Block);
+                continue;
+            }
+
+            HeapEntry->SmallTagIndex = HEAP_LFH_CACHED_MARK;
+
+            /* Keep the first one for the caller */
+            if (!Result)
+                Result = Block;
+            else
+                RtlInterlockedPushEntrySList(ListHead, Block);
+        }
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        /* Out of memory on a HEAP_GENERATE_EXCEPTIONS heap, keep what we got.
+           The caller falls back to the back end if that is nothing. */
+    }
+    _SEH2_END;
+
+    RtlLeaveHeapLock(Heap->LockVariable);
+
+    return Result;
+}
+
+static
+PVOID
+RtlpLowFragHeapAllocate(PHEAP Heap,
+                        ULONG Flags,
+                        SIZE_T Size,
+                        SIZE_T Index)
+{
+    PHEAP_LFH Lfh = (PHEAP_LFH)Heap->FrontEndHeap;
+    ULONG Affinity = RtlpGetHeapAffinity() % HEAP_LFH_SLOTS;
+    ULONG Bucket = (ULONG)(Index - HEAP_LFH_MIN_INDEX);
+    PHEAP_LFH_SLOT Slot = &Lfh->Slots[Affinity];
+    PSLIST_ENTRY ListEntry;
+    PHEAP_ENTRY InUseEntry;
+    ULONG i;
+
+    ListEntry = RtlInterlockedPopEntrySList(&Slot->Buckets[Bucket]);
+
+    /* Take from the other slots before bothering the back end */
+    for (i = 1; !ListEntry && i < HEAP_LFH_SLOTS; i++)
+    {
+        ListEntry = RtlInterlockedPopEntrySList(
+            &Lfh->Slots[(Affinity + i) % HEAP_LFH_SLOTS].Buckets[Bucket]);
+    }
+
+    if (ListEntry)
+    {
+        InterlockedIncrement((PLONG)&Slot->Hits);
+    }
+    else
+    {
+        InterlockedIncrement((PLONG)&Slot->Misses);
+        ListEntry = RtlpLowFragHeapRefill(Heap, Slot, Index);
+        if (!ListEntry) return NULL;
+    }
+
+    /* Turn the cached block back into a regular busy one */
+    InUseEntry = (PHEAP_ENTRY)ListEntry - 1;
+    ASSERT(InUseEntry->Size == Index);
+    ASSERT(InUseEntry->SmallTagIndex == HEAP_LFH_CACHED_MARK);
+    InUseEntry->SmallTagIndex = 0;
+    InUseEntry->UnusedBytes = (UCHAR)((Index << HEAP_ENTRY_SHIFT) - Size);
+
+    /* Zero memory if that was requested */
+    if (Flags & HEAP_ZERO_MEMORY)
+        RtlZeroMemory(InUseEntry + 1, Size);
+
+    return InUseEntry + 1;
+}
+
+static
+BOOLEAN
+RtlpLowFragHeapFree(PHEAP Heap,
+                    PHEAP_ENTRY HeapEntry)
+{
+    PHEAP_LFH Lfh = (PHEAP_LFH)Heap->FrontEndHeap;
+    PHEAP_LFH_SLOT Slot;
+    PSLIST_HEADER ListHead;
+
+    /* Only plain blocks of a bucket size, anything with extra state goes to the back end */
+    if (((HeapEntry->Flags & ~HEAP_ENTRY_LAST_ENTRY) != HEAP_ENTRY_BUSY) ||
+        (HeapEntry->Size < HEAP_LFH_MIN_INDEX) ||
+        (HeapEntry->Size > HEAP_LFH_MAX_INDEX))
+    {
+        return FALSE;
+    }
+
+    Slot = &Lfh->Slots[RtlpGetHeapAffinity() % HEAP_LFH_SLOTS];
+    ListHead = &Slot->Buckets[HeapEntry->Size - HEAP_LFH_MIN_INDEX];
+
+    /* Let the back end coalesce it if this bucket holds enough already */
+    if (RtlQueryDepthSList(ListHead) >= RtlpLowFragHeapDepth(HeapEntry->Size))
+    {
+        InterlockedIncrement((PLONG)&Slot->Overflows);
+        return FALSE;
+    }
+
+    HeapEntry->SmallTagIndex = HEAP_LFH_CACHED_MARK;
+    RtlInterlockedPushEntrySList(ListHead, (PSLIST_ENTRY)(HeapEntry + 1));
+    InterlockedIncrement((PLONG)&Slot->Frees);
+
+    return TRUE;
+}
+
+static
+NTSTATUS
+RtlpEnableLowFragHeap(PHEAP Heap)
+{
+    PHEAP_LFH Lfh = NULL;
+    SIZE_T Size = sizeof(HEAP_LFH);
+    NTSTATUS Status;
+    ULONG i, j;
+
+    /* Check for page heap first, its handle is not a HEAP */
+    if (Heap->ForceFlags & HEAP_FLAG_PAGE_ALLOCS)
+        return STATUS_UNSUCCESSFUL;
+
+    if (Heap->Signature != HEAP_SIGNATURE)
+        return STATUS_INVALID_PARAMETER;
+
+    /* Nothing to do if it's already there */
+    if (Heap->FrontEndHeapType == HEAP_FRONT_END_LFH)
+        return STATUS_SUCCESS;
+
+    /* The front end works without the heap lock and skips the debug checks */
+    if ((Heap->Flags & (HEAP_NO_SERIALIZE |
+                        HEAP_TAIL_CHECKING_ENABLED |
+                        HEAP_FREE_CHECKING_ENABLED)) ||
+        RtlpHeapIsSpecial(Heap->Flags))
+    {
+        return STATUS_UNSUCCESSFUL;
+    }
+
+    Status = ZwAllocateVirtualMemory(NtCurrentProcess(),
+                                     (PVOID *)&Lfh,
+                                     0,
+                                     &Size,
+                                     MEM_COMMIT,
+                                     PAGE_READWRITE);
+    if (!NT_SUCCESS(Status))
+        return Status;
+
+    for (i = 0; i < HEAP_LFH_SLOTS; i++)
+    {
+        for (j = 0; j < HEAP_LFH_BUCKETS; j++)
+            RtlInitializeSListHead(&Lfh->Slots[i].Buckets[j]);
+    }
+
+    if (InterlockedCompareExchangePointer(&Heap->FrontEndHeap, Lfh, NULL) != NULL)
+    {
+        /* Somebody else enabled it meanwhile */
+        Size = 0;
+        ZwFreeVirtualMemory(NtCurrentProcess(), (PVOID *)&Lfh, &Size, MEM_RELEASE);
+        return STATUS_SUCCESS;
+    }
+
+    Heap->FrontEndHeapType = HEAP_FRONT_END_LFH;
+    return STATUS_SUCCESS;
+}
+
+static
+VOID
+RtlpQueryLowFragHeap(PHEAP Heap,
+                     PRTL_HEAP_FRONT_END_INFORMATION Information)
+{
+    PHEAP_LFH Lfh = (PHEAP_LFH)Heap->FrontEndHeap;
+    PHEAP_LFH_SLOT Slot;
+    ULONG i, j;
+
+    RtlZeroMemory(Information, sizeof(*Information));
+    Information->FrontEndHeapType = Heap->FrontEndHeapType;
+    if (!Lfh) return;
+
+    Information->NumberOfSlots = HEAP_LFH_SLOTS;
+    Information->MaximumBlockSize = (HEAP_LFH_MAX_INDEX << HEAP_ENTRY_SHIFT) - sizeof(HEAP_ENTRY);
+
+    /* The counters are updated without the heap lock, this is a snapshot */
+    for (i = 0; i < HEAP_LFH_SLOTS; i++)
+    {
+        Slot = &Lfh->Slots[i];
+        for (j = 0; j < HEAP_LFH_BUCKETS; j++)
+            Information->CachedBlocks += RtlQueryDepthSList(&Slot->Buckets[j]);
+
+        Information->Hits += Slot->Hits;
+        Information->Misses += Slot->Misses;
+        Information->Frees += Slot->Frees;
+        Information->Overflows += Slot->Overflows;
+    }
+}
+
 /***********************************************************************
  *           HeapAlloc   (KERNEL32.334)
  * RETURNS
@@ -2125,6 +2380,17 @@ RtlAllocateHeap(IN PVOID HeapPtr,
 
     Index = AllocationSize >> HEAP_ENTRY_SHIFT;
 
+    /* Plain small allocations are served by the low fragmentation front end */
+    if (Heap->FrontEndHeap &&
+        (EntryFlags == HEAP_ENTRY_BUSY) &&
+        !(Flags & HEAP_NO_SERIALIZE) &&
+        (Index >= HEAP_LFH_MIN_INDEX) &&
+        (Index <= HEAP_LFH_MAX_INDEX))
+    {
+        PVOID Block = RtlpLowFragHeapAllocate(Heap, Flags, Size, Index);
+        if (Block) return Block;
+    }
+
     /* Acquire the lock if necessary */
     if (!(Flags & HEAP_NO_SERIALIZE))
     {
@@ -2334,6 +2600,21 @@ BOOLEAN NTAPI RtlFreeHeap(
     }
     _SEH2_END;
 
+    if (Heap->FrontEndHeap)
+    {
+        /* A block sitting in the front end caches is already free */
+        if (HeapEntry->SmallTagIndex == HEAP_LFH_CACHED_MARK)
+        {
+            DPRINT1("HEAP: Trying to free an already freed block %p!\n", Ptr);
+            RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_INVALID_PARAMETER);
+            return FALSE;
+        }
+
+        /* Keep small blocks in the front end */
+        if (!(Flags & HEAP_NO_SERIALIZE) && RtlpLowFragHeapFree(Heap, HeapEntry))
+            return TRUE;
+    }
+
     /* Lock if necessary */
     if (!(Flags & HEAP_NO_SERIALIZE))
     {
@@ -4080,13 +4361,15 @@ RtlSetHeapInformation(IN HANDLE HeapHandle OPTIONAL,
         }
 
         /* Check for a special magic value for enabling LFH */
-        if (*(PULONG)HeapInformation != 2)
+        if (*(PULONG)HeapInformation != HEAP_FRONT_END_LFH)
         {
             return STATUS_UNSUCCESSFUL;
         }
 
-        DPRINT1("RtlSetHeapInformation() needs to enable LFH\n");
-        return STATUS_SUCCESS;
+        if (!HeapHandle)
+            return STATUS_SUCCESS;
+
+        return RtlpEnableLowFragHeap((PHEAP)HeapHandle);
     }
 
     return STATUS_SUCCESS;
@@ -4122,9 +4405,120 @@ RtlQueryHeapInformation(HANDLE HeapHandle,
         return STATUS_SUCCESS;
     }
 
+    /* Low fragmentation front end statistics */
+    if (HeapInformationClass == HeapFrontEndInformation)
+    {
+        if (ReturnLength)
+            *ReturnLength = sizeof(RTL_HEAP_FRONT_END_INFORMATION);
+
+        if (HeapInformationLength < sizeof(RTL_HEAP_FRONT_END_INFORMATION))
+            return STATUS_BUFFER_TOO_SMALL;
+
+        RtlpQueryLowFragHeap(Heap, HeapInformation);
+        return STATUS_SUCCESS;
+    }
+
     return STATUS_UNSUCCESSFUL;
 }
 
+static
+PHEAP_FREE_ENTRY
+RtlpFindFreeRun(PHEAP Heap,
+                SIZE_T Index,
+                SIZE_T RunSize)
+{
+    PHEAP_FREE_ENTRY FreeEntry;
+    ULONG HintIndex;
+
+    if (IsListEmpty(&Heap->FreeLists))
+        return NULL;
+
+    /* The list is sorted, the largest entry is the last one */
+    FreeEntry = CONTAINING_RECORD(Heap->FreeLists.Blink, HEAP_FREE_ENTRY, FreeList);
+    if (FreeEntry->Size < Index)
+        return NULL;
+
+    /* Nothing is big enough for the whole run, carve as much as we can from the largest */
+    if (FreeEntry->Size <= RunSize)
+        return FreeEntry;
+
+    /* Otherwise use the smallest entry holding all of it */
+    if (RunSize > Heap->DeCommitFreeBlockThreshold)
+    {
+        FreeEntry = CONTAINING_RECORD(Heap->FreeHints[0], HEAP_FREE_ENTRY, FreeList);
+
+        while (FreeEntry->Size < RunSize)
+        {
+            ASSERT(FreeEntry->FreeList.Flink != &Heap->FreeLists);
+            FreeEntry = CONTAINING_RECORD(FreeEntry->FreeList.Flink,
+                                          HEAP_FREE_ENTRY,
+                                          FreeList);
+        }
+    }
+    else
+    {
+        HintIndex = RtlFindSetBits(&Heap->FreeHintBitmap, 1, (ULONG)(RunSize - 1));
+        ASSERT(HintIndex != 0xFFFFFFFF);
+        ASSERT((HintIndex >= (RunSize - 1)) || (HintIndex == 0));
+        FreeEntry = CONTAINING_RECORD(Heap->FreeHints[HintIndex],
+                                      HEAP_FREE_ENTRY,
+                                      FreeList);
+    }
+
+    return FreeEntry;
+}
+
+static
+ULONG
+RtlpCarveFreeRun(PHEAP Heap,
+                 ULONG Flags,
+                 PHEAP_FREE_ENTRY FreeEntry,
+                 SIZE_T AllocationSize,
+                 SIZE_T Index,
+                 SIZE_T Size,
+                 ULONG Count)
+{
+    PHEAP_ENTRY InUseEntry = (PHEAP_ENTRY)FreeEntry;
+    SIZE_T FreeSize = FreeEntry->Size;
+    UCHAR FreeFlags = FreeEntry->Flags;
+    UCHAR SegmentOffset = FreeEntry->SegmentOffset;
+    ULONG Carved;
+
+    if (Count > FreeSize / Index)
+        Count = (ULONG)(FreeSize / Index);
+    ASSERT(Count != 0);
+
+    /* Cut all but the last block off the front of the free entry */
+    for (Carved = 0; Carved < Count - 1; Carved++)
+    {
+        InUseEntry->Size = (USHORT)Index;
+        InUseEntry->Flags = HEAP_ENTRY_BUSY;
+        InUseEntry->SmallTagIndex = 0;
+        InUseEntry->UnusedBytes = (UCHAR)(AllocationSize - Size);
+
+        Heap->TotalFreeSize -= Index;
+        FreeSize -= Index;
+
+        InUseEntry += Index;
+        InUseEntry->PreviousSize = (USHORT)Index;
+        InUseEntry->SegmentOffset = SegmentOffset;
+    }
+
+    /* The last one goes through the regular split, which takes care of the remainder */
+    FreeEntry = (PHEAP_FREE_ENTRY)InUseEntry;
+    FreeEntry->Size = (USHORT)FreeSize;
+    FreeEntry->Flags = FreeFlags;
+
+    InUseEntry = RtlpSplitEntry(Heap, Flags, FreeEntry, AllocationSize, Index, Size);
+    Carved++;
+
+    /* The entry after the original free one still has its size as previous size */
+    if (!(InUseEntry->Flags & HEAP_ENTRY_LAST_ENTRY))
+        (InUseEntry + InUseEntry->Size)->PreviousSize = InUseEntry->Size;
+
+    return Carved;
+}
+
 /* @implemented */
 ULONG
 NTAPI
@@ -4134,31 +4528,194 @@ RtlMultipleAllocateHeap(IN PVOID HeapHandle,
                         IN ULONG Count,
                         OUT PVOID *Array)
 {
-    ULONG Index;
+    PHEAP Heap = (PHEAP)HeapHandle;
+    PHEAP_FREE_ENTRY FreeEntry;
+    PHEAP_ENTRY InUseEntry;
+    SIZE_T AllocationSize, Index, RunSize, Blocks;
+    ULONG Allocated = 0, Carved, i;
+    BOOLEAN FromExtension;
     EXCEPTION_RECORD ExceptionRecord;
 
-    for (Index = 0; Index < Count; ++Index)
+    Flags |= Heap->ForceFlags;
+
+    if (Size)
+        AllocationSize = Size;
+    else
+        AllocationSize = 1;
+    AllocationSize = (AllocationSize + Heap->AlignRound) & Heap->AlignMask;
+    Index = AllocationSize >> HEAP_ENTRY_SHIFT;
+
+    /* Only plain blocks from the free lists are carved in one go,
+       everything else takes the regular path one block at a time */
+    if (RtlpHeapIsSpecial(Flags) ||
+        (Size >= 0x80000000) ||
+        (Flags & (HEAP_EXTRA_FLAGS_MASK | HEAP_SETTABLE_USER_FLAGS)) ||
+        Heap->PseudoTagEntries ||
+        (Index > Heap->VirtualMemoryThreshold))
     {
-        Array[Index] = RtlAllocateHeap(HeapHandle, Flags, Size);
-        if (Array[Index] == NULL)
+        for (Allocated = 0; Allocated < Count; ++Allocated)
         {
-            /* ERROR_NOT_ENOUGH_MEMORY */
-            RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_NO_MEMORY);
+            Array[Allocated] = RtlAllocateHeap(HeapHandle, Flags, Size);
+            if (Array[Allocated] == NULL)
+                break;
+        }
+    }
+    else
+    {
+        if (!(Flags & HEAP_NO_SERIALIZE))
+            RtlEnterHeapLock(Heap->LockVariable, TRUE);
 
-            if (Flags & HEAP_GENERATE_EXCEPTIONS)
+        /* The array may be invalid, don't leave the heap locked then */
+        _SEH2_TRY
+        {
+            while (Allocated < Count)
             {
-                ExceptionRecord.ExceptionCode = STATUS_NO_MEMORY;
-                ExceptionRecord.ExceptionRecord = NULL;
-                ExceptionRecord.NumberParameters = 0;
-                ExceptionRecord.ExceptionFlags = 0;
+                /* Look for a single free entry holding all the remaining blocks */
+                RunSize = min((SIZE_T)(Count - Allocated), HEAP_MAX_BLOCK_SIZE / Index) * Index;
+                FreeEntry = RtlpFindFreeRun(Heap, Index, RunSize);
+                FromExtension = FALSE;
 
-                RtlRaiseException(&ExceptionRecord);
+                if (!FreeEntry)
+                {
+                    /* A fragmented or nearly full heap may not grow by the whole run,
+                       so ask for half as many blocks each time, down to a single one */
+                    for (Blocks = RunSize / Index; ; Blocks /= 2)
+                    {
+                        FreeEntry = RtlpExtendHeap(Heap, (Blocks * Index) << HEAP_ENTRY_SHIFT);
+                        if ((FreeEntry && (FreeEntry->Size >= Index)) || (Blocks == 1))
+                            break;
+                    }
+
+                    if (!FreeEntry || (FreeEntry->Size < Index))
+                        break;
+
+                    FromExtension = TRUE;
+                }
+
+                RtlpRemoveFreeBlock(Heap, FreeEntry, FromExtension);
+                Carved = RtlpCarveFreeRun(Heap,
+                                          Flags,
+                                          FreeEntry,
+                                          AllocationSize,
+                                          Index,
+                                          Size,
+                                          Count - Allocated);
+
+                /* The heap is consistent again, the array can fault now */
+                for (i = 0; i < Carved; i++)
+                    Array[Allocated++] = (PHEAP_ENTRY)FreeEntry + i * Index + 1;
             }
-            break;
         }
+        _SEH2_FINALLY
+        {
+            if (!(Flags & HEAP_NO_SERIALIZE))
+                RtlLeaveHeapLock(Heap->LockVariable);
+        }
+        _SEH2_END;
+
+        /* Fill the blocks outside of the lock */
+        for (i = 0; i < Allocated; i++)
+        {
+            InUseEntry = (PHEAP_ENTRY)Array[i] - 1;
+
+            if (Flags & HEAP_ZERO_MEMORY)
+                RtlZeroMemory(Array[i], Size);
+            else if (Heap->Flags & HEAP_FREE_CHECKING_ENABLED)
+                RtlFillMemoryUlong(Array[i], Size & ~0x3, ARENA_INUSE_FILLER);
+
+            if (Heap->Flags & HEAP_TAIL_CHECKING_ENABLED)
+            {
+                RtlFillMemory((PCHAR)Array[i] + Size, sizeof(HEAP_ENTRY), HEAP_TAIL_FILL);
+                InUseEntry->Flags |= HEAP_ENTRY_FILL_PATTERN;
+            }
+        }
+    }
+
+    if (Allocated < Count)
+    {
+        Array[Allocated] = NULL;
+
+        /* ERROR_NOT_ENOUGH_MEMORY */
+        RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_NO_MEMORY);
+
+        if (Flags & HEAP_GENERATE_EXCEPTIONS)
+        {
+            ExceptionRecord.ExceptionCode = STATUS_NO_MEMORY;
+            ExceptionRecord.ExceptionRecord = NULL;
+            ExceptionRecord.NumberParameters = 0;
+            ExceptionRecord.ExceptionFlags = 0;
+
+            RtlRaiseException(&ExceptionRecord);
+        }
+    }
+
+    return Allocated;
+}
+
+FORCEINLINE
+BOOLEAN
+RtlpIsQueuedForRelease(PHEAP_ENTRY HeapEntry,
+                       PVOID Cookie)
+{
+    /* Header and guard entries may have anything in SmallTagIndex,
+       so queued blocks also carry the cookie of the current call */
+    return (HeapEntry->Flags & HEAP_ENTRY_BUSY) &&
+           (HeapEntry->Size > 1) &&
+           (HeapEntry->SmallTagIndex == HEAP_BATCH_FREE_MARK) &&
+           (*(PVOID *)(HeapEntry + 1) == Cookie);
+}
+
+static
+VOID
+RtlpMergeBatchRun(PHEAP_ENTRY HeapEntry,
+                  PVOID Cookie,
+                  BOOLEAN Coalesce,
+                  PHEAP_ENTRY *RunList)
+{
+    PHEAP_ENTRY RunEntry;
+    SIZE_T BlockSize;
+    UCHAR LastFlag;
+
+    /* Go back to the first queued block of this run */
+    while (Coalesce &&
+           ((HeapEntry - HeapEntry->PreviousSize) != HeapEntry) &&
+           RtlpIsQueuedForRelease(HeapEntry - HeapEntry->PreviousSize, Cookie))
+    {
+        HeapEntry -= HeapEntry->PreviousSize;
     }
 
-    return Index;
+    while (RtlpIsQueuedForRelease(HeapEntry, Cookie))
+    {
+        /* Merge the neighbouring queued blocks, up to the largest entry size */
+        RunEntry = HeapEntry;
+        BlockSize = 0;
+        do
+        {
+            RunEntry->SmallTagIndex = 0;
+            LastFlag = RunEntry->Flags & HEAP_ENTRY_LAST_ENTRY;
+            BlockSize += RunEntry->Size;
+            RunEntry += RunEntry->Size;
+        } while (Coalesce &&
+                 !LastFlag &&
+                 RtlpIsQueuedForRelease(RunEntry, Cookie) &&
+                 (BlockSize + RunEntry->Size <= HEAP_MAX_BLOCK_SIZE));
+
+        /* The merged block stays busy and is linked through its data. Nothing
+           else is written to it yet, the headers inside are still read when
+           the rest of the array is walked. */
+        HeapEntry->Flags = HEAP_ENTRY_BUSY | LastFlag;
+        HeapEntry->Size = (USHORT)BlockSize;
+        if (!LastFlag)
+            RunEntry->PreviousSize = (USHORT)BlockSize;
+
+        *(PHEAP_ENTRY *)(HeapEntry + 1) = *RunList;
+        *RunList = HeapEntry;
+
+        if (LastFlag || !Coalesce)
+            break;
+
+        HeapEntry = RunEntry;
+    }
 }
 
 /* @implemented */
@@ -4169,32 +4726,190 @@ RtlMultipleFreeHeap(IN PVOID HeapHandle,
                     IN ULONG Count,
                     OUT PVOID *Array)
 {
-    ULONG Index;
+    PHEAP Heap = (PHEAP)HeapHandle;
+    PHEAP_ENTRY HeapEntry, RunList = NULL, DeCommitList = NULL;
+    PHEAP_VIRTUAL_ALLOC_ENTRY VirtualEntry;
+    SIZE_T BlockSize;
+    BOOLEAN Coalesce, Valid;
+    ULONG Index, Queued;
+    PVOID Cookie = &Queued;
+    NTSTATUS Status;
 
-    for (Index = 0; Index < Count; ++Index)
+    Flags |= Heap->ForceFlags;
+
+    if (RtlpHeapIsSpecial(Flags))
     {
-        if (Array[Index] == NULL)
-            continue;
+        for (Index = 0; Index < Count; ++Index)
+        {
+            if (Array[Index] == NULL)
+                continue;
 
-        _SEH2_TRY
+            _SEH2_TRY
+            {
+                Valid = RtlFreeHeap(HeapHandle, Flags, Array[Index]);
+            }
+            _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+            {
+                Valid = FALSE;
+            }
+            _SEH2_END;
+
+            if (!Valid)
+            {
+                /* ERROR_INVALID_PARAMETER */
+                RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_INVALID_PARAMETER);
+                break;
+            }
+        }
+
+        return Index;
+    }
+
+    if (!(Flags & HEAP_NO_SERIALIZE))
+        RtlEnterHeapLock(Heap->LockVariable, TRUE);
+
+    /* The array may be invalid, don't leave the heap locked then */
+    _SEH2_TRY
+    {
+        /* Read the whole array before marking anything. If it faults, the
+           exception reaches the caller without leaving any block queued. */
+        for (Queued = 0; Queued < Count; ++Queued)
+            (VOID)*(volatile PVOID *)&Array[Queued];
+
+        /* First check and queue all the blocks. They stay busy so that
+           freeing one doesn't coalesce it with another queued one. */
+        for (Queued = 0; Queued < Count; ++Queued)
         {
-            if (!RtlFreeHeap(HeapHandle, Flags, Array[Index]))
+            if (Array[Queued] == NULL)
+                continue;
+
+            HeapEntry = (PHEAP_ENTRY)Array[Queued] - 1;
+
+            _SEH2_TRY
             {
+                Valid = (HeapEntry->Flags & HEAP_ENTRY_BUSY) &&
+                        (((ULONG_PTR)Array[Queued] & 0x7) == 0) &&
+                        (HeapEntry->SegmentOffset < HEAP_SEGMENTS) &&
+                        !RtlpIsQueuedForRelease(HeapEntry, Cookie) &&
+                        !(Heap->FrontEndHeap && (HeapEntry->SmallTagIndex == HEAP_LFH_CACHED_MARK));
+
+                if (Valid)
+                {
+                    HeapEntry->SmallTagIndex = HEAP_BATCH_FREE_MARK;
+                    *(PVOID *)Array[Queued] = Cookie;
+                }
+            }
+            _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+            {
+                Valid = FALSE;
+            }
+            _SEH2_END;
+
+            if (!Valid)
+            {
+                DPRINT1("HEAP: Trying to free an invalid address %p!\n", Array[Queued]);
+
                 /* ERROR_INVALID_PARAMETER */
                 RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_INVALID_PARAMETER);
                 break;
             }
         }
-        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+
+        /* Coalesce in kernel mode, and in usermode if it's not disabled */
+        Coalesce = (RtlpGetMode() == KernelMode) || !(Heap->Flags & HEAP_DISABLE_COALESCE_ON_FREE);
+
+        /* Then merge each run of neighbouring blocks into a single one */
+        for (Index = 0; Index < Queued; ++Index)
         {
-            /* ERROR_INVALID_PARAMETER */
-            RtlSetLastWin32ErrorAndNtStatusFromNtStatus(STATUS_INVALID_PARAMETER);
-            break;
+            if (Array[Index] == NULL)
+                continue;
+
+            HeapEntry = (PHEAP_ENTRY)Array[Index] - 1;
+
+            if (HeapEntry->Flags & HEAP_ENTRY_VIRTUAL_ALLOC)
+            {
+                VirtualEntry = CONTAINING_RECORD(HeapEntry, HEAP_VIRTUAL_ALLOC_ENTRY, BusyBlock);
+                RemoveEntryList(&VirtualEntry->Entry);
+
+                BlockSize = 0;
+                Status = ZwFreeVirtualMemory(NtCurrentProcess(),
+                                             (PVOID *)&VirtualEntry,
+                                             &BlockSize,
+                                             MEM_RELEASE);
+                if (!NT_SUCCESS(Status))
+                {
+                    DPRINT1("HEAP: Failed releasing memory with Status 0x%08X. Heap %p, ptr %p\n",
+                            Status, Heap, Array[Index]);
+                    RtlSetLastWin32ErrorAndNtStatusFromNtStatus(Status);
+                }
+            }
+            else if (RtlpIsQueuedForRelease(HeapEntry, Cookie))
+            {
+                /* Not merged yet as part of an earlier run */
+                RtlpMergeBatchRun(HeapEntry, Cookie, Coalesce, &RunList);
+            }
+        }
+
+        /* And finally coalesce and release the merged blocks, the same way RtlFreeHeap does */
+        while (RunList)
+        {
+            HeapEntry = RunList;
+            RunList = *(PHEAP_ENTRY *)(HeapEntry + 1);
+
+            BlockSize = HeapEntry->Size;
+            HeapEntry->Flags &= HEAP_ENTRY_LAST_ENTRY;
+
+            if (Coalesce)
+            {
+                HeapEntry = (PHEAP_ENTRY)RtlpCoalesceFreeBlocks(Heap,
+                                                               (PHEAP_FREE_ENTRY)HeapEntry,
+                                                               &BlockSize,
+                                                               FALSE);
+            }
+
+            if ((BlockSize >= Heap->DeCommitFreeBlockThreshold) ||
+                (Heap->TotalFreeSize + BlockSize >= Heap->DeCommitTotalFreeThreshold))
+            {
+                /* Keep it busy so the other runs don't coalesce with it,
+                   it is decommitted once they are all back in the free lists */
+                HeapEntry->Flags |= HEAP_ENTRY_BUSY;
+                *(PHEAP_ENTRY *)(HeapEntry + 1) = DeCommitList;
+                DeCommitList = HeapEntry;
+            }
+            else
+            {
+                RtlpInsertFreeBlock(Heap, (PHEAP_FREE_ENTRY)HeapEntry, BlockSize);
+            }
+        }
+
+        /* Now the blocks to decommit may grow with runs freed after them */
+        while (DeCommitList)
+        {
+            HeapEntry = DeCommitList;
+            DeCommitList = *(PHEAP_ENTRY *)(HeapEntry + 1);
+
+            BlockSize = HeapEntry->Size;
+            HeapEntry->Flags &= HEAP_ENTRY_LAST_ENTRY;
+
+            if (Coalesce)
+            {
+                HeapEntry = (PHEAP_ENTRY)RtlpCoalesceFreeBlocks(Heap,
+                                                               (PHEAP_FREE_ENTRY)HeapEntry,
+                                                               &BlockSize,
+                                                               FALSE);
+            }
+
+            RtlpDeCommitFreeBlock(Heap, (PHEAP_FREE_ENTRY)HeapEntry, BlockSize);
         }
-        _SEH2_END;
     }
+    _SEH2_FINALLY
+    {
+        if (!(Flags & HEAP_NO_SERIALIZE))
+            RtlLeaveHeapLock(Heap->LockVariable);
+    }
+    _SEH2_END;
 
-    return Index;
+    return Queued;
 }
 
 /*
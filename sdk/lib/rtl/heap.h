@@ -273,6 +273,42 @@ typedef struct _HEAP_SEGMENT
     HEAP_SEGMENT_MEMBERS;
 } HEAP_SEGMENT, *PHEAP_SEGMENT;
 
+/* Front end heap types, see HEAP::FrontEndHeapType */
+#define HEAP_FRONT_END_NONE     0
+#define HEAP_FRONT_END_LFH      2
+
+/* Low fragmentation front end. Busy blocks of HEAP_LFH_MIN_INDEX up to
+   HEAP_LFH_MAX_INDEX heap entries are cached in lock-free lists instead of
+   being returned to the back end. Each slot is used by a subset of the
+   threads (user mode) or processors (kernel mode), a slot running dry
+   takes blocks from the others before refilling from the back end. */
+#define HEAP_LFH_SLOTS          8
+#define HEAP_LFH_BUCKETS        128
+#define HEAP_LFH_MIN_INDEX      2
+#define HEAP_LFH_MAX_INDEX      (HEAP_LFH_MIN_INDEX + HEAP_LFH_BUCKETS - 1)
+#define HEAP_LFH_BUCKET_BYTES   0x1000 /* Memory cached per slot and bucket */
+#define HEAP_LFH_MIN_DEPTH      4
+#define HEAP_LFH_MAX_DEPTH      128
+#define HEAP_LFH_REFILL         16     /* Blocks taken from the back end at once */
+#define HEAP_LFH_CACHED_MARK    0xFF   /* HEAP_ENTRY::SmallTagIndex of a cached block */
+
+/* HEAP_ENTRY::SmallTagIndex of a block queued for release by RtlMultipleFreeHeap */
+#define HEAP_BATCH_FREE_MARK    0xFE
+
+typedef struct _HEAP_LFH_SLOT
+{
+    SLIST_HEADER Buckets[HEAP_LFH_BUCKETS];
+    ULONG Hits;
+    ULONG Misses;
+    ULONG Frees;
+    ULONG Overflows;
+} HEAP_LFH_SLOT, *PHEAP_LFH_SLOT;
+
+typedef struct _HEAP_LFH
+{
+    HEAP_LFH_SLOT Slots[HEAP_LFH_SLOTS];
+} HEAP_LFH, *PHEAP_LFH;
+
 typedef struct _HEAP_UCR_DESCRIPTOR
 {
     LIST_ENTRY ListEntry;
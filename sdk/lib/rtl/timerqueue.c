@@ -41,6 +41,7 @@ struct queue_timer
 {
     struct timer_queue *q;
     struct list entry;
+    ULONG heap_index;           /* position in the expiration heap, or HEAP_NONE */
     ULONG runcount;             /* number of callbacks pending execution */
     WAITORTIMERCALLBACKFUNC callback;
     PVOID param;
@@ -55,7 +56,10 @@ struct timer_queue
 {
     DWORD magic;
     RTL_CRITICAL_SECTION cs;
-    struct list timers;         /* sorted by expiration time */
+    struct list timers;         /* all timers, in no particular order */
+    struct queue_timer **heap;  /* armed timers, binary min-heap on expire */
+    ULONG heap_size;
+    ULONG heap_capacity;
     BOOL quit;                  /* queue should be deleted; once set, never unset */
     HANDLE event;
     HANDLE thread;
@@ -63,6 +67,107 @@ struct timer_queue
 
 #define EXPIRE_NEVER (~(ULONGLONG) 0)
 #define TIMER_QUEUE_MAGIC  0x516d6954   /* TimQ */
+#define HEAP_NONE (~(ULONG) 0)
+#define HEAP_INITIAL_CAPACITY 64
+#define EXPIRE_BATCH 64                 /* timers dispatched per timer thread wakeup */
+
+/* The heap functions below MUST be called with the queue cs held.  */
+
+static inline void heap_set(struct timer_queue *q, ULONG i, struct queue_timer *t)
+{
+    q->heap[i] = t;
+    t->heap_index = i;
+}
+
+static void heap_sift_up(struct timer_queue *q, ULONG i)
+{
+    struct queue_timer *t = q->heap[i];
+
+    while (i > 0)
+    {
+        ULONG parent = (i - 1) / 2;
+        if (q->heap[parent]->expire <= t->expire)
+            break;
+        heap_set(q, i, q->heap[parent]);
+        i = parent;
+    }
+    heap_set(q, i, t);
+}
+
+static void heap_sift_down(struct timer_queue *q, ULONG i)
+{
+    struct queue_timer *t = q->heap[i];
+
+    for (;;)
+    {
+        ULONG child = 2 * i + 1;
+        if (child >= q->heap_size)
+            break;
+        if (child + 1 < q->heap_size &&
+            q->heap[child + 1]->expire < q->heap[child]->expire)
+            ++child;
+        if (t->expire <= q->heap[child]->expire)
+            break;
+        heap_set(q, i, q->heap[child]);
+        i = child;
+    }
+    heap_set(q, i, t);
+}
+
+static BOOL heap_reserve(struct timer_queue *q, ULONG count)
+{
+    struct queue_timer **heap;
+    ULONG capacity;
+
+    if (count <= q->heap_capacity)
+        return TRUE;
+
+    capacity = max(q->heap_capacity * 2, HEAP_INITIAL_CAPACITY);
+    if (capacity < count)
+        capacity = count;
+
+    if (q->heap)
+        heap = RtlReAllocateHeap(RtlGetProcessHeap(), 0, q->heap,
+                                 capacity * sizeof(*heap));
+    else
+        heap = RtlAllocateHeap(RtlGetProcessHeap(), 0, capacity * sizeof(*heap));
+    if (!heap)
+        return FALSE;
+
+    q->heap = heap;
+    q->heap_capacity = capacity;
+    return TRUE;
+}
+
+static void heap_insert(struct timer_queue *q, struct queue_timer *t)
+{
+    /* Room was made by heap_reserve when the timer was created.  */
+    assert(q->heap_size < q->heap_capacity);
+    heap_set(q, q->heap_size++, t);
+    heap_sift_up(q, t->heap_index);
+}
+
+static void heap_remove(struct timer_queue *q, struct queue_timer *t)
+{
+    ULONG i = t->heap_index;
+    struct queue_timer *last = q->heap[--q->heap_size];
+
+    t->heap_index = HEAP_NONE;
+    if (last == t)
+        return;
+
+    /* Put the last timer in the hole and restore the heap order.  */
+    heap_set(q, i, last);
+    if (i > 0 && q->heap[(i - 1) / 2]->expire > last->expire)
+        heap_sift_up(q, i);
+    else
+        heap_sift_down(q, i);
+}
+
+static inline struct queue_timer *heap_first(struct timer_queue *q)
+{
+    return q->heap_size ? q->heap[0] : NULL;
+}
 
 static void queue_remove_timer(struct queue_timer *t)
 {
@@ -74,6 +179,8 @@ static void queue_remove_timer(struct queue_timer *t)
     assert(t->runcount == 0);
     assert(t->destroy);
 
+    if (t->heap_index != HEAP_NONE)
+        heap_remove(q, t);
     list_remove(&t->entry);
     if (t->event)
         NtSetEvent(t->event, NULL);
@@ -116,65 +223,87 @@ static void queue_add_timer(struct queue_timer *t, ULONGLONG time,
 {
     /* We MUST hold the queue cs while calling this function.  */
     struct timer_queue *q = t->q;
-    struct list *ptr = &q->timers;
 
     assert(!q->quit || (t->destroy && time == EXPIRE_NEVER));
 
-    if (time != EXPIRE_NEVER)
-        LIST_FOR_EACH(ptr, &q->timers)
-        {
-            struct queue_timer *cur = LIST_ENTRY(ptr, struct queue_timer, entry);
-            if (time < cur->expire)
-                break;
-        }
-    list_add_before(ptr, &t->entry);
-
     t->expire = time;
 
-    /* If we insert at the head of the list, we need to expire sooner
-       than expected.  */
-    if (set_event && &t->entry == list_head(&q->timers))
-        NtSetEvent(q->event, NULL);
+    /* Only armed timers live in the heap; the others just wait to be
+       updated or deleted.  */
+    if (time != EXPIRE_NEVER)
+    {
+        heap_insert(q, t);
+
+        /* If we insert at the head of the heap, we need to expire sooner
+           than expected.  */
+        if (set_event && t == heap_first(q))
+            NtSetEvent(q->event, NULL);
+    }
 }
 
-static inline void queue_move_timer(struct queue_timer *t, ULONGLONG time,
-                                    BOOL set_event)
+static void queue_move_timer(struct queue_timer *t, ULONGLONG time,
+                             BOOL set_event)
 {
     /* We MUST hold the queue cs while calling this function.  */
-    list_remove(&t->entry);
-    queue_add_timer(t, time, set_event);
+    struct timer_queue *q = t->q;
+    ULONGLONG old = t->expire;
+
+    if (t->heap_index == HEAP_NONE)
+    {
+        queue_add_timer(t, time, set_event);
+        return;
+    }
+
+    if (time == EXPIRE_NEVER)
+    {
+        heap_remove(q, t);
+        t->expire = EXPIRE_NEVER;
+        return;
+    }
+
+    /* Rekey in place instead of removing and inserting again.  */
+    t->expire = time;
+    if (time < old)
+        heap_sift_up(q, t->heap_index);
+    else
+        heap_sift_down(q, t->heap_index);
+
+    if (set_event && t == heap_first(q))
+        NtSetEvent(q->event, NULL);
 }
 
 static void queue_timer_expire(struct timer_queue *q)
 {
-    struct queue_timer *t = NULL;
+    struct queue_timer *expired[EXPIRE_BATCH];
+    struct queue_timer *t;
+    ULONG count = 0, i;
+    ULONGLONG now, next;
 
+    /* Take every timer that is due with a single trip through the cs.  */
     RtlEnterCriticalSection(&q->cs);
-    if (list_head(&q->timers))
+    now = queue_current_time();
+    while (count < EXPIRE_BATCH &&
+           (t = heap_first(q)) && t->expire <= now)
     {
-        ULONGLONG now, next;
-        t = LIST_ENTRY(list_head(&q->timers), struct queue_timer, entry);
-        if (!t->destroy && t->expire <= ((now = queue_current_time())))
+        assert(!t->destroy);
+        ++t->runcount;
+        if (t->period)
         {
-            ++t->runcount;
-            if (t->period)
-            {
-                next = t->expire + t->period;
-                /* avoid trigger cascade if overloaded / hibernated */
-                if (next < now)
-                    next = now + t->period;
-            }
-            else
-                next = EXPIRE_NEVER;
-            queue_move_timer(t, next, FALSE);
+            next = t->expire + t->period;
+            /* avoid trigger cascade if overloaded / hibernated */
+            if (next <= now)
+                next = now + t->period;
         }
         else
-            t = NULL;
+            next = EXPIRE_NEVER;
+        queue_move_timer(t, next, FALSE);
+        expired[count++] = t;
     }
     RtlLeaveCriticalSection(&q->cs);
 
-    if (t)
+    for (i = 0; i < count; i++)
     {
+        t = expired[i];
         if (t->flags & WT_EXECUTEINTIMERTHREAD)
             timer_callback_wrapper(t);
         else
@@ -196,16 +325,12 @@ static ULONG queue_get_timeout(struct timer_queue *q)
     ULONG timeout = INFINITE;
 
     RtlEnterCriticalSection(&q->cs);
-    if (list_head(&q->timers))
+    t = heap_first(q);
+    if (t)
     {
-        t = LIST_ENTRY(list_head(&q->timers), struct queue_timer, entry);
-        assert(!t->destroy || t->expire == EXPIRE_NEVER);
-
-        if (t->expire != EXPIRE_NEVER)
-        {
-            ULONGLONG time = queue_current_time();
-            timeout = t->expire < time ? 0 : (ULONG)(t->expire - time);
-        }
+        ULONGLONG time = queue_current_time();
+        assert(!t->destroy && t->expire != EXPIRE_NEVER);
+        timeout = t->expire < time ? 0 : (ULONG)(t->expire - time);
     }
     RtlLeaveCriticalSection(&q->cs);
 
@@ -249,6 +374,8 @@ static DWORD WINAPI timer_queue_thread_proc(LPVOID p)
 
     NtClose(q->event);
     RtlDeleteCriticalSection(&q->cs);
+    if (q->heap)
+        RtlFreeHeap(RtlGetProcessHeap(), 0, q->heap);
     q->magic = 0;
     RtlFreeHeap(RtlGetProcessHeap(), 0, q);
     RtlpExitThreadFunc(STATUS_SUCCESS);
@@ -265,8 +392,8 @@ static void queue_destroy_timer(struct queue_timer *t)
            cleanup wrapper.  */
         queue_remove_timer(t);
     else
-        /* Make sure no destroyed timer masks an active timer at the head
-           of the sorted list.  */
+        /* Disarm it so it can't fire again while the pending callbacks
+           finish.  */
         queue_move_timer(t, EXPIRE_NEVER, FALSE);
 }
 
@@ -291,6 +418,9 @@ NTSTATUS WINAPI RtlCreateTimerQueue(PHANDLE NewTimerQueue)
 
     RtlInitializeCriticalSection(&q->cs);
     list_init(&q->timers);
+    q->heap = NULL;
+    q->heap_size = 0;
+    q->heap_capacity = 0;
     q->quit = FALSE;
     q->magic = TIMER_QUEUE_MAGIC;
     status = NtCreateEvent(&q->event, EVENT_ALL_ACCESS, NULL, SynchronizationEvent, FALSE);
@@ -446,13 +576,19 @@ NTSTATUS WINAPI RtlCreateTimer(HANDLE TimerQueue, PHANDLE NewTimer,
     t->flags = Flags;
     t->destroy = FALSE;
     t->event = NULL;
+    t->heap_index = HEAP_NONE;
 
     status = STATUS_SUCCESS;
     RtlEnterCriticalSection(&q->cs);
     if (q->quit)
         status = STATUS_INVALID_HANDLE;
+    else if (!heap_reserve(q, q->heap_size + 1))
+        status = STATUS_NO_MEMORY;
     else
+    {
+        list_add_tail(&q->timers, &t->entry);
         queue_add_timer(t, queue_current_time() + DueTime, TRUE);
+    }
     RtlLeaveCriticalSection(&q->cs);
 
     if (status == STATUS_SUCCESS)
@@ -0,0 +1,1067 @@
+/*
+ * PROJECT:     ReactOS hive maker
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Bulk import of INF files
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+/*
+ * The INF files are parsed on worker threads. Their operations are then
+ * applied, in the order of the command line, to a tree of keys kept in
+ * memory, where the subkeys of every key are sorted. Nothing goes to the
+ * hives before everything has been applied: each new subtree is written in
+ * a single depth-first pass, which allocates every cell once at its final
+ * size and builds the subkey index cells already sorted.
+ *
+ * The keys which exist before the import (the hive roots and the control
+ * set created by RegInitializeRegistry) are looked up in the hives when the
+ * tree first reaches them. They have no values yet, and they are never
+ * deleted.
+ */
+
+/* INCLUDES *****************************************************************/
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+#define NDEBUG
+#include "mkhive.h"
+
+#ifdef _WIN32
+/* We only include host headers, declare what we need from kernel32 */
+__declspec(dllimport) DWORD __stdcall WaitForSingleObject(HANDLE hHandle, DWORD dwMilliseconds);
+__declspec(dllimport) BOOL __stdcall CloseHandle(HANDLE hObject);
+#define INFINITE 0xFFFFFFFF
+#endif
+
+/* DATA *********************************************************************/
+
+#define BULK_PARSE_THREADS  8
+
+/* Same limits as in cmindex.c, so that cmlib can still insert into the leaves */
+#define BULK_MAX_FAST_INDEX                             \
+    ((HBLOCK_SIZE - (sizeof(HBIN) + sizeof(HCELL) +     \
+                     FIELD_OFFSET(CM_KEY_FAST_INDEX, List))) / sizeof(CM_INDEX))
+
+#define BULK_MAX_INDEX                                  \
+    ((HBLOCK_SIZE - (sizeof(HBIN) + sizeof(HCELL) +     \
+                     FIELD_OFFSET(CM_KEY_INDEX, List))) / sizeof(HCELL_INDEX) - 1)
+
+typedef struct _BULK_PARSE_CONTEXT
+{
+    ULONG FirstFile;
+    ULONG Stride;
+    ULONG FileCount;
+    PCHAR *FileNames;
+    PREG_OPERATION_LIST Lists;
+    BOOL *Results;
+} BULK_PARSE_CONTEXT, *PBULK_PARSE_CONTEXT;
+
+typedef struct _BULK_VALUE
+{
+    PWSTR Name;         /* Empty for the default value */
+    ULONG Type;
+    PVOID Data;
+    ULONG DataSize;
+} BULK_VALUE, *PBULK_VALUE;
+
+typedef struct _BULK_KEY
+{
+    /* Location of the keys which exist in the hives, HCELL_NIL for new ones */
+    PCMHIVE Hive;
+    HCELL_INDEX Cell;
+    LIST_ENTRY ExistingListEntry;
+
+    /* Set when another name of the same existing key, through a symbolic link, was seen first */
+    struct _BULK_KEY *Link;
+
+    struct _BULK_KEY **SubKeys;
+    ULONG SubKeyCount;
+    ULONG MaxSubKeys;
+
+    PBULK_VALUE Values;
+    ULONG ValueCount;
+    ULONG MaxValues;
+
+    USHORT NameLength;  /* In bytes */
+    WCHAR Name[ANYSIZE_ARRAY];
+} BULK_KEY, *PBULK_KEY;
+
+static PBULK_KEY BulkRootKey;
+static LIST_ENTRY BulkExistingKeysHead;
+
+/* Consecutive lines of an INF file mostly use the same key */
+static PCWSTR BulkLastKeyName;
+static PBULK_KEY BulkLastKey;
+static PBULK_KEY BulkLastParentKey;
+
+/* FUNCTIONS ****************************************************************/
+
+static VOID
+BulkParseFiles(
+    IN PBULK_PARSE_CONTEXT Context)
+{
+    ULONG i;
+
+    for (i = Context->FirstFile; i < Context->FileCount; i += Context->Stride)
+        Context->Results[i] = ParseRegistryFile(Context->FileNames[i], &Context->Lists[i]);
+}
+
+#ifdef _WIN32
+static unsigned __stdcall
+BulkParseThread(void *Parameter)
+{
+    BulkParseFiles((PBULK_PARSE_CONTEXT)Parameter);
+    return 0;
+}
+#else
+static void *
+BulkParseThread(void *Parameter)
+{
+    BulkParseFiles((PBULK_PARSE_CONTEXT)Parameter);
+    return NULL;
+}
+#endif
+
+static VOID
+BulkParseAllFiles(
+    IN ULONG FileCount,
+    IN PCHAR *FileNames,
+    OUT PREG_OPERATION_LIST Lists,
+    OUT BOOL *Results)
+{
+    BULK_PARSE_CONTEXT Contexts[BULK_PARSE_THREADS];
+#ifdef _WIN32
+    HANDLE Threads[BULK_PARSE_THREADS];
+#else
+    pthread_t Threads[BULK_PARSE_THREADS];
+#endif
+    BOOLEAN Started[BULK_PARSE_THREADS];
+    ULONG ThreadCount, i;
+
+    ThreadCount = (FileCount < BULK_PARSE_THREADS) ? FileCount : BULK_PARSE_THREADS;
+
+    for (i = 0; i < ThreadCount; i++)
+    {
+        Contexts[i].FirstFile = i;
+        Contexts[i].Stride = ThreadCount;
+        Contexts[i].FileCount = FileCount;
+        Contexts[i].FileNames = FileNames;
+        Contexts[i].Lists = Lists;
+        Contexts[i].Results = Results;
+    }
+
+    for (i = 1; i < ThreadCount; i++)
+    {
+#ifdef _WIN32
+        Threads[i] = (HANDLE)_beginthreadex(NULL, 0, BulkParseThread, &Contexts[i], 0, NULL);
+        Started[i] = (Threads[i] != NULL);
+#else
+        Started[i] = (pthread_create(&Threads[i], NULL, BulkParseThread, &Contexts[i]) == 0);
+#endif
+    }
+
+    /* Take the first share, and the ones of the threads which could not start */
+    if (ThreadCount)
+        BulkParseFiles(&Contexts[0]);
+
+    for (i = 1; i < ThreadCount; i++)
+    {
+        if (!Started[i])
+        {
+            BulkParseFiles(&Contexts[i]);
+            continue;
+        }
+
+#ifdef _WIN32
+        WaitForSingleObject(Threads[i], INFINITE);
+        CloseHandle(Threads[i]);
+#else
+        pthread_join(Threads[i], NULL);
+#endif
+    }
+}
+
+/* Same order as the one of cmlib for compressed names */
+static LONG
+BulkCompareNames(
+    IN PCWSTR Name1,
+    IN ULONG Length1, // In characters
+    IN PCWSTR Name2,
+    IN ULONG Length2) // In characters
+{
+    LONG Result;
+    ULONG i;
+
+    for (i = 0; i < Length1 && i < Length2; i++)
+    {
+        Result = (LONG)RtlUpcaseUnicodeChar(Name1[i]) - (LONG)RtlUpcaseUnicodeChar(Name2[i]);
+        if (Result)
+            return Result;
+    }
+
+    return (LONG)Length1 - (LONG)Length2;
+}
+
+static PBULK_KEY
+BulkCreateKey(
+    IN PCWSTR Name,
+    IN ULONG Length, // In characters
+    IN PCMHIVE Hive OPTIONAL,
+    IN HCELL_INDEX Cell)
+{
+    PBULK_KEY Key;
+
+    Key = calloc(1, FIELD_OFFSET(BULK_KEY, Name) + (Length + 1) * sizeof(WCHAR));
+    if (!Key)
+        return NULL;
+
+    memcpy(Key->Name, Name, Length * sizeof(WCHAR));
+    Key->NameLength = (USHORT)(Length * sizeof(WCHAR));
+    Key->Hive = Hive;
+    Key->Cell = Cell;
+
+    if (Cell != HCELL_NIL)
+        InsertTailList(&BulkExistingKeysHead, &Key->ExistingListEntry);
+
+    return Key;
+}
+
+static VOID
+BulkFreeKey(
+    IN PBULK_KEY Key)
+{
+    ULONG i;
+
+    for (i = 0; i < Key->SubKeyCount; i++)
+        BulkFreeKey(Key->SubKeys[i]);
+
+    for (i = 0; i < Key->ValueCount; i++)
+    {
+        free(Key->Values[i].Name);
+        free(Key->Values[i].Data);
+    }
+
+    if (Key->Cell != HCELL_NIL)
+        RemoveEntryList(&Key->ExistingListEntry);
+
+    free(Key->SubKeys);
+    free(Key->Values);
+    free(Key);
+}
+
+/* Binary search, returns where the subkey should be if it isn't there */
+static PBULK_KEY
+BulkFindSubKey(
+    IN PBULK_KEY Key,
+    IN PCWSTR Name,
+    IN ULONG Length, // In characters
+    OUT PULONG Index)
+{
+    ULONG Low = 0, High = Key->SubKeyCount, Middle;
+    PBULK_KEY SubKey;
+    LONG Result;
+
+    while (Low < High)
+    {
+        Middle = (Low + High) / 2;
+        SubKey = Key->SubKeys[Middle];
+
+        Result = BulkCompareNames(Name, Length, SubKey->Name, SubKey->NameLength / sizeof(WCHAR));
+        if (Result == 0)
+        {
+            *Index = Middle;
+            return SubKey;
+        }
+
+        if (Result < 0)
+            High = Middle;
+        else
+            Low = Middle + 1;
+    }
+
+    *Index = Low;
+    return NULL;
+}
+
+static BOOL
+BulkInsertSubKey(
+    IN PBULK_KEY Key,
+    IN ULONG Index,
+    IN PBULK_KEY SubKey)
+{
+    PBULK_KEY *SubKeys;
+    ULONG MaxSubKeys;
+
+    if (Key->SubKeyCount == Key->MaxSubKeys)
+    {
+        MaxSubKeys = Key->MaxSubKeys ? Key->MaxSubKeys * 2 : 4;
+        SubKeys = realloc(Key->SubKeys, MaxSubKeys * sizeof(PBULK_KEY));
+        if (!SubKeys)
+            return FALSE;
+
+        Key->SubKeys = SubKeys;
+        Key->MaxSubKeys = MaxSubKeys;
+    }
+
+    memmove(&Key->SubKeys[Index + 1],
+            &Key->SubKeys[Index],
+            (Key->SubKeyCount - Index) * sizeof(PBULK_KEY));
+    Key->SubKeys[Index] = SubKey;
+    Key->SubKeyCount++;
+    return TRUE;
+}
+
+/* Looks for a subkey in the hive of an existing key, reparse points included */
+static PBULK_KEY
+BulkFindExistingSubKey(
+    IN PBULK_KEY Key,
+    IN PCWSTR Name,
+    IN ULONG Length) // In characters
+{
+    MEMKEY ParentKey;
+    HKEY SubKeyHandle;
+    PMEMKEY ExistingKey;
+    PBULK_KEY SubKey;
+    PLIST_ENTRY Entry;
+    PWSTR LocalName;
+    LONG rc;
+
+    /* New keys only have new subkeys, and an empty name would open the key itself */
+    if (Key->Cell == HCELL_NIL || Length == 0)
+        return NULL;
+
+    LocalName = calloc(Length + 1, sizeof(WCHAR));
+    if (!LocalName)
+        return NULL;
+    memcpy(LocalName, Name, Length * sizeof(WCHAR));
+
+    ParentKey.RegistryHive = Key->Hive;
+    ParentKey.KeyCellOffset = Key->Cell;
+    rc = RegOpenKeyW(MEMKEY_TO_HKEY(&ParentKey), LocalName, &SubKeyHandle);
+    free(LocalName);
+    if (rc != ERROR_SUCCESS)
+        return NULL;
+
+    ExistingKey = HKEY_TO_MEMKEY(SubKeyHandle);
+
+    /* The same key can be reached through a link and through its own name */
+    for (Entry = BulkExistingKeysHead.Flink;
+         Entry != &BulkExistingKeysHead;
+         Entry = Entry->Flink)
+    {
+        PBULK_KEY Other = CONTAINING_RECORD(Entry, BULK_KEY, ExistingListEntry);
+
+        if (Other->Hive == ExistingKey->RegistryHive &&
+            Other->Cell == ExistingKey->KeyCellOffset)
+        {
+            SubKey = BulkCreateKey(Name, Length, NULL, HCELL_NIL);
+            if (SubKey)
+                SubKey->Link = Other;
+
+            RegCloseKey(SubKeyHandle);
+            return SubKey;
+        }
+    }
+
+    SubKey = BulkCreateKey(Name, Length, ExistingKey->RegistryHive, ExistingKey->KeyCellOffset);
+    RegCloseKey(SubKeyHandle);
+    return SubKey;
+}
+
+/* Same path parsing as RegpCreateOrOpenKey() */
+static PBULK_KEY
+BulkOpenKey(
+    IN PCWSTR KeyName,
+    IN BOOL AllowCreation,
+    OUT PBULK_KEY *ParentKey)
+{
+    PBULK_KEY Key, SubKey, Parent = NULL;
+    PCWSTR Name, End;
+    ULONG Length, Index;
+
+    if (BulkLastKeyName && !strcmpW(BulkLastKeyName, KeyName))
+    {
+        *ParentKey = BulkLastParentKey;
+        return BulkLastKey;
+    }
+
+    Key = BulkRootKey;
+    Name = KeyName;
+    if (*Name == OBJ_NAME_PATH_SEPARATOR)
+        Name++;
+
+    for (;;)
+    {
+        End = strchrW(Name, OBJ_NAME_PATH_SEPARATOR);
+        Length = End ? (ULONG)(End - Name) : strlenW(Name);
+
+        /* Trailing path separator: we're done */
+        if (!End && Length == 0)
+            break;
+
+        SubKey = BulkFindSubKey(Key, Name, Length, &Index);
+        if (!SubKey)
+        {
+            SubKey = BulkFindExistingSubKey(Key, Name, Length);
+            if (!SubKey && AllowCreation)
+                SubKey = BulkCreateKey(Name, Length, NULL, HCELL_NIL);
+            if (!SubKey)
+                return NULL;
+
+            if (!BulkInsertSubKey(Key, Index, SubKey))
+            {
+                BulkFreeKey(SubKey);
+                return NULL;
+            }
+        }
+
+        Parent = Key;
+        Key = SubKey->Link ? SubKey->Link : SubKey;
+
+        if (!End)
+            break;
+        Name = End + 1;
+    }
+
+    BulkLastKeyName = KeyName;
+    BulkLastKey = Key;
+    BulkLastParentKey = Parent;
+
+    *ParentKey = Parent;
+    return Key;
+}
+
+static VOID
+BulkDeleteKey(
+    IN PBULK_KEY ParentKey,
+    IN PBULK_KEY Key)
+{
+    ULONG Index;
+
+    /* Like RegDeleteKeyW(), which only deletes keys without subkeys */
+    if (!ParentKey || Key->Cell != HCELL_NIL || Key->SubKeyCount)
+        return;
+
+    if (BulkFindSubKey(ParentKey, Key->Name, Key->NameLength / sizeof(WCHAR), &Index) != Key)
+        return;
+
+    memmove(&ParentKey->SubKeys[Index],
+            &ParentKey->SubKeys[Index + 1],
+            (ParentKey->SubKeyCount - Index - 1) * sizeof(PBULK_KEY));
+    ParentKey->SubKeyCount--;
+
+    BulkFreeKey(Key);
+    BulkLastKeyName = NULL;
+}
+
+static PBULK_VALUE
+BulkFindValue(
+    IN PBULK_KEY Key,
+    IN PCWSTR Name OPTIONAL)
+{
+    ULONG Length = Name ? strlenW(Name) : 0;
+    ULONG i;
+
+    for (i = 0; i < Key->ValueCount; i++)
+    {
+        if (!BulkCompareNames(Name, Length, Key->Values[i].Name, strlenW(Key->Values[i].Name)))
+            return &Key->Values[i];
+    }
+
+    return NULL;
+}
+
+/* On success, the key owns the data */
+static BOOL
+BulkSetValue(
+    IN PBULK_KEY Key,
+    IN PCWSTR Name OPTIONAL,
+    IN ULONG Type,
+    IN PVOID Data,
+    IN ULONG DataSize)
+{
+    PBULK_VALUE Value, Values;
+    ULONG MaxValues, Length;
+
+    Value = BulkFindValue(Key, Name);
+    if (Value)
+    {
+        /* Keep the name and the position of the value, like cmlib */
+        free(Value->Data);
+    }
+    else
+    {
+        if (Key->ValueCount == Key->MaxValues)
+        {
+            MaxValues = Key->MaxValues ? Key->MaxValues * 2 : 4;
+            Values = realloc(Key->Values, MaxValues * sizeof(BULK_VALUE));
+            if (!Values)
+                return FALSE;
+
+            Key->Values = Values;
+            Key->MaxValues = MaxValues;
+        }
+
+        Length = Name ? strlenW(Name) : 0;
+        Value = &Key->Values[Key->ValueCount];
+        Value->Name = calloc(Length + 1, sizeof(WCHAR));
+        if (!Value->Name)
+            return FALSE;
+        memcpy(Value->Name, Name, Length * sizeof(WCHAR));
+        Key->ValueCount++;
+    }
+
+    Value->Type = Type;
+    Value->Data = Data;
+    Value->DataSize = DataSize;
+    return TRUE;
+}
+
+static VOID
+BulkDeleteValue(
+    IN PBULK_KEY Key,
+    IN PCWSTR Name)
+{
+    PBULK_VALUE Value;
+    ULONG Index;
+
+    Value = BulkFindValue(Key, Name);
+    if (!Value)
+        return;
+
+    free(Value->Name);
+    free(Value->Data);
+
+    Index = (ULONG)(Value - Key->Values);
+    memmove(&Key->Values[Index],
+            &Key->Values[Index + 1],
+            (Key->ValueCount - Index - 1) * sizeof(BULK_VALUE));
+    Key->ValueCount--;
+}
+
+/* The counterpart of do_reg_operation() in reginf.c */
+static VOID
+BulkApplyOperation(
+    IN OUT PREG_OPERATION Operation)
+{
+    PBULK_KEY Key, ParentKey;
+    PBULK_VALUE Value;
+    ULONG Flags = Operation->Flags;
+    PWCHAR Buffer;
+    ULONG Size;
+
+    Key = BulkOpenKey(Operation->KeyName, !IS_REG_OPEN_OPERATION(Flags), &ParentKey);
+    if (!Key)
+    {
+        DPRINT("BulkOpenKey(%S) failed\n", Operation->KeyName);
+        return;  /* ignore if it doesn't exist */
+    }
+
+    if (IS_REG_DELETE_OPERATION(Flags))
+    {
+        if (Operation->ValueName && *Operation->ValueName && !(Flags & FLG_DELREG_KEYONLY_COMMON))
+            BulkDeleteValue(Key, Operation->ValueName);
+        else
+            BulkDeleteKey(ParentKey, Key);
+        return;
+    }
+
+    if (Flags & (FLG_ADDREG_KEYONLY | FLG_ADDREG_KEYONLY_COMMON))
+        return;
+
+    Value = BulkFindValue(Key, Operation->ValueName);
+
+    if (Value && (Flags & FLG_ADDREG_NOCLOBBER))
+        return;
+
+    if (!Value && (Flags & FLG_ADDREG_OVERWRITEONLY))
+        return;
+
+    if (Flags & FLG_ADDREG_APPEND)
+    {
+        if (!Operation->Data || !Value || Value->Type != REG_MULTI_SZ)
+            return;
+
+        Buffer = AppendMultiSz(Value->Data,
+                               Value->DataSize,
+                               Operation->Data,
+                               Operation->DataSize / sizeof(WCHAR),
+                               &Size);
+        if (Buffer && !BulkSetValue(Key, Operation->ValueName, REG_MULTI_SZ, Buffer, Size))
+            free(Buffer);
+        return;
+    }
+
+    /* Links are made by mkhive itself, never by INF files */
+    if (Operation->Type == REG_LINK)
+        return;
+
+    if (BulkSetValue(Key, Operation->ValueName, Operation->Type, Operation->Data, Operation->DataSize))
+        Operation->Data = NULL;
+}
+
+static HCELL_INDEX
+BulkWriteValue(
+    IN PHHIVE Hive,
+    IN PBULK_VALUE Value)
+{
+    UNICODE_STRING Name;
+    PCM_KEY_VALUE ValueCell;
+    HCELL_INDEX Cell, DataCell;
+
+    RtlInitUnicodeString(&Name, Value->Name);
+
+    Cell = HvAllocateCell(Hive,
+                          FIELD_OFFSET(CM_KEY_VALUE, Name) + CmpNameSize(Hive, &Name),
+                          Stable,
+                          HCELL_NIL);
+    if (Cell == HCELL_NIL)
+        return HCELL_NIL;
+
+    ValueCell = (PCM_KEY_VALUE)HvGetCell(Hive, Cell);
+    RtlZeroMemory(ValueCell, FIELD_OFFSET(CM_KEY_VALUE, Name));
+    ValueCell->Signature = CM_KEY_VALUE_SIGNATURE;
+    ValueCell->NameLength = CmpCopyName(Hive, ValueCell->Name, &Name);
+    if (ValueCell->NameLength < Name.Length)
+        ValueCell->Flags = VALUE_COMP_NAME;
+    ValueCell->Type = Value->Type;
+
+    if (Value->DataSize <= sizeof(HCELL_INDEX))
+    {
+        /* Small data is stored in the data offset */
+        ValueCell->Data = HCELL_NIL;
+        if (Value->DataSize)
+            RtlCopyMemory(&ValueCell->Data, Value->Data, Value->DataSize);
+        ValueCell->DataLength = Value->DataSize | CM_KEY_VALUE_SPECIAL_SIZE;
+        HvReleaseCell(Hive, Cell);
+        return Cell;
+    }
+    HvReleaseCell(Hive, Cell);
+
+    /* The data goes right after its value */
+    DataCell = HvAllocateCell(Hive, Value->DataSize, Stable, HCELL_NIL);
+    if (DataCell == HCELL_NIL)
+        return HCELL_NIL;
+
+    RtlCopyMemory(HvGetCell(Hive, DataCell), Value->Data, Value->DataSize);
+    HvReleaseCell(Hive, DataCell);
+
+    ValueCell = (PCM_KEY_VALUE)HvGetCell(Hive, Cell);
+    ValueCell->Data = DataCell;
+    ValueCell->DataLength = Value->DataSize;
+    HvReleaseCell(Hive, Cell);
+
+    return Cell;
+}
+
+static HCELL_INDEX
+BulkWriteKey(
+    IN PHHIVE Hive,
+    IN HCELL_INDEX ParentCell,
+    IN HCELL_INDEX SecurityCell,
+    IN PBULK_KEY Key);
+
+/* Same name hint as CmpAddToLeaf() */
+static VOID
+BulkSetNameHint(
+    OUT PUCHAR NameHint,
+    IN PCUNICODE_STRING Name)
+{
+    ULONG j;
+
+    NameHint[0] = NameHint[1] = NameHint[2] = NameHint[3] = 0;
+
+    j = min(Name->Length / sizeof(WCHAR), 4);
+    for (; j > 0; j--)
+    {
+        if ((USHORT)Name->Buffer[j - 1] > (UCHAR)-1)
+            break;
+
+        NameHint[j - 1] = (UCHAR)Name->Buffer[j - 1];
+    }
+}
+
+static HCELL_INDEX
+BulkWriteLeaf(
+    IN PHHIVE Hive,
+    IN ULONG Signature,
+    IN HCELL_INDEX KeyCell,
+    IN HCELL_INDEX SecurityCell,
+    IN PBULK_KEY *SubKeys,
+    IN ULONG Count,
+    IN OUT PULONG MaxNameLen)
+{
+    PCM_KEY_INDEX Leaf;
+    PCM_KEY_FAST_INDEX FastLeaf;
+    HCELL_INDEX LeafCell, SubKeyCell;
+    UNICODE_STRING Name;
+    ULONG Size, i;
+
+    if (Signature == CM_KEY_INDEX_LEAF)
+        Size = FIELD_OFFSET(CM_KEY_INDEX, List) + Count * sizeof(HCELL_INDEX);
+    else
+        Size = FIELD_OFFSET(CM_KEY_FAST_INDEX, List) + Count * sizeof(CM_INDEX);
+
+    LeafCell = HvAllocateCell(Hive, Size, Stable, HCELL_NIL);
+    if (LeafCell == HCELL_NIL)
+        return HCELL_NIL;
+
+    Leaf = (PCM_KEY_INDEX)HvGetCell(Hive, LeafCell);
+    Leaf->Signature = (USHORT)Signature;
+    Leaf->Count = (USHORT)Count;
+    HvReleaseCell(Hive, LeafCell);
+
+    for (i = 0; i < Count; i++)
+    {
+        SubKeyCell = BulkWriteKey(Hive, KeyCell, SecurityCell, SubKeys[i]);
+        if (SubKeyCell == HCELL_NIL)
+            return HCELL_NIL;
+
+        Name.Buffer = SubKeys[i]->Name;
+        Name.Length = Name.MaximumLength = SubKeys[i]->NameLength;
+
+        Leaf = (PCM_KEY_INDEX)HvGetCell(Hive, LeafCell);
+        if (Signature == CM_KEY_INDEX_LEAF)
+        {
+            Leaf->List[i] = SubKeyCell;
+        }
+        else
+        {
+            FastLeaf = (PCM_KEY_FAST_INDEX)Leaf;
+            FastLeaf->List[i].Cell = SubKeyCell;
+            if (Signature == CM_KEY_HASH_LEAF)
+                FastLeaf->List[i].HashKey = CmpComputeHashKey(0, &Name, FALSE);
+            else
+                BulkSetNameHint(FastLeaf->List[i].NameHint, &Name);
+        }
+        HvReleaseCell(Hive, LeafCell);
+
+        if (*MaxNameLen < Name.Length)
+            *MaxNameLen = Name.Length;
+    }
+
+    return LeafCell;
+}
+
+/* Writes the index cells of a key, followed by its subkeys */
+static HCELL_INDEX
+BulkWriteSubKeys(
+    IN PHHIVE Hive,
+    IN HCELL_INDEX KeyCell,
+    IN HCELL_INDEX SecurityCell,
+    IN PBULK_KEY Key,
+    OUT PULONG MaxNameLen)
+{
+    PCM_KEY_INDEX Root;
+    HCELL_INDEX RootCell = HCELL_NIL, LeafCell = HCELL_NIL;
+    ULONG Signature, MaxPerLeaf, LeafCount, First, Count, i;
+
+    /* Same kind of leaves as CmpAddSubKey() */
+    if (Hive->Version >= 5)
+    {
+        Signature = CM_KEY_HASH_LEAF;
+        MaxPerLeaf = BULK_MAX_INDEX;
+    }
+    else if (Hive->Version >= 3)
+    {
+        Signature = CM_KEY_FAST_LEAF;
+        MaxPerLeaf = BULK_MAX_FAST_INDEX;
+    }
+    else
+    {
+        Signature = CM_KEY_INDEX_LEAF;
+        MaxPerLeaf = BULK_MAX_INDEX;
+    }
+
+    *MaxNameLen = 0;
+
+    /* Too many subkeys for one leaf: spread them evenly under a root index */
+    LeafCount = (Key->SubKeyCount + MaxPerLeaf - 1) / MaxPerLeaf;
+    if (LeafCount > 1)
+    {
+        RootCell = HvAllocateCell(Hive,
+                                  FIELD_OFFSET(CM_KEY_INDEX, List) + LeafCount * sizeof(HCELL_INDEX),
+                                  Stable,
+                                  HCELL_NIL);
+        if (RootCell == HCELL_NIL)
+            return HCELL_NIL;
+
+        Root = (PCM_KEY_INDEX)HvGetCell(Hive, RootCell);
+        Root->Signature = CM_KEY_INDEX_ROOT;
+        Root->Count = (USHORT)LeafCount;
+        HvReleaseCell(Hive, RootCell);
+    }
+
+    for (First = 0, i = 0; i < LeafCount; i++, First += Count)
+    {
+        Count = (Key->SubKeyCount - First + (LeafCount - i) - 1) / (LeafCount - i);
+
+        LeafCell = BulkWriteLeaf(Hive,
+                                 Signature,
+                                 KeyCell,
+                                 SecurityCell,
+                                 &Key->SubKeys[First],
+                                 Count,
+                                 MaxNameLen);
+        if (LeafCell == HCELL_NIL)
+            return HCELL_NIL;
+
+        if (RootCell != HCELL_NIL)
+        {
+            Root = (PCM_KEY_INDEX)HvGetCell(Hive, RootCell);
+            Root->List[i] = LeafCell;
+            HvReleaseCell(Hive, RootCell);
+        }
+    }
+
+    return (RootCell != HCELL_NIL) ? RootCell : LeafCell;
+}
+
+/* Writes a new key and everything under it, like CmiCreateSubKey() would */
+static HCELL_INDEX
+BulkWriteKey(
+    IN PHHIVE Hive,
+    IN HCELL_INDEX ParentCell,
+    IN HCELL_INDEX SecurityCell,
+    IN PBULK_KEY Key)
+{
+    UNICODE_STRING Name;
+    PCM_KEY_NODE KeyNode;
+    PCM_KEY_SECURITY Security;
+    HCELL_INDEX KeyCell, ListCell, ValueCell, IndexCell;
+    PHCELL_INDEX List;
+    ULONG MaxValueNameLen = 0, MaxValueDataLen = 0, MaxNameLen;
+    ULONG i;
+
+    ASSERT(Key->Cell == HCELL_NIL && !Key->Link);
+
+    Name.Buffer = Key->Name;
+    Name.Length = Name.MaximumLength = Key->NameLength;
+
+    KeyCell = HvAllocateCell(Hive,
+                             FIELD_OFFSET(CM_KEY_NODE, Name) + CmpNameSize(Hive, &Name),
+                             Stable,
+                             HCELL_NIL);
+    if (KeyCell == HCELL_NIL)
+        return HCELL_NIL;
+
+    KeyNode = (PCM_KEY_NODE)HvGetCell(Hive, KeyCell);
+    RtlZeroMemory(KeyNode, FIELD_OFFSET(CM_KEY_NODE, Name));
+    KeyNode->Signature = CM_KEY_NODE_SIGNATURE;
+    KeQuerySystemTime(&KeyNode->LastWriteTime);
+    KeyNode->Parent = ParentCell;
+    KeyNode->SubKeyLists[Stable] = HCELL_NIL;
+    KeyNode->SubKeyLists[Volatile] = HCELL_NIL;
+    KeyNode->ValueList.List = HCELL_NIL;
+    KeyNode->Security = SecurityCell;
+    KeyNode->Class = HCELL_NIL;
+    KeyNode->NameLength = CmpCopyName(Hive, KeyNode->Name, &Name);
+    if (KeyNode->NameLength < Name.Length)
+        KeyNode->Flags |= KEY_COMP_NAME;
+    HvReleaseCell(Hive, KeyCell);
+
+    /* Inherit the security block of the parent */
+    if (SecurityCell != HCELL_NIL)
+    {
+        Security = (PCM_KEY_SECURITY)HvGetCell(Hive, SecurityCell);
+        ++Security->ReferenceCount;
+        HvReleaseCell(Hive, SecurityCell);
+    }
+
+    /* The value list, with exactly the room needed, then the values */
+    if (Key->ValueCount)
+    {
+        ListCell = HvAllocateCell(Hive, Key->ValueCount * sizeof(HCELL_INDEX), Stable, HCELL_NIL);
+        if (ListCell == HCELL_NIL)
+            return HCELL_NIL;
+
+        for (i = 0; i < Key->ValueCount; i++)
+        {
+            ValueCell = BulkWriteValue(Hive, &Key->Values[i]);
+            if (ValueCell == HCELL_NIL)
+                return HCELL_NIL;
+
+            List = (PHCELL_INDEX)HvGetCell(Hive, ListCell);
+            List[i] = ValueCell;
+            HvReleaseCell(Hive, ListCell);
+
+            if (MaxValueNameLen < strlenW(Key->Values[i].Name) * sizeof(WCHAR))
+                MaxValueNameLen = strlenW(Key->Values[i].Name) * sizeof(WCHAR);
+            if (MaxValueDataLen < Key->Values[i].DataSize)
+                MaxValueDataLen = Key->Values[i].DataSize;
+        }
+
+        KeyNode = (PCM_KEY_NODE)HvGetCell(Hive, KeyCell);
+        KeyNode->ValueList.Count = Key->ValueCount;
+        KeyNode->ValueList.List = ListCell;
+        KeyNode->MaxValueNameLen = MaxValueNameLen;
+        KeyNode->MaxValueDataLen = MaxValueDataLen;
+        HvReleaseCell(Hive, KeyCell);
+    }
+
+    /* Then the subkeys */
+    if (Key->SubKeyCount)
+    {
+        IndexCell = BulkWriteSubKeys(Hive, KeyCell, SecurityCell, Key, &MaxNameLen);
+        if (IndexCell == HCELL_NIL)
+            return HCELL_NIL;
+
+        KeyNode = (PCM_KEY_NODE)HvGetCell(Hive, KeyCell);
+        KeyNode->SubKeyCounts[Stable] = Key->SubKeyCount;
+        KeyNode->SubKeyLists[Stable] = IndexCell;
+        KeyNode->MaxNameLen = MaxNameLen;
+        HvReleaseCell(Hive, KeyCell);
+    }
+
+    return KeyCell;
+}
+
+/* Adds the values and the new subkeys of a key which was already in a hive */
+static BOOL
+BulkWriteExistingKey(
+    IN PBULK_KEY Key)
+{
+    MEMKEY KeyHandle;
+    PHHIVE Hive = &Key->Hive->Hive;
+    PCM_KEY_NODE KeyNode;
+    PBULK_KEY SubKey;
+    HCELL_INDEX SecurityCell, SubKeyCell;
+    ULONG i;
+
+    KeyHandle.RegistryHive = Key->Hive;
+    KeyHandle.KeyCellOffset = Key->Cell;
+
+    for (i = 0; i < Key->ValueCount; i++)
+    {
+        if (RegSetValueExW(MEMKEY_TO_HKEY(&KeyHandle),
+                           Key->Values[i].Name,
+                           0,
+                           Key->Values[i].Type,
+                           Key->Values[i].Data,
+                           Key->Values[i].DataSize) != ERROR_SUCCESS)
+        {
+            return FALSE;
+        }
+    }
+
+    KeyNode = (PCM_KEY_NODE)HvGetCell(Hive, Key->Cell);
+    SecurityCell = KeyNode->Security;
+    HvReleaseCell(Hive, Key->Cell);
+
+    for (i = 0; i < Key->SubKeyCount; i++)
+    {
+        SubKey = Key->SubKeys[i];
+
+        /* The existing subkeys are written on their own */
+        if (SubKey->Cell != HCELL_NIL || SubKey->Link)
+            continue;
+
+        SubKeyCell = BulkWriteKey(Hive, Key->Cell, SecurityCell, SubKey);
+        if (SubKeyCell == HCELL_NIL)
+            return FALSE;
+
+        HvMarkCellDirty(Hive, Key->Cell, FALSE);
+        if (!CmpAddSubKey(Hive, Key->Cell, SubKeyCell))
+            return FALSE;
+
+        KeyNode = (PCM_KEY_NODE)HvGetCell(Hive, Key->Cell);
+        KeQuerySystemTime(&KeyNode->LastWriteTime);
+        if (KeyNode->MaxNameLen < SubKey->NameLength)
+            KeyNode->MaxNameLen = SubKey->NameLength;
+        HvReleaseCell(Hive, Key->Cell);
+    }
+
+    return TRUE;
+}
+
+/*
+ * Imports INF files like ImportRegistryFile() does one after the other,
+ * with the same result, but the hives are written in one go at the end.
+ */
+BOOL
+BulkImportRegistryFiles(
+    IN ULONG FileCount,
+    IN PCHAR *FileNames)
+{
+    PREG_OPERATION_LIST Lists;
+    BOOL *Results;
+    HKEY RootHandle;
+    PLIST_ENTRY Entry;
+    BOOL Success = FALSE;
+    ULONG i, j;
+
+    InitializeListHead(&BulkExistingKeysHead);
+    BulkRootKey = NULL;
+    BulkLastKeyName = NULL;
+
+    Lists = calloc(FileCount, sizeof(REG_OPERATION_LIST));
+    Results = calloc(FileCount, sizeof(BOOL));
+    if (!Lists || !Results)
+        goto Quit;
+
+    /* Nothing in an INF file depends on the others, they can all be parsed at once */
+    BulkParseAllFiles(FileCount, FileNames, Lists, Results);
+    for (i = 0; i < FileCount; i++)
+    {
+        if (!Results[i])
+        {
+            DPRINT1("Failed to parse %s\n", FileNames[i]);
+            goto Quit;
+        }
+    }
+
+    /* The tree starts at the root of the registry, existing keys are added as they are found */
+    if (RegOpenKeyW(NULL, L"", &RootHandle) != ERROR_SUCCESS)
+        goto Quit;
+    BulkRootKey = BulkCreateKey(L"",
+                                0,
+                                HKEY_TO_MEMKEY(RootHandle)->RegistryHive,
+                                HKEY_TO_MEMKEY(RootHandle)->KeyCellOffset);
+    RegCloseKey(RootHandle);
+    if (!BulkRootKey)
+        goto Quit;
+
+    /* Apply the operations in order, this is what keeps the result deterministic */
+    for (i = 0; i < FileCount; i++)
+    {
+        for (j = 0; j < Lists[i].Count; j++)
+            BulkApplyOperation(&Lists[i].Operations[j]);
+    }
+
+    for (Entry = BulkExistingKeysHead.Flink;
+         Entry != &BulkExistingKeysHead;
+         Entry = Entry->Flink)
+    {
+        if (!BulkWriteExistingKey(CONTAINING_RECORD(Entry, BULK_KEY, ExistingListEntry)))
+        {
+            DPRINT1("Failed to write the imported keys\n");
+            goto Quit;
+        }
+    }
+
+    Success = TRUE;
+
+Quit:
+    if (BulkRootKey)
+        BulkFreeKey(BulkRootKey);
+    BulkRootKey = NULL;
+    BulkLastKeyName = NULL;
+
+    if (Lists)
+    {
+        for (i = 0; i < FileCount; i++)
+            FreeRegistryOperations(&Lists[i]);
+        free(Lists);
+    }
+    free(Results);
+
+    return Success;
+}
+
+/* EOF */
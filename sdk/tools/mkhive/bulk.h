@@ -0,0 +1,15 @@
+/*
+ * PROJECT:     ReactOS hive maker
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Bulk import of INF files
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#pragma once
+
+BOOL
+BulkImportRegistryFiles(
+    IN ULONG FileCount,
+    IN PCHAR *FileNames);
+
+/* EOF */
@@ -0,0 +1,192 @@
+/*
+ * PROJECT:     ReactOS hive maker
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Benchmarks cell allocation in large, fragmented hives
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include <string.h>
+#include <time.h>
+
+#define NDEBUG
+#include "mkhive.h"
+
+#define DEFAULT_KEY_COUNT   20000
+#define VALUES_PER_KEY      4
+#define MAX_VALUE_SIZE      3000
+
+static ULONG Seed = 0x5EED;
+
+static
+ULONG
+NextRandom(VOID)
+{
+    /* Same results on every host */
+    Seed = Seed * 1103515245 + 12345;
+    return (Seed >> 16) & 0x7FFF;
+}
+
+static
+VOID
+MakeName(
+    OUT PWCHAR Buffer,
+    IN PCSTR Prefix,
+    IN ULONG Number)
+{
+    char Name[64];
+    int i;
+
+    snprintf(Name, sizeof(Name), "%s%lu", Prefix, (unsigned long)Number);
+    for (i = 0; Name[i]; i++)
+        Buffer[i] = (WCHAR)Name[i];
+    Buffer[i] = UNICODE_NULL;
+}
+
+static
+ULONG
+SetValues(
+    IN HKEY Key,
+    IN PUCHAR Data)
+{
+    WCHAR ValueName[16];
+    ULONG Failures = 0;
+    ULONG i, Size;
+
+    for (i = 0; i < VALUES_PER_KEY; i++)
+    {
+        /* Mostly small values, with the odd large one, like a SOFTWARE hive */
+        Size = (NextRandom() % 8) ? (NextRandom() % 200) + 4 : (NextRandom() % MAX_VALUE_SIZE) + 4;
+        MakeName(ValueName, "Value", i);
+        if (RegSetValueExW(Key, ValueName, 0, REG_BINARY, Data, Size) != ERROR_SUCCESS)
+            Failures++;
+    }
+
+    return Failures;
+}
+
+static
+ULONG
+CreateKey(
+    IN HKEY Parent,
+    IN ULONG Number,
+    IN PUCHAR Data)
+{
+    WCHAR KeyName[32];
+    ULONG Failures;
+    HKEY Key;
+
+    MakeName(KeyName, "Key", Number);
+    if (RegCreateKeyW(Parent, KeyName, &Key) != ERROR_SUCCESS)
+        return 1;
+
+    Failures = SetValues(Key, Data);
+    RegCloseKey(Key);
+    return Failures;
+}
+
+static
+ULONG
+DeleteKey(
+    IN HKEY Parent,
+    IN ULONG Number)
+{
+    WCHAR KeyName[32], ValueName[16];
+    ULONG Failures = 0;
+    HKEY Key;
+    ULONG i;
+
+    MakeName(KeyName, "Key", Number);
+    if (RegOpenKeyW(Parent, KeyName, &Key) != ERROR_SUCCESS)
+        return 1;
+
+    for (i = 0; i < VALUES_PER_KEY; i++)
+    {
+        MakeName(ValueName, "Value", i);
+        if (RegDeleteValueW(Key, ValueName) != ERROR_SUCCESS)
+            Failures++;
+    }
+    if (RegDeleteKeyW(Key, NULL) != ERROR_SUCCESS)
+        Failures++;
+
+    RegCloseKey(Key);
+    return Failures;
+}
+
+static
+double
+ElapsedMs(
+    IN clock_t Start)
+{
+    return (double)(clock() - Start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+static
+ULONG
+HiveSize(VOID)
+{
+    return RegistryHives[2].CmHive->Hive.Storage[Stable].Length * HBLOCK_SIZE;
+}
+
+int
+main(int argc, char *argv[])
+{
+    UCHAR Data[MAX_VALUE_SIZE + 4];
+    ULONG KeyCount = DEFAULT_KEY_COUNT;
+    ULONG Failures = 0;
+    ULONG FilledSize;
+    HKEY Parent;
+    clock_t Start;
+    ULONG i, Number;
+
+    if (argc > 2 || (argc == 2 && (KeyCount = strtoul(argv[1], NULL, 0)) == 0))
+    {
+        printf("Benchmarks cell allocation in a fragmented SOFTWARE hive.\n"
+               "Syntax: hivebench [key count, default %u]\n", DEFAULT_KEY_COUNT);
+        return -1;
+    }
+
+    memset(Data, 0xA5, sizeof(Data));
+
+    /* Set up the registry the way mkhive does, with only the SOFTWARE hive */
+    RegInitializeRegistry("SOFTWARE");
+    if (RegCreateKeyW(NULL, L"Registry\\Machine\\SOFTWARE\\HiveBench", &Parent) != ERROR_SUCCESS)
+    {
+        printf("Cannot create the benchmark key\n");
+        return -1;
+    }
+
+    /* Fill the hive */
+    Start = clock();
+    for (i = 0; i < KeyCount; i++)
+        Failures += CreateKey(Parent, i, Data);
+    printf("Fill:      %lu keys in %.0f ms\n", (unsigned long)KeyCount, ElapsedMs(Start));
+    FilledSize = HiveSize();
+
+    /*
+     * Replace random keys with new ones, with other value sizes. The hive
+     * stays about the same size and ends up full of free cells, nearly
+     * every allocation has to find one.
+     */
+    Start = clock();
+    for (i = 0; i < 2 * KeyCount; i++)
+    {
+        Number = ((NextRandom() << 15) | NextRandom()) % KeyCount;
+        Failures += DeleteKey(Parent, Number);
+        Failures += CreateKey(Parent, Number, Data);
+    }
+    printf("Churn:     %lu keys replaced in %.0f ms\n", (unsigned long)(2 * KeyCount), ElapsedMs(Start));
+
+    printf("Hive size: %lu KB after the fill, %lu KB after the churn\n",
+           (unsigned long)(FilledSize / 1024), (unsigned long)(HiveSize() / 1024));
+
+    RegCloseKey(Parent);
+    RegShutdownRegistry();
+
+    if (Failures)
+    {
+        printf("%lu registry operations failed\n", (unsigned long)Failures);
+        return -1;
+    }
+
+    return 0;
+}
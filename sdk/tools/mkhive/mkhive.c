@@ -54,10 +54,11 @@
 
 void usage(void)
 {
-    printf("Usage: mkhive [-?] -h:hive1[,hiveN...] [-u] -d:<dstdir> <inffiles>\n\n"
+    printf("Usage: mkhive [-?] -h:hive1[,hiveN...] [-u] [-b] -d:<dstdir> <inffiles>\n\n"
            "  -h:hiveN  - Comma-separated list of hives to create. Possible values are:\n"
            "              SETUPREG, SYSTEM, SOFTWARE, DEFAULT, SAM, SECURITY, BCD.\n"
            "  -u        - Generate file names in uppercase (default: lowercase) (TEMPORARY FLAG!).\n"
+           "  -b        - Bulk mode: parse all the INF files at once, then write the hives in one pass.\n"
            "  -d:dstdir - The binary hive files are created in this directory.\n"
            "  inffiles  - List of INF files with full path.\n"
            "  -?        - Displays this help screen.\n");
@@ -97,6 +98,7 @@ int main(int argc, char *argv[])
     INT i;
     PSTR ptr;
     BOOL UpperCaseFileName = FALSE;
+    BOOL BulkImport = FALSE;
     PCSTR HiveList = NULL;
     CHAR DestPath[PATH_MAX] = "";
     CHAR FileName[PATH_MAX];
@@ -122,6 +124,10 @@ int main(int argc, char *argv[])
         {
             UpperCaseFileName = TRUE;
         }
+        else if (argv[i][1] == 'b' && argv[i][2] == 0)
+        {
+            BulkImport = TRUE;
+        }
         else
         if (argv[i][1] == 'h' && (argv[i][2] == ':' || argv[i][2] == '='))
         {
@@ -162,12 +168,24 @@ int main(int argc, char *argv[])
     ret = -1;
 
     /* Now we should have the list of INF files: parse it */
-    for (; i < argc; ++i)
+    if (BulkImport)
     {
-        convert_path(FileName, argv[i]);
-        if (!ImportRegistryFile(FileName))
+        for (ret = i; ret < argc; ++ret)
+            convert_path(argv[ret], argv[ret]);
+
+        ret = -1;
+        if (!BulkImportRegistryFiles(argc - i, &argv[i]))
             goto Quit;
     }
+    else
+    {
+        for (; i < argc; ++i)
+        {
+            convert_path(FileName, argv[i]);
+            if (!ImportRegistryFile(FileName))
+                goto Quit;
+        }
+    }
 
     for (i = 0; i < MAX_NUMBER_OF_REGISTRY_HIVES; ++i)
     {
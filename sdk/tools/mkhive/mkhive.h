@@ -120,6 +120,7 @@ RegOpenKeyW(
 #include <cmlib.h>
 #include <infhost.h>
 #include "reginf.h"
+#include "bulk.h"
 #include "cmi.h"
 #include "registry.h"
 #include "binhive.h"
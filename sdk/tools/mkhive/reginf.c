@@ -34,25 +34,6 @@
 #define NDEBUG
 #include "mkhive.h"
 
-#define FLG_ADDREG_BINVALUETYPE         0x00000001
-#define FLG_ADDREG_NOCLOBBER            0x00000002
-#define FLG_ADDREG_DELVAL               0x00000004
-#define FLG_ADDREG_APPEND               0x00000008
-#define FLG_ADDREG_KEYONLY              0x00000010
-#define FLG_ADDREG_OVERWRITEONLY        0x00000020
-#define FLG_ADDREG_KEYONLY_COMMON       0x00002000
-#define FLG_DELREG_KEYONLY_COMMON       FLG_ADDREG_KEYONLY_COMMON
-#define FLG_ADDREG_DELREG_BIT           0x00008000
-
-#define FLG_ADDREG_TYPE_SZ              0x00000000
-#define FLG_ADDREG_TYPE_MULTI_SZ        0x00010000
-#define FLG_ADDREG_TYPE_EXPAND_SZ       0x00020000
-#define FLG_ADDREG_TYPE_BINARY         (0x00000000 | FLG_ADDREG_BINVALUETYPE)
-#define FLG_ADDREG_TYPE_DWORD          (0x00010000 | FLG_ADDREG_BINVALUETYPE)
-#define FLG_ADDREG_TYPE_NONE           (0x00020000 | FLG_ADDREG_BINVALUETYPE)
-#define FLG_ADDREG_TYPE_MASK           (0xFFFF0000 | FLG_ADDREG_BINVALUETYPE)
-
-
 static const WCHAR HKCR[] = {'H','K','C','R',0};
 static const WCHAR HKCU[] = {'H','K','C','U',0};
 static const WCHAR HKLM[] = {'H','K','L','M',0};
@@ -113,12 +94,68 @@ get_root_key(PWCHAR Name)
 }
 
 
+/***********************************************************************
+ * AppendMultiSz
+ *
+ * Append to a multisz buffer the strings it doesn't contain yet. Returns
+ * the new multisz, or NULL if there is nothing to append.
+ */
+// NOTE: Synced with setupapi/install.c ; see also usetup/registry.c
+PWCHAR
+AppendMultiSz(
+    IN PCWSTR Buffer,
+    IN ULONG Size,       // In bytes
+    IN PCWSTR Strings,
+    IN ULONG StringSize, // In characters
+    OUT PULONG NewSize)  // In bytes
+{
+    ULONG Total;
+    PWCHAR NewBuffer;
+    PWCHAR p;
+    size_t len;
+
+    /* Zeroed, the value must not depend on what was left in the heap */
+    NewBuffer = calloc(1, Size + (StringSize + 1) * sizeof(WCHAR));
+    if (NewBuffer == NULL)
+        return NULL;
+
+    memcpy(NewBuffer, Buffer, Size);
+
+    /* compare each string against all the existing ones */
+    Total = Size;
+    while (*Strings != 0)
+    {
+        len = strlenW(Strings) + 1;
+
+        for (p = NewBuffer; *p != 0; p += strlenW(p) + 1)
+            if (!strcmpiW(p, Strings))
+                break;
+
+        if (*p == 0)  /* not found, need to append it */
+        {
+            memcpy(p, Strings, len * sizeof(WCHAR));
+            p[len] = 0;
+            Total += len * sizeof(WCHAR);
+        }
+        Strings += len;
+    }
+
+    if (Total == Size)
+    {
+        free(NewBuffer);
+        return NULL;
+    }
+
+    *NewSize = Total + sizeof(WCHAR);
+    return NewBuffer;
+}
+
+
 /***********************************************************************
  * append_multi_sz_value
  *
  * Append a multisz string to a multisz registry value.
  */
-// NOTE: Synced with setupapi/install.c ; see also usetup/registry.c
 static VOID
 append_multi_sz_value(
     IN HKEY KeyHandle,
@@ -129,8 +166,7 @@ append_multi_sz_value(
     ULONG Size, Total;   // In bytes
     ULONG Type;
     PWCHAR Buffer;
-    PWCHAR p;
-    size_t len;
+    PWCHAR NewBuffer;
     LONG Error;
 
     Error = RegQueryValueExW(KeyHandle,
@@ -142,7 +178,7 @@ append_multi_sz_value(
     if ((Error != ERROR_SUCCESS) || (Type != REG_MULTI_SZ))
         return;
 
-    Buffer = malloc(Size + StringSize * sizeof(WCHAR));
+    Buffer = malloc(Size + sizeof(WCHAR));
     if (Buffer == NULL)
         return;
 
@@ -155,34 +191,17 @@ append_multi_sz_value(
     if (Error != ERROR_SUCCESS)
         goto done;
 
-    /* compare each string against all the existing ones */
-    Total = Size;
-    while (*Strings != 0)
-    {
-        len = strlenW(Strings) + 1;
-
-        for (p = Buffer; *p != 0; p += strlenW(p) + 1)
-            if (!strcmpiW(p, Strings))
-                break;
-
-        if (*p == 0)  /* not found, need to append it */
-        {
-            memcpy(p, Strings, len * sizeof(WCHAR));
-            p[len] = 0;
-            Total += len * sizeof(WCHAR);
-        }
-        Strings += len;
-    }
-
-    if (Total != Size)
+    NewBuffer = AppendMultiSz(Buffer, Size, Strings, StringSize, &Total);
+    if (NewBuffer)
     {
-        DPRINT("setting value '%S' to '%S'\n", ValueName, Buffer);
+        DPRINT("setting value '%S' to '%S'\n", ValueName, NewBuffer);
         RegSetValueExW(KeyHandle,
                        ValueName,
                        0,
                        REG_MULTI_SZ,
-                       (PUCHAR)Buffer,
-                       Total + sizeof(WCHAR));
+                       (PUCHAR)NewBuffer,
+                       Total);
+        free(NewBuffer);
     }
 
 done:
@@ -195,49 +214,91 @@ done:
  *
  * Perform an add/delete registry operation depending on the flags.
  */
-static BOOL
+static VOID
 do_reg_operation(
     IN HKEY KeyHandle,
-    IN PCWSTR ValueName,
-    IN PINFCONTEXT Context,
-    IN ULONG Flags)
+    IN PREG_OPERATION Operation)
 {
-    WCHAR EmptyStr = 0;
-    ULONG Type;
-    ULONG Size;
+    ULONG Flags = Operation->Flags;
     LONG Error;
 
-    if (Flags & (FLG_ADDREG_DELREG_BIT | FLG_ADDREG_DELVAL))  /* deletion */
+    if (IS_REG_DELETE_OPERATION(Flags))  /* deletion */
     {
-        if (ValueName && *ValueName && !(Flags & FLG_DELREG_KEYONLY_COMMON))
+        if (Operation->ValueName && *Operation->ValueName && !(Flags & FLG_DELREG_KEYONLY_COMMON))
         {
             // NOTE: We don't currently handle deleting sub-values inside multi-strings.
-            RegDeleteValueW(KeyHandle, ValueName);
+            RegDeleteValueW(KeyHandle, Operation->ValueName);
         }
         else
         {
             RegDeleteKeyW(KeyHandle, NULL);
         }
-        return TRUE;
+        return;
     }
 
     if (Flags & (FLG_ADDREG_KEYONLY | FLG_ADDREG_KEYONLY_COMMON))
-        return TRUE;
+        return;
 
     if (Flags & (FLG_ADDREG_NOCLOBBER | FLG_ADDREG_OVERWRITEONLY))
     {
         Error = RegQueryValueExW(KeyHandle,
-                                 ValueName,
+                                 Operation->ValueName,
                                  NULL,
                                  NULL,
                                  NULL,
                                  NULL);
 
         if ((Error == ERROR_SUCCESS) && (Flags & FLG_ADDREG_NOCLOBBER))
-            return TRUE;
+            return;
 
         if ((Error != ERROR_SUCCESS) && (Flags & FLG_ADDREG_OVERWRITEONLY))
-            return TRUE;
+            return;
+    }
+
+    if (Flags & FLG_ADDREG_APPEND)
+    {
+        if (Operation->Data == NULL)
+            return;
+
+        DPRINT("append_multi_sz_value(ValueName = '%S')\n", Operation->ValueName);
+        append_multi_sz_value(KeyHandle,
+                              Operation->ValueName,
+                              Operation->Data,
+                              Operation->DataSize / sizeof(WCHAR));
+        return;
+    }
+
+    DPRINT("setting value '%S', type %u, %u bytes\n",
+           Operation->ValueName, Operation->Type, Operation->DataSize);
+
+    RegSetValueExW(KeyHandle,
+                   Operation->ValueName,
+                   0,
+                   Operation->Type,
+                   Operation->Data,
+                   Operation->DataSize);
+}
+
+
+/***********************************************************************
+ *            get_reg_operation_data
+ *
+ * Read the type and the data of the value set by an AddReg line.
+ */
+static BOOL
+get_reg_operation_data(
+    IN PINFCONTEXT Context,
+    IN OUT PREG_OPERATION Operation)
+{
+    ULONG Flags = Operation->Flags;
+    ULONG Type;
+    ULONG Size;
+
+    /* Deletions and keys without values don't have any */
+    if (IS_REG_DELETE_OPERATION(Flags) ||
+        (Flags & (FLG_ADDREG_KEYONLY | FLG_ADDREG_KEYONLY_COMMON)))
+    {
+        return TRUE;
     }
 
     switch (Flags & FLG_ADDREG_TYPE_MASK)
@@ -271,10 +332,13 @@ do_reg_operation(
             break;
     }
 
+    Operation->Type = Type;
+
     if (!(Flags & FLG_ADDREG_BINVALUETYPE) ||
         (Type == REG_DWORD && InfHostGetFieldCount(Context) == 5))
     {
         PWCHAR Str = NULL;
+        PULONG dw;
 
         if (Type == REG_MULTI_SZ)
         {
@@ -292,16 +356,9 @@ do_reg_operation(
 
             if (Flags & FLG_ADDREG_APPEND)
             {
-                if (Str == NULL)
-                    return TRUE;
-
-                DPRINT("append_multi_sz_value(ValueName = '%S')\n", ValueName);
-                append_multi_sz_value(KeyHandle,
-                                      ValueName,
-                                      Str,
-                                      Size);
-
-                free(Str);
+                /* Nothing is appended if there is no string */
+                Operation->Data = Str;
+                Operation->DataSize = Size * sizeof(WCHAR);
                 return TRUE;
             }
             /* else fall through to normal string handling */
@@ -321,48 +378,47 @@ do_reg_operation(
             }
         }
 
+        /* Only multi-strings can be appended to */
+        Operation->Flags &= ~FLG_ADDREG_APPEND;
+
         if (Type == REG_DWORD)
         {
-            ULONG dw = Str ? strtoulW(Str, NULL, 0) : 0;
+            dw = malloc(sizeof(ULONG));
+            if (dw == NULL)
+            {
+                free(Str);
+                return FALSE;
+            }
 
-            DPRINT("setting dword '%S' to %x\n", ValueName, dw);
+            *dw = Str ? strtoulW(Str, NULL, 0) : 0;
+            free(Str);
 
-            RegSetValueExW(KeyHandle,
-                           ValueName,
-                           0,
-                           Type,
-                           (const PUCHAR)&dw,
-                           sizeof(ULONG));
+            DPRINT("dword value %x\n", *dw);
+            Operation->Data = dw;
+            Operation->DataSize = sizeof(ULONG);
+        }
+        else if (Str)
+        {
+            Operation->Data = Str;
+            Operation->DataSize = (ULONG)(Size * sizeof(WCHAR));
         }
         else
         {
-            DPRINT("setting value '%S' to '%S'\n", ValueName, Str);
+            /* An empty string */
+            Str = calloc(1, sizeof(WCHAR));
+            if (Str == NULL)
+                return FALSE;
 
-            if (Str)
-            {
-                RegSetValueExW(KeyHandle,
-                               ValueName,
-                               0,
-                               Type,
-                               (PVOID)Str,
-                               (ULONG)(Size * sizeof(WCHAR)));
-            }
-            else
-            {
-                RegSetValueExW(KeyHandle,
-                               ValueName,
-                               0,
-                               Type,
-                               (PVOID)&EmptyStr,
-                               sizeof(WCHAR));
-            }
+            Operation->Data = Str;
+            Operation->DataSize = sizeof(WCHAR);
         }
-        free(Str);
     }
     else  /* get the binary data */
     {
         PUCHAR Data = NULL;
 
+        Operation->Flags &= ~FLG_ADDREG_APPEND;
+
         if (InfHostGetBinaryField(Context, 5, NULL, 0, &Size) != 0)
             Size = 0;
 
@@ -372,38 +428,77 @@ do_reg_operation(
             if (Data == NULL)
                 return FALSE;
 
-            DPRINT("setting binary data '%S' len %d\n", ValueName, (ULONG)Size);
+            DPRINT("binary data len %d\n", (ULONG)Size);
             InfHostGetBinaryField(Context, 5, Data, Size, NULL);
         }
 
-        RegSetValueExW(KeyHandle,
-                       ValueName,
-                       0,
-                       Type,
-                       (PVOID)Data,
-                       (ULONG)Size);
+        Operation->Data = Data;
+        Operation->DataSize = Size;
+    }
+
+    return TRUE;
+}
+
+
+static PWSTR
+duplicate_string(PCWSTR String)
+{
+    size_t Size = (strlenW(String) + 1) * sizeof(WCHAR);
+    PWSTR Copy;
+
+    Copy = malloc(Size);
+    if (Copy)
+        memcpy(Copy, String, Size);
+
+    return Copy;
+}
 
-        free(Data);
+
+static VOID
+free_reg_operation(PREG_OPERATION Operation)
+{
+    free(Operation->KeyName);
+    free(Operation->ValueName);
+    free(Operation->Data);
+}
+
+
+static BOOL
+add_reg_operation(PREG_OPERATION_LIST List, PREG_OPERATION Operation)
+{
+    PREG_OPERATION Operations;
+    ULONG MaxCount;
+
+    if (List->Count == List->MaxCount)
+    {
+        MaxCount = List->MaxCount ? List->MaxCount * 2 : 64;
+        Operations = realloc(List->Operations, MaxCount * sizeof(REG_OPERATION));
+        if (Operations == NULL)
+            return FALSE;
+
+        List->Operations = Operations;
+        List->MaxCount = MaxCount;
     }
 
+    List->Operations[List->Count++] = *Operation;
     return TRUE;
 }
 
+
 /***********************************************************************
  *            registry_callback
  *
  * Called once for each AddReg and DelReg entry in a given section.
  */
 static BOOL
-registry_callback(HINF hInf, PCWSTR Section, BOOL Delete)
+registry_callback(HINF hInf, PCWSTR Section, BOOL Delete, PREG_OPERATION_LIST List)
 {
     WCHAR Buffer[MAX_INF_STRING_LENGTH];
-    PWCHAR ValuePtr;
+    REG_OPERATION Operation;
     ULONG Flags;
     size_t Length;
 
     PINFCONTEXT Context = NULL;
-    HKEY KeyHandle;
     BOOL Ok;
 
     Ok = InfHostFindFirstLine(hInf, Section, NULL, &Context) == 0;
@@ -444,55 +539,56 @@ registry_callback(HINF hInf, PCWSTR Section, BOOL Delete)
 
         DPRINT("Flags: 0x%x\n", Flags);
 
-        if (Delete || (Flags & FLG_ADDREG_OVERWRITEONLY))
-        {
-            if (RegOpenKeyW(NULL, Buffer, &KeyHandle) != ERROR_SUCCESS)
-            {
-                DPRINT("RegOpenKey(%S) failed\n", Buffer);
-                continue;  /* ignore if it doesn't exist */
-            }
-        }
-        else
-        {
-            if (RegCreateKeyW(NULL, Buffer, &KeyHandle) != ERROR_SUCCESS)
-            {
-                DPRINT("RegCreateKey(%S) failed\n", Buffer);
-                continue;
-            }
-        }
+        RtlZeroMemory(&Operation, sizeof(Operation));
+        Operation.Flags = Flags;
+        Operation.KeyName = duplicate_string(Buffer);
+        if (Operation.KeyName == NULL)
+            goto Fail;
 
         /* Get value name */
         if (InfHostGetStringField(Context, 3, Buffer, sizeof(Buffer)/sizeof(WCHAR), NULL) == 0)
         {
-            ValuePtr = Buffer;
-        }
-        else
-        {
-            ValuePtr = NULL;
+            Operation.ValueName = duplicate_string(Buffer);
+            if (Operation.ValueName == NULL)
+                goto Fail;
         }
 
-        /* And now do it */
-        if (!do_reg_operation(KeyHandle, ValuePtr, Context, Flags))
+        /* And now read what it does */
+        if (!get_reg_operation_data(Context, &Operation) ||
+            !add_reg_operation(List, &Operation))
         {
-            RegCloseKey(KeyHandle);
-            return FALSE;
+            goto Fail;
         }
-
-        RegCloseKey(KeyHandle);
     }
 
     InfHostFreeContext(Context);
 
     return TRUE;
+
+Fail:
+    free_reg_operation(&Operation);
+    InfHostFreeContext(Context);
+    return FALSE;
 }
 
 
+/***********************************************************************
+ *            ParseRegistryFile
+ *
+ * Read the DelReg and AddReg lines of an INF file, in the order in which
+ * they must be applied. This doesn't touch the registry, so several files
+ * can be parsed at the same time.
+ */
 BOOL
-ImportRegistryFile(PCHAR FileName)
+ParseRegistryFile(
+    IN PCSTR FileName,
+    OUT PREG_OPERATION_LIST List)
 {
     HINF hInf;
     ULONG ErrorLine;
 
+    RtlZeroMemory(List, sizeof(*List));
+
     /* Load inf file from install media. */
     if (InfHostOpenFile(&hInf, FileName, 0, &ErrorLine) != 0)
     {
@@ -500,17 +596,19 @@ ImportRegistryFile(PCHAR FileName)
         return FALSE;
     }
 
-    if (!registry_callback(hInf, (PWCHAR)DelReg, TRUE))
+    if (!registry_callback(hInf, (PWCHAR)DelReg, TRUE, List))
     {
         DPRINT1("registry_callback() for DelReg failed\n");
         InfHostCloseFile(hInf);
+        FreeRegistryOperations(List);
         return FALSE;
     }
 
-    if (!registry_callback(hInf, (PWCHAR)AddReg, FALSE))
+    if (!registry_callback(hInf, (PWCHAR)AddReg, FALSE, List))
     {
         DPRINT1("registry_callback() for AddReg failed\n");
         InfHostCloseFile(hInf);
+        FreeRegistryOperations(List);
         return FALSE;
     }
 
@@ -518,4 +616,59 @@ ImportRegistryFile(PCHAR FileName)
     return TRUE;
 }
 
+
+VOID
+FreeRegistryOperations(
+    IN OUT PREG_OPERATION_LIST List)
+{
+    ULONG i;
+
+    for (i = 0; i < List->Count; i++)
+        free_reg_operation(&List->Operations[i]);
+
+    free(List->Operations);
+    RtlZeroMemory(List, sizeof(*List));
+}
+
+
+BOOL
+ImportRegistryFile(PCHAR FileName)
+{
+    REG_OPERATION_LIST List;
+    PREG_OPERATION Operation;
+    HKEY KeyHandle;
+    ULONG i;
+
+    if (!ParseRegistryFile(FileName, &List))
+        return FALSE;
+
+    for (i = 0; i < List.Count; i++)
+    {
+        Operation = &List.Operations[i];
+
+        if (IS_REG_OPEN_OPERATION(Operation->Flags))
+        {
+            if (RegOpenKeyW(NULL, Operation->KeyName, &KeyHandle) != ERROR_SUCCESS)
+            {
+                DPRINT("RegOpenKey(%S) failed\n", Operation->KeyName);
+                continue;  /* ignore if it doesn't exist */
+            }
+        }
+        else
+        {
+            if (RegCreateKeyW(NULL, Operation->KeyName, &KeyHandle) != ERROR_SUCCESS)
+            {
+                DPRINT("RegCreateKey(%S) failed\n", Operation->KeyName);
+                continue;
+            }
+        }
+
+        do_reg_operation(KeyHandle, Operation);
+        RegCloseKey(KeyHandle);
+    }
+
+    FreeRegistryOperations(&List);
+    return TRUE;
+}
+
 /* EOF */
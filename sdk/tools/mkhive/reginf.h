@@ -26,6 +26,70 @@
 
 #pragma once
 
+#define FLG_ADDREG_BINVALUETYPE         0x00000001
+#define FLG_ADDREG_NOCLOBBER            0x00000002
+#define FLG_ADDREG_DELVAL               0x00000004
+#define FLG_ADDREG_APPEND               0x00000008
+#define FLG_ADDREG_KEYONLY              0x00000010
+#define FLG_ADDREG_OVERWRITEONLY        0x00000020
+#define FLG_ADDREG_KEYONLY_COMMON       0x00002000
+#define FLG_DELREG_KEYONLY_COMMON       FLG_ADDREG_KEYONLY_COMMON
+#define FLG_ADDREG_DELREG_BIT           0x00008000
+
+#define FLG_ADDREG_TYPE_SZ              0x00000000
+#define FLG_ADDREG_TYPE_MULTI_SZ        0x00010000
+#define FLG_ADDREG_TYPE_EXPAND_SZ       0x00020000
+#define FLG_ADDREG_TYPE_BINARY         (0x00000000 | FLG_ADDREG_BINVALUETYPE)
+#define FLG_ADDREG_TYPE_DWORD          (0x00010000 | FLG_ADDREG_BINVALUETYPE)
+#define FLG_ADDREG_TYPE_NONE           (0x00020000 | FLG_ADDREG_BINVALUETYPE)
+#define FLG_ADDREG_TYPE_MASK           (0xFFFF0000 | FLG_ADDREG_BINVALUETYPE)
+
+/*
+ * An AddReg or DelReg line of an INF file, with its value data already
+ * converted. Parsing needs nothing from the registry, so the lines can be
+ * read ahead and applied later.
+ */
+typedef struct _REG_OPERATION
+{
+    PWSTR KeyName;      /* Full path, with the root key expanded */
+    PWSTR ValueName;    /* NULL if the line has no value name */
+    ULONG Flags;        /* FLG_ADDREG_APPEND only remains for multi-strings */
+    ULONG Type;
+    PVOID Data;
+    ULONG DataSize;     /* In bytes */
+} REG_OPERATION, *PREG_OPERATION;
+
+typedef struct _REG_OPERATION_LIST
+{
+    PREG_OPERATION Operations;
+    ULONG Count;
+    ULONG MaxCount;
+} REG_OPERATION_LIST, *PREG_OPERATION_LIST;
+
+#define IS_REG_DELETE_OPERATION(Flags) \
+    (((Flags) & (FLG_ADDREG_DELREG_BIT | FLG_ADDREG_DELVAL)) != 0)
+
+/* Keys of these operations are opened, the other ones are created */
+#define IS_REG_OPEN_OPERATION(Flags) \
+    (((Flags) & (FLG_ADDREG_DELREG_BIT | FLG_ADDREG_OVERWRITEONLY)) != 0)
+
+PWCHAR
+AppendMultiSz(
+    IN PCWSTR Buffer,
+    IN ULONG Size,
+    IN PCWSTR Strings,
+    IN ULONG StringSize,
+    OUT PULONG NewSize);
+
+BOOL
+ParseRegistryFile(
+    IN PCSTR FileName,
+    OUT PREG_OPERATION_LIST List);
+
+VOID
+FreeRegistryOperations(
+    IN OUT PREG_OPERATION_LIST List);
+
 BOOL
 ImportRegistryFile(PCHAR Filename);
 
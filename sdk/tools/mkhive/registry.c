@@ -41,16 +41,6 @@ typedef struct _REPARSE_POINT
     HCELL_INDEX DestinationKeyCellOffset;
 } REPARSE_POINT, *PREPARSE_POINT;
 
-typedef struct _MEMKEY
-{
-    /* Information on hard disk structure */
-    HCELL_INDEX KeyCellOffset;
-    PCMHIVE RegistryHive;
-} MEMKEY, *PMEMKEY;
-
-#define HKEY_TO_MEMKEY(hKey) ((PMEMKEY)(hKey))
-#define MEMKEY_TO_HKEY(memKey) ((HKEY)(memKey))
-
 static CMHIVE RootHive;
 static PMEMKEY RootKey;
 
@@ -751,7 +741,7 @@ RegSetValueExW(
         if (!DataCell)
             return ERROR_GEN_FAILURE; // STATUS_UNSUCCESSFUL;
 
-        DataCellSize = (ULONG)(-HvGetCellSize(Hive, DataCell));
+        DataCellSize = (ULONG)HvGetCellSize(Hive, DataCell);
     }
     else
     {
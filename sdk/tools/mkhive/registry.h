@@ -19,6 +19,16 @@ typedef struct _HIVE_LIST_ENTRY
 #define MAX_NUMBER_OF_REGISTRY_HIVES    7
 extern HIVE_LIST_ENTRY RegistryHives[];
 
+typedef struct _MEMKEY
+{
+    /* Information on hard disk structure */
+    HCELL_INDEX KeyCellOffset;
+    PCMHIVE RegistryHive;
+} MEMKEY, *PMEMKEY;
+
+#define HKEY_TO_MEMKEY(hKey) ((PMEMKEY)(hKey))
+#define MEMKEY_TO_HKEY(memKey) ((HKEY)(memKey))
+
 #define ERROR_SUCCESS                    0L
 #define ERROR_INVALID_FUNCTION           1L
 #define ERROR_FILE_NOT_FOUND             2L
@@ -0,0 +1,222 @@
+/*
+ * PROJECT:     ReactOS host tools
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Dumps the traces written by the kernel prefetcher
+ * COPYRIGHT:   Copyright 2026 ReactOS Team
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <typedefs.h>
+#include <reactos/pftrace.h>
+
+static
+void
+Usage(void)
+{
+    printf("Dumps a prefetcher trace (\\SystemRoot\\Prefetch\\*.pf).\n"
+           "Syntax: pfdump [-r] <trace file>\n"
+           "  -r  List the runs of every file\n");
+}
+
+static
+void
+PrintName(
+    const WCHAR *Name,
+    unsigned int Length)
+{
+    unsigned int i;
+
+    /* The names are UTF-16, keep it simple and only print ASCII */
+    for (i = 0; i < Length; i++)
+    {
+        putchar((Name[i] >= 0x20 && Name[i] < 0x7F) ? (char)Name[i] : '?');
+    }
+}
+
+static
+int
+ValidateTrace(
+    const PF_TRACE_FILE_HEADER *Header,
+    size_t Size)
+{
+    const PF_TRACE_FILE *Files;
+    ULONG i;
+
+    if (Size < sizeof(*Header))
+    {
+        fprintf(stderr, "File is too small\n");
+        return 0;
+    }
+
+    if (Header->Magic != PF_TRACE_MAGIC || Header->Version != PF_TRACE_VERSION)
+    {
+        fprintf(stderr, "Not a version %d trace\n", PF_TRACE_VERSION);
+        return 0;
+    }
+
+    if (Header->Size != Size ||
+        (ULONGLONG)Header->FileOffset + (ULONGLONG)Header->FileCount * sizeof(PF_TRACE_FILE) > Size ||
+        (ULONGLONG)Header->RunOffset + (ULONGLONG)Header->RunCount * sizeof(PF_TRACE_RUN) > Size ||
+        (ULONGLONG)Header->NameOffset + Header->NameLength > Size ||
+        (Header->FileOffset % 4) || (Header->RunOffset % 4) || (Header->NameOffset % 2))
+    {
+        fprintf(stderr, "Corrupted header\n");
+        return 0;
+    }
+
+    Files = (const PF_TRACE_FILE *)((const char *)Header + Header->FileOffset);
+    for (i = 0; i < Header->FileCount; i++)
+    {
+        if ((ULONGLONG)Files[i].NameOffset + Files[i].NameLength > Header->NameLength ||
+            (ULONGLONG)Files[i].FirstRun + Files[i].RunCount > Header->RunCount ||
+            (Files[i].NameOffset % 2))
+        {
+            fprintf(stderr, "Corrupted file entry %lu\n", (unsigned long)i);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static
+void
+DumpTrace(
+    const PF_TRACE_FILE_HEADER *Header,
+    int ListRuns)
+{
+    const PF_TRACE_FILE *Files;
+    const PF_TRACE_RUN *Runs;
+    const char *Names;
+    ULONGLONG TotalPages, Pages;
+    ULONG i, j;
+
+    Files = (const PF_TRACE_FILE *)((const char *)Header + Header->FileOffset);
+    Runs = (const PF_TRACE_RUN *)((const char *)Header + Header->RunOffset);
+    Names = (const char *)Header + Header->NameOffset;
+
+    TotalPages = 0;
+    for (i = 0; i < Header->RunCount; i++)
+        TotalPages += Runs[i].PageCount;
+
+    /* The scenario name is NUL terminated, unless it fills the whole array */
+    for (i = 0; i < sizeof(Header->ScenarioName) / sizeof(WCHAR) && Header->ScenarioName[i]; i++)
+        ;
+    printf("Scenario:  ");
+    PrintName(Header->ScenarioName, i);
+    printf("-%08lX (%s)\n",
+           (unsigned long)Header->HashId,
+           Header->ScenarioType == PF_TRACE_SYSTEM_BOOT ? "boot" : "application launch");
+    printf("Launches:  %lu\n", (unsigned long)Header->LaunchCount);
+    printf("Faults:    %lu\n", (unsigned long)Header->FaultCount);
+    printf("Files:     %lu\n", (unsigned long)Header->FileCount);
+    printf("Runs:      %lu\n", (unsigned long)Header->RunCount);
+    printf("Pages:     %llu (%llu KB)\n\n",
+           (unsigned long long)TotalPages,
+           (unsigned long long)TotalPages << (PF_TRACE_PAGE_SHIFT - 10));
+
+    printf("    # Type   Runs    Pages  Name\n");
+    for (i = 0; i < Header->FileCount; i++)
+    {
+        Pages = 0;
+        for (j = 0; j < Files[i].RunCount; j++)
+            Pages += Runs[Files[i].FirstRun + j].PageCount;
+
+        printf("%5lu %-5s %5lu %8llu  ",
+               (unsigned long)i,
+               (Files[i].Flags & PF_TRACE_FILE_IMAGE) ? "image" : "data",
+               (unsigned long)Files[i].RunCount,
+               (unsigned long long)Pages);
+        if (Files[i].NameLength)
+            PrintName((const WCHAR *)(Names + Files[i].NameOffset), Files[i].NameLength / sizeof(WCHAR));
+        else
+            printf("<unnamed>");
+        printf("\n");
+
+        if (!ListRuns)
+            continue;
+
+        for (j = 0; j < Files[i].RunCount; j++)
+        {
+            const PF_TRACE_RUN *Run = &Runs[Files[i].FirstRun + j];
+
+            printf("                          0x%08lx - 0x%08lx  %lu pages\n",
+                   (unsigned long)Run->Page,
+                   (unsigned long)(Run->Page + Run->PageCount - 1),
+                   (unsigned long)Run->PageCount);
+        }
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    PF_TRACE_FILE_HEADER *Header;
+    const char *FileName = NULL;
+    int ListRuns = 0;
+    long Size;
+    FILE *File;
+    int i, Ret;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-r"))
+            ListRuns = 1;
+        else if (!FileName)
+            FileName = argv[i];
+        else
+            break;
+    }
+
+    if (!FileName || i != argc)
+    {
+        Usage();
+        return -1;
+    }
+
+    File = fopen(FileName, "rb");
+    if (!File)
+    {
+        fprintf(stderr, "Cannot open %s\n", FileName);
+        return -1;
+    }
+
+    fseek(File, 0, SEEK_END);
+    Size = ftell(File);
+    fseek(File, 0, SEEK_SET);
+    if (Size <= 0 || Size > PF_TRACE_MAXIMUM_SIZE)
+    {
+        fprintf(stderr, "Invalid trace size %ld\n", Size);
+        fclose(File);
+        return -1;
+    }
+
+    Header = malloc(Size);
+    if (!Header)
+    {
+        fprintf(stderr, "Out of memory\n");
+        fclose(File);
+        return -1;
+    }
+
+    if (fread(Header, 1, Size, File) != (size_t)Size)
+    {
+        fprintf(stderr, "Cannot read %s\n", FileName);
+        Ret = -1;
+    }
+    else if (!ValidateTrace(Header, Size))
+    {
+        Ret = -1;
+    }
+    else
+    {
+        DumpTrace(Header, ListRuns);
+        Ret = 0;
+    }
+
+    free(Header);
+    fclose(File);
+    return Ret;
+}
@@ -134,6 +134,7 @@ typedef struct _SHARED_FACE {
   PSHARED_MEM   Memory;
   SHARED_FACE_CACHE EnglishUS;
   SHARED_FACE_CACHE UserLanguage;
+  LIST_ENTRY    GlyphCacheListHead; /* FONT_CACHE_ENTRY::FaceEntry */
 } SHARED_FACE, *PSHARED_FACE;
 
 typedef struct _FONTGDI {
@@ -1194,22 +1194,6 @@ NtGdiPolyTextOutW(
     return FALSE;
 }
 
-/*
- * @unimplemented
- */
-NTSTATUS
-APIENTRY
-NtGdiGetStats(
-    IN HANDLE hProcess,
-    IN INT iIndex,
-    IN INT iPidType,
-    OUT PVOID pResults,
-    IN UINT cjResultSize)
-{
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
-}
-
 /*
  * @unimplemented
  */
@@ -54,8 +54,11 @@ typedef struct _FONT_CACHE_HASHED
 
 typedef struct _FONT_CACHE_ENTRY
 {
-    LIST_ENTRY ListEntry;
+    LIST_ENTRY ListEntry;   /* Global LRU list, most recently used first */
+    LIST_ENTRY HashEntry;   /* Hash bucket chain */
+    LIST_ENTRY FaceEntry;   /* SHARED_FACE::GlyphCacheListHead */
     FT_BitmapGlyph BitmapGlyph;
+    SIZE_T cbCharge;        /* Bytes charged against the cache budget */
     DWORD dwHash;
     FONT_CACHE_HASHED Hashed;
 } FONT_CACHE_ENTRY, *PFONT_CACHE_ENTRY;
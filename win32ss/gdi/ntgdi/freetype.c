@@ -346,10 +346,27 @@ do { \
     ExReleaseFastMutexUnsafeAndLeaveCriticalRegion(g_FreeTypeLock); \
 } while(0)
 
-#define MAX_FONT_CACHE 256
+/*
+ * The glyph bitmap cache is bounded by the memory it holds rather than by
+ * the number of glyphs, so that large CJK sizes and small Latin text both
+ * get a sensible working set. Lookups go through a hash table; the global
+ * list keeps LRU order for eviction and each SHARED_FACE lists its own
+ * entries so they can be dropped when the face goes away.
+ */
+#define FONT_CACHE_HASH_BITS    10
+#define FONT_CACHE_HASH_SIZE    (1 << FONT_CACHE_HASH_BITS)
+#define MAX_FONT_CACHE_BYTES    (2 * 1024 * 1024)
 
 static RTL_STATIC_LIST_HEAD(g_FontCacheListHead);
-static UINT g_FontCacheNumEntries;
+static LIST_ENTRY g_FontCacheHashTable[FONT_CACHE_HASH_SIZE];
+static FONT_CACHE_STATISTICS g_FontCacheStats;
+
+static inline PLIST_ENTRY
+IntGetFontCacheBucket(DWORD dwHash)
+{
+    dwHash ^= (dwHash >> FONT_CACHE_HASH_BITS) ^ (dwHash >> (2 * FONT_CACHE_HASH_BITS));
+    return &g_FontCacheHashTable[dwHash & (FONT_CACHE_HASH_SIZE - 1)];
+}
 
 static PWCHAR g_ElfScripts[32] =   /* These are in the order of the fsCsb[0] bits */
 {
@@ -509,6 +526,11 @@ SharedFace_Create(FT_Face Face, PSHARED_MEM Memory)
         Ptr->Memory = Memory;
         SharedFaceCache_Init(&Ptr->EnglishUS);
         SharedFaceCache_Init(&Ptr->UserLanguage);
+        InitializeListHead(&Ptr->GlyphCacheListHead);
+
+        /* Let the glyph cache find its way back from the FT_Face */
+        Face->generic.data = Ptr;
+        Face->generic.finalizer = NULL;
 
         SharedMem_AddRef(Memory);
         DPRINT("Creating SharedFace for %s\n", Face->family_name ? Face->family_name : "<NULL>");
@@ -547,30 +569,32 @@ RemoveCachedEntry(PFONT_CACHE_ENTRY Entry)
 
     FT_Done_Glyph((FT_Glyph)Entry->BitmapGlyph);
     RemoveEntryList(&Entry->ListEntry);
+    RemoveEntryList(&Entry->HashEntry);
+    RemoveEntryList(&Entry->FaceEntry);
+
+    ASSERT(g_FontCacheStats.NumEntries > 0);
+    ASSERT(g_FontCacheStats.CurrentBytes >= Entry->cbCharge);
+    g_FontCacheStats.NumEntries--;
+    g_FontCacheStats.CurrentBytes -= Entry->cbCharge;
+
     ExFreePoolWithTag(Entry, TAG_FONT);
-    g_FontCacheNumEntries--;
-    ASSERT(g_FontCacheNumEntries <= MAX_FONT_CACHE);
 }
 
 static void
-RemoveCacheEntries(FT_Face Face)
+RemoveCacheEntries(PSHARED_FACE SharedFace)
 {
-    PLIST_ENTRY CurrentEntry, NextEntry;
+    PLIST_ENTRY CurrentEntry;
     PFONT_CACHE_ENTRY FontEntry;
 
     ASSERT_FREETYPE_LOCK_HELD();
 
-    for (CurrentEntry = g_FontCacheListHead.Flink;
-         CurrentEntry != &g_FontCacheListHead;
-         CurrentEntry = NextEntry)
+    while (!IsListEmpty(&SharedFace->GlyphCacheListHead))
     {
-        FontEntry = CONTAINING_RECORD(CurrentEntry, FONT_CACHE_ENTRY, ListEntry);
-        NextEntry = CurrentEntry->Flink;
-
-        if (FontEntry->Hashed.Face == Face)
-        {
-            RemoveCachedEntry(FontEntry);
-        }
+        CurrentEntry = SharedFace->GlyphCacheListHead.Flink;
+        FontEntry = CONTAINING_RECORD(CurrentEntry, FONT_CACHE_ENTRY, FaceEntry);
+        ASSERT(FontEntry->Hashed.Face == SharedFace->Face);
+        RemoveCachedEntry(FontEntry);
+        g_FontCacheStats.FaceEvictions++;
     }
 }
 
@@ -616,7 +640,7 @@ SharedFace_Release(PSHARED_FACE Ptr, BOOL bDoLock)
     if (Ptr->RefCount == 0)
     {
         DPRINT("Releasing SharedFace for %s\n", Ptr->Face->family_name ? Ptr->Face->family_name : "<NULL>");
-        RemoveCacheEntries(Ptr->Face);
+        RemoveCacheEntries(Ptr);
         FT_Done_Face(Ptr->Face);
         SharedMem_Release(Ptr->Memory);
         SharedFaceCache_Release(&Ptr->EnglishUS);
@@ -997,8 +1021,14 @@ BOOL FASTCALL
 InitFontSupport(VOID)
 {
     ULONG ulError;
+    UINT i;
 
-    g_FontCacheNumEntries = 0;
+    for (i = 0; i < FONT_CACHE_HASH_SIZE; ++i)
+    {
+        InitializeListHead(&g_FontCacheHashTable[i]);
+    }
+    RtlZeroMemory(&g_FontCacheStats, sizeof(g_FontCacheStats));
+    g_FontCacheStats.MaximumBytes = MAX_FONT_CACHE_BYTES;
 
     g_FreeTypeLock = ExAllocatePoolWithTag(NonPagedPool, sizeof(FAST_MUTEX), TAG_INTERNAL_SYNC);
     if (g_FreeTypeLock == NULL)
@@ -1053,7 +1083,7 @@ FreeFontSupport(VOID)
     pHead = &g_FontCacheListHead;
     while (!IsListEmpty(pHead))
     {
-        pEntry = RemoveHeadList(pHead);
+        pEntry = pHead->Flink;
         pFontCache = CONTAINING_RECORD(pEntry, FONT_CACHE_ENTRY, ListEntry);
         RemoveCachedEntry(pFontCache);
     }
@@ -3779,17 +3809,18 @@ IntGetHash(IN LPCVOID pv, IN DWORD cdw)
 static FT_BitmapGlyph
 IntFindGlyphCache(IN const FONT_CACHE_ENTRY *pCache)
 {
-    PLIST_ENTRY CurrentEntry;
+    PLIST_ENTRY CurrentEntry, BucketHead;
     PFONT_CACHE_ENTRY FontEntry;
     DWORD dwHash = pCache->dwHash;
 
     ASSERT_FREETYPE_LOCK_HELD();
 
-    for (CurrentEntry = g_FontCacheListHead.Flink;
-         CurrentEntry != &g_FontCacheListHead;
+    BucketHead = IntGetFontCacheBucket(dwHash);
+    for (CurrentEntry = BucketHead->Flink;
+         CurrentEntry != BucketHead;
          CurrentEntry = CurrentEntry->Flink)
     {
-        FontEntry = CONTAINING_RECORD(CurrentEntry, FONT_CACHE_ENTRY, ListEntry);
+        FontEntry = CONTAINING_RECORD(CurrentEntry, FONT_CACHE_ENTRY, HashEntry);
         if (FontEntry->dwHash == dwHash &&
             FontEntry->Hashed.GlyphIndex == pCache->Hashed.GlyphIndex &&
             FontEntry->Hashed.Face == pCache->Hashed.Face &&
@@ -3803,13 +3834,19 @@ IntFindGlyphCache(IN const FONT_CACHE_ENTRY *pCache)
         }
     }
 
-    if (CurrentEntry == &g_FontCacheListHead)
+    if (CurrentEntry == BucketHead)
     {
+        g_FontCacheStats.Misses++;
         return NULL;
     }
 
-    RemoveEntryList(CurrentEntry);
-    InsertHeadList(&g_FontCacheListHead, CurrentEntry);
+    g_FontCacheStats.Hits++;
+
+    /* Move to the front of both lists, the bucket chain is searched in MRU order too */
+    RemoveEntryList(&FontEntry->ListEntry);
+    InsertHeadList(&g_FontCacheListHead, &FontEntry->ListEntry);
+    RemoveEntryList(&FontEntry->HashEntry);
+    InsertHeadList(BucketHead, &FontEntry->HashEntry);
     return FontEntry->BitmapGlyph;
 }
 
@@ -3823,6 +3860,7 @@ IntGetBitmapGlyphWithCache(
     PFONT_CACHE_ENTRY NewEntry;
     FT_Bitmap AlignedBitmap;
     FT_BitmapGlyph BitmapGlyph;
+    PSHARED_FACE SharedFace;
 
     ASSERT_FREETYPE_LOCK_HELD();
 
@@ -3867,17 +3905,80 @@ IntGetBitmapGlyphWithCache(
     NewEntry->BitmapGlyph = BitmapGlyph;
     NewEntry->dwHash = Cache->dwHash;
     NewEntry->Hashed = Cache->Hashed;
+    NewEntry->cbCharge = sizeof(FONT_CACHE_ENTRY) + sizeof(FT_BitmapGlyphRec) +
+                         (SIZE_T)abs(BitmapGlyph->bitmap.pitch) * BitmapGlyph->bitmap.rows;
 
-    InsertHeadList(&g_FontCacheListHead, &NewEntry->ListEntry);
-    if (++g_FontCacheNumEntries > MAX_FONT_CACHE)
+    SharedFace = Cache->Hashed.Face->generic.data;
+    ASSERT(SharedFace != NULL && SharedFace->Face == Cache->Hashed.Face);
+
+    /* Make room first, the new entry must not evict itself */
+    while (!IsListEmpty(&g_FontCacheListHead) &&
+           g_FontCacheStats.CurrentBytes + NewEntry->cbCharge > g_FontCacheStats.MaximumBytes)
     {
-        NewEntry = CONTAINING_RECORD(g_FontCacheListHead.Blink, FONT_CACHE_ENTRY, ListEntry);
-        RemoveCachedEntry(NewEntry);
+        RemoveCachedEntry(CONTAINING_RECORD(g_FontCacheListHead.Blink,
+                                            FONT_CACHE_ENTRY, ListEntry));
+        g_FontCacheStats.Evictions++;
     }
 
+    InsertHeadList(&g_FontCacheListHead, &NewEntry->ListEntry);
+    InsertHeadList(IntGetFontCacheBucket(NewEntry->dwHash), &NewEntry->HashEntry);
+    InsertHeadList(&SharedFace->GlyphCacheListHead, &NewEntry->FaceEntry);
+    g_FontCacheStats.NumEntries++;
+    g_FontCacheStats.CurrentBytes += NewEntry->cbCharge;
+
     return BitmapGlyph;
 }
 
+/* No locking: this is also called from the kernel debugger, the counters are informational */
+VOID FASTCALL
+IntGetGlyphCacheStatistics(PFONT_CACHE_STATISTICS Statistics)
+{
+    *Statistics = g_FontCacheStats;
+}
+
+/*
+ * @implemented
+ * Only the glyph cache counters (GS_GLYPH_CACHE) are supported.
+ */
+NTSTATUS
+APIENTRY
+NtGdiGetStats(
+    IN HANDLE hProcess,
+    IN INT iIndex,
+    IN INT iPidType,
+    OUT PVOID pResults,
+    IN UINT cjResultSize)
+{
+    FONT_CACHE_STATISTICS Statistics;
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    if (iIndex != GS_GLYPH_CACHE)
+    {
+        UNIMPLEMENTED;
+        return STATUS_NOT_IMPLEMENTED;
+    }
+
+    if (cjResultSize < sizeof(Statistics))
+        return STATUS_BUFFER_TOO_SMALL;
+
+    IntLockFreeType();
+    IntGetGlyphCacheStatistics(&Statistics);
+    IntUnLockFreeType();
+
+    _SEH2_TRY
+    {
+        ProbeForWrite(pResults, sizeof(Statistics), 1);
+        RtlCopyMemory(pResults, &Statistics, sizeof(Statistics));
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        Status = _SEH2_GetExceptionCode();
+    }
+    _SEH2_END;
+
+    return Status;
+}
+
 
 static unsigned int get_native_glyph_outline(FT_Outline *outline, unsigned int buflen, char *buf)
 {
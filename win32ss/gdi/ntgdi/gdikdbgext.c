@@ -69,6 +69,7 @@ KdbCommand_Gdi_help(VOID)
              "- handle <handle> - Displays information about a handle\n"
              "- entry <entry> - Displays an ENTRY, <entry> can be a pointer or index\n"
              "- baseobject <object> - Displays a BASEOBJECT\n"
+             "- glyphcache - Displays glyph bitmap cache statistics\n"
 #if DBG_ENABLE_EVENT_LOGGING
              "- eventlist <object> - Displays the eventlist for an object\n"
 #endif
@@ -278,6 +279,22 @@ KdbCommand_Gdi_baseobject(char *argv)
 {
 }
 
+static
+VOID
+KdbCommand_Gdi_glyphcache(VOID)
+{
+    FONT_CACHE_STATISTICS Stats;
+
+    IntGetGlyphCacheStatistics(&Stats);
+
+    DbgPrint("Entries:         %lu\n", Stats.NumEntries);
+    DbgPrint("Bytes:           %Iu / %Iu\n", Stats.CurrentBytes, Stats.MaximumBytes);
+    DbgPrint("Hits:            %I64u\n", Stats.Hits);
+    DbgPrint("Misses:          %I64u\n", Stats.Misses);
+    DbgPrint("Evictions:       %I64u\n", Stats.Evictions);
+    DbgPrint("Face evictions:  %I64u\n", Stats.FaceEvictions);
+}
+
 #if DBG_ENABLE_EVENT_LOGGING
 static
 VOID
@@ -347,6 +364,10 @@ DbgGdiKdbgCliCallback(
     {
         KdbCommand_Gdi_baseobject(argv[1]);
     }
+    else if (_stricmp(argv[0], "!gdi.glyphcache") == 0)
+    {
+        KdbCommand_Gdi_glyphcache();
+    }
 #if DBG_ENABLE_EVENT_LOGGING
     else if (_stricmp(argv[0], "!gdi.eventlist") == 0)
     {
@@ -1,6 +1,7 @@
 #pragma once
 
 #define TAG_FINF        'FNIF'
+
 //
 // EXSTROBJ flags.
 //
@@ -111,6 +112,7 @@ NTSTATUS FASTCALL TextIntCreateFontIndirect(CONST LPLOGFONTW lf, HFONT *NewFont)
 BYTE FASTCALL IntCharSetFromCodePage(UINT uCodePage);
 BOOL FASTCALL InitFontSupport(VOID);
 VOID FASTCALL FreeFontSupport(VOID);
+VOID FASTCALL IntGetGlyphCacheStatistics(PFONT_CACHE_STATISTICS Statistics);
 BOOL FASTCALL IntIsFontRenderingEnabled(VOID);
 BOOL FASTCALL IntIsFontRenderingEnabled(VOID);
 VOID FASTCALL IntEnableFontRendering(BOOL Enable);
@@ -355,6 +355,20 @@ typedef struct _GDIHANDLECACHE
     HANDLE          Handle[CACHE_BRUSH_ENTRIES+CACHE_PEN_ENTRIES+CACHE_REGION_ENTRIES+CACHE_LFONT_ENTRIES];
 } GDIHANDLECACHE, *PGDIHANDLECACHE;
 
+/* NtGdiGetStats index for the glyph bitmap cache counters (ReactOS specific) */
+#define GS_GLYPH_CACHE              0x100
+
+typedef struct _FONT_CACHE_STATISTICS
+{
+    ULONG NumEntries;
+    SIZE_T CurrentBytes;
+    SIZE_T MaximumBytes;
+    ULONGLONG Hits;
+    ULONGLONG Misses;
+    ULONGLONG Evictions;        // Dropped to stay within MaximumBytes
+    ULONGLONG FaceEvictions;    // Dropped because their face was released
+} FONT_CACHE_STATISTICS, *PFONT_CACHE_STATISTICS;
+
 /* Font Structures */
 typedef struct _TMDIFF
 {